@@ -32,6 +32,21 @@
 	(G_TYPE_INSTANCE_GET_PRIVATE \
 	((obj), E_TYPE_ADDRESSBOOK_MODEL, EAddressbookModelPrivate))
 
+/* Books with at least this many matching contacts are browsed
+ * through an EBookClientCursor, instead of loading all of them. */
+#define CURSOR_MIN_CONTACTS 5000
+
+/* Contacts fetched at once through the cursor, and how many such
+ * windows are kept around the visible rows, including prefetched. */
+#define CURSOR_WINDOW_SIZE 100
+#define CURSOR_N_WINDOWS 4
+
+typedef struct _CursorWindow {
+	gint start;		/* row of the first contact; -1 when unused */
+	GPtrArray *contacts;	/* EContact * */
+	guint64 last_used;
+} CursorWindow;
+
 struct _EAddressbookModelPrivate {
 	EClientCache *client_cache;
 	gulong client_notify_readonly_handler_id;
@@ -43,6 +58,20 @@ struct _EAddressbookModelPrivate {
 
 	/* Query Results */
 	GPtrArray *contacts;
+	GHashTable *contacts_index; /* UID ~> index into contacts */
+
+	/* Virtual mode, used instead of the client view for large results */
+	EBookClientCursor *cursor;
+	GCancellable *cursor_cancellable;
+	GMutex cursor_lock; /* serializes positioning of the cursor */
+	gulong cursor_refresh_id;
+	gint cursor_total;
+	guint cursor_generation;
+	guint64 cursor_use_counter;
+	CursorWindow cursor_windows[CURSOR_N_WINDOWS];
+	GQueue cursor_requests; /* window starts to fetch */
+	gboolean cursor_fetching;
+	EContact *cursor_placeholder;
 
 	/* Signal Handler IDs */
 	gulong create_contact_id;
@@ -89,10 +118,371 @@ free_data (EAddressbookModel *model)
 	GPtrArray *array;
 
 	array = model->priv->contacts;
+	g_hash_table_remove_all (model->priv->contacts_index);
 	g_ptr_array_foreach (array, (GFunc) g_object_unref, NULL);
 	g_ptr_array_set_size (array, 0);
 }
 
+static void
+contacts_index_add (EAddressbookModel *model,
+                    EContact *contact,
+                    gint index)
+{
+	const gchar *uid;
+
+	/* The key is owned by the contact */
+	uid = e_contact_get_const (contact, E_CONTACT_UID);
+	if (uid)
+		g_hash_table_replace (
+			model->priv->contacts_index,
+			(gpointer) uid, GINT_TO_POINTER (index));
+}
+
+static gint
+contacts_index_lookup (EAddressbookModel *model,
+                       const gchar *uid)
+{
+	gpointer value;
+
+	if (!uid || !g_hash_table_lookup_extended (
+		model->priv->contacts_index, uid, NULL, &value))
+		return -1;
+
+	return GPOINTER_TO_INT (value);
+}
+
+typedef struct _CursorFetchData {
+	EBookClientCursor *cursor;
+	gint start;		/* first row, or an alphabetic index */
+	guint generation;
+} CursorFetchData;
+
+static void
+cursor_fetch_data_free (gpointer ptr)
+{
+	CursorFetchData *fd = ptr;
+
+	if (fd) {
+		g_clear_object (&fd->cursor);
+		g_free (fd);
+	}
+}
+
+static void
+cursor_windows_clear (EAddressbookModel *model)
+{
+	gint ii;
+
+	for (ii = 0; ii < CURSOR_N_WINDOWS; ii++) {
+		CursorWindow *window = &model->priv->cursor_windows[ii];
+
+		if (window->contacts)
+			g_ptr_array_unref (window->contacts);
+
+		window->start = -1;
+		window->contacts = NULL;
+		window->last_used = 0;
+	}
+
+	g_queue_clear (&model->priv->cursor_requests);
+
+	/* Results of a running fetch are stale now */
+	model->priv->cursor_generation++;
+	model->priv->cursor_fetching = FALSE;
+}
+
+static void
+cursor_clear (EAddressbookModel *model)
+{
+	if (model->priv->cursor_cancellable) {
+		g_cancellable_cancel (model->priv->cursor_cancellable);
+		g_clear_object (&model->priv->cursor_cancellable);
+	}
+
+	if (model->priv->cursor) {
+		g_signal_handler_disconnect (
+			model->priv->cursor,
+			model->priv->cursor_refresh_id);
+		model->priv->cursor_refresh_id = 0;
+
+		g_clear_object (&model->priv->cursor);
+	}
+
+	model->priv->cursor_total = 0;
+
+	cursor_windows_clear (model);
+}
+
+/* Can be called from any thread */
+static GPtrArray *
+cursor_fetch_window_sync (EAddressbookModel *model,
+                          EBookClientCursor *cursor,
+                          gint start,
+                          GCancellable *cancellable,
+                          GError **error)
+{
+	EBookCursorOrigin origin = E_BOOK_CURSOR_ORIGIN_BEGIN;
+	GPtrArray *contacts = NULL;
+	GSList *results = NULL, *link;
+	gint n_fetched = 0;
+
+	/* The cursor is positioned and then read, which
+	 * cannot interleave with another fetch. */
+	g_mutex_lock (&model->priv->cursor_lock);
+
+	if (start > 0) {
+		n_fetched = e_book_client_cursor_step_sync (
+			cursor, E_BOOK_CURSOR_STEP_MOVE,
+			E_BOOK_CURSOR_ORIGIN_BEGIN, start,
+			NULL, cancellable, error);
+		origin = E_BOOK_CURSOR_ORIGIN_CURRENT;
+	}
+
+	if (n_fetched >= 0)
+		n_fetched = e_book_client_cursor_step_sync (
+			cursor, E_BOOK_CURSOR_STEP_FETCH, origin,
+			CURSOR_WINDOW_SIZE, &results, cancellable, error);
+
+	g_mutex_unlock (&model->priv->cursor_lock);
+
+	if (n_fetched >= 0) {
+		contacts = g_ptr_array_new_with_free_func (g_object_unref);
+
+		/* Takes ownership of the contacts */
+		for (link = results; link; link = g_slist_next (link))
+			g_ptr_array_add (contacts, link->data);
+
+		g_slist_free (results);
+	}
+
+	return contacts;
+}
+
+static void
+cursor_fetch_thread (GTask *task,
+                     gpointer source_object,
+                     gpointer task_data,
+                     GCancellable *cancellable)
+{
+	CursorFetchData *fd = task_data;
+	GPtrArray *contacts;
+	GError *local_error = NULL;
+
+	contacts = cursor_fetch_window_sync (
+		E_ADDRESSBOOK_MODEL (source_object), fd->cursor,
+		fd->start, cancellable, &local_error);
+
+	if (contacts)
+		g_task_return_pointer (
+			task, contacts, (GDestroyNotify) g_ptr_array_unref);
+	else
+		g_task_return_error (task, local_error);
+}
+
+static CursorWindow *
+cursor_lookup_window (EAddressbookModel *model,
+                      gint start)
+{
+	gint ii;
+
+	for (ii = 0; ii < CURSOR_N_WINDOWS; ii++) {
+		CursorWindow *window = &model->priv->cursor_windows[ii];
+
+		if (window->start == start && window->contacts)
+			return window;
+	}
+
+	return NULL;
+}
+
+/* Replaces the least recently used window */
+static void
+cursor_store_window (EAddressbookModel *model,
+                     gint start,
+                     GPtrArray *contacts)
+{
+	CursorWindow *window;
+	gint ii;
+
+	window = cursor_lookup_window (model, start);
+
+	if (!window) {
+		window = &model->priv->cursor_windows[0];
+
+		for (ii = 1; ii < CURSOR_N_WINDOWS; ii++) {
+			CursorWindow *candidate = &model->priv->cursor_windows[ii];
+
+			if (candidate->last_used < window->last_used)
+				window = candidate;
+		}
+	}
+
+	if (window->contacts)
+		g_ptr_array_unref (window->contacts);
+
+	window->start = start;
+	window->contacts = g_ptr_array_ref (contacts);
+	window->last_used = ++model->priv->cursor_use_counter;
+}
+
+static void cursor_fetch_next (EAddressbookModel *model);
+
+static void
+cursor_fetch_done_cb (GObject *source_object,
+                      GAsyncResult *result,
+                      gpointer user_data)
+{
+	EAddressbookModel *model = E_ADDRESSBOOK_MODEL (source_object);
+	CursorFetchData *fd;
+	GPtrArray *contacts;
+	GError *local_error = NULL;
+
+	fd = g_task_get_task_data (G_TASK (result));
+	contacts = g_task_propagate_pointer (G_TASK (result), &local_error);
+
+	/* The cursor results changed meanwhile, drop these. */
+	if (fd->generation != model->priv->cursor_generation) {
+		if (contacts)
+			g_ptr_array_unref (contacts);
+		g_clear_error (&local_error);
+		return;
+	}
+
+	model->priv->cursor_fetching = FALSE;
+
+	if (contacts) {
+		guint ii;
+
+		cursor_store_window (model, fd->start, contacts);
+
+		/* The rows showed placeholders until now */
+		for (ii = 0; ii < contacts->len; ii++)
+			g_signal_emit (
+				model, signals[CONTACT_CHANGED], 0,
+				fd->start + ii);
+
+		g_ptr_array_unref (contacts);
+
+	} else if (!g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		g_warning (
+			"%s: Failed to fetch contacts: %s", G_STRFUNC,
+			local_error ? local_error->message : "Unknown error");
+	}
+
+	g_clear_error (&local_error);
+
+	cursor_fetch_next (model);
+}
+
+static void
+cursor_fetch_next (EAddressbookModel *model)
+{
+	GQueue *requests = &model->priv->cursor_requests;
+
+	while (!model->priv->cursor_fetching && !g_queue_is_empty (requests)) {
+		CursorFetchData *fd;
+		GTask *task;
+		gint start;
+
+		start = GPOINTER_TO_INT (g_queue_pop_head (requests));
+
+		if (cursor_lookup_window (model, start))
+			continue;
+
+		fd = g_new0 (CursorFetchData, 1);
+		fd->cursor = g_object_ref (model->priv->cursor);
+		fd->start = start;
+		fd->generation = model->priv->cursor_generation;
+
+		task = g_task_new (
+			model, model->priv->cursor_cancellable,
+			cursor_fetch_done_cb, NULL);
+		g_task_set_source_tag (task, cursor_fetch_next);
+		g_task_set_task_data (task, fd, cursor_fetch_data_free);
+		g_task_run_in_thread (task, cursor_fetch_thread);
+		g_object_unref (task);
+
+		model->priv->cursor_fetching = TRUE;
+	}
+}
+
+/* Schedules fetch of the window starting at @start. The @urgent
+ * windows are for the shown rows, the others are prefetched. */
+static void
+cursor_request_window (EAddressbookModel *model,
+                       gint start,
+                       gboolean urgent)
+{
+	GQueue *requests = &model->priv->cursor_requests;
+
+	if (start < 0 || start >= model->priv->cursor_total)
+		return;
+
+	if (cursor_lookup_window (model, start))
+		return;
+
+	if (g_queue_find (requests, GINT_TO_POINTER (start))) {
+		if (!urgent)
+			return;
+
+		g_queue_remove (requests, GINT_TO_POINTER (start));
+	}
+
+	if (urgent)
+		g_queue_push_head (requests, GINT_TO_POINTER (start));
+	else
+		g_queue_push_tail (requests, GINT_TO_POINTER (start));
+
+	/* More windows than kept would only evict each other */
+	while (g_queue_get_length (requests) > CURSOR_N_WINDOWS)
+		g_queue_pop_tail (requests);
+
+	cursor_fetch_next (model);
+}
+
+static EContact *
+cursor_peek_contact (EAddressbookModel *model,
+                     gint row)
+{
+	CursorWindow *window;
+	gint start;
+
+	start = row - (row % CURSOR_WINDOW_SIZE);
+
+	window = cursor_lookup_window (model, start);
+	if (!window || row - start >= window->contacts->len)
+		return NULL;
+
+	window->last_used = ++model->priv->cursor_use_counter;
+
+	return window->contacts->pdata[row - start];
+}
+
+static EContact *
+cursor_contact_at (EAddressbookModel *model,
+                   gint row)
+{
+	EContact *contact;
+	gint start, offset;
+
+	start = row - (row % CURSOR_WINDOW_SIZE);
+	offset = row - start;
+
+	contact = cursor_peek_contact (model, row);
+	if (!contact) {
+		cursor_request_window (model, start, TRUE);
+		return model->priv->cursor_placeholder;
+	}
+
+	/* Prefetch the neighbour window the user moves to */
+	if (offset >= CURSOR_WINDOW_SIZE * 3 / 4)
+		cursor_request_window (model, start + CURSOR_WINDOW_SIZE, FALSE);
+	else if (offset < CURSOR_WINDOW_SIZE / 4)
+		cursor_request_window (model, start - CURSOR_WINDOW_SIZE, FALSE);
+
+	return contact;
+}
+
 static void
 remove_book_view (EAddressbookModel *model)
 {
@@ -128,6 +518,8 @@ remove_book_view (EAddressbookModel *model)
 
 	model->priv->search_in_progress = FALSE;
 
+	cursor_clear (model);
+
 	if (model->priv->client_view) {
 		GError *error = NULL;
 
@@ -153,7 +545,7 @@ update_folder_bar_message (EAddressbookModel *model)
 	guint count;
 	gchar *message;
 
-	count = model->priv->contacts->len;
+	count = e_addressbook_model_contact_count (model);
 
 	switch (count) {
 	case 0:
@@ -187,6 +579,7 @@ view_create_contact_cb (EBookClientView *client_view,
 		EContact *contact = contact_list->data;
 
 		g_ptr_array_add (array, g_object_ref (contact));
+		contacts_index_add (model, contact, array->len - 1);
 		contact_list = contact_list->next;
 	}
 
@@ -209,53 +602,58 @@ view_remove_contact_cb (EBookClientView *client_view,
                         const GSList *ids,
                         EAddressbookModel *model)
 {
-	/* XXX we should keep a hash around instead of this O(n*m) loop */
 	const GSList *iter;
 	GArray *indices;
 	GPtrArray *array;
-	gint ii;
+	guint ii, jj;
 
 	array = model->priv->contacts;
 	indices = g_array_new (FALSE, FALSE, sizeof (gint));
 
 	for (iter = ids; iter != NULL; iter = iter->next) {
 		const gchar *target_uid = iter->data;
+		EContact *contact;
+		gint index;
 
-		for (ii = 0; ii < array->len; ii++) {
-			EContact *contact;
-			const gchar *uid;
-
-			contact = array->pdata[ii];
-			/* check if already removed */
-			if (!contact)
-				continue;
+		index = contacts_index_lookup (model, target_uid);
+		if (index < 0)
+			continue;
 
-			uid = e_contact_get_const (contact, E_CONTACT_UID);
-			g_return_if_fail (uid != NULL);
+		contact = array->pdata[index];
+		g_hash_table_remove (model->priv->contacts_index, target_uid);
+		g_object_unref (contact);
+		g_array_append_val (indices, index);
+		array->pdata[index] = NULL;
+	}
 
-			if (strcmp (uid, target_uid) == 0) {
-				g_object_unref (contact);
-				g_array_append_val (indices, ii);
-				array->pdata[ii] = NULL;
-				break;
-			}
-		}
+	if (indices->len == 0) {
+		g_array_free (indices, TRUE);
+		return;
 	}
 
-	/* Sort the 'indices' array in descending order, since
-	 * g_ptr_array_remove_index() shifts subsequent elements
-	 * down one position to fill the gap. */
-	g_array_sort (indices, sort_descending);
+	/* Close the holes in one pass, instead of moving
+	 * the tail of the array for each removed contact. */
+	for (ii = 0, jj = 0; ii < array->len; ii++) {
+		EContact *contact = array->pdata[ii];
 
-	for (ii = 0; ii < indices->len; ii++) {
-		gint index;
+		if (contact == NULL)
+			continue;
+
+		if (ii != jj) {
+			array->pdata[jj] = contact;
+			contacts_index_add (model, contact, jj);
+		}
 
-		index = g_array_index (indices, gint, ii);
-		g_ptr_array_remove_index (array, index);
+		jj++;
 	}
 
+	g_ptr_array_set_size (array, jj);
+
+	/* Listeners expect the indices in descending order. */
+	g_array_sort (indices, sort_descending);
+
 	g_signal_emit (model, signals[CONTACTS_REMOVED], 0, indices);
-	g_array_free (indices, FALSE);
+	g_array_free (indices, TRUE);
 
 	update_folder_bar_message (model);
 }
@@ -271,38 +669,28 @@ view_modify_contact_cb (EBookClientView *client_view,
 
 	while (contact_list != NULL) {
 		EContact *new_contact = contact_list->data;
+		EContact *old_contact;
 		const gchar *target_uid;
-		gint ii;
+		gint index;
 
 		target_uid = e_contact_get_const (new_contact, E_CONTACT_UID);
 		g_warn_if_fail (target_uid != NULL);
 
-		/* skip contacts without UID */
-		if (!target_uid) {
+		/* skip contacts without UID or not known */
+		index = contacts_index_lookup (model, target_uid);
+		if (index < 0) {
 			contact_list = contact_list->next;
 			continue;
 		}
 
-		for (ii = 0; ii < array->len; ii++) {
-			EContact *old_contact;
-			const gchar *uid;
-
-			old_contact = array->pdata[ii];
-			g_return_if_fail (old_contact != NULL);
+		old_contact = array->pdata[index];
+		array->pdata[index] = e_contact_duplicate (new_contact);
 
-			uid = e_contact_get_const (old_contact, E_CONTACT_UID);
-			g_return_if_fail (uid != NULL);
+		/* Re-key before the old contact, owning the key, is freed */
+		contacts_index_add (model, array->pdata[index], index);
+		g_object_unref (old_contact);
 
-			if (strcmp (uid, target_uid) != 0)
-				continue;
-
-			g_object_unref (old_contact);
-			array->pdata[ii] = e_contact_duplicate (new_contact);
-
-			g_signal_emit (
-				model, signals[CONTACT_CHANGED], 0, ii);
-			break;
-		}
+		g_signal_emit (model, signals[CONTACT_CHANGED], 0, index);
 
 		contact_list = contact_list->next;
 	}
@@ -412,6 +800,103 @@ client_view_ready_cb (GObject *source_object,
 	}
 }
 
+static void
+cursor_refresh_cb (EBookClientCursor *cursor,
+                   EAddressbookModel *model)
+{
+	/* The contacts changed; the rows are fetched again when shown */
+	cursor_windows_clear (model);
+	model->priv->cursor_total = e_book_client_cursor_get_total (cursor);
+
+	g_signal_emit (model, signals[MODEL_CHANGED], 0);
+	update_folder_bar_message (model);
+}
+
+static void
+client_cursor_ready_cb (GObject *source_object,
+                        GAsyncResult *result,
+                        gpointer user_data)
+{
+	EBookClient *book_client = E_BOOK_CLIENT (source_object);
+	EBookClientCursor *cursor = NULL;
+	GCancellable *cancellable = user_data;
+	EAddressbookModel *model;
+	GError *error = NULL;
+
+	e_book_client_get_cursor_finish (
+		book_client, result, &cursor, &error);
+
+	model = g_object_get_data (G_OBJECT (cancellable), "e-addressbook-model");
+
+	/* Superseded by another query or client */
+	if (g_cancellable_is_cancelled (cancellable)) {
+		g_clear_object (&cursor);
+		g_clear_error (&error);
+		g_object_unref (cancellable);
+		return;
+	}
+
+	/* Cursors are not supported by every backend, and small
+	 * results are better loaded at once, with live updates. */
+	if (!cursor || e_book_client_cursor_get_total (cursor) < CURSOR_MIN_CONTACTS) {
+		g_clear_object (&cursor);
+		g_clear_error (&error);
+
+		g_clear_object (&model->priv->cursor_cancellable);
+
+		if (model->priv->book_client == book_client && model->priv->query_str)
+			e_book_client_get_view (
+				book_client, model->priv->query_str,
+				NULL, client_view_ready_cb, model);
+
+		g_object_unref (cancellable);
+		return;
+	}
+
+	remove_book_view (model);
+	free_data (model);
+
+	model->priv->cursor = cursor;
+	model->priv->cursor_total = e_book_client_cursor_get_total (cursor);
+	model->priv->cursor_cancellable = g_cancellable_new ();
+	model->priv->cursor_refresh_id = g_signal_connect (
+		cursor, "refresh",
+		G_CALLBACK (cursor_refresh_cb), model);
+
+	/* Nothing is loaded upfront, the search is done already */
+	g_signal_emit (model, signals[MODEL_CHANGED], 0);
+	g_signal_emit (model, signals[SEARCH_STARTED], 0);
+	g_signal_emit (model, signals[SEARCH_RESULT], 0, NULL);
+	g_signal_emit (model, signals[STOP_STATE_CHANGED], 0);
+	update_folder_bar_message (model);
+
+	g_object_unref (cancellable);
+}
+
+static void
+addressbook_model_get_contacts (EAddressbookModel *model)
+{
+	EContactField sort_fields[] = { E_CONTACT_FILE_AS };
+	EBookCursorSortType sort_types[] = { E_BOOK_CURSOR_SORT_ASCENDING };
+
+	/* Try a cursor first; client_cursor_ready_cb() falls
+	 * back to a client view when the cursor is not used. */
+	model->priv->cursor_cancellable = g_cancellable_new ();
+
+	/* Not a reference; the model cancels the request
+	 * when it's disposed or when the query changes. */
+	g_object_set_data (
+		G_OBJECT (model->priv->cursor_cancellable),
+		"e-addressbook-model", model);
+
+	e_book_client_get_cursor (
+		model->priv->book_client, model->priv->query_str,
+		sort_fields, sort_types, G_N_ELEMENTS (sort_fields),
+		model->priv->cursor_cancellable,
+		client_cursor_ready_cb,
+		g_object_ref (model->priv->cursor_cancellable));
+}
+
 static gboolean
 addressbook_model_idle_cb (EAddressbookModel *model)
 {
@@ -424,9 +909,7 @@ addressbook_model_idle_cb (EAddressbookModel *model)
 			model->priv->first_get_view = FALSE;
 
 			if (e_client_check_capability (E_CLIENT (model->priv->book_client), "do-initial-query")) {
-				e_book_client_get_view (
-					model->priv->book_client, model->priv->query_str,
-					NULL, client_view_ready_cb, model);
+				addressbook_model_get_contacts (model);
 			} else {
 				free_data (model);
 
@@ -436,9 +919,7 @@ addressbook_model_idle_cb (EAddressbookModel *model)
 					model, signals[STOP_STATE_CHANGED], 0);
 			}
 		} else
-			e_book_client_get_view (
-				model->priv->book_client, model->priv->query_str,
-				NULL, client_view_ready_cb, model);
+			addressbook_model_get_contacts (model);
 
 	}
 
@@ -576,7 +1057,10 @@ addressbook_model_finalize (GObject *object)
 
 	priv = E_ADDRESSBOOK_MODEL_GET_PRIVATE (object);
 
+	g_hash_table_destroy (priv->contacts_index);
 	g_ptr_array_free (priv->contacts, TRUE);
+	g_object_unref (priv->cursor_placeholder);
+	g_mutex_clear (&priv->cursor_lock);
 
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (e_addressbook_model_parent_class)->finalize (object);
@@ -768,6 +1252,11 @@ e_addressbook_model_init (EAddressbookModel *model)
 {
 	model->priv = E_ADDRESSBOOK_MODEL_GET_PRIVATE (model);
 	model->priv->contacts = g_ptr_array_new ();
+	model->priv->contacts_index = g_hash_table_new (g_str_hash, g_str_equal);
+	model->priv->cursor_placeholder = e_contact_new ();
+	g_mutex_init (&model->priv->cursor_lock);
+	g_queue_init (&model->priv->cursor_requests);
+	cursor_windows_clear (model);
 	model->priv->first_get_view = TRUE;
 }
 
@@ -789,6 +1278,9 @@ e_addressbook_model_get_client_cache (EAddressbookModel *model)
 	return model->priv->client_cache;
 }
 
+/* Returns a copy of the contact at @row. In the virtual mode returns NULL
+ * for rows not fetched yet; use e_addressbook_model_dup_contacts() when
+ * all of the rows are needed. */
 EContact *
 e_addressbook_model_get_contact (EAddressbookModel *model,
                                  gint row)
@@ -797,6 +1289,21 @@ e_addressbook_model_get_contact (EAddressbookModel *model,
 
 	g_return_val_if_fail (E_IS_ADDRESSBOOK_MODEL (model), NULL);
 
+	if (model->priv->cursor) {
+		EContact *contact;
+
+		if (row < 0 || row >= model->priv->cursor_total)
+			return NULL;
+
+		/* Never blocks; the row is fetched in the background
+		 * and "contact_changed" is emitted for it afterwards. */
+		contact = cursor_contact_at (model, row);
+		if (contact == model->priv->cursor_placeholder)
+			return NULL;
+
+		return e_contact_duplicate (contact);
+	}
+
 	array = model->priv->contacts;
 
 	if (0 <= row && row < array->len)
@@ -846,18 +1353,351 @@ e_addressbook_model_contact_count (EAddressbookModel *model)
 {
 	g_return_val_if_fail (E_IS_ADDRESSBOOK_MODEL (model), 0);
 
+	if (model->priv->cursor)
+		return model->priv->cursor_total;
+
 	return model->priv->contacts->len;
 }
 
+/* In the virtual mode returns an empty placeholder contact for rows
+ * not fetched yet; the "contact_changed" signal is emitted for them
+ * once they are available. */
 EContact *
 e_addressbook_model_contact_at (EAddressbookModel *model,
                                 gint index)
 {
 	g_return_val_if_fail (E_IS_ADDRESSBOOK_MODEL (model), NULL);
 
+	if (model->priv->cursor)
+		return cursor_contact_at (model, index);
+
+	return model->priv->contacts->pdata[index];
+}
+
+/* Like e_addressbook_model_contact_at(), only returns NULL
+ * for rows not fetched yet, without fetching them. */
+EContact *
+e_addressbook_model_peek_contact_at (EAddressbookModel *model,
+                                     gint index)
+{
+	g_return_val_if_fail (E_IS_ADDRESSBOOK_MODEL (model), NULL);
+
+	if (model->priv->cursor)
+		return cursor_peek_contact (model, index);
+
+	if (index < 0 || index >= model->priv->contacts->len)
+		return NULL;
+
 	return model->priv->contacts->pdata[index];
 }
 
+/* Whether the contacts are read on demand through a cursor,
+ * instead of being all loaded, which is done for large books. */
+gboolean
+e_addressbook_model_get_virtual (EAddressbookModel *model)
+{
+	g_return_val_if_fail (E_IS_ADDRESSBOOK_MODEL (model), FALSE);
+
+	return model->priv->cursor != NULL;
+}
+
+typedef struct _DupContactsData {
+	EBookClientCursor *cursor;
+	GArray *rows;		/* gint, ascending */
+	GPtrArray *contacts;	/* EContact * of the rows, NULL when not fetched */
+} DupContactsData;
+
+static void
+dup_contacts_data_free (gpointer ptr)
+{
+	DupContactsData *dcd = ptr;
+
+	if (dcd) {
+		g_clear_object (&dcd->cursor);
+		g_array_unref (dcd->rows);
+		g_ptr_array_unref (dcd->contacts);
+		g_free (dcd);
+	}
+}
+
+static void
+dup_contacts_free_list (gpointer ptr)
+{
+	g_slist_free_full (ptr, g_object_unref);
+}
+
+static gint
+dup_contacts_compare_rows (gconstpointer ptr1,
+                           gconstpointer ptr2)
+{
+	gint row1 = *((const gint *) ptr1);
+	gint row2 = *((const gint *) ptr2);
+
+	return row1 - row2;
+}
+
+/* Transfers the contacts to the returned list, skipping missing rows */
+static GSList *
+dup_contacts_data_steal_list (DupContactsData *dcd)
+{
+	GSList *list = NULL;
+	guint ii;
+
+	for (ii = dcd->contacts->len; ii-- > 0;) {
+		if (dcd->contacts->pdata[ii])
+			list = g_slist_prepend (list, dcd->contacts->pdata[ii]);
+		dcd->contacts->pdata[ii] = NULL;
+	}
+
+	return list;
+}
+
+static void
+dup_contacts_thread (GTask *task,
+                     gpointer source_object,
+                     gpointer task_data,
+                     GCancellable *cancellable)
+{
+	EAddressbookModel *model = source_object;
+	DupContactsData *dcd = task_data;
+	GPtrArray *window = NULL;
+	gint window_start = -1;
+	guint ii;
+	GError *local_error = NULL;
+
+	for (ii = 0; ii < dcd->rows->len; ii++) {
+		gint row, start;
+
+		if (dcd->contacts->pdata[ii])
+			continue;
+
+		row = g_array_index (dcd->rows, gint, ii);
+		start = row - (row % CURSOR_WINDOW_SIZE);
+
+		/* The rows are sorted, thus each window is fetched once */
+		if (start != window_start) {
+			if (window)
+				g_ptr_array_unref (window);
+
+			window = cursor_fetch_window_sync (
+				model, dcd->cursor, start,
+				cancellable, &local_error);
+			window_start = start;
+
+			if (!window)
+				break;
+		}
+
+		if (row - start < window->len)
+			dcd->contacts->pdata[ii] = g_object_ref (window->pdata[row - start]);
+	}
+
+	if (window)
+		g_ptr_array_unref (window);
+
+	if (local_error)
+		g_task_return_error (task, local_error);
+	else
+		g_task_return_pointer (
+			task, dup_contacts_data_steal_list (dcd),
+			dup_contacts_free_list);
+}
+
+/* Asynchronously gets copies of the contacts at the @rows, fetching those,
+ * which were not read yet in the virtual mode, in a dedicated thread. */
+void
+e_addressbook_model_dup_contacts (EAddressbookModel *model,
+                                  const gint *rows,
+                                  guint n_rows,
+                                  GCancellable *cancellable,
+                                  GAsyncReadyCallback callback,
+                                  gpointer user_data)
+{
+	DupContactsData *dcd;
+	GTask *task;
+	gboolean complete = TRUE;
+	guint ii;
+
+	g_return_if_fail (E_IS_ADDRESSBOOK_MODEL (model));
+
+	task = g_task_new (model, cancellable, callback, user_data);
+	g_task_set_source_tag (task, e_addressbook_model_dup_contacts);
+
+	dcd = g_new0 (DupContactsData, 1);
+	dcd->rows = g_array_sized_new (FALSE, FALSE, sizeof (gint), n_rows);
+	dcd->contacts = g_ptr_array_new_full (n_rows, g_object_unref);
+
+	if (n_rows > 0)
+		g_array_append_vals (dcd->rows, rows, n_rows);
+	g_array_sort (dcd->rows, dup_contacts_compare_rows);
+
+	for (ii = 0; ii < dcd->rows->len; ii++) {
+		EContact *contact;
+
+		contact = e_addressbook_model_peek_contact_at (
+			model, g_array_index (dcd->rows, gint, ii));
+
+		if (contact)
+			contact = e_contact_duplicate (contact);
+		else if (model->priv->cursor &&
+			 g_array_index (dcd->rows, gint, ii) >= 0 &&
+			 g_array_index (dcd->rows, gint, ii) < model->priv->cursor_total)
+			complete = FALSE;
+
+		g_ptr_array_add (dcd->contacts, contact);
+	}
+
+	if (complete) {
+		g_task_return_pointer (
+			task, dup_contacts_data_steal_list (dcd),
+			dup_contacts_free_list);
+		dup_contacts_data_free (dcd);
+	} else {
+		dcd->cursor = g_object_ref (model->priv->cursor);
+
+		g_task_set_task_data (task, dcd, dup_contacts_data_free);
+		g_task_run_in_thread (task, dup_contacts_thread);
+	}
+
+	g_object_unref (task);
+}
+
+/* Returns a GSList of EContact, in the order of the rows; free it
+ * with g_slist_free_full (contacts, g_object_unref) */
+GSList *
+e_addressbook_model_dup_contacts_finish (EAddressbookModel *model,
+                                         GAsyncResult *result,
+                                         GError **error)
+{
+	g_return_val_if_fail (g_task_is_valid (result, model), NULL);
+
+	return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/* Synchronous variant of e_addressbook_model_dup_contacts(), for callers,
+ * which have to answer at once, like drag and drop; it waits for the rows,
+ * which were not read yet, to be fetched in a dedicated thread. */
+GSList *
+e_addressbook_model_dup_contacts_sync (EAddressbookModel *model,
+                                       const gint *rows,
+                                       guint n_rows,
+                                       GCancellable *cancellable,
+                                       GError **error)
+{
+	EAsyncClosure *closure;
+	GAsyncResult *result;
+	GSList *contacts;
+
+	g_return_val_if_fail (E_IS_ADDRESSBOOK_MODEL (model), NULL);
+
+	closure = e_async_closure_new ();
+
+	e_addressbook_model_dup_contacts (
+		model, rows, n_rows, cancellable,
+		e_async_closure_callback, closure);
+
+	result = e_async_closure_wait (closure);
+
+	contacts = e_addressbook_model_dup_contacts_finish (
+		model, result, error);
+
+	e_async_closure_free (closure);
+
+	return contacts;
+}
+
+static void
+cursor_find_letter_thread (GTask *task,
+                           gpointer source_object,
+                           gpointer task_data,
+                           GCancellable *cancellable)
+{
+	EAddressbookModel *model = source_object;
+	CursorFetchData *fd = task_data;
+	gint row = -1;
+	GError *local_error = NULL;
+
+	/* Positions the cursor, thus cannot interleave with a fetch */
+	g_mutex_lock (&model->priv->cursor_lock);
+
+	if (e_book_client_cursor_set_alphabetic_index_sync (
+		fd->cursor, fd->start, cancellable, &local_error)) {
+		/* The row is the count of contacts before the index;
+		 * the position property is updated asynchronously. */
+		row = e_book_client_cursor_step_sync (
+			fd->cursor, E_BOOK_CURSOR_STEP_MOVE,
+			E_BOOK_CURSOR_ORIGIN_CURRENT,
+			-(e_book_client_cursor_get_total (fd->cursor) + 1),
+			NULL, cancellable, &local_error);
+
+		/* Refused when there is nothing before the index */
+		if (row < 0 && g_error_matches (
+			local_error, E_CLIENT_ERROR,
+			E_CLIENT_ERROR_QUERY_REFUSED)) {
+			g_clear_error (&local_error);
+			row = 0;
+		}
+	}
+
+	g_mutex_unlock (&model->priv->cursor_lock);
+
+	if (row >= 0)
+		g_task_return_int (task, row);
+	else
+		g_task_return_error (task, local_error);
+}
+
+/* Asynchronously finds the first row of contacts sorted under the same
+ * alphabetic index of the cursor as the @letter. Available only in the
+ * virtual mode, the other models are not sorted. */
+void
+e_addressbook_model_find_letter (EAddressbookModel *model,
+                                 gunichar letter,
+                                 GCancellable *cancellable,
+                                 GAsyncReadyCallback callback,
+                                 gpointer user_data)
+{
+	CursorFetchData *fd;
+	GTask *task;
+	gchar utf_str[6 + 1];
+
+	g_return_if_fail (E_IS_ADDRESSBOOK_MODEL (model));
+
+	task = g_task_new (model, cancellable, callback, user_data);
+	g_task_set_source_tag (task, e_addressbook_model_find_letter);
+
+	if (!model->priv->cursor) {
+		g_task_return_new_error (
+			task, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+			_("Contacts are not sorted alphabetically"));
+		g_object_unref (task);
+		return;
+	}
+
+	utf_str[g_unichar_to_utf8 (letter, utf_str)] = '\0';
+
+	fd = g_new0 (CursorFetchData, 1);
+	fd->cursor = g_object_ref (model->priv->cursor);
+	fd->start = e_book_client_cursor_get_alphabetic_index (fd->cursor, utf_str);
+	fd->generation = model->priv->cursor_generation;
+
+	g_task_set_task_data (task, fd, cursor_fetch_data_free);
+	g_task_run_in_thread (task, cursor_find_letter_thread);
+
+	g_object_unref (task);
+}
+
+/* Returns the row, or -1 on error */
+gint
+e_addressbook_model_find_letter_finish (EAddressbookModel *model,
+                                        GAsyncResult *result,
+                                        GError **error)
+{
+	g_return_val_if_fail (g_task_is_valid (result, model), -1);
+
+	return g_task_propagate_int (G_TASK (result), error);
+}
+
 gint
 e_addressbook_model_find (EAddressbookModel *model,
                           EContact *contact)
@@ -873,14 +1713,27 @@ e_addressbook_model_find (EAddressbookModel *model,
 	g_return_val_if_fail (E_IS_ADDRESSBOOK_MODEL (model), -1);
 	g_return_val_if_fail (E_IS_CONTACT (contact), -1);
 
-	array = model->priv->contacts;
-	for (ii = 0; ii < array->len; ii++) {
-		EContact *candidate = array->pdata[ii];
+	if (model->priv->cursor) {
+		for (ii = 0; ii < CURSOR_N_WINDOWS; ii++) {
+			CursorWindow *window = &model->priv->cursor_windows[ii];
+			guint jj;
+
+			for (jj = 0; window->contacts && jj < window->contacts->len; jj++) {
+				if (window->contacts->pdata[jj] == contact)
+					return window->start + jj;
+			}
+		}
 
-		if (contact == candidate)
-			return ii;
+		return -1;
 	}
 
+	array = model->priv->contacts;
+
+	ii = contacts_index_lookup (
+		model, e_contact_get_const (contact, E_CONTACT_UID));
+	if (ii >= 0 && array->pdata[ii] == contact)
+		return ii;
+
 	return -1;
 }
 
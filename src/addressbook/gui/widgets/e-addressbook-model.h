@@ -101,6 +101,37 @@ EContact *	e_addressbook_model_contact_at	(EAddressbookModel *model,
 						 gint index);
 gint		e_addressbook_model_find	(EAddressbookModel *model,
 						 EContact *contact);
+EContact *	e_addressbook_model_peek_contact_at
+						(EAddressbookModel *model,
+						 gint index);
+gboolean	e_addressbook_model_get_virtual	(EAddressbookModel *model);
+void		e_addressbook_model_dup_contacts
+						(EAddressbookModel *model,
+						 const gint *rows,
+						 guint n_rows,
+						 GCancellable *cancellable,
+						 GAsyncReadyCallback callback,
+						 gpointer user_data);
+GSList *	e_addressbook_model_dup_contacts_finish
+						(EAddressbookModel *model,
+						 GAsyncResult *result,
+						 GError **error);
+GSList *	e_addressbook_model_dup_contacts_sync
+						(EAddressbookModel *model,
+						 const gint *rows,
+						 guint n_rows,
+						 GCancellable *cancellable,
+						 GError **error);
+void		e_addressbook_model_find_letter
+						(EAddressbookModel *model,
+						 gunichar letter,
+						 GCancellable *cancellable,
+						 GAsyncReadyCallback callback,
+						 gpointer user_data);
+gint		e_addressbook_model_find_letter_finish
+						(EAddressbookModel *model,
+						 GAsyncResult *result,
+						 GError **error);
 EBookClient *	e_addressbook_model_get_client	(EAddressbookModel *model);
 void		e_addressbook_model_set_client	(EAddressbookModel *model,
 						 EBookClient *book_client);
@@ -161,18 +161,22 @@ addressbook_height (EReflowModel *erm,
 	EContactField field;
 	gint count = 0;
 	gchar *string;
-	EContact *contact = (EContact *) e_addressbook_model_contact_at (priv->model, i);
+	EContact *contact;
 	PangoLayout *layout;
 	gint height;
 
+	/* Heights are asked for all the contacts, thus do not make
+	 * the model fetch them; the rows change once fetched. */
+	contact = e_addressbook_model_peek_contact_at (priv->model, i);
+
 	layout = gtk_widget_create_pango_layout (
 		GTK_WIDGET (GNOME_CANVAS_ITEM (parent)->canvas), "");
 
-	string = e_contact_get (contact, E_CONTACT_FILE_AS);
+	string = contact ? e_contact_get (contact, E_CONTACT_FILE_AS) : NULL;
 	height = text_height (layout, string ? string : "") + 10.0;
 	g_free (string);
 
-	for (field = E_CONTACT_FULL_NAME;
+	for (field = E_CONTACT_FULL_NAME; contact &&
 	     field != E_CONTACT_LAST_SIMPLE_STRING && count < 5; field++) {
 
 		if (field == E_CONTACT_FAMILY_NAME || field == E_CONTACT_GIVEN_NAME)
@@ -213,7 +217,9 @@ addressbook_create_cmp_cache (EReflowModel *erm)
 
 	count = e_reflow_model_count (erm);
 
-	if (priv->loading || count <= 0)
+	/* Contacts of a virtual model are sorted already */
+	if (priv->loading || count <= 0 ||
+	    e_addressbook_model_get_virtual (priv->model))
 		return NULL;
 
 	cmp_cache = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
@@ -248,7 +254,7 @@ addressbook_compare (EReflowModel *erm,
 	EAddressbookReflowAdapterPrivate *priv = adapter->priv;
 	EContact *contact1, *contact2;
 
-	if (priv->loading) {
+	if (priv->loading || e_addressbook_model_get_virtual (priv->model)) {
 		return n1 - n2;
 	}
 	else {
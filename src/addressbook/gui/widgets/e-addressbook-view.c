@@ -80,6 +80,9 @@ struct _EAddressbookViewPrivate {
 
 	GtkTargetList *copy_target_list;
 	GtkTargetList *paste_target_list;
+
+	/* Sorting of the table, while ignored for a virtual model */
+	ETableSortInfo *table_sort_info;
 };
 
 enum {
@@ -193,6 +196,9 @@ table_double_click (ETable *table,
 
 	model = e_addressbook_view_get_model (view);
 	contact = e_addressbook_model_get_contact (model, row);
+	if (!contact)
+		return;
+
 	addressbook_view_emit_open_contact (view, contact, FALSE);
 	g_object_unref (contact);
 }
@@ -287,6 +293,77 @@ table_drag_data_get (ETable *table,
 	g_slist_free_full (contact_list, (GDestroyNotify) g_object_unref);
 }
 
+static void
+addressbook_view_copy_sort_info (ETableSortInfo *from,
+                                 ETableSortInfo *to)
+{
+	ETableColumnSpecification *spec;
+	GtkSortType sort_type;
+	guint ii, count;
+
+	count = e_table_sort_info_grouping_get_count (from);
+	e_table_sort_info_grouping_truncate (to, count);
+	for (ii = 0; ii < count; ii++) {
+		spec = e_table_sort_info_grouping_get_nth (from, ii, &sort_type);
+		e_table_sort_info_grouping_set_nth (to, ii, spec, sort_type);
+	}
+
+	count = e_table_sort_info_sorting_get_count (from);
+	e_table_sort_info_sorting_truncate (to, count);
+	for (ii = 0; ii < count; ii++) {
+		spec = e_table_sort_info_sorting_get_nth (from, ii, &sort_type);
+		e_table_sort_info_sorting_set_nth (to, ii, spec, sort_type);
+	}
+}
+
+/* Contacts of a virtual model are read on demand, in the order of its
+ * cursor, thus the table cannot sort nor group them by its columns. The
+ * sorting is ignored meanwhile; the state of the table is not saved with
+ * the view until the sorting is put back, to not lose it. */
+static void
+addressbook_view_check_table_sorting (EAddressbookView *view)
+{
+	ETableSortInfo *sort_info;
+	GtkWidget *child;
+	ETable *table;
+	gboolean is_virtual;
+
+	child = gtk_bin_get_child (GTK_BIN (view));
+	if (!E_IS_TABLE (child) || !view->priv->model)
+		return;
+
+	table = E_TABLE (child);
+	sort_info = table->sort_info;
+	if (!sort_info)
+		return;
+
+	is_virtual = e_addressbook_model_get_virtual (view->priv->model);
+
+	if (!is_virtual) {
+		if (view->priv->table_sort_info) {
+			ETableSortInfo *saved = view->priv->table_sort_info;
+
+			view->priv->table_sort_info = NULL;
+			addressbook_view_copy_sort_info (saved, sort_info);
+			g_object_unref (saved);
+
+			e_table_thaw_state_change (table);
+		}
+		return;
+	}
+
+	if (!view->priv->table_sort_info) {
+		view->priv->table_sort_info = e_table_sort_info_duplicate (sort_info);
+		e_table_freeze_state_change (table);
+	}
+
+	if (e_table_sort_info_grouping_get_count (sort_info) > 0)
+		e_table_sort_info_grouping_truncate (sort_info, 0);
+
+	if (e_table_sort_info_sorting_get_count (sort_info) > 0)
+		e_table_sort_info_sorting_truncate (sort_info, 0);
+}
+
 static void
 addressbook_view_create_table_view (EAddressbookView *view,
                                     GalViewEtable *gal_view)
@@ -357,6 +434,18 @@ addressbook_view_create_table_view (EAddressbookView *view,
 	gtk_widget_show (widget);
 
 	gal_view_etable_attach_table (gal_view, E_TABLE (widget));
+
+	/* Also covers changes of the sorting done by the user */
+	g_signal_connect_object (
+		E_TABLE (widget)->sort_info, "sort_info_changed",
+		G_CALLBACK (addressbook_view_check_table_sorting),
+		view, G_CONNECT_SWAPPED);
+	g_signal_connect_object (
+		E_TABLE (widget)->sort_info, "group_info_changed",
+		G_CALLBACK (addressbook_view_check_table_sorting),
+		view, G_CONNECT_SWAPPED);
+
+	addressbook_view_check_table_sorting (view);
 }
 
 static void
@@ -417,6 +506,9 @@ addressbook_view_display_view_cb (GalViewInstance *view_instance,
 		gtk_container_remove (GTK_CONTAINER (view), child);
 	view->priv->object = NULL;
 
+	/* Belonged to the removed table */
+	g_clear_object (&view->priv->table_sort_info);
+
 	if (GAL_IS_VIEW_ETABLE (gal_view))
 		addressbook_view_create_table_view (
 			view, GAL_VIEW_ETABLE (gal_view));
@@ -565,6 +657,8 @@ addressbook_view_dispose (GObject *object)
 		priv->activity = NULL;
 	}
 
+	g_clear_object (&priv->table_sort_info);
+
 	if (priv->source != NULL) {
 		g_object_unref (priv->source);
 		priv->source = NULL;
@@ -706,35 +800,113 @@ addressbook_view_update_actions (ESelectable *selectable,
 	gtk_action_set_tooltip (action, tooltip);
 }
 
+typedef struct _SelectedContactsData {
+	EAddressbookView *view;
+	gboolean copy_clipboard;
+	gboolean remove_contacts;
+	gboolean confirm_remove;
+} SelectedContactsData;
+
+static void	addressbook_view_remove_contacts
+						(EAddressbookView *view,
+						 GSList *list,
+						 gboolean is_delete);
+
 static void
-addressbook_view_cut_clipboard (ESelectable *selectable)
+addressbook_view_submit_fetch_error (EAddressbookView *view,
+                                     const GError *error)
 {
-	EAddressbookView *view;
+	EShellView *shell_view;
+	EShellContent *shell_content;
 
-	view = E_ADDRESSBOOK_VIEW (selectable);
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		return;
 
-	e_selectable_copy_clipboard (selectable);
-	e_addressbook_view_delete_selection (view, FALSE);
+	shell_view = e_addressbook_view_get_shell_view (view);
+	shell_content = e_shell_view_get_shell_content (shell_view);
+
+	e_alert_submit (
+		E_ALERT_SINK (shell_content),
+		"addressbook:search-error",
+		error->message, NULL);
 }
 
 static void
-addressbook_view_copy_clipboard (ESelectable *selectable)
+addressbook_view_selected_contacts_cb (GObject *source_object,
+                                       GAsyncResult *result,
+                                       gpointer user_data)
 {
-	EAddressbookView *view;
-	GtkClipboard *clipboard;
+	SelectedContactsData *scd = user_data;
 	GSList *contact_list;
-	gchar *string;
+	GError *local_error = NULL;
 
-	view = E_ADDRESSBOOK_VIEW (selectable);
-	clipboard = gtk_clipboard_get (GDK_SELECTION_CLIPBOARD);
+	contact_list = e_addressbook_view_dup_selected_finish (
+		scd->view, result, &local_error);
 
-	contact_list = e_addressbook_view_get_selected (view);
+	if (local_error != NULL) {
+		addressbook_view_submit_fetch_error (scd->view, local_error);
+		g_error_free (local_error);
 
-	string = eab_contact_list_to_string (contact_list);
-	e_clipboard_set_directory (clipboard, string, -1);
-	g_free (string);
+	} else if (contact_list != NULL) {
+		if (scd->copy_clipboard) {
+			GtkClipboard *clipboard;
+			gchar *string;
 
-	g_slist_free_full (contact_list, (GDestroyNotify) g_object_unref);
+			clipboard = gtk_clipboard_get (GDK_SELECTION_CLIPBOARD);
+
+			string = eab_contact_list_to_string (contact_list);
+			e_clipboard_set_directory (clipboard, string, -1);
+			g_free (string);
+		}
+
+		if (scd->remove_contacts) {
+			/* Takes ownership of the list */
+			addressbook_view_remove_contacts (
+				scd->view, contact_list, scd->confirm_remove);
+			contact_list = NULL;
+		}
+
+		g_slist_free_full (contact_list, (GDestroyNotify) g_object_unref);
+	}
+
+	g_object_unref (scd->view);
+	g_free (scd);
+}
+
+/* The selected contacts may need to be fetched first,
+ * thus the actions on them are finished asynchronously. */
+static void
+addressbook_view_act_on_selected (EAddressbookView *view,
+                                  gboolean copy_clipboard,
+                                  gboolean remove_contacts,
+                                  gboolean confirm_remove)
+{
+	SelectedContactsData *scd;
+
+	scd = g_new0 (SelectedContactsData, 1);
+	scd->view = g_object_ref (view);
+	scd->copy_clipboard = copy_clipboard;
+	scd->remove_contacts = remove_contacts;
+	scd->confirm_remove = confirm_remove;
+
+	e_addressbook_view_dup_selected (
+		view, NULL, addressbook_view_selected_contacts_cb, scd);
+}
+
+static void
+addressbook_view_cut_clipboard (ESelectable *selectable)
+{
+	/* Both done with the same contacts; they would not match
+	 * when the removal went first and the rows moved up. */
+	addressbook_view_act_on_selected (
+		E_ADDRESSBOOK_VIEW (selectable), TRUE, TRUE, FALSE);
+}
+
+static void
+addressbook_view_copy_clipboard (ESelectable *selectable)
+{
+	addressbook_view_act_on_selected (
+		E_ADDRESSBOOK_VIEW (selectable), TRUE, FALSE, FALSE);
 }
 
 static void
@@ -961,6 +1133,9 @@ e_addressbook_view_new (EShellView *shell_view,
 	g_signal_connect_swapped (
 		view->priv->model, "writable-status",
 		G_CALLBACK (command_state_change), view);
+	g_signal_connect_swapped (
+		view->priv->model, "model_changed",
+		G_CALLBACK (addressbook_view_check_table_sorting), view);
 
 	return widget;
 }
@@ -991,31 +1166,103 @@ e_addressbook_view_get_view_object (EAddressbookView *view)
 	return view->priv->object;
 }
 
-/* Helper for e_addressbook_view_get_selected() */
+/* Helper for e_addressbook_view_get_selected()
+ * and e_addressbook_view_dup_selected() */
 static void
-add_to_list (gint model_row,
-             gpointer closure)
+add_to_array (gint model_row,
+              gpointer closure)
 {
-	GSList **list = closure;
-	*list = g_slist_prepend (*list, GINT_TO_POINTER (model_row));
+	GArray *rows = closure;
+
+	g_array_append_val (rows, model_row);
 }
 
+static GArray *
+addressbook_view_get_selected_rows (EAddressbookView *view)
+{
+	ESelectionModel *selection;
+	GArray *rows;
+
+	rows = g_array_new (FALSE, FALSE, sizeof (gint));
+
+	selection = e_addressbook_view_get_selection_model (view);
+	if (selection != NULL)
+		e_selection_model_foreach (selection, add_to_array, rows);
+
+	return rows;
+}
+
+/* Returns all of the selected contacts. Rows of a virtual model, which
+ * were not read yet, are fetched first, which blocks; use it only where
+ * the answer is needed at once, otherwise e_addressbook_view_dup_selected(). */
 GSList *
 e_addressbook_view_get_selected (EAddressbookView *view)
 {
-	GSList *list, *iter;
-	ESelectionModel *selection;
+	GArray *rows;
+	GSList *list;
+	GError *local_error = NULL;
 
 	g_return_val_if_fail (E_IS_ADDRESSBOOK_VIEW (view), NULL);
 
-	list = NULL;
-	selection = e_addressbook_view_get_selection_model (view);
-	e_selection_model_foreach (selection, add_to_list, &list);
+	rows = addressbook_view_get_selected_rows (view);
+
+	list = e_addressbook_model_dup_contacts_sync (
+		view->priv->model, (const gint *) rows->data, rows->len,
+		NULL, &local_error);
+
+	if (local_error != NULL) {
+		g_warning (
+			"%s: Failed to fetch contacts: %s",
+			G_STRFUNC, local_error->message);
+		g_error_free (local_error);
+	}
+
+	g_array_unref (rows);
 
-	for (iter = list; iter != NULL; iter = iter->next)
-		iter->data = e_addressbook_model_get_contact (
-			view->priv->model, GPOINTER_TO_INT (iter->data));
-	return g_slist_reverse (list);
+	return list;
+}
+
+/* Like e_addressbook_view_get_selected(), only also fetches the selected
+ * contacts, which were not read yet from a virtual model. Finish it with
+ * e_addressbook_view_dup_selected_finish(). */
+void
+e_addressbook_view_dup_selected (EAddressbookView *view,
+                                 GCancellable *cancellable,
+                                 GAsyncReadyCallback callback,
+                                 gpointer user_data)
+{
+	GArray *rows;
+
+	g_return_if_fail (E_IS_ADDRESSBOOK_VIEW (view));
+
+	rows = addressbook_view_get_selected_rows (view);
+
+	e_addressbook_model_dup_contacts (
+		view->priv->model, (const gint *) rows->data, rows->len,
+		cancellable, callback, user_data);
+
+	g_array_unref (rows);
+}
+
+GSList *
+e_addressbook_view_dup_selected_finish (EAddressbookView *view,
+                                        GAsyncResult *result,
+                                        GError **error)
+{
+	EAddressbookModel *model;
+	GSList *contacts;
+
+	g_return_val_if_fail (E_IS_ADDRESSBOOK_VIEW (view), NULL);
+
+	/* The view can be disposed meanwhile, the model stays */
+	model = E_ADDRESSBOOK_MODEL (g_async_result_get_source_object (result));
+
+	contacts = e_addressbook_model_dup_contacts_finish (
+		model, result, error);
+
+	g_object_unref (model);
+
+	return contacts;
 }
 
 ESelectionModel *
@@ -1202,6 +1449,37 @@ e_contact_print_button (EPrintable *printable,
 	g_object_unref (operation);
 }
 
+typedef struct _PrintSelectedData {
+	EAddressbookView *view;
+	GtkPrintOperationAction action;
+} PrintSelectedData;
+
+static void
+addressbook_view_print_selected_cb (GObject *source_object,
+                                    GAsyncResult *result,
+                                    gpointer user_data)
+{
+	PrintSelectedData *psd = user_data;
+	GSList *contact_list;
+	GError *local_error = NULL;
+
+	contact_list = e_addressbook_view_dup_selected_finish (
+		psd->view, result, &local_error);
+
+	if (local_error != NULL) {
+		addressbook_view_submit_fetch_error (psd->view, local_error);
+		g_error_free (local_error);
+	} else if (contact_list != NULL) {
+		e_contact_print (NULL, NULL, contact_list, psd->action);
+		g_slist_free_full (
+			contact_list,
+			(GDestroyNotify) g_object_unref);
+	}
+
+	g_object_unref (psd->view);
+	g_free (psd);
+}
+
 void
 e_addressbook_view_print (EAddressbookView *view,
                           gboolean selection_only,
@@ -1217,13 +1495,14 @@ e_addressbook_view_print (EAddressbookView *view,
 
 	/* Print the selected contacts. */
 	if (GAL_IS_VIEW_MINICARD (gal_view) && selection_only) {
-		GSList *contact_list;
+		PrintSelectedData *psd;
 
-		contact_list = e_addressbook_view_get_selected (view);
-		e_contact_print (NULL, NULL, contact_list, action);
-		g_slist_free_full (
-			contact_list,
-			(GDestroyNotify) g_object_unref);
+		psd = g_new0 (PrintSelectedData, 1);
+		psd->view = g_object_ref (view);
+		psd->action = action;
+
+		e_addressbook_view_dup_selected (
+			view, NULL, addressbook_view_print_selected_cb, psd);
 
 	/* Print the latest query results. */
 	} else if (GAL_IS_VIEW_MINICARD (gal_view)) {
@@ -1368,11 +1647,13 @@ addressbook_view_confirm_delete (GtkWindow *parent,
 	return (response == GTK_RESPONSE_ACCEPT);
 }
 
-void
-e_addressbook_view_delete_selection (EAddressbookView *view,
-                                     gboolean is_delete)
+/* Takes ownership of the @list */
+static void
+addressbook_view_remove_contacts (EAddressbookView *view,
+                                  GSList *list,
+                                  gboolean is_delete)
 {
-	GSList *list, *l;
+	GSList *l;
 	gboolean plural = FALSE, is_list = FALSE;
 	EContact *contact;
 	ETable *etable = NULL;
@@ -1391,7 +1672,6 @@ e_addressbook_view_delete_selection (EAddressbookView *view,
 	view_instance = e_addressbook_view_get_view_instance (view);
 	gal_view = gal_view_instance_get_current_view (view_instance);
 
-	list = e_addressbook_view_get_selected (view);
 	g_return_if_fail (list != NULL);
 
 	contact = list->data;
@@ -1484,15 +1764,35 @@ e_addressbook_view_delete_selection (EAddressbookView *view,
 }
 
 void
-e_addressbook_view_view (EAddressbookView *view)
+e_addressbook_view_delete_selection (EAddressbookView *view,
+                                     gboolean is_delete)
+{
+	g_return_if_fail (E_IS_ADDRESSBOOK_VIEW (view));
+
+	addressbook_view_act_on_selected (view, FALSE, TRUE, is_delete);
+}
+
+static void
+addressbook_view_view_selected_cb (GObject *source_object,
+                                   GAsyncResult *result,
+                                   gpointer user_data)
 {
+	EAddressbookView *view = user_data;
 	GSList *list, *iter;
 	gint response;
 	guint length;
+	GError *local_error = NULL;
 
-	g_return_if_fail (E_IS_ADDRESSBOOK_VIEW (view));
+	list = e_addressbook_view_dup_selected_finish (
+		view, result, &local_error);
+
+	if (local_error != NULL) {
+		addressbook_view_submit_fetch_error (view, local_error);
+		g_error_free (local_error);
+		g_object_unref (view);
+		return;
+	}
 
-	list = e_addressbook_view_get_selected (view);
 	length = g_slist_length (list);
 	response = GTK_RESPONSE_YES;
 
@@ -1526,6 +1826,18 @@ e_addressbook_view_view (EAddressbookView *view)
 				view, iter->data, FALSE);
 
 	g_slist_free_full (list, (GDestroyNotify) g_object_unref);
+
+	g_object_unref (view);
+}
+
+void
+e_addressbook_view_view (EAddressbookView *view)
+{
+	g_return_if_fail (E_IS_ADDRESSBOOK_VIEW (view));
+
+	e_addressbook_view_dup_selected (
+		view, NULL, addressbook_view_view_selected_cb,
+		g_object_ref (view));
 }
 
 void
@@ -1550,26 +1862,18 @@ struct TransferContactsData
 	EAddressbookView *view;
 };
 
+/* Takes ownership of the @contacts and frees the @tcd */
 static void
-all_contacts_ready_cb (GObject *source_object,
-                       GAsyncResult *result,
-                       gpointer user_data)
+transfer_contacts_ready (struct TransferContactsData *tcd,
+                         EBookClient *book_client,
+                         GSList *contacts,
+                         GError *error)
 {
-	EBookClient *book_client = E_BOOK_CLIENT (source_object);
-	struct TransferContactsData *tcd = user_data;
 	EAddressbookModel *model;
 	EClientCache *client_cache;
 	EShellView *shell_view;
 	EShellContent *shell_content;
 	EAlertSink *alert_sink;
-	GSList *contacts = NULL;
-	GError *error = NULL;
-
-	g_return_if_fail (book_client != NULL);
-	g_return_if_fail (tcd != NULL);
-
-	e_book_client_get_contacts_finish (
-		book_client, result, &contacts, &error);
 
 	shell_view = e_addressbook_view_get_shell_view (tcd->view);
 	shell_content = e_shell_view_get_shell_content (shell_view);
@@ -1600,6 +1904,44 @@ all_contacts_ready_cb (GObject *source_object,
 	g_free (tcd);
 }
 
+static void
+all_contacts_ready_cb (GObject *source_object,
+                       GAsyncResult *result,
+                       gpointer user_data)
+{
+	EBookClient *book_client = E_BOOK_CLIENT (source_object);
+	struct TransferContactsData *tcd = user_data;
+	GSList *contacts = NULL;
+	GError *error = NULL;
+
+	g_return_if_fail (book_client != NULL);
+	g_return_if_fail (tcd != NULL);
+
+	e_book_client_get_contacts_finish (
+		book_client, result, &contacts, &error);
+
+	transfer_contacts_ready (tcd, book_client, contacts, error);
+}
+
+static void
+selected_contacts_ready_cb (GObject *source_object,
+                            GAsyncResult *result,
+                            gpointer user_data)
+{
+	struct TransferContactsData *tcd = user_data;
+	GSList *contacts;
+	GError *error = NULL;
+
+	g_return_if_fail (tcd != NULL);
+
+	contacts = e_addressbook_view_dup_selected_finish (
+		tcd->view, result, &error);
+
+	transfer_contacts_ready (
+		tcd, e_addressbook_model_get_client (
+		E_ADDRESSBOOK_MODEL (source_object)), contacts, error);
+}
+
 static void
 view_transfer_contacts (EAddressbookView *view,
                         gboolean delete_from_source,
@@ -1607,48 +1949,29 @@ view_transfer_contacts (EAddressbookView *view,
 {
 	EAddressbookModel *model;
 	EBookClient *book_client;
-	EClientCache *client_cache;
+	struct TransferContactsData *tcd;
 
 	model = e_addressbook_view_get_model (view);
 	book_client = e_addressbook_model_get_client (model);
-	client_cache = e_addressbook_model_get_client_cache (model);
+
+	tcd = g_new0 (struct TransferContactsData, 1);
+	tcd->delete_from_source = delete_from_source;
+	tcd->view = g_object_ref (view);
 
 	if (all) {
 		EBookQuery *query;
 		gchar *query_str;
-		struct TransferContactsData *tcd;
 
 		query = e_book_query_any_field_contains ("");
 		query_str = e_book_query_to_string (query);
 		e_book_query_unref (query);
 
-		tcd = g_new0 (struct TransferContactsData, 1);
-		tcd->delete_from_source = delete_from_source;
-		tcd->view = g_object_ref (view);
-
 		e_book_client_get_contacts (
 			book_client, query_str, NULL,
 			all_contacts_ready_cb, tcd);
 	} else {
-		GSList *contacts = NULL;
-		EShellView *shell_view;
-		EShellContent *shell_content;
-		EAlertSink *alert_sink;
-		ESourceRegistry *registry;
-
-		shell_view = e_addressbook_view_get_shell_view (view);
-		shell_content = e_shell_view_get_shell_content (shell_view);
-		alert_sink = E_ALERT_SINK (shell_content);
-
-		contacts = e_addressbook_view_get_selected (view);
-
-		registry = e_client_cache_ref_registry (client_cache);
-
-		eab_transfer_contacts (
-			registry, book_client, contacts,
-			delete_from_source, alert_sink);
-
-		g_object_unref (registry);
+		e_addressbook_view_dup_selected (
+			view, NULL, selected_contacts_ready_cb, tcd);
 	}
 }
 
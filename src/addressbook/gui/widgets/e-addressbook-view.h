@@ -83,6 +83,14 @@ GalViewInstance *
 GObject *	e_addressbook_view_get_view_object
 						(EAddressbookView *view);
 GSList *	e_addressbook_view_get_selected	(EAddressbookView *view);
+void		e_addressbook_view_dup_selected	(EAddressbookView *view,
+						 GCancellable *cancellable,
+						 GAsyncReadyCallback callback,
+						 gpointer user_data);
+GSList *	e_addressbook_view_dup_selected_finish
+						(EAddressbookView *view,
+						 GAsyncResult *result,
+						 GError **error);
 ESelectionModel *
 		e_addressbook_view_get_selection_model
 						(EAddressbookView *view);
@@ -425,6 +425,15 @@ e_minicard_view_event (GnomeCanvasItem *item,
 		if (((event->key.state & GDK_SHIFT_MASK) != 0 && event->key.keyval == GDK_KEY_F10) ||
 		    ((event->key.state & (GDK_SHIFT_MASK | GDK_CONTROL_MASK | GDK_MOD1_MASK)) == 0 && event->key.keyval == GDK_KEY_Menu)) {
 			e_minicard_view_right_click (view, event);
+		} else if ((event->key.state & (GDK_CONTROL_MASK | GDK_MOD1_MASK)) == 0) {
+			gunichar letter;
+
+			/* Typing a letter jumps to the cards filed under it */
+			letter = gdk_keyval_to_unicode (event->key.keyval);
+			if (letter && g_unichar_isalnum (letter)) {
+				e_minicard_view_jump_to_letter (view, letter);
+				return TRUE;
+			}
 		}
 		break;
 	default:
@@ -574,47 +583,154 @@ e_minicard_view_init (EMinicardView *view)
 	set_empty_message (view);
 }
 
+static EAddressbookModel *
+minicard_view_ref_model (EMinicardView *view)
+{
+	EAddressbookModel *model = NULL;
+
+	if (view->adapter)
+		g_object_get (view->adapter, "model", &model, NULL);
+
+	return model;
+}
+
+static void
+minicard_view_select_row (EMinicardView *view,
+                          gint row)
+{
+	EReflow *reflow = E_REFLOW (view);
+
+	/* Moving the cursor also scrolls to the card */
+	if (row >= 0 && row < reflow->count)
+		e_selection_model_select_as_key_press (reflow->selection, row, 0, 0);
+}
+
+static void
+minicard_view_find_letter_cb (GObject *source_object,
+                              GAsyncResult *result,
+                              gpointer user_data)
+{
+	EMinicardView *view = user_data;
+	GError *local_error = NULL;
+	gint row;
+
+	row = e_addressbook_model_find_letter_finish (
+		E_ADDRESSBOOK_MODEL (source_object), result, &local_error);
+
+	if (row >= 0)
+		minicard_view_select_row (view, row);
+	else if (!g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		g_warning (
+			"%s: Failed to find letter: %s", G_STRFUNC,
+			local_error ? local_error->message : "Unknown error");
+
+	g_clear_error (&local_error);
+	g_object_unref (view);
+}
+
+/* Moves the cursor to the first card filed under the @letter, or after it */
 void
 e_minicard_view_jump_to_letter (EMinicardView *view,
                                 gunichar letter)
 {
-#if 0
-	gchar uft_str[6 + 1];
-
-	utf_str[g_unichar_to_utf8 (letter, utf_str)] = '\0';
-	e_reflow_sorted_jump (
-		E_REFLOW_SORTED (view),
-		(GCompareFunc) compare_to_utf_str,
-		utf_str);
-#endif
-}
+	EAddressbookModel *model;
+	EReflow *reflow;
+	gchar utf_str[6 + 1];
+	gchar *letter_key;
+	gint ii;
 
-typedef struct {
-	GSList *list;
-	EAddressbookReflowAdapter *adapter;
-} ModelAndList;
+	g_return_if_fail (E_IS_MINICARD_VIEW (view));
+
+	model = minicard_view_ref_model (view);
+	if (!model)
+		return;
+
+	/* Large books are read on demand, the cursor knows where the letter is */
+	if (e_addressbook_model_get_virtual (model)) {
+		e_addressbook_model_find_letter (
+			model, letter, NULL,
+			minicard_view_find_letter_cb,
+			g_object_ref (view));
+		g_object_unref (model);
+		return;
+	}
+
+	reflow = E_REFLOW (view);
+
+	utf_str[g_unichar_to_utf8 (g_unichar_tolower (letter), utf_str)] = '\0';
+	letter_key = g_utf8_collate_key (utf_str, -1);
+
+	/* The cards are sorted by "File As", thus look in the sorted order */
+	for (ii = 0; ii < reflow->count; ii++) {
+		EContact *contact;
+		const gchar *file_as;
+		gint row;
+
+		row = e_sorter_sorted_to_model (reflow->selection->sorter, ii);
+		contact = e_addressbook_model_peek_contact_at (model, row);
+		file_as = contact ? e_contact_get_const (contact, E_CONTACT_FILE_AS) : NULL;
+
+		if (file_as && *file_as) {
+			gchar *folded, *key;
+			gboolean found;
+
+			folded = g_utf8_casefold (file_as, -1);
+			key = g_utf8_collate_key (folded, -1);
+			found = strcmp (key, letter_key) >= 0;
+			g_free (folded);
+			g_free (key);
+
+			if (found) {
+				minicard_view_select_row (view, row);
+				break;
+			}
+		}
+	}
+
+	g_free (letter_key);
+	g_object_unref (model);
+}
 
 static void
-add_to_list (gint index,
-             gpointer closure)
+add_to_array (gint index,
+              gpointer closure)
 {
-	ModelAndList *mal = closure;
-	mal->list = g_slist_prepend (
-		mal->list, e_addressbook_reflow_adapter_get_contact (
-		mal->adapter, index));
+	GArray *rows = closure;
+
+	g_array_append_val (rows, index);
 }
 
+/* Rows of a virtual model, which were not read yet, are fetched
+ * first, because the drag needs all of the selected contacts. */
 GSList *
 e_minicard_view_get_card_list (EMinicardView *view)
 {
-	ModelAndList mal;
+	EAddressbookModel *model;
+	GArray *rows;
+	GSList *list;
+	GError *local_error = NULL;
+
+	model = minicard_view_ref_model (view);
+	if (!model)
+		return NULL;
+
+	rows = g_array_new (FALSE, FALSE, sizeof (gint));
+	e_selection_model_foreach (E_REFLOW (view)->selection, add_to_array, rows);
 
-	mal.adapter = view->adapter;
-	mal.list = NULL;
+	list = e_addressbook_model_dup_contacts_sync (
+		model, (const gint *) rows->data, rows->len, NULL, &local_error);
+
+	if (local_error != NULL) {
+		g_warning (
+			"%s: Failed to fetch contacts: %s",
+			G_STRFUNC, local_error->message);
+		g_error_free (local_error);
+	}
 
-	e_selection_model_foreach (E_REFLOW (view)->selection, add_to_list, &mal);
+	g_array_unref (rows);
+	g_object_unref (model);
 
-	return g_slist_reverse (mal.list);
+	return list;
 }
 
 void
@@ -70,6 +70,10 @@ typedef struct {
 	/* The live view to the calendar */
 	ECalClientView *view;
 
+	/* Start of the day the view was created for by the midnight
+	 * refresh, or 0, when it covers the whole lookahead window */
+	time_t view_start;
+
 	/* Hash table of component UID -> CompQueuedAlarms.  If an element is
 	 * present here, then it means its cqa->queued_alarms contains at least
 	 * one queued alarm.  When all the alarms for a component have been
@@ -122,6 +126,11 @@ typedef struct {
 static gpointer midnight_refresh_id = NULL;
 static time_t midnight = 0;
 
+/* End of the time range with queued alarms. The range is extended
+ * by one day every midnight and only the alarms of that day are added,
+ * the already queued alarms are not generated again. */
+static time_t lookahead_end = 0;
+
 static void	remove_client_alarms		(ClientAlarms *ca);
 static void	display_notification		(time_t trigger,
 						 CompQueuedAlarms *cqa,
@@ -142,6 +151,9 @@ static void	popup_notification		(time_t trigger,
 						 gpointer alarm_id,
 						 gboolean use_description);
 #endif
+static void	query_objects_added_cb		(ECalClientView *view,
+						 const GSList *objects,
+						 gpointer data);
 static void	query_objects_modified_cb	(ECalClientView *view,
 						 const GSList *objects,
 						 gpointer data);
@@ -160,7 +172,10 @@ static void	on_dialog_objs_removed_cb	(ECalClientView *view,
 
 /* Alarm queue engine */
 
-static void	load_alarms_for_today		(ClientAlarms *ca);
+static void	load_alarms			(ClientAlarms *ca,
+						 time_t start,
+						 time_t end);
+static void	load_alarms_in_lookahead	(ClientAlarms *ca);
 static void	midnight_refresh_cb		(gpointer alarm_id,
 						 time_t trigger,
 						 gpointer data);
@@ -264,7 +279,36 @@ add_client_alarms_cb (gpointer key,
 
 	debug (("Adding %p", ca));
 
-	load_alarms_for_today (ca);
+	load_alarms_in_lookahead (ca);
+}
+
+/* Loads a client's alarms of the day appended to the lookahead window,
+ * which starts at the time pointed to by @data */
+static void
+append_client_alarms_cb (gpointer key,
+                         gpointer value,
+                         gpointer data)
+{
+	ClientAlarms *ca = (ClientAlarms *) value;
+	const time_t *start = data;
+
+	debug (("Appending %p", ca));
+
+	ca->view_start = *start;
+	load_alarms (ca, *start, lookahead_end);
+}
+
+/* Returns the end of the lookahead window for @now */
+static time_t
+get_lookahead_end (time_t now)
+{
+	icaltimezone *zone;
+
+	zone = config_data_get_timezone ();
+
+	/* Add one hour after midnight, just to cover the delay in 30 minutes
+	 * midnight checking. */
+	return time_day_end_with_zone (now, zone) + (60 * 60);
 }
 
 struct _midnight_refresh_msg {
@@ -272,14 +316,36 @@ struct _midnight_refresh_msg {
 	gboolean remove;
 };
 
-/* Loads the alarms for the new day every midnight */
+/* Appends the new day to the lookahead window every midnight */
 static void
 midnight_refresh_async (struct _midnight_refresh_msg *msg)
 {
+	time_t now, new_end;
+	guint n_queued = 0, max_queued = 0;
+
 	debug (("..."));
 
-	/* Re-load the alarms for all clients */
-	g_hash_table_foreach (client_alarms_hash, add_client_alarms_cb, NULL);
+	now = time (NULL);
+	new_end = get_lookahead_end (now);
+
+	if (lookahead_end <= now) {
+		/* The window ended already, like after a suspend;
+		 * load everything since the last notification. */
+		lookahead_end = new_end;
+
+		g_hash_table_foreach (client_alarms_hash, add_client_alarms_cb, NULL);
+	} else if (new_end > lookahead_end) {
+		time_t start = lookahead_end;
+
+		lookahead_end = new_end;
+
+		g_hash_table_foreach (client_alarms_hash, append_client_alarms_cb, &start);
+	}
+
+	alarm_get_stats (&n_queued, &max_queued, NULL);
+	debug ((
+		"Alarms queued till %s: %u (max %u)",
+		e_ctime (&lookahead_end), n_queued, max_queued));
 
 	/* Re-schedule the midnight update */
 	if (msg->remove && midnight_refresh_id != NULL) {
@@ -694,7 +760,7 @@ load_alarms (ClientAlarms *ca,
 
 		g_signal_connect (
 			ca->view, "objects-added",
-			G_CALLBACK (query_objects_modified_cb), ca);
+			G_CALLBACK (query_objects_added_cb), ca);
 		g_signal_connect (
 			ca->view, "objects-modified",
 			G_CALLBACK (query_objects_modified_cb), ca);
@@ -715,17 +781,20 @@ load_alarms (ClientAlarms *ca,
 	g_free (str_query);
 }
 
-/* Loads today's remaining alarms for a client */
+/* Loads the remaining alarms in the lookahead window for a client */
 static void
-load_alarms_for_today (ClientAlarms *ca)
+load_alarms_in_lookahead (ClientAlarms *ca)
 {
-	time_t now, from, day_end, day_start;
+	time_t now, from, day_start;
 	icaltimezone *zone;
 
 	now = time (NULL);
 	zone = config_data_get_timezone ();
 	day_start = time_day_begin_with_zone (now, zone);
 
+	if (lookahead_end <= now)
+		lookahead_end = get_lookahead_end (now);
+
 	/* Make sure we don't miss some events from the last notification.
 	 * We add 1 to the saved notification time to make the time ranges
 	 * half-open; we do not want to display the "last" displayed alarm
@@ -735,11 +804,9 @@ load_alarms_for_today (ClientAlarms *ca)
 	if (from <= 0)
 		from = MAX (from, day_start);
 
-	/* Add one hour after midnight, just to cover the delay in 30 minutes
-	 * midnight checking. */
-	day_end = time_day_end_with_zone (now, zone) + (60 * 60);
-	debug (("From %s to %s", e_ctime (&from), e_ctime (&day_end)));
-	load_alarms (ca, from, day_end);
+	debug (("From %s to %s", e_ctime (&from), e_ctime (&lookahead_end)));
+	ca->view_start = 0;
+	load_alarms (ca, from, lookahead_end);
 }
 
 /* Looks up a component's queued alarm structure in a client alarms structure */
@@ -811,6 +878,7 @@ struct _query_msg {
 	Message header;
 	GSList *objects;
 	gpointer data;
+	time_t start;	/* of the added objects, 0 for changed objects */
 };
 
 static GSList *
@@ -886,10 +954,9 @@ static void
 query_objects_changed_async (struct _query_msg *msg)
 {
 	ClientAlarms *ca;
-	time_t from, day_end;
+	time_t from, to;
 	ECalComponentAlarms *alarms;
 	gboolean found;
-	icaltimezone *zone;
 	CompQueuedAlarms *cqa;
 	GSList *l;
 	GSList *objects;
@@ -903,19 +970,25 @@ query_objects_changed_async (struct _query_msg *msg)
 	else
 		from += 1; /* we add 1 to make sure the alarm is not displayed twice */
 
-	zone = config_data_get_timezone ();
+	/* The alarms before the range of the view, which added the objects,
+	 * are queued already, see midnight_refresh_async() */
+	if (msg->start > from)
+		from = msg->start;
+
+	if (lookahead_end <= time (NULL))
+		lookahead_end = get_lookahead_end (time (NULL));
 
-	day_end = time_day_end_with_zone (time (NULL), zone);
+	to = MAX (from, lookahead_end);
 
 	for (l = objects; l != NULL; l = l->next) {
 		ECalComponentId *id;
-		GSList *sl;
+		GSList *sl, *instances, *queued = NULL;
 		ECalComponent *comp = e_cal_component_new ();
 
 		e_cal_component_set_icalcomponent (comp, l->data);
 
 		id = e_cal_component_get_id (comp);
-		found = get_alarms_for_object (ca->cal_client, id, from, day_end, &alarms);
+		found = get_alarms_for_object (ca->cal_client, id, from, to, &alarms);
 
 		if (!found) {
 			debug (("No Alarm found for client %p", ca->cal_client));
@@ -951,13 +1024,24 @@ query_objects_changed_async (struct _query_msg *msg)
 			continue;
 		}
 
-		/* if already in the list, just update it */
-		remove_alarms (cqa, FALSE);
-		cqa->alarms = alarms;
-		cqa->queued_alarms = NULL;
+		if (msg->start) {
+			/* Keep the queued alarms, add those of the appended day */
+			instances = alarms->alarms;
+			alarms->alarms = NULL;
+			e_cal_component_alarms_free (alarms);
+
+			cqa->alarms->alarms = g_slist_concat (cqa->alarms->alarms, instances);
+		} else {
+			/* if already in the list, just update it */
+			remove_alarms (cqa, FALSE);
+			cqa->alarms = alarms;
+			cqa->queued_alarms = NULL;
+
+			instances = cqa->alarms->alarms;
+		}
 
 		/* add the new alarms */
-		for (sl = cqa->alarms->alarms; sl; sl = sl->next) {
+		for (sl = instances; sl; sl = sl->next) {
 			ECalComponentAlarmInstance *instance;
 			gpointer alarm_id;
 			QueuedAlarm *qa;
@@ -976,11 +1060,11 @@ query_objects_changed_async (struct _query_msg *msg)
 			qa->instance = instance;
 			qa->snooze = FALSE;
 			qa->orig_trigger = instance->trigger;
-			cqa->queued_alarms = g_slist_prepend (cqa->queued_alarms, qa);
+			queued = g_slist_prepend (queued, qa);
 			debug (("Adding %p to queue", qa));
 		}
 
-		cqa->queued_alarms = g_slist_reverse (cqa->queued_alarms);
+		cqa->queued_alarms = g_slist_concat (cqa->queued_alarms, g_slist_reverse (queued));
 		g_object_unref (comp);
 		comp = NULL;
 	}
@@ -989,6 +1073,23 @@ query_objects_changed_async (struct _query_msg *msg)
 	g_slice_free (struct _query_msg, msg);
 }
 
+static void
+query_objects_added_cb (ECalClientView *view,
+                        const GSList *objects,
+                        gpointer data)
+{
+	ClientAlarms *ca = data;
+	struct _query_msg *msg;
+
+	msg = g_slice_new0 (struct _query_msg);
+	msg->header.func = (MessageFunc) query_objects_changed_async;
+	msg->objects = duplicate_ical (objects);
+	msg->data = data;
+	msg->start = ca->view_start;
+
+	message_push ((Message *) msg);
+}
+
 static void
 query_objects_modified_cb (ECalClientView *view,
                            const GSList *objects,
@@ -2414,7 +2515,7 @@ alarm_queue_add_async (struct _alarm_client_msg *msg)
 	ca->uid_alarms_hash = g_hash_table_new (
 		(GHashFunc) hash_ids, (GEqualFunc) compare_ids);
 
-	load_alarms_for_today (ca);
+	load_alarms_in_lookahead (ca);
 
 	g_slice_free (struct _alarm_client_msg, msg);
 }
@@ -2585,7 +2686,7 @@ update_cqa (CompQueuedAlarms *cqa,
 
 	zone = config_data_get_timezone ();
 	from = time_day_begin_with_zone (time (NULL), zone);
-	to = time_day_end_with_zone (time (NULL), zone);
+	to = MAX (from, lookahead_end);
 
 	debug (("Generating alarms between %s and %s", e_ctime (&from), e_ctime (&to)));
 	alarms = e_cal_util_generate_alarms_for_comp (
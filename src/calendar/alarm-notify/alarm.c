@@ -36,8 +36,17 @@
 /* Our glib timeout */
 static guint timeout_id;
 
-/* The list of pending alarms */
-static GList *alarms = NULL;
+/* The pending alarms, as a binary min-heap ordered by the trigger time;
+ * the first element is the next alarm to trigger */
+static GPtrArray *alarms = NULL;
+
+/* The set of queued AlarmRecord-s, to recognize stale identifiers */
+static GHashTable *alarms_set = NULL;
+
+/* Queue statistics, for debugging */
+static guint alarms_max_len = 0;
+static guint64 alarms_n_added = 0;
+static guint64 alarms_n_triggered = 0;
 
 /* A queued alarm structure */
 typedef struct {
@@ -45,26 +54,101 @@ typedef struct {
 	AlarmFunction      alarm_fn;
 	gpointer           data;
 	AlarmDestroyNotify destroy_notify_fn;
+
+	/* Position in the 'alarms' heap */
+	guint              index;
 } AlarmRecord;
 
 static void setup_timeout (void);
 
+#define HEAP_LEN() (alarms ? alarms->len : 0)
+#define HEAP_AT(_idx) ((AlarmRecord *) g_ptr_array_index (alarms, (_idx)))
+
+static void
+heap_set (guint index,
+          AlarmRecord *ar)
+{
+	alarms->pdata[index] = ar;
+	ar->index = index;
+}
+
+static void
+heap_sift_up (guint index)
+{
+	AlarmRecord *ar = HEAP_AT (index);
+
+	while (index > 0) {
+		guint parent = (index - 1) / 2;
+
+		if (HEAP_AT (parent)->trigger <= ar->trigger)
+			break;
+
+		heap_set (index, HEAP_AT (parent));
+		index = parent;
+	}
+
+	heap_set (index, ar);
+}
+
+static void
+heap_sift_down (guint index)
+{
+	AlarmRecord *ar = HEAP_AT (index);
+
+	while (TRUE) {
+		guint child = 2 * index + 1;
+
+		if (child >= alarms->len)
+			break;
+
+		if (child + 1 < alarms->len &&
+		    HEAP_AT (child + 1)->trigger < HEAP_AT (child)->trigger)
+			child++;
+
+		if (ar->trigger <= HEAP_AT (child)->trigger)
+			break;
+
+		heap_set (index, HEAP_AT (child));
+		index = child;
+	}
+
+	heap_set (index, ar);
+}
+
+/* Removes the alarm at the @index from the heap.  Does not free it. */
+static void
+heap_remove (guint index)
+{
+	AlarmRecord *last;
+
+	g_hash_table_remove (alarms_set, HEAP_AT (index));
+
+	last = g_ptr_array_remove_index_fast (alarms, alarms->len - 1);
+	if (index == alarms->len)
+		return;
+
+	heap_set (index, last);
+
+	if (index > 0 && HEAP_AT ((index - 1) / 2)->trigger > last->trigger)
+		heap_sift_up (index);
+	else
+		heap_sift_down (index);
+}
+
 /* Removes the head alarm from the queue.  Does not touch the timeout_id. */
 static void
 pop_alarm (void)
 {
 	AlarmRecord *ar;
-	GList *l;
 
-	if (!alarms) {
+	if (!HEAP_LEN ()) {
 		g_warning ("Nothing to pop from the alarm queue");
 		return;
 	}
 
-	ar = alarms->data;
+	ar = HEAP_AT (0);
 
-	l = alarms;
-	alarms = g_list_delete_link (alarms, l);
+	heap_remove (0);
 
 	g_free (ar);
 }
@@ -75,7 +159,7 @@ alarm_ready_cb (gpointer data)
 {
 	time_t now;
 
-	if (!alarms) {
+	if (!HEAP_LEN ()) {
 		g_warning ("Alarm triggered, but no alarm present\n");
 		return FALSE;
 	}
@@ -85,11 +169,11 @@ alarm_ready_cb (gpointer data)
 	now = time (NULL);
 
 	debug (("Alarm callback!"));
-	while (alarms) {
+	while (HEAP_LEN ()) {
 		AlarmRecord *notify_id, *ar;
 		AlarmRecord ar_copy;
 
-		ar = alarms->data;
+		ar = HEAP_AT (0);
 
 		if (ar->trigger > now)
 			break;
@@ -104,6 +188,8 @@ alarm_ready_cb (gpointer data)
 		 * that's why we copy it. */
 		pop_alarm ();
 
+		alarms_n_triggered++;
+
 		(* ar->alarm_fn) (notify_id, ar->trigger, ar->data);
 
 		if (ar->destroy_notify_fn)
@@ -114,7 +200,7 @@ alarm_ready_cb (gpointer data)
 	 * re-entered and added an alarm of its own, so the timer will
 	 * already be set up.
 	 */
-	if (alarms)
+	if (HEAP_LEN ())
 		setup_timeout ();
 
 	return FALSE;
@@ -130,12 +216,12 @@ setup_timeout (void)
 	guint diff;
 	time_t now;
 
-	if (!alarms) {
+	if (!HEAP_LEN ()) {
 		g_warning ("No alarm to setup\n");
 		return;
 	}
 
-	ar = alarms->data;
+	ar = HEAP_AT (0);
 
 	/* Remove the existing time out */
 	if (timeout_id != 0) {
@@ -154,38 +240,31 @@ setup_timeout (void)
 		diff / 60, diff % 60, (gint64) ar->trigger, (gint64) now));
 	debug ((" %s", ctime (&ar->trigger)));
 	debug ((" %s", ctime (&now)));
+	debug ((
+		" queue: %u alarms (max %u), %" G_GUINT64_FORMAT " added, %" G_GUINT64_FORMAT " triggered",
+		HEAP_LEN (), alarms_max_len, alarms_n_added, alarms_n_triggered));
 	timeout_id = e_named_timeout_add_seconds (diff, alarm_ready_cb, NULL);
 }
 
-/* Used from g_list_insert_sorted(); compares the
- * trigger times of two AlarmRecord structures. */
-static gint
-compare_alarm_by_time (gconstpointer a,
-                       gconstpointer b)
-{
-	const AlarmRecord *ara = a;
-	const AlarmRecord *arb = b;
-	time_t diff;
-
-	diff = ara->trigger - arb->trigger;
-	return (diff < 0) ? -1 : (diff > 0) ? 1 : 0;
-}
-
 /* Adds an alarm to the queue and sets up the timer */
 static void
 queue_alarm (AlarmRecord *ar)
 {
-	GList *old_head;
+	if (!alarms) {
+		alarms = g_ptr_array_new ();
+		alarms_set = g_hash_table_new (g_direct_hash, g_direct_equal);
+	}
 
-	/* Track the current head of the list in case there are changes */
-	old_head = alarms;
+	g_ptr_array_add (alarms, ar);
+	g_hash_table_add (alarms_set, ar);
 
-	/* Insert the new alarm in order if the alarm's trigger time is
-	 * after the current time */
-	alarms = g_list_insert_sorted (alarms, ar, compare_alarm_by_time);
+	heap_sift_up (alarms->len - 1);
 
-	/* If there first item on the list didn't change, the time out is fine */
-	if (old_head == alarms)
+	alarms_n_added++;
+	alarms_max_len = MAX (alarms_max_len, alarms->len);
+
+	/* If the head of the queue didn't change, the time out is fine */
+	if (HEAP_AT (0) != ar)
 		return;
 
 	/* Set the timer for removal upon activation */
@@ -237,47 +316,36 @@ alarm_add (time_t trigger,
 void
 alarm_remove (gpointer alarm)
 {
-	AlarmRecord *notify_id, *ar;
-	AlarmRecord ar_copy;
-	AlarmRecord *old_head;
-	GList *l;
+	AlarmRecord *ar;
+	gboolean was_head;
 
 	g_return_if_fail (alarm != NULL);
 
 	ar = alarm;
 
-	l = g_list_find (alarms, ar);
-	if (!l) {
+	if (!alarms_set || !g_hash_table_contains (alarms_set, ar)) {
 		g_warning (G_STRLOC ": Requested removal of nonexistent alarm!");
 		return;
 	}
 
-	old_head = alarms->data;
+	was_head = ar->index == 0;
 
-	notify_id = ar;
-
-	if (old_head == ar) {
-		ar_copy = *ar;
-		ar = &ar_copy;
-
-		/* This will free the original AlarmRecord;
-		 * that's why we copy it. */
-		pop_alarm ();
-	} else {
-		alarms = g_list_delete_link (alarms, l);
-	}
+	heap_remove (ar->index);
 
 	/* Reset the timeout */
-	if (!alarms) {
+	if (!HEAP_LEN ()) {
 		g_source_remove (timeout_id);
 		timeout_id = 0;
+	} else if (was_head) {
+		setup_timeout ();
 	}
 
 	/* Notify about destructiono of the alarm */
 
 	if (ar->destroy_notify_fn)
-		(* ar->destroy_notify_fn) (notify_id, ar->data);
+		(* ar->destroy_notify_fn) (ar, ar->data);
 
+	g_free (ar);
 }
 
 /**
@@ -289,10 +357,10 @@ alarm_remove (gpointer alarm)
 void
 alarm_done (void)
 {
-	GList *l;
+	guint ii;
 
 	if (timeout_id == 0) {
-		if (alarms)
+		if (HEAP_LEN ())
 			g_warning ("No timeout, but queue is not NULL\n");
 		return;
 	}
@@ -300,15 +368,15 @@ alarm_done (void)
 	g_source_remove (timeout_id);
 	timeout_id = 0;
 
-	if (!alarms) {
+	if (!HEAP_LEN ()) {
 		g_warning ("timeout present, freed, but no alarms active\n");
 		return;
 	}
 
-	for (l = alarms; l; l = l->next) {
+	for (ii = 0; ii < alarms->len; ii++) {
 		AlarmRecord *ar;
 
-		ar = l->data;
+		ar = HEAP_AT (ii);
 
 		if (ar->destroy_notify_fn)
 			(* ar->destroy_notify_fn) (ar, ar->data);
@@ -316,8 +384,11 @@ alarm_done (void)
 		g_free (ar);
 	}
 
-	g_list_free (alarms);
+	g_ptr_array_free (alarms, TRUE);
 	alarms = NULL;
+
+	g_hash_table_destroy (alarms_set);
+	alarms_set = NULL;
 }
 
 /**
@@ -328,6 +399,31 @@ alarm_done (void)
 void
 alarm_reschedule_timeout (void)
 {
-	if (alarms)
+	if (HEAP_LEN ())
 		setup_timeout ();
 }
+
+/**
+ * alarm_get_stats:
+ * @out_n_queued: (out) (nullable): where to store the number of queued alarms
+ * @out_max_queued: (out) (nullable): where to store the largest number
+ *    of alarms queued at once
+ * @out_next_trigger: (out) (nullable): where to store the trigger time
+ *    of the next alarm, or -1 when there is none
+ *
+ * Returns statistics of the alarm queue, for debugging.
+ **/
+void
+alarm_get_stats (guint *out_n_queued,
+                 guint *out_max_queued,
+                 time_t *out_next_trigger)
+{
+	if (out_n_queued)
+		*out_n_queued = HEAP_LEN ();
+
+	if (out_max_queued)
+		*out_max_queued = alarms_max_len;
+
+	if (out_next_trigger)
+		*out_next_trigger = HEAP_LEN () ? HEAP_AT (0)->trigger : (time_t) -1;
+}
@@ -39,4 +39,7 @@ void alarm_remove (gpointer alarm);
 
 void alarm_reschedule_timeout (void);
 
+void alarm_get_stats (guint *out_n_queued, guint *out_max_queued,
+		      time_t *out_next_trigger);
+
 #endif
@@ -287,7 +287,8 @@ destination_list_to_vector (GList *list)
 	return destination_list_to_vector_sized (list, -1);
 }
 
-#define LINE_LEN 72
+/* The longest line allowed in a 7bit part, without the CRLF (RFC 5322) */
+#define MAX_7BIT_LINE_LEN 998
 
 static gboolean
 text_requires_quoted_printable (const gchar *text,
@@ -313,42 +314,190 @@ text_requires_quoted_printable (const gchar *text,
 	return FALSE;
 }
 
+/* What is known about a UTF-8 text after a single scan of it */
+typedef struct _TextStats {
+	gboolean is_ascii;
+	gboolean is_valid_utf8;
+	gboolean has_from_line;	/* a line begins with "From " */
+	gsize n_8bit;		/* count of bytes with the highest bit set */
+	gsize max_line_len;	/* in bytes, without the line end */
+} TextStats;
+
+static gsize
+count_8bit_bytes (const guchar *data,
+                  gsize len)
+{
+	gsize count = 0;
+
+	while (len > 0) {
+		count += (*data) >> 7;
+		data++;
+		len--;
+	}
+
+	return count;
+}
+
+static gboolean
+text_has_from_line_at (const guchar *text,
+                       gsize len,
+                       gsize pos)
+{
+	return (pos == 0 || text[pos - 1] == '\n') && pos + 5 <= len &&
+		strncmp ((const gchar *) text + pos, "From ", 5) == 0;
+}
+
+static void
+text_stats_end_line (const guchar *text,
+                     gsize line_start,
+                     gsize line_end,
+                     TextStats *stats)
+{
+	if (line_end > line_start && text[line_end - 1] == '\r')
+		line_end--;
+
+	stats->max_line_len = MAX (stats->max_line_len, line_end - line_start);
+}
+
+static void
+text_stats_check_lines (const guchar *text,
+                        gsize len,
+                        gsize from,
+                        gsize to,
+                        gsize *line_start,
+                        TextStats *stats)
+{
+	for (; from < to; from++) {
+		if (text[from] != '\n')
+			continue;
+
+		text_stats_end_line (text, *line_start, from, stats);
+		*line_start = from + 1;
+
+		if (!stats->has_from_line)
+			stats->has_from_line = text_has_from_line_at (text, len, from + 1);
+	}
+}
+
+/* Checks the text a machine word at a time, which makes the common case,
+ * a pure ASCII text, cheap; only words with 8-bit bytes are counted and
+ * only words with a new line are looked at for the line lengths and
+ * a "From " line. */
+static void
+text_stats_scan (const GByteArray *buf,
+                 TextStats *stats)
+{
+	const gsize low_bits = ((gsize) -1) / 0xFF;
+	const gsize high_bits = low_bits * 0x80;
+	const gsize new_lines = low_bits * '\n';
+	const guchar *data = buf->data;
+	gsize len = buf->len, pos = 0, line_start = 0;
+
+	stats->n_8bit = 0;
+	stats->max_line_len = 0;
+	stats->has_from_line = text_has_from_line_at (data, len, 0);
+
+	for (; pos + sizeof (gsize) <= len; pos += sizeof (gsize)) {
+		gsize word, nl;
+
+		memcpy (&word, data + pos, sizeof (gsize));
+
+		if ((word & high_bits) != 0)
+			stats->n_8bit += count_8bit_bytes (data + pos, sizeof (gsize));
+
+		/* Non-zero when any of the bytes is a new line */
+		nl = word ^ new_lines;
+		if (((nl - low_bits) & ~nl & high_bits) != 0)
+			text_stats_check_lines (data, len, pos, pos + sizeof (gsize), &line_start, stats);
+	}
+
+	stats->n_8bit += count_8bit_bytes (data + pos, len - pos);
+	text_stats_check_lines (data, len, pos, len, &line_start, stats);
+	text_stats_end_line (data, line_start, len, stats);
+
+	stats->is_ascii = stats->n_8bit == 0;
+	stats->is_valid_utf8 = stats->is_ascii ||
+		g_utf8_validate ((const gchar *) buf->data, buf->len, NULL);
+}
+
+static gboolean
+charset_is_utf8 (const gchar *charset)
+{
+	return g_ascii_strcasecmp (charset, "UTF-8") == 0 ||
+		g_ascii_strcasecmp (charset, "UTF8") == 0;
+}
+
+static gboolean
+charset_is_ascii (const gchar *charset)
+{
+	return g_ascii_strcasecmp (charset, "US-ASCII") == 0 ||
+		g_ascii_strcasecmp (charset, "ASCII") == 0;
+}
+
+/* Whether a pure ASCII text is the same in the @charset */
+static gboolean
+charset_is_ascii_compatible (const gchar *charset)
+{
+	return g_ascii_strncasecmp (charset, "UTF-7", 5) != 0 &&
+		g_ascii_strncasecmp (charset, "UTF-16", 6) != 0 &&
+		g_ascii_strncasecmp (charset, "UTF-32", 6) != 0 &&
+		g_ascii_strncasecmp (charset, "UCS", 3) != 0;
+}
+
 static gboolean
 best_encoding (GByteArray *buf,
+               const TextStats *stats,
                const gchar *charset,
 	       CamelTransferEncoding *encoding)
 {
-	gchar *in, *out, outbuf[256], *ch;
-	gsize inlen, outlen;
-	gint status, count = 0;
-	iconv_t cd;
+	gsize count = 0;
 
 	if (!charset)
 		return FALSE;
 
-	cd = camel_iconv_open (charset, "utf-8");
-	if (cd == (iconv_t) -1)
-		return FALSE;
+	/* The text is in UTF-8, thus the result of the conversion
+	 * into these is known without doing it. */
+	if (charset_is_ascii (charset)) {
+		if (!stats->is_ascii)
+			return FALSE;
+	} else if (stats->is_ascii && charset_is_ascii_compatible (charset)) {
+		/* Nothing to convert, as long as iconv knows the charset */
+		iconv_t cd;
 
-	in = (gchar *) buf->data;
-	inlen = buf->len;
-	do {
-		out = outbuf;
-		outlen = sizeof (outbuf);
-		status = camel_iconv (cd, (const gchar **) &in, &inlen, &out, &outlen);
-		for (ch = out - 1; ch >= outbuf; ch--) {
-			if ((guchar) *ch > 127)
-				count++;
-		}
-	} while (status == (gsize) -1 && errno == E2BIG);
-	camel_iconv_close (cd);
+		cd = camel_iconv_open (charset, "utf-8");
+		if (cd == (iconv_t) -1)
+			return FALSE;
+		camel_iconv_close (cd);
+	} else if (charset_is_utf8 (charset)) {
+		if (!stats->is_valid_utf8)
+			return FALSE;
 
-	if (status == (gsize) -1 || status > 0)
-		return FALSE;
+		count = stats->n_8bit;
+	} else {
+		gchar *in, *out, outbuf[4096];
+		gsize inlen, outlen;
+		gint status;
+		iconv_t cd;
 
-	if ((count == 0) && (buf->len < LINE_LEN) &&
-		!text_requires_quoted_printable (
-		(const gchar *) buf->data, buf->len))
+		cd = camel_iconv_open (charset, "utf-8");
+		if (cd == (iconv_t) -1)
+			return FALSE;
+
+		in = (gchar *) buf->data;
+		inlen = buf->len;
+		do {
+			out = outbuf;
+			outlen = sizeof (outbuf);
+			status = camel_iconv (cd, (const gchar **) &in, &inlen, &out, &outlen);
+			count += count_8bit_bytes ((const guchar *) outbuf, out - outbuf);
+		} while (status == (gsize) -1 && errno == E2BIG);
+		camel_iconv_close (cd);
+
+		if (status == (gsize) -1 || status > 0)
+			return FALSE;
+	}
+
+	if (count == 0 && stats->max_line_len <= MAX_7BIT_LINE_LEN && !stats->has_from_line)
 		*encoding = CAMEL_TRANSFER_ENCODING_7BIT;
 	else if (count <= buf->len * 0.17)
 		*encoding = CAMEL_TRANSFER_ENCODING_QUOTEDPRINTABLE;
@@ -363,20 +512,23 @@ best_charset (GByteArray *buf,
               const gchar *default_charset,
               CamelTransferEncoding *encoding)
 {
+	TextStats stats;
 	const gchar *charset;
 
+	text_stats_scan (buf, &stats);
+
 	/* First try US-ASCII */
-	if (best_encoding (buf, "US-ASCII", encoding) &&
+	if (best_encoding (buf, &stats, "US-ASCII", encoding) &&
 	    *encoding == CAMEL_TRANSFER_ENCODING_7BIT)
 		return NULL;
 
 	/* Next try the user-specified charset for this message */
-	if (best_encoding (buf, default_charset, encoding))
+	if (best_encoding (buf, &stats, default_charset, encoding))
 		return g_strdup (default_charset);
 
 	/* Now try the user's default charset from the mail config */
 	charset = e_composer_get_default_charset ();
-	if (best_encoding (buf, charset, encoding))
+	if (best_encoding (buf, &stats, charset, encoding))
 		return g_strdup (charset);
 
 	/* Try to find something that will work */
@@ -387,7 +539,7 @@ best_charset (GByteArray *buf,
 		return NULL;
 	}
 
-	if (!best_encoding (buf, charset, encoding))
+	if (!best_encoding (buf, &stats, charset, encoding))
 		*encoding = CAMEL_TRANSFER_ENCODING_BASE64;
 
 	return g_strdup (charset);
@@ -32,6 +32,7 @@
 
 #include <libedataserver/libedataserver.h>
 
+#include "e-file-data-wrapper.h"
 #include "e-icon-factory.h"
 #include "e-mktemp.h"
 #include "e-misc-utils.h"
@@ -57,6 +58,11 @@
 /* Attributes needed for EAttachmentStore columns. */
 #define ATTACHMENT_QUERY "standard::*,preview::*,thumbnail::*"
 
+/* Regular local files of at least this size are not loaded into
+ * memory, the attachment content is read from a private copy
+ * of the file only when it's needed. */
+#define ATTACHMENT_FILE_BACKED_MIN_SIZE (1024 * 1024)
+
 struct _EAttachmentPrivate {
 	GMutex property_lock;
 
@@ -1770,6 +1776,8 @@ struct _LoadContext {
 	GInputStream *input_stream;
 	GOutputStream *output_stream;
 	GFileInfo *file_info;
+	GFile *private_copy;
+	CamelDataWrapper *file_wrapper;
 	goffset total_num_bytes;
 	gssize bytes_read;
 	gchar buffer[4096];
@@ -1826,6 +1834,12 @@ attachment_load_context_free (LoadContext *load_context)
 	if (load_context->file_info != NULL)
 		g_object_unref (load_context->file_info);
 
+	if (load_context->private_copy != NULL)
+		g_object_unref (load_context->private_copy);
+
+	if (load_context->file_wrapper != NULL)
+		g_object_unref (load_context->file_wrapper);
+
 	g_slice_free (LoadContext, load_context);
 }
 
@@ -1870,25 +1884,34 @@ attachment_load_finish (LoadContext *load_context)
 
 	file_info = load_context->file_info;
 	attachment = load_context->attachment;
-	output_stream = G_MEMORY_OUTPUT_STREAM (load_context->output_stream);
-
-	if (e_attachment_is_rfc822 (attachment))
-		wrapper = (CamelDataWrapper *) camel_mime_message_new ();
-	else
-		wrapper = camel_data_wrapper_new ();
 
 	content_type = g_file_info_get_content_type (file_info);
 	mime_type = g_content_type_get_mime_type (content_type);
 
-	data = g_memory_output_stream_get_data (output_stream);
-	size = g_memory_output_stream_get_data_size (output_stream);
+	if (load_context->file_wrapper != NULL) {
+		/* The content is streamed from the disk when needed. */
+		wrapper = g_object_ref (load_context->file_wrapper);
+		camel_data_wrapper_set_mime_type (wrapper, mime_type);
 
-	stream = camel_stream_mem_new_with_buffer (data, size);
-	camel_data_wrapper_construct_from_stream_sync (
-		wrapper, stream, NULL, NULL);
-	camel_data_wrapper_set_mime_type (wrapper, mime_type);
-	camel_stream_close (stream, NULL, NULL);
-	g_object_unref (stream);
+		size = g_file_info_get_size (file_info);
+	} else {
+		output_stream = G_MEMORY_OUTPUT_STREAM (load_context->output_stream);
+
+		if (e_attachment_is_rfc822 (attachment))
+			wrapper = (CamelDataWrapper *) camel_mime_message_new ();
+		else
+			wrapper = camel_data_wrapper_new ();
+
+		data = g_memory_output_stream_get_data (output_stream);
+		size = g_memory_output_stream_get_data_size (output_stream);
+
+		stream = camel_stream_mem_new_with_buffer (data, size);
+		camel_data_wrapper_construct_from_stream_sync (
+			wrapper, stream, NULL, NULL);
+		camel_data_wrapper_set_mime_type (wrapper, mime_type);
+		camel_stream_close (stream, NULL, NULL);
+		g_object_unref (stream);
+	}
 
 	mime_part = camel_mime_part_new ();
 	camel_medium_set_content (CAMEL_MEDIUM (mime_part), wrapper);
@@ -2045,6 +2068,99 @@ attachment_load_file_read_cb (GFile *file,
 		load_context);
 }
 
+static gboolean
+attachment_load_can_be_file_backed (EAttachment *attachment,
+                                    GFile *file,
+                                    GFileInfo *file_info)
+{
+	/* Messages are parsed, thus they need to be in memory. */
+	if (e_attachment_is_rfc822 (attachment))
+		return FALSE;
+
+	return g_file_is_native (file) &&
+		g_file_info_get_file_type (file_info) == G_FILE_TYPE_REGULAR &&
+		g_file_info_get_size (file_info) >= ATTACHMENT_FILE_BACKED_MIN_SIZE;
+}
+
+static void
+attachment_load_file_copy_cb (GFile *file,
+                              GAsyncResult *result,
+                              LoadContext *load_context)
+{
+	EAttachment *attachment;
+	GError *error = NULL;
+
+	/* The wrapper keeps the copy open, thus the content is available
+	 * even after the temporary directory expires, see e_mkdtemp(). */
+	if (g_file_copy_finish (file, result, &error)) {
+		load_context->file_wrapper = e_file_data_wrapper_new (
+			load_context->private_copy,
+			load_context->attachment->priv->cancellable, &error);
+
+		if (load_context->file_wrapper) {
+			attachment_load_finish (load_context);
+			return;
+		}
+	}
+
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		attachment_load_check_for_error (load_context, error);
+		return;
+	}
+
+	/* Fall back to reading the file into memory. */
+	g_clear_error (&error);
+	g_clear_object (&load_context->private_copy);
+
+	attachment = load_context->attachment;
+
+	g_file_read_async (
+		file, G_PRIORITY_DEFAULT,
+		attachment->priv->cancellable, (GAsyncReadyCallback)
+		attachment_load_file_read_cb, load_context);
+}
+
+/* Makes a private copy of the file, thus the user can change or delete
+ * the original file while the message is being composed. The copy uses
+ * copy-on-write (reflink) when the file system supports it. */
+static void
+attachment_load_file_backed (GFile *file,
+                             LoadContext *load_context)
+{
+	EAttachment *attachment;
+	GFile *temp_directory;
+	gchar *basename;
+	GError *error = NULL;
+
+	attachment = load_context->attachment;
+
+	temp_directory = attachment_get_temporary (&error);
+	if (!temp_directory) {
+		/* Not fatal, read the file into memory instead. */
+		g_clear_error (&error);
+
+		g_file_read_async (
+			file, G_PRIORITY_DEFAULT,
+			attachment->priv->cancellable, (GAsyncReadyCallback)
+			attachment_load_file_read_cb, load_context);
+		return;
+	}
+
+	basename = g_file_get_basename (file);
+	load_context->private_copy = g_file_get_child (
+		temp_directory, basename ? basename : "attachment");
+	g_free (basename);
+
+	g_file_copy_async (
+		file, load_context->private_copy,
+		G_FILE_COPY_OVERWRITE | G_FILE_COPY_NOFOLLOW_SYMLINKS,
+		G_PRIORITY_DEFAULT, attachment->priv->cancellable,
+		(GFileProgressCallback) attachment_progress_cb, attachment,
+		(GAsyncReadyCallback) attachment_load_file_copy_cb, load_context);
+
+	g_object_unref (temp_directory);
+}
+
 #ifdef HAVE_AUTOAR
 static void
 attachment_load_created_decide_dest_cb (AutoarCompressor *compressor,
@@ -2167,10 +2283,13 @@ attachment_load_query_info_cb (GFile *file,
 		g_object_unref (temporary);
 	} else {
 #endif
-		g_file_read_async (
-			file, G_PRIORITY_DEFAULT,
-			cancellable, (GAsyncReadyCallback)
-			attachment_load_file_read_cb, load_context);
+		if (attachment_load_can_be_file_backed (attachment, file, file_info))
+			attachment_load_file_backed (file, load_context);
+		else
+			g_file_read_async (
+				file, G_PRIORITY_DEFAULT,
+				cancellable, (GAsyncReadyCallback)
+				attachment_load_file_read_cb, load_context);
 #ifdef HAVE_AUTOAR
 	}
 #endif
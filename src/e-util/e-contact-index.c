@@ -0,0 +1,678 @@
+/*
+ * e-contact-index.c
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * SECTION: e-contact-index
+ * @include: e-util/e-util.h
+ * @short_description: In-memory prefix index of contacts
+ *
+ * #EContactIndex keeps contacts with an email address of one #EBookClient
+ * in memory, together with a sorted array of keys built from their names,
+ * nicknames and email addresses.  The index is kept up to date by a running
+ * #EBookClientView, thus prefix lookups, as used by the recipient
+ * autocompletion, are answered synchronously, without a new query.
+ *
+ * The keys are case folded and start at every word of the indexed values,
+ * thus "smi" matches "John Smith" and "jsmith@example.com" alike.
+ *
+ * There is one #EContactIndex for each #EBookClient, use e_contact_index_ref()
+ * to get it.
+ **/
+
+#include "evolution-config.h"
+
+#include <string.h>
+
+#include "e-contact-index.h"
+
+#define E_CONTACT_INDEX_GET_PRIVATE(obj) \
+	(G_TYPE_INSTANCE_GET_PRIVATE \
+	((obj), E_TYPE_CONTACT_INDEX, EContactIndexPrivate))
+
+#define CONTACT_INDEX_KEY "e-contact-index"
+
+/* Characters, after which an indexed word starts. */
+#define WORD_SEPARATORS " \t,.-_@<>()\"'"
+
+typedef struct _IndexedContact {
+	EContact *contact;
+	GPtrArray *values;	/* gchar *, folded, owned */
+} IndexedContact;
+
+typedef struct _IndexKey {
+	const gchar *key;	/* points into IndexedContact::values */
+	IndexedContact *indexed;
+} IndexKey;
+
+struct _EContactIndexPrivate {
+	GWeakRef client;
+	GCancellable *cancellable;
+	EBookClientView *client_view;
+	gboolean complete;
+
+	GHashTable *contacts;	/* gchar *uid ~> IndexedContact * */
+	GArray *keys;		/* IndexKey */
+	gboolean keys_sorted;
+};
+
+enum {
+	CHANGED,
+	LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL];
+
+G_DEFINE_TYPE (EContactIndex, e_contact_index, G_TYPE_OBJECT)
+
+static gchar *
+contact_index_fold (const gchar *value)
+{
+	gchar *folded, *normalized;
+
+	folded = g_utf8_casefold (value, -1);
+	normalized = g_utf8_normalize (folded, -1, G_NORMALIZE_DEFAULT);
+
+	if (normalized) {
+		g_free (folded);
+		folded = normalized;
+	}
+
+	return folded;
+}
+
+/* Returns folded values of the @contact, which are indexed. */
+static GPtrArray *
+contact_index_get_values (EContact *contact)
+{
+	EContactField fields[] = {
+		E_CONTACT_FULL_NAME,
+		E_CONTACT_FILE_AS,
+		E_CONTACT_NICKNAME
+	};
+	GPtrArray *values;
+	GList *emails, *link;
+	gint ii;
+
+	values = g_ptr_array_new_with_free_func (g_free);
+
+	for (ii = 0; ii < G_N_ELEMENTS (fields); ii++) {
+		const gchar *value;
+
+		value = e_contact_get_const (contact, fields[ii]);
+		if (value && *value)
+			g_ptr_array_add (values, contact_index_fold (value));
+	}
+
+	/* Email addresses of contact lists are not matched. */
+	if (!e_contact_get (contact, E_CONTACT_IS_LIST)) {
+		emails = e_contact_get (contact, E_CONTACT_EMAIL);
+
+		for (link = emails; link; link = g_list_next (link)) {
+			const gchar *value = link->data;
+
+			if (value && *value)
+				g_ptr_array_add (values, contact_index_fold (value));
+		}
+
+		g_list_free_full (emails, g_free);
+	}
+
+	return values;
+}
+
+static gboolean
+contact_index_is_word_start (const gchar *value,
+                             const gchar *pos)
+{
+	if (pos == value)
+		return TRUE;
+
+	return strchr (WORD_SEPARATORS, *(pos - 1)) != NULL &&
+		strchr (WORD_SEPARATORS, *pos) == NULL;
+}
+
+static void
+indexed_contact_free (gpointer ptr)
+{
+	IndexedContact *indexed = ptr;
+
+	if (indexed) {
+		g_object_unref (indexed->contact);
+		g_ptr_array_unref (indexed->values);
+		g_slice_free (IndexedContact, indexed);
+	}
+}
+
+static gint
+contact_index_compare_keys (gconstpointer ptr1,
+                            gconstpointer ptr2)
+{
+	const IndexKey *key1 = ptr1, *key2 = ptr2;
+
+	return strcmp (key1->key, key2->key);
+}
+
+static void
+contact_index_remove_keys (EContactIndex *contact_index,
+                           GHashTable *indexed_set)
+{
+	GArray *keys = contact_index->priv->keys;
+	guint ii, jj;
+
+	/* Compacts the array in one pass, which keeps it sorted. */
+	for (ii = 0, jj = 0; ii < keys->len; ii++) {
+		IndexKey *key = &g_array_index (keys, IndexKey, ii);
+
+		if (g_hash_table_contains (indexed_set, key->indexed))
+			continue;
+
+		if (ii != jj)
+			g_array_index (keys, IndexKey, jj) = *key;
+		jj++;
+	}
+
+	g_array_set_size (keys, jj);
+}
+
+static void
+contact_index_add_contact (EContactIndex *contact_index,
+                           EContact *contact)
+{
+	IndexedContact *indexed;
+	const gchar *uid;
+	guint ii;
+
+	uid = e_contact_get_const (contact, E_CONTACT_UID);
+	if (!uid)
+		return;
+
+	indexed = g_slice_new0 (IndexedContact);
+	indexed->contact = g_object_ref (contact);
+	indexed->values = contact_index_get_values (contact);
+
+	for (ii = 0; ii < indexed->values->len; ii++) {
+		const gchar *value = g_ptr_array_index (indexed->values, ii);
+		const gchar *pos;
+
+		for (pos = value; *pos; pos++) {
+			if (contact_index_is_word_start (value, pos)) {
+				IndexKey key;
+
+				key.key = pos;
+				key.indexed = indexed;
+
+				g_array_append_val (contact_index->priv->keys, key);
+			}
+		}
+	}
+
+	contact_index->priv->keys_sorted = FALSE;
+
+	g_hash_table_insert (contact_index->priv->contacts, g_strdup (uid), indexed);
+}
+
+static void
+contact_index_objects_added_cb (EBookClientView *client_view,
+                                const GSList *contacts,
+                                EContactIndex *contact_index)
+{
+	const GSList *link;
+
+	for (link = contacts; link; link = g_slist_next (link))
+		contact_index_add_contact (contact_index, link->data);
+
+	if (contact_index->priv->complete)
+		g_signal_emit (contact_index, signals[CHANGED], 0);
+}
+
+static void
+contact_index_remove_uids (EContactIndex *contact_index,
+                           const GSList *uids)
+{
+	GHashTable *indexed_set;
+	const GSList *link;
+
+	indexed_set = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	for (link = uids; link; link = g_slist_next (link)) {
+		IndexedContact *indexed;
+
+		indexed = g_hash_table_lookup (contact_index->priv->contacts, link->data);
+		if (indexed)
+			g_hash_table_add (indexed_set, indexed);
+	}
+
+	if (g_hash_table_size (indexed_set) > 0) {
+		contact_index_remove_keys (contact_index, indexed_set);
+
+		for (link = uids; link; link = g_slist_next (link))
+			g_hash_table_remove (contact_index->priv->contacts, link->data);
+	}
+
+	g_hash_table_destroy (indexed_set);
+}
+
+static void
+contact_index_objects_modified_cb (EBookClientView *client_view,
+                                   const GSList *contacts,
+                                   EContactIndex *contact_index)
+{
+	GSList *uids = NULL;
+	const GSList *link;
+
+	for (link = contacts; link; link = g_slist_next (link)) {
+		const gchar *uid = e_contact_get_const (link->data, E_CONTACT_UID);
+
+		if (uid)
+			uids = g_slist_prepend (uids, (gpointer) uid);
+	}
+
+	contact_index_remove_uids (contact_index, uids);
+	g_slist_free (uids);
+
+	for (link = contacts; link; link = g_slist_next (link))
+		contact_index_add_contact (contact_index, link->data);
+
+	if (contact_index->priv->complete)
+		g_signal_emit (contact_index, signals[CHANGED], 0);
+}
+
+static void
+contact_index_objects_removed_cb (EBookClientView *client_view,
+                                  const GSList *uids,
+                                  EContactIndex *contact_index)
+{
+	contact_index_remove_uids (contact_index, uids);
+
+	if (contact_index->priv->complete)
+		g_signal_emit (contact_index, signals[CHANGED], 0);
+}
+
+static void
+contact_index_complete_cb (EBookClientView *client_view,
+                           const GError *error,
+                           EContactIndex *contact_index)
+{
+	if (error) {
+		g_warning ("%s: %s", G_STRFUNC, error->message);
+		return;
+	}
+
+	if (!contact_index->priv->complete) {
+		contact_index->priv->complete = TRUE;
+		g_signal_emit (contact_index, signals[CHANGED], 0);
+	}
+}
+
+static void
+contact_index_view_ready_cb (GObject *source_object,
+                             GAsyncResult *result,
+                             gpointer user_data)
+{
+	EContactIndex *contact_index = user_data;
+	EBookClientView *client_view = NULL;
+	GError *error = NULL;
+
+	e_book_client_get_view_finish (E_BOOK_CLIENT (source_object), result, &client_view, &error);
+
+	if (client_view && !g_cancellable_is_cancelled (contact_index->priv->cancellable)) {
+		contact_index->priv->client_view = client_view;
+
+		g_signal_connect (
+			client_view, "objects-added",
+			G_CALLBACK (contact_index_objects_added_cb), contact_index);
+		g_signal_connect (
+			client_view, "objects-modified",
+			G_CALLBACK (contact_index_objects_modified_cb), contact_index);
+		g_signal_connect (
+			client_view, "objects-removed",
+			G_CALLBACK (contact_index_objects_removed_cb), contact_index);
+		g_signal_connect (
+			client_view, "complete",
+			G_CALLBACK (contact_index_complete_cb), contact_index);
+
+		e_book_client_view_start (client_view, NULL);
+	} else {
+		if (error && !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("%s: %s", G_STRFUNC, error->message);
+
+		g_clear_object (&client_view);
+	}
+
+	g_clear_error (&error);
+	g_object_unref (contact_index);
+}
+
+static gpointer
+contact_index_stop_view_in_thread (gpointer user_data)
+{
+	EBookClientView *client_view = user_data;
+
+	/* this does blocking D-Bus call, thus do it in a dedicated thread */
+	e_book_client_view_stop (client_view, NULL);
+	g_object_unref (client_view);
+
+	return NULL;
+}
+
+static void
+contact_index_dispose (GObject *object)
+{
+	EContactIndexPrivate *priv;
+
+	priv = E_CONTACT_INDEX_GET_PRIVATE (object);
+
+	if (priv->cancellable) {
+		g_cancellable_cancel (priv->cancellable);
+		g_clear_object (&priv->cancellable);
+	}
+
+	if (priv->client_view) {
+		GThread *thread;
+
+		g_signal_handlers_disconnect_matched (
+			priv->client_view, G_SIGNAL_MATCH_DATA,
+			0, 0, NULL, NULL, object);
+
+		thread = g_thread_new (NULL, contact_index_stop_view_in_thread, priv->client_view);
+		g_thread_unref (thread);
+
+		priv->client_view = NULL;
+	}
+
+	/* Chain up to parent's dispose() method. */
+	G_OBJECT_CLASS (e_contact_index_parent_class)->dispose (object);
+}
+
+static void
+contact_index_finalize (GObject *object)
+{
+	EContactIndexPrivate *priv;
+
+	priv = E_CONTACT_INDEX_GET_PRIVATE (object);
+
+	g_weak_ref_clear (&priv->client);
+	g_array_free (priv->keys, TRUE);
+	g_hash_table_destroy (priv->contacts);
+
+	/* Chain up to parent's finalize() method. */
+	G_OBJECT_CLASS (e_contact_index_parent_class)->finalize (object);
+}
+
+static void
+e_contact_index_class_init (EContactIndexClass *class)
+{
+	GObjectClass *object_class;
+
+	g_type_class_add_private (class, sizeof (EContactIndexPrivate));
+
+	object_class = G_OBJECT_CLASS (class);
+	object_class->dispose = contact_index_dispose;
+	object_class->finalize = contact_index_finalize;
+
+	/**
+	 * EContactIndex::changed:
+	 * @contact_index: the #EContactIndex which emitted the signal
+	 *
+	 * Emitted when the index finished its initial load and then
+	 * whenever any of the indexed contacts is added, modified
+	 * or removed.
+	 *
+	 * Since: 3.28
+	 **/
+	signals[CHANGED] = g_signal_new (
+		"changed",
+		G_TYPE_FROM_CLASS (class),
+		G_SIGNAL_RUN_LAST,
+		G_STRUCT_OFFSET (EContactIndexClass, changed),
+		NULL, NULL, NULL,
+		G_TYPE_NONE, 0);
+}
+
+static void
+e_contact_index_init (EContactIndex *contact_index)
+{
+	contact_index->priv = E_CONTACT_INDEX_GET_PRIVATE (contact_index);
+
+	g_weak_ref_init (&contact_index->priv->client, NULL);
+	contact_index->priv->cancellable = g_cancellable_new ();
+	contact_index->priv->contacts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, indexed_contact_free);
+	contact_index->priv->keys = g_array_new (FALSE, FALSE, sizeof (IndexKey));
+	contact_index->priv->keys_sorted = TRUE;
+}
+
+/**
+ * e_contact_index_ref:
+ * @book_client: an #EBookClient
+ *
+ * Returns the #EContactIndex of the @book_client, creating it, if needed.
+ * The index is shared by all callers and lives as long as the @book_client.
+ * Right after being created, the index is loading the contacts; see
+ * e_contact_index_is_complete().
+ *
+ * Unreference the returned #EContactIndex with g_object_unref() when
+ * finished with it.
+ *
+ * Returns: (transfer full): an #EContactIndex for the @book_client
+ *
+ * Since: 3.28
+ **/
+EContactIndex *
+e_contact_index_ref (EBookClient *book_client)
+{
+	EContactIndex *contact_index;
+
+	g_return_val_if_fail (E_IS_BOOK_CLIENT (book_client), NULL);
+
+	contact_index = g_object_get_data (G_OBJECT (book_client), CONTACT_INDEX_KEY);
+
+	if (!contact_index) {
+		EBookQuery *book_query;
+		gchar *query_str;
+
+		contact_index = g_object_new (E_TYPE_CONTACT_INDEX, NULL);
+		g_weak_ref_set (&contact_index->priv->client, book_client);
+
+		g_object_set_data_full (
+			G_OBJECT (book_client), CONTACT_INDEX_KEY,
+			contact_index, g_object_unref);
+
+		/* Only contacts with an email address can be completed. */
+		book_query = e_book_query_field_exists (E_CONTACT_EMAIL);
+		query_str = e_book_query_to_string (book_query);
+		e_book_query_unref (book_query);
+
+		e_book_client_get_view (
+			book_client, query_str,
+			contact_index->priv->cancellable,
+			contact_index_view_ready_cb,
+			g_object_ref (contact_index));
+
+		g_free (query_str);
+	}
+
+	return g_object_ref (contact_index);
+}
+
+/**
+ * e_contact_index_ref_client:
+ * @contact_index: an #EContactIndex
+ *
+ * Returns the #EBookClient the @contact_index is for.
+ *
+ * Unreference the returned #EBookClient with g_object_unref() when
+ * finished with it.
+ *
+ * Returns: (transfer full) (nullable): an #EBookClient, or %NULL,
+ *    when it was freed meanwhile
+ *
+ * Since: 3.28
+ **/
+EBookClient *
+e_contact_index_ref_client (EContactIndex *contact_index)
+{
+	g_return_val_if_fail (E_IS_CONTACT_INDEX (contact_index), NULL);
+
+	return g_weak_ref_get (&contact_index->priv->client);
+}
+
+/**
+ * e_contact_index_is_complete:
+ * @contact_index: an #EContactIndex
+ *
+ * Returns whether the @contact_index loaded all contacts, thus its lookups
+ * return all matching contacts.
+ *
+ * Returns: whether the initial load of the @contact_index finished
+ *
+ * Since: 3.28
+ **/
+gboolean
+e_contact_index_is_complete (EContactIndex *contact_index)
+{
+	g_return_val_if_fail (E_IS_CONTACT_INDEX (contact_index), FALSE);
+
+	return contact_index->priv->complete;
+}
+
+/**
+ * e_contact_index_lookup:
+ * @contact_index: an #EContactIndex
+ * @prefix: a prefix to look up
+ *
+ * Looks up contacts, whose name, file-as, nickname or an email address
+ * has a word starting with @prefix, ignoring the letter case.
+ *
+ * Free the returned #GPtrArray with g_ptr_array_unref() when finished
+ * with it.
+ *
+ * Returns: (transfer container) (element-type EContact): a #GPtrArray
+ *    of matching #EContact-s, each of them at most once
+ *
+ * Since: 3.28
+ **/
+GPtrArray *
+e_contact_index_lookup (EContactIndex *contact_index,
+                        const gchar *prefix)
+{
+	GArray *keys;
+	GPtrArray *matches;
+	GHashTable *seen;
+	gchar *folded;
+	gsize folded_len;
+	guint lower, upper;
+
+	g_return_val_if_fail (E_IS_CONTACT_INDEX (contact_index), NULL);
+	g_return_val_if_fail (prefix != NULL, NULL);
+
+	keys = contact_index->priv->keys;
+	matches = g_ptr_array_new_with_free_func (g_object_unref);
+
+	if (!*prefix)
+		return matches;
+
+	/* The initial load adds the keys unsorted, sort them on demand. */
+	if (!contact_index->priv->keys_sorted) {
+		g_array_sort (keys, contact_index_compare_keys);
+		contact_index->priv->keys_sorted = TRUE;
+	}
+
+	folded = contact_index_fold (prefix);
+	folded_len = strlen (folded);
+
+	/* Find the first key not less than the prefix. */
+	lower = 0;
+	upper = keys->len;
+
+	while (lower < upper) {
+		guint middle = lower + (upper - lower) / 2;
+
+		if (strcmp (g_array_index (keys, IndexKey, middle).key, folded) < 0)
+			lower = middle + 1;
+		else
+			upper = middle;
+	}
+
+	seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	for (; lower < keys->len; lower++) {
+		IndexKey *key = &g_array_index (keys, IndexKey, lower);
+
+		if (strncmp (key->key, folded, folded_len) != 0)
+			break;
+
+		if (g_hash_table_contains (seen, key->indexed))
+			continue;
+
+		g_hash_table_add (seen, key->indexed);
+		g_ptr_array_add (matches, g_object_ref (key->indexed->contact));
+	}
+
+	g_hash_table_destroy (seen);
+	g_free (folded);
+
+	return matches;
+}
+
+/**
+ * e_contact_index_contact_matches:
+ * @contact: an #EContact
+ * @prefix: a prefix to look up
+ *
+ * Checks whether the @contact would be returned by e_contact_index_lookup()
+ * for the @prefix.  This can be used to refine results of a lookup for
+ * a shorter prefix, without doing a new lookup.
+ *
+ * Returns: whether the @contact matches the @prefix
+ *
+ * Since: 3.28
+ **/
+gboolean
+e_contact_index_contact_matches (EContact *contact,
+                                 const gchar *prefix)
+{
+	GPtrArray *values;
+	gchar *folded;
+	gsize folded_len;
+	guint ii;
+	gboolean matches = FALSE;
+
+	g_return_val_if_fail (E_IS_CONTACT (contact), FALSE);
+	g_return_val_if_fail (prefix != NULL, FALSE);
+
+	if (!*prefix)
+		return FALSE;
+
+	folded = contact_index_fold (prefix);
+	folded_len = strlen (folded);
+	values = contact_index_get_values (contact);
+
+	for (ii = 0; ii < values->len && !matches; ii++) {
+		const gchar *value = g_ptr_array_index (values, ii);
+		const gchar *pos;
+
+		for (pos = value; *pos && !matches; pos++) {
+			matches = contact_index_is_word_start (value, pos) &&
+				strncmp (pos, folded, folded_len) == 0;
+		}
+	}
+
+	g_ptr_array_unref (values);
+	g_free (folded);
+
+	return matches;
+}
@@ -0,0 +1,83 @@
+/*
+ * e-contact-index.h
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#if !defined (__E_UTIL_H_INSIDE__) && !defined (LIBEUTIL_COMPILATION)
+#error "Only <e-util/e-util.h> should be included directly."
+#endif
+
+#ifndef E_CONTACT_INDEX_H
+#define E_CONTACT_INDEX_H
+
+#include <libebook/libebook.h>
+
+/* Standard GObject macros */
+#define E_TYPE_CONTACT_INDEX \
+	(e_contact_index_get_type ())
+#define E_CONTACT_INDEX(obj) \
+	(G_TYPE_CHECK_INSTANCE_CAST \
+	((obj), E_TYPE_CONTACT_INDEX, EContactIndex))
+#define E_CONTACT_INDEX_CLASS(cls) \
+	(G_TYPE_CHECK_CLASS_CAST \
+	((cls), E_TYPE_CONTACT_INDEX, EContactIndexClass))
+#define E_IS_CONTACT_INDEX(obj) \
+	(G_TYPE_CHECK_INSTANCE_TYPE \
+	((obj), E_TYPE_CONTACT_INDEX))
+#define E_IS_CONTACT_INDEX_CLASS(cls) \
+	(G_TYPE_CHECK_CLASS_TYPE \
+	((cls), E_TYPE_CONTACT_INDEX))
+#define E_CONTACT_INDEX_GET_CLASS(obj) \
+	(G_TYPE_INSTANCE_GET_CLASS \
+	((obj), E_TYPE_CONTACT_INDEX, EContactIndexClass))
+
+G_BEGIN_DECLS
+
+typedef struct _EContactIndex EContactIndex;
+typedef struct _EContactIndexClass EContactIndexClass;
+typedef struct _EContactIndexPrivate EContactIndexPrivate;
+
+/**
+ * EContactIndex:
+ *
+ * Contains only private data that should be read and manipulated using the
+ * functions below.
+ *
+ * Since: 3.28
+ **/
+struct _EContactIndex {
+	GObject parent;
+	EContactIndexPrivate *priv;
+};
+
+struct _EContactIndexClass {
+	GObjectClass parent_class;
+
+	/* Signals */
+	void		(*changed)		(EContactIndex *contact_index);
+};
+
+GType		e_contact_index_get_type	(void) G_GNUC_CONST;
+EContactIndex *	e_contact_index_ref		(EBookClient *book_client);
+EBookClient *	e_contact_index_ref_client	(EContactIndex *contact_index);
+gboolean	e_contact_index_is_complete	(EContactIndex *contact_index);
+GPtrArray *	e_contact_index_lookup		(EContactIndex *contact_index,
+						 const gchar *prefix);
+gboolean	e_contact_index_contact_matches	(EContact *contact,
+						 const gchar *prefix);
+
+G_END_DECLS
+
+#endif /* E_CONTACT_INDEX_H */
@@ -100,9 +100,11 @@ typedef struct
 
 	EBookClientView *client_view;
 	GPtrArray *contacts;
+	GHashTable *contacts_uids;	/* UID ~> index into contacts */
 
 	EBookClientView *client_view_pending;
 	GPtrArray *contacts_pending;
+	GHashTable *contacts_pending_uids;	/* UID ~> index into contacts_pending */
 }
 ContactSource;
 
@@ -128,6 +130,7 @@ contact_store_dispose (GObject *object)
 
 		clear_contact_source (E_CONTACT_STORE (object), source);
 		free_contact_ptrarray (source->contacts);
+		g_hash_table_destroy (source->contacts_uids);
 		g_object_unref (source->book_client);
 	}
 	g_array_set_size (priv->contact_sources, 0);
@@ -421,76 +424,109 @@ count_contacts (EContactStore *contact_store)
 	return count;
 }
 
+static GHashTable *
+contact_uids_new (void)
+{
+	/* The keys are owned by the contacts in the array */
+	return g_hash_table_new (g_str_hash, g_str_equal);
+}
+
+static void
+contact_uids_add (GHashTable *uids,
+                  EContact *contact,
+                  gint index)
+{
+	const gchar *uid = e_contact_get_const (contact, E_CONTACT_UID);
+
+	if (uid)
+		g_hash_table_replace (uids, (gpointer) uid, GINT_TO_POINTER (index));
+}
+
 static gint
-find_contact_by_view_and_uid (EContactStore *contact_store,
-                              EBookClientView *find_view,
-                              const gchar *find_uid)
+sort_indices_descending (gconstpointer a,
+                         gconstpointer b)
 {
-	GArray *array;
-	ContactSource *source;
-	GPtrArray *contacts;
-	gint source_index;
-	gint i;
+	gint ia = *((const gint *) a);
+	gint ib = *((const gint *) b);
 
-	g_return_val_if_fail (find_uid != NULL, -1);
+	return (ia == ib) ? 0 : (ia < ib) ? 1 : -1;
+}
 
-	source_index = find_contact_source_by_view (contact_store, find_view);
-	if (source_index < 0)
-		return -1;
+/* Removes the contacts at @indices from @contacts, from the last one,
+ * and emits the row deletion right after each removal when @emit is set.
+ * The moved contacts are re-indexed in @uids once, at the end. */
+static void
+remove_contacts (EContactStore *contact_store,
+                 GPtrArray *contacts,
+                 GHashTable *uids,
+                 gint offset,
+                 GArray *indices,
+                 gboolean emit)
+{
+	guint ii;
+	gint last_index = -1;
 
-	array = contact_store->priv->contact_sources;
-	source = &g_array_index (array, ContactSource, source_index);
+	if (!indices->len)
+		return;
 
-	if (find_view == source->client_view)
-		contacts = source->contacts;          /* Current view */
-	else
-		contacts = source->contacts_pending;  /* Pending view */
+	g_array_sort (indices, sort_indices_descending);
 
-	for (i = 0; i < contacts->len; i++) {
-		EContact    *contact = g_ptr_array_index (contacts, i);
-		const gchar *uid = e_contact_get_const (contact, E_CONTACT_UID);
+	for (ii = 0; ii < indices->len; ii++) {
+		gint index = g_array_index (indices, gint, ii);
+		EContact *contact;
+		const gchar *uid;
 
-		if (uid && !strcmp (find_uid, uid))
-			return i;
+		if (index == last_index)
+			continue;
+
+		last_index = index;
+		contact = g_ptr_array_index (contacts, index);
+		uid = e_contact_get_const (contact, E_CONTACT_UID);
+
+		if (uid)
+			g_hash_table_remove (uids, uid);
+
+		g_ptr_array_remove_index (contacts, index);
+
+		if (emit)
+			row_deleted (contact_store, offset + index);
+
+		g_object_unref (contact);
 	}
 
-	return -1;
+	for (ii = last_index; ii < contacts->len; ii++)
+		contact_uids_add (uids, g_ptr_array_index (contacts, ii), ii);
 }
 
-static GHashTable *
-get_contact_hash (EContactStore *contact_store,
-                  EBookClientView *find_view)
+static gint
+find_contact_by_view_and_uid (EContactStore *contact_store,
+                              EBookClientView *find_view,
+                              const gchar *find_uid)
 {
 	GArray *array;
 	ContactSource *source;
-	GPtrArray *contacts;
+	GHashTable *uids;
 	gint source_index;
-	gint ii;
-	GHashTable *hash;
+	gpointer value;
+
+	g_return_val_if_fail (find_uid != NULL, -1);
 
 	source_index = find_contact_source_by_view (contact_store, find_view);
 	if (source_index < 0)
-		return NULL;
+		return -1;
 
 	array = contact_store->priv->contact_sources;
 	source = &g_array_index (array, ContactSource, source_index);
 
 	if (find_view == source->client_view)
-		contacts = source->contacts;          /* Current view */
+		uids = source->contacts_uids;          /* Current view */
 	else
-		contacts = source->contacts_pending;  /* Pending view */
+		uids = source->contacts_pending_uids;  /* Pending view */
 
-	hash = g_hash_table_new (g_str_hash, g_str_equal);
-
-	for (ii = 0; ii < contacts->len; ii++) {
-		EContact *contact = g_ptr_array_index (contacts, ii);
-		const gchar *uid = e_contact_get_const (contact, E_CONTACT_UID);
-
-		if (uid)
-			g_hash_table_insert (hash, (gpointer) uid, GINT_TO_POINTER (ii));
-	}
+	if (!g_hash_table_lookup_extended (uids, find_uid, NULL, &value))
+		return -1;
 
-	return hash;
+	return GPOINTER_TO_INT (value);
 }
 
 static gint
@@ -498,21 +534,19 @@ find_contact_by_uid (EContactStore *contact_store,
                      const gchar *find_uid)
 {
 	GArray *array;
+	gint offset = 0;
 	gint i;
 
 	array = contact_store->priv->contact_sources;
 
 	for (i = 0; i < array->len; i++) {
 		ContactSource *source = &g_array_index (array, ContactSource, i);
-		gint           j;
+		gpointer       value;
 
-		for (j = 0; j < source->contacts->len; j++) {
-			EContact    *contact = g_ptr_array_index (source->contacts, j);
-			const gchar *uid = e_contact_get_const (contact, E_CONTACT_UID);
+		if (g_hash_table_lookup_extended (source->contacts_uids, find_uid, NULL, &value))
+			return offset + GPOINTER_TO_INT (value);
 
-			if (!strcmp (find_uid, uid))
-				return get_contact_source_offset (contact_store, i) + j;
-		}
+		offset += source->contacts->len;
 	}
 
 	return -1;
@@ -605,10 +639,12 @@ view_contacts_added (EContactStore *contact_store,
 		if (client_view == source->client_view) {
 			/* Current view */
 			g_ptr_array_add (source->contacts, contact);
+			contact_uids_add (source->contacts_uids, contact, source->contacts->len - 1);
 			row_inserted (contact_store, offset + source->contacts->len - 1);
 		} else {
 			/* Pending view */
 			g_ptr_array_add (source->contacts_pending, contact);
+			contact_uids_add (source->contacts_pending_uids, contact, source->contacts_pending->len - 1);
 		}
 	}
 }
@@ -618,6 +654,9 @@ view_contacts_removed (EContactStore *contact_store,
                        const GSList *uids,
                        EBookClientView *client_view)
 {
+	GPtrArray     *cached_contacts;
+	GHashTable    *cached_uids;
+	GArray        *indices;
 	ContactSource *source;
 	gint           offset;
 	const GSList  *l;
@@ -627,29 +666,38 @@ view_contacts_removed (EContactStore *contact_store,
 		return;
 	}
 
+	if (client_view == source->client_view) {
+		cached_contacts = source->contacts;
+		cached_uids = source->contacts_uids;
+	} else {
+		cached_contacts = source->contacts_pending;
+		cached_uids = source->contacts_pending_uids;
+	}
+
+	indices = g_array_new (FALSE, FALSE, sizeof (gint));
+
 	for (l = uids; l; l = g_slist_next (l)) {
 		const gchar *uid = l->data;
 		gint         n = find_contact_by_view_and_uid (contact_store, client_view, uid);
-		EContact    *contact;
 
 		if (n < 0) {
 			g_warning ("EContactStore got 'contacts_removed' on unknown contact!");
 			continue;
 		}
 
-		if (client_view == source->client_view) {
-			/* Current view */
-			contact = g_ptr_array_index (source->contacts, n);
-			g_object_unref (contact);
-			g_ptr_array_remove_index (source->contacts, n);
-			row_deleted (contact_store, offset + n);
-		} else {
-			/* Pending view */
-			contact = g_ptr_array_index (source->contacts_pending, n);
-			g_object_unref (contact);
-			g_ptr_array_remove_index (source->contacts_pending, n);
-		}
+		g_array_append_val (indices, n);
 	}
+
+	/* Emit changes for current view only */
+	if (client_view == source->client_view) {
+		g_signal_emit (contact_store, signals[START_UPDATE], 0, client_view);
+		remove_contacts (contact_store, cached_contacts, cached_uids, offset, indices, TRUE);
+		g_signal_emit (contact_store, signals[STOP_UPDATE], 0, client_view);
+	} else {
+		remove_contacts (contact_store, cached_contacts, cached_uids, offset, indices, FALSE);
+	}
+
+	g_array_free (indices, TRUE);
 }
 
 static void
@@ -658,6 +706,7 @@ view_contacts_modified (EContactStore *contact_store,
                         EBookClientView *client_view)
 {
 	GPtrArray     *cached_contacts;
+	GHashTable    *cached_uids;
 	ContactSource *source;
 	gint           offset;
 	const GSList  *l;
@@ -667,10 +716,17 @@ view_contacts_modified (EContactStore *contact_store,
 		return;
 	}
 
-	if (client_view == source->client_view)
+	if (client_view == source->client_view) {
 		cached_contacts = source->contacts;
-	else
+		cached_uids = source->contacts_uids;
+	} else {
 		cached_contacts = source->contacts_pending;
+		cached_uids = source->contacts_pending_uids;
+	}
+
+	/* Let the listeners handle the changed rows at once */
+	if (client_view == source->client_view)
+		g_signal_emit (contact_store, signals[START_UPDATE], 0, client_view);
 
 	for (l = contacts; l; l = g_slist_next (l)) {
 		EContact    *cached_contact;
@@ -685,16 +741,20 @@ view_contacts_modified (EContactStore *contact_store,
 
 		cached_contact = g_ptr_array_index (cached_contacts, n);
 
-		/* Update cached contact */
+		/* Update cached contact; the UID key belongs to the contact */
 		if (cached_contact != contact) {
-			g_object_unref (cached_contact);
 			cached_contacts->pdata[n] = g_object_ref (contact);
+			contact_uids_add (cached_uids, contact, n);
+			g_object_unref (cached_contact);
 		}
 
 		/* Emit changes for current view only */
 		if (client_view == source->client_view)
 			row_changed (contact_store, offset + n);
 	}
+
+	if (client_view == source->client_view)
+		g_signal_emit (contact_store, signals[STOP_UPDATE], 0, client_view);
 }
 
 static void
@@ -705,7 +765,7 @@ view_complete (EContactStore *contact_store,
 	ContactSource *source;
 	gint           offset;
 	gint           i;
-	GHashTable *hash;
+	GArray        *indices;
 
 	if (!find_contact_source_details_by_view (contact_store, client_view, &source, &offset)) {
 		g_warning ("EContactStore got 'complete' signal from unknown EBookClientView!");
@@ -726,37 +786,34 @@ view_complete (EContactStore *contact_store,
 	g_signal_emit (contact_store, signals[START_UPDATE], 0, client_view);
 
 	/* Deletions */
-	hash = get_contact_hash (contact_store, source->client_view_pending);
+	indices = g_array_new (FALSE, FALSE, sizeof (gint));
 	for (i = 0; i < source->contacts->len; i++) {
 		EContact    *old_contact = g_ptr_array_index (source->contacts, i);
 		const gchar *old_uid = e_contact_get_const (old_contact, E_CONTACT_UID);
 
-		if (!g_hash_table_contains (hash, old_uid)) {
+		if (!old_uid || !g_hash_table_contains (source->contacts_pending_uids, old_uid)) {
 			/* Contact is not in new view; removed */
-			g_object_unref (old_contact);
-			g_ptr_array_remove_index (source->contacts, i);
-			row_deleted (contact_store, offset + i);
-			i--;  /* Stay in place */
+			g_array_append_val (indices, i);
 		}
 	}
-	g_hash_table_unref (hash);
+	remove_contacts (contact_store, source->contacts, source->contacts_uids, offset, indices, TRUE);
+	g_array_free (indices, TRUE);
 
 	/* Insertions */
-	hash = get_contact_hash (contact_store, source->client_view);
 	for (i = 0; i < source->contacts_pending->len; i++) {
 		EContact    *new_contact = g_ptr_array_index (source->contacts_pending, i);
 		const gchar *new_uid = e_contact_get_const (new_contact, E_CONTACT_UID);
 
-		if (!g_hash_table_contains (hash, new_uid)) {
+		if (!new_uid || !g_hash_table_contains (source->contacts_uids, new_uid)) {
 			/* Contact is not in old view; inserted */
 			g_ptr_array_add (source->contacts, new_contact);
+			contact_uids_add (source->contacts_uids, new_contact, source->contacts->len - 1);
 			row_inserted (contact_store, offset + source->contacts->len - 1);
 		} else {
 			/* Contact already in old view; drop the new one */
 			g_object_unref (new_contact);
 		}
 	}
-	g_hash_table_unref (hash);
 
 	g_signal_emit (contact_store, signals[STOP_UPDATE], 0, client_view);
 
@@ -768,7 +825,9 @@ view_complete (EContactStore *contact_store,
 
 	/* Free array of pending contacts (members have been either moved or unreffed) */
 	g_ptr_array_free (source->contacts_pending, TRUE);
+	g_hash_table_destroy (source->contacts_pending_uids);
 	source->contacts_pending = NULL;
+	source->contacts_pending_uids = NULL;
 }
 
 /* --------------------- *
@@ -883,6 +942,9 @@ clear_contact_source (EContactStore *contact_store,
 		g_signal_emit (contact_store, signals[STOP_UPDATE], 0, source->client_view);
 	}
 
+	if (source->contacts_uids)
+		g_hash_table_remove_all (source->contacts_uids);
+
 	/* Free main and pending views, clear cached contacts */
 
 	if (source->client_view) {
@@ -896,9 +958,11 @@ clear_contact_source (EContactStore *contact_store,
 		stop_view (contact_store, source->client_view_pending);
 		g_object_unref (source->client_view_pending);
 		free_contact_ptrarray (source->contacts_pending);
+		g_hash_table_destroy (source->contacts_pending_uids);
 
 		source->client_view_pending = NULL;
 		source->contacts_pending = NULL;
+		source->contacts_pending_uids = NULL;
 	}
 }
 
@@ -932,15 +996,18 @@ client_view_ready_cb (GObject *source_object,
 				stop_view (contact_store, source->client_view_pending);
 				g_object_unref (source->client_view_pending);
 				free_contact_ptrarray (source->contacts_pending);
+				g_hash_table_destroy (source->contacts_pending_uids);
 			}
 
 			source->client_view_pending = client_view;
 
 			if (source->client_view_pending) {
 				source->contacts_pending = g_ptr_array_new ();
+				source->contacts_pending_uids = contact_uids_new ();
 				start_view (contact_store, client_view);
 			} else {
 				source->contacts_pending = NULL;
+				source->contacts_pending_uids = NULL;
 			}
 		} else {
 			source->client_view = client_view;
@@ -972,8 +1039,10 @@ query_contact_source (EContactStore *contact_store,
 			stop_view (contact_store, source->client_view_pending);
 			g_object_unref (source->client_view_pending);
 			free_contact_ptrarray (source->contacts_pending);
+			g_hash_table_destroy (source->contacts_pending_uids);
 			source->client_view_pending = NULL;
 			source->contacts_pending = NULL;
+			source->contacts_pending_uids = NULL;
 		}
 	}
 
@@ -1125,6 +1194,7 @@ e_contact_store_add_client (EContactStore *contact_store,
 	memset (&source, 0, sizeof (ContactSource));
 	source.book_client = g_object_ref (book_client);
 	source.contacts = g_ptr_array_new ();
+	source.contacts_uids = contact_uids_new ();
 	g_array_append_val (array, source);
 
 	indexed_source = &g_array_index (array, ContactSource, array->len - 1);
@@ -1164,6 +1234,7 @@ e_contact_store_remove_client (EContactStore *contact_store,
 	source = &g_array_index (array, ContactSource, source_index);
 	clear_contact_source (contact_store, source);
 	free_contact_ptrarray (source->contacts);
+	g_hash_table_destroy (source->contacts_uids);
 	g_object_unref (book_client);
 
 	g_array_remove_index (array, source_index);  /* Preserve order */
@@ -1208,6 +1279,119 @@ e_contact_store_set_query (EContactStore *contact_store,
 	}
 }
 
+/**
+ * e_contact_store_set_contacts:
+ * @contact_store: an #EContactStore
+ * @book_client: an #EBookClient, previously added to @contact_store
+ * @contacts: (element-type EContact): contacts to show for @book_client
+ *
+ * Sets the contacts provided by @book_client directly, without running
+ * a query.  Any view of the @book_client is stopped.  Only the differences
+ * against the current contacts are emitted as row changes.  This is meant
+ * for callers with the contacts already at hand, like from an #EContactIndex,
+ * which have no query set on the @contact_store.
+ *
+ * Since: 3.28
+ **/
+void
+e_contact_store_set_contacts (EContactStore *contact_store,
+                              EBookClient *book_client,
+                              const GPtrArray *contacts)
+{
+	ContactSource *source;
+	GHashTable *hash;
+	GArray *indices;
+	gint source_index;
+	gint offset;
+	gint ii;
+
+	g_return_if_fail (E_IS_CONTACT_STORE (contact_store));
+	g_return_if_fail (E_IS_BOOK_CLIENT (book_client));
+	g_return_if_fail (contacts != NULL);
+
+	source_index = find_contact_source_by_client (contact_store, book_client);
+	g_return_if_fail (source_index >= 0);
+
+	source = &g_array_index (contact_store->priv->contact_sources, ContactSource, source_index);
+	offset = get_contact_source_offset (contact_store, source_index);
+
+	if (source->client_view_pending) {
+		stop_view (contact_store, source->client_view_pending);
+		g_object_unref (source->client_view_pending);
+		free_contact_ptrarray (source->contacts_pending);
+		g_hash_table_destroy (source->contacts_pending_uids);
+
+		source->client_view_pending = NULL;
+		source->contacts_pending = NULL;
+		source->contacts_pending_uids = NULL;
+	}
+
+	if (source->client_view) {
+		stop_view (contact_store, source->client_view);
+		g_object_unref (source->client_view);
+
+		source->client_view = NULL;
+	}
+
+	g_signal_emit (contact_store, signals[START_UPDATE], 0, NULL);
+
+	hash = g_hash_table_new (g_str_hash, g_str_equal);
+
+	for (ii = 0; ii < contacts->len; ii++) {
+		EContact *contact = g_ptr_array_index (contacts, ii);
+		const gchar *uid = e_contact_get_const (contact, E_CONTACT_UID);
+
+		if (uid)
+			g_hash_table_insert (hash, (gpointer) uid, contact);
+	}
+
+	/* Deletions */
+	indices = g_array_new (FALSE, FALSE, sizeof (gint));
+	for (ii = 0; ii < source->contacts->len; ii++) {
+		EContact *old_contact = g_ptr_array_index (source->contacts, ii);
+		const gchar *old_uid = e_contact_get_const (old_contact, E_CONTACT_UID);
+
+		if (!old_uid || !g_hash_table_contains (hash, old_uid))
+			g_array_append_val (indices, ii);
+	}
+	remove_contacts (contact_store, source->contacts, source->contacts_uids, offset, indices, TRUE);
+	g_array_free (indices, TRUE);
+
+	/* Modifications */
+	for (ii = 0; ii < source->contacts->len; ii++) {
+		EContact *old_contact = g_ptr_array_index (source->contacts, ii);
+		const gchar *old_uid = e_contact_get_const (old_contact, E_CONTACT_UID);
+		EContact *new_contact = g_hash_table_lookup (hash, old_uid);
+
+		/* Already shown */
+		g_hash_table_remove (hash, old_uid);
+
+		if (new_contact != old_contact) {
+			source->contacts->pdata[ii] = g_object_ref (new_contact);
+			contact_uids_add (source->contacts_uids, new_contact, ii);
+			g_object_unref (old_contact);
+			row_changed (contact_store, offset + ii);
+		}
+	}
+
+	/* Insertions, in the order of the given contacts */
+	for (ii = 0; ii < contacts->len; ii++) {
+		EContact *contact = g_ptr_array_index (contacts, ii);
+		const gchar *uid = e_contact_get_const (contact, E_CONTACT_UID);
+
+		if (uid && g_hash_table_lookup (hash, uid) == contact) {
+			g_hash_table_remove (hash, uid);
+			g_ptr_array_add (source->contacts, g_object_ref (contact));
+			contact_uids_add (source->contacts_uids, contact, source->contacts->len - 1);
+			row_inserted (contact_store, offset + source->contacts->len - 1);
+		}
+	}
+
+	g_hash_table_destroy (hash);
+
+	g_signal_emit (contact_store, signals[STOP_UPDATE], 0, NULL);
+}
+
 /**
  * e_contact_store_peek_query:
  * @contact_store: an #EContactStore
@@ -0,0 +1,257 @@
+/*
+ * e-file-data-wrapper.c
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * SECTION: e-file-data-wrapper
+ * @include: e-util/e-util.h
+ * @short_description: A #CamelDataWrapper with content in a file
+ *
+ * #EFileDataWrapper is a #CamelDataWrapper, which doesn't hold its content
+ * in memory, but reads it from a #GFile whenever it's written or decoded.
+ * That allows to attach large files to a message without loading them
+ * into memory; the content is streamed from the disk when the message
+ * is being written.
+ *
+ * The file is opened when the wrapper is created and it is kept open
+ * for the whole life of the wrapper. The content stays readable even when
+ * the file is deleted meanwhile, like when it's in an expired temporary
+ * directory, see e_mkdtemp().
+ *
+ * The content of the file is used as is, it's expected to be the raw,
+ * not encoded data. The file should not change while the wrapper is used.
+ **/
+
+#include "evolution-config.h"
+
+#include <glib/gi18n-lib.h>
+
+#include "e-file-data-wrapper.h"
+
+#define E_FILE_DATA_WRAPPER_GET_PRIVATE(obj) \
+	(G_TYPE_INSTANCE_GET_PRIVATE \
+	((obj), E_TYPE_FILE_DATA_WRAPPER, EFileDataWrapperPrivate))
+
+#define FILE_DATA_WRAPPER_BUFFER_SIZE 65536
+
+struct _EFileDataWrapperPrivate {
+	GFile *file;
+
+	/* The open file, which is read from the beginning
+	 * on each write. The lock guards the read position. */
+	GMutex lock;
+	GInputStream *input_stream;
+};
+
+G_DEFINE_TYPE (EFileDataWrapper, e_file_data_wrapper, CAMEL_TYPE_DATA_WRAPPER)
+
+static gssize
+file_data_wrapper_write_to_stream_sync (CamelDataWrapper *data_wrapper,
+                                        CamelStream *stream,
+                                        GCancellable *cancellable,
+                                        GError **error)
+{
+	EFileDataWrapper *wrapper = E_FILE_DATA_WRAPPER (data_wrapper);
+	gchar *buffer;
+	gssize total = 0;
+
+	g_mutex_lock (&wrapper->priv->lock);
+
+	if (!g_seekable_seek (G_SEEKABLE (wrapper->priv->input_stream), 0, G_SEEK_SET, cancellable, error)) {
+		g_mutex_unlock (&wrapper->priv->lock);
+		return -1;
+	}
+
+	buffer = g_malloc (FILE_DATA_WRAPPER_BUFFER_SIZE);
+
+	while (TRUE) {
+		gssize n_read;
+
+		n_read = g_input_stream_read (
+			wrapper->priv->input_stream, buffer,
+			FILE_DATA_WRAPPER_BUFFER_SIZE, cancellable, error);
+
+		if (n_read < 0) {
+			total = -1;
+			break;
+		}
+
+		if (n_read == 0)
+			break;
+
+		if (camel_stream_write (stream, buffer, n_read, cancellable, error) != n_read) {
+			total = -1;
+			break;
+		}
+
+		total += n_read;
+	}
+
+	g_free (buffer);
+
+	g_mutex_unlock (&wrapper->priv->lock);
+
+	return total;
+}
+
+static gssize
+file_data_wrapper_write_to_output_stream_sync (CamelDataWrapper *data_wrapper,
+                                               GOutputStream *output_stream,
+                                               GCancellable *cancellable,
+                                               GError **error)
+{
+	EFileDataWrapper *wrapper = E_FILE_DATA_WRAPPER (data_wrapper);
+	gssize total = -1;
+
+	g_mutex_lock (&wrapper->priv->lock);
+
+	if (g_seekable_seek (G_SEEKABLE (wrapper->priv->input_stream), 0, G_SEEK_SET, cancellable, error))
+		total = g_output_stream_splice (
+			output_stream, wrapper->priv->input_stream,
+			G_OUTPUT_STREAM_SPLICE_NONE,
+			cancellable, error);
+
+	g_mutex_unlock (&wrapper->priv->lock);
+
+	return total;
+}
+
+static gboolean
+file_data_wrapper_construct_from_stream_sync (CamelDataWrapper *data_wrapper,
+                                              CamelStream *stream,
+                                              GCancellable *cancellable,
+                                              GError **error)
+{
+	/* The content is always read from the file. */
+	g_set_error_literal (
+		error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+		_("Operation not supported"));
+
+	return FALSE;
+}
+
+static gboolean
+file_data_wrapper_construct_from_input_stream_sync (CamelDataWrapper *data_wrapper,
+                                                    GInputStream *input_stream,
+                                                    GCancellable *cancellable,
+                                                    GError **error)
+{
+	return file_data_wrapper_construct_from_stream_sync (data_wrapper, NULL, cancellable, error);
+}
+
+static gboolean
+file_data_wrapper_is_offline (CamelDataWrapper *data_wrapper)
+{
+	return FALSE;
+}
+
+static void
+file_data_wrapper_finalize (GObject *object)
+{
+	EFileDataWrapperPrivate *priv;
+
+	priv = E_FILE_DATA_WRAPPER_GET_PRIVATE (object);
+
+	g_clear_object (&priv->file);
+	g_clear_object (&priv->input_stream);
+	g_mutex_clear (&priv->lock);
+
+	/* Chain up to parent's finalize() method. */
+	G_OBJECT_CLASS (e_file_data_wrapper_parent_class)->finalize (object);
+}
+
+static void
+e_file_data_wrapper_class_init (EFileDataWrapperClass *class)
+{
+	GObjectClass *object_class;
+	CamelDataWrapperClass *data_wrapper_class;
+
+	g_type_class_add_private (class, sizeof (EFileDataWrapperPrivate));
+
+	object_class = G_OBJECT_CLASS (class);
+	object_class->finalize = file_data_wrapper_finalize;
+
+	/* The content is not encoded, thus writing and decoding is the same. */
+	data_wrapper_class = CAMEL_DATA_WRAPPER_CLASS (class);
+	data_wrapper_class->write_to_stream_sync = file_data_wrapper_write_to_stream_sync;
+	data_wrapper_class->decode_to_stream_sync = file_data_wrapper_write_to_stream_sync;
+	data_wrapper_class->construct_from_stream_sync = file_data_wrapper_construct_from_stream_sync;
+	data_wrapper_class->write_to_output_stream_sync = file_data_wrapper_write_to_output_stream_sync;
+	data_wrapper_class->decode_to_output_stream_sync = file_data_wrapper_write_to_output_stream_sync;
+	data_wrapper_class->construct_from_input_stream_sync = file_data_wrapper_construct_from_input_stream_sync;
+	data_wrapper_class->is_offline = file_data_wrapper_is_offline;
+}
+
+static void
+e_file_data_wrapper_init (EFileDataWrapper *wrapper)
+{
+	wrapper->priv = E_FILE_DATA_WRAPPER_GET_PRIVATE (wrapper);
+
+	g_mutex_init (&wrapper->priv->lock);
+}
+
+/**
+ * e_file_data_wrapper_new:
+ * @file: a #GFile with the content
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Creates a new #EFileDataWrapper, which reads its content from @file.
+ * The @file is opened immediately and kept open until the wrapper
+ * is freed. The caller is responsible to set a MIME type of the wrapper.
+ *
+ * Returns: (transfer full): a new #EFileDataWrapper, as a #CamelDataWrapper,
+ *    or %NULL, when the @file could not be opened
+ *
+ * Since: 3.28
+ **/
+CamelDataWrapper *
+e_file_data_wrapper_new (GFile *file,
+                         GCancellable *cancellable,
+                         GError **error)
+{
+	EFileDataWrapper *wrapper;
+	GFileInputStream *input_stream;
+
+	g_return_val_if_fail (G_IS_FILE (file), NULL);
+
+	input_stream = g_file_read (file, cancellable, error);
+	if (!input_stream)
+		return NULL;
+
+	wrapper = g_object_new (E_TYPE_FILE_DATA_WRAPPER, NULL);
+	wrapper->priv->file = g_object_ref (file);
+	wrapper->priv->input_stream = G_INPUT_STREAM (input_stream);
+
+	return CAMEL_DATA_WRAPPER (wrapper);
+}
+
+/**
+ * e_file_data_wrapper_get_file:
+ * @wrapper: an #EFileDataWrapper
+ *
+ * Returns: (transfer none): a #GFile the @wrapper reads its content from;
+ *    the file itself may not exist anymore, see e_file_data_wrapper_new()
+ *
+ * Since: 3.28
+ **/
+GFile *
+e_file_data_wrapper_get_file (EFileDataWrapper *wrapper)
+{
+	g_return_val_if_fail (E_IS_FILE_DATA_WRAPPER (wrapper), NULL);
+
+	return wrapper->priv->file;
+}
@@ -0,0 +1,78 @@
+/*
+ * e-file-data-wrapper.h
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#if !defined (__E_UTIL_H_INSIDE__) && !defined (LIBEUTIL_COMPILATION)
+#error "Only <e-util/e-util.h> should be included directly."
+#endif
+
+#ifndef E_FILE_DATA_WRAPPER_H
+#define E_FILE_DATA_WRAPPER_H
+
+#include <camel/camel.h>
+
+/* Standard GObject macros */
+#define E_TYPE_FILE_DATA_WRAPPER \
+	(e_file_data_wrapper_get_type ())
+#define E_FILE_DATA_WRAPPER(obj) \
+	(G_TYPE_CHECK_INSTANCE_CAST \
+	((obj), E_TYPE_FILE_DATA_WRAPPER, EFileDataWrapper))
+#define E_FILE_DATA_WRAPPER_CLASS(cls) \
+	(G_TYPE_CHECK_CLASS_CAST \
+	((cls), E_TYPE_FILE_DATA_WRAPPER, EFileDataWrapperClass))
+#define E_IS_FILE_DATA_WRAPPER(obj) \
+	(G_TYPE_CHECK_INSTANCE_TYPE \
+	((obj), E_TYPE_FILE_DATA_WRAPPER))
+#define E_IS_FILE_DATA_WRAPPER_CLASS(cls) \
+	(G_TYPE_CHECK_CLASS_TYPE \
+	((cls), E_TYPE_FILE_DATA_WRAPPER))
+#define E_FILE_DATA_WRAPPER_GET_CLASS(obj) \
+	(G_TYPE_INSTANCE_GET_CLASS \
+	((obj), E_TYPE_FILE_DATA_WRAPPER, EFileDataWrapperClass))
+
+G_BEGIN_DECLS
+
+typedef struct _EFileDataWrapper EFileDataWrapper;
+typedef struct _EFileDataWrapperClass EFileDataWrapperClass;
+typedef struct _EFileDataWrapperPrivate EFileDataWrapperPrivate;
+
+/**
+ * EFileDataWrapper:
+ *
+ * Contains only private data that should be read and manipulated using the
+ * functions below.
+ *
+ * Since: 3.28
+ **/
+struct _EFileDataWrapper {
+	CamelDataWrapper parent;
+	EFileDataWrapperPrivate *priv;
+};
+
+struct _EFileDataWrapperClass {
+	CamelDataWrapperClass parent_class;
+};
+
+GType		e_file_data_wrapper_get_type	(void) G_GNUC_CONST;
+CamelDataWrapper *
+		e_file_data_wrapper_new		(GFile *file,
+						 GCancellable *cancellable,
+						 GError **error);
+GFile *		e_file_data_wrapper_get_file	(EFileDataWrapper *wrapper);
+
+G_END_DECLS
+
+#endif /* E_FILE_DATA_WRAPPER_H */
@@ -27,6 +27,7 @@
 #include <camel/camel.h>
 #include <libebackend/libebackend.h>
 
+#include "e-contact-index.h"
 #include "e-name-selector-entry.h"
 
 #define E_NAME_SELECTOR_ENTRY_GET_PRIVATE(obj) \
@@ -67,6 +68,11 @@ struct _ENameSelectorEntryPrivate {
 
 	GHashTable *known_contacts; /* gchar * ~> 1 */
 
+	/* Completion answered from in-memory contact indexes */
+	GHashTable *contact_indexes; /* EBookClient * ~> EContactIndex * */
+	GHashTable *index_results; /* EBookClient * ~> GPtrArray { EContact * } */
+	gchar *index_cue;
+
 	gboolean block_entry_changed_signal;
 };
 
@@ -105,6 +111,7 @@ G_DEFINE_TYPE_WITH_CODE (
 	} G_STMT_END
 
 static void destination_row_inserted (ENameSelectorEntry *name_selector_entry, GtkTreePath *path, GtkTreeIter *iter);
+static void completion_indexes_clear (ENameSelectorEntry *name_selector_entry);
 static void destination_row_changed  (ENameSelectorEntry *name_selector_entry, GtkTreePath *path, GtkTreeIter *iter);
 static void destination_row_deleted  (ENameSelectorEntry *name_selector_entry, GtkTreePath *path);
 
@@ -219,6 +226,20 @@ name_selector_entry_dispose (GObject *object)
 		priv->known_contacts = NULL;
 	}
 
+	if (priv->contact_indexes) {
+		completion_indexes_clear (E_NAME_SELECTOR_ENTRY (object));
+		g_hash_table_destroy (priv->contact_indexes);
+		priv->contact_indexes = NULL;
+	}
+
+	if (priv->index_results) {
+		g_hash_table_destroy (priv->index_results);
+		priv->index_results = NULL;
+	}
+
+	g_free (priv->index_cue);
+	priv->index_cue = NULL;
+
 	g_slist_foreach (priv->user_query_fields, (GFunc) g_free, NULL);
 	g_slist_free (priv->user_query_fields);
 	priv->user_query_fields = NULL;
@@ -824,6 +845,191 @@ ens_util_populate_user_query_fields (GSList *user_query_fields,
 	return g_string_free (user_fields, !user_fields->str || !*user_fields->str);
 }
 
+static void set_completion_query (ENameSelectorEntry *name_selector_entry, const gchar *cue_str);
+
+static void
+completion_index_changed_cb (EContactIndex *contact_index,
+                             ENameSelectorEntry *name_selector_entry)
+{
+	gchar *cue_str;
+
+	if (!name_selector_entry->priv->index_cue)
+		return;
+
+	/* The previous results cannot be refined anymore,
+	 * thus look up the current cue again from scratch. */
+	cue_str = name_selector_entry->priv->index_cue;
+	name_selector_entry->priv->index_cue = NULL;
+
+	set_completion_query (name_selector_entry, cue_str);
+
+	g_free (cue_str);
+}
+
+static void
+completion_indexes_clear (ENameSelectorEntry *name_selector_entry)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	g_hash_table_iter_init (&iter, name_selector_entry->priv->contact_indexes);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		g_signal_handlers_disconnect_by_func (
+			value, completion_index_changed_cb, name_selector_entry);
+	}
+
+	g_hash_table_remove_all (name_selector_entry->priv->contact_indexes);
+}
+
+/* Makes sure there is an index for each book of the contact store and
+ * returns whether the completion can be answered from the indexes. */
+static gboolean
+completion_indexes_ready (ENameSelectorEntry *name_selector_entry)
+{
+	ENameSelectorEntryPrivate *priv = name_selector_entry->priv;
+	GSList *clients, *link;
+	gboolean ready;
+
+	/* Custom fields to search in are known only to the book query */
+	if (!priv->contact_store || priv->user_query_fields)
+		return FALSE;
+
+	clients = e_contact_store_get_clients (priv->contact_store);
+	ready = clients != NULL;
+
+	for (link = clients; link; link = g_slist_next (link)) {
+		EBookClient *book_client = link->data;
+		EContactIndex *contact_index;
+
+		contact_index = g_hash_table_lookup (priv->contact_indexes, book_client);
+		if (!contact_index) {
+			contact_index = e_contact_index_ref (book_client);
+			g_signal_connect (
+				contact_index, "changed",
+				G_CALLBACK (completion_index_changed_cb), name_selector_entry);
+			g_hash_table_insert (
+				priv->contact_indexes,
+				g_object_ref (book_client), contact_index);
+		}
+
+		ready = ready && e_contact_index_is_complete (contact_index);
+	}
+
+	g_slist_free (clients);
+
+	return ready;
+}
+
+/* Drops contacts set from the indexes, if any */
+static void
+completion_index_results_clear (ENameSelectorEntry *name_selector_entry)
+{
+	ENameSelectorEntryPrivate *priv = name_selector_entry->priv;
+	GHashTableIter iter;
+	gpointer key;
+
+	g_free (priv->index_cue);
+	priv->index_cue = NULL;
+
+	if (!g_hash_table_size (priv->index_results))
+		return;
+
+	if (priv->contact_store) {
+		GPtrArray *empty;
+		GSList *clients;
+
+		empty = g_ptr_array_new ();
+		clients = e_contact_store_get_clients (priv->contact_store);
+
+		g_hash_table_iter_init (&iter, priv->index_results);
+		while (g_hash_table_iter_next (&iter, &key, NULL)) {
+			/* The book could be removed from the store meanwhile */
+			if (g_slist_find (clients, key))
+				e_contact_store_set_contacts (priv->contact_store, key, empty);
+		}
+
+		g_slist_free (clients);
+		g_ptr_array_unref (empty);
+	}
+
+	g_hash_table_remove_all (priv->index_results);
+}
+
+static gboolean
+completion_cue_extends (const gchar *previous_cue,
+                        const gchar *cue_str)
+{
+	gchar *previous_folded, *cue_folded;
+	gboolean extends;
+
+	previous_folded = g_utf8_casefold (previous_cue, -1);
+	cue_folded = g_utf8_casefold (cue_str, -1);
+
+	extends = g_str_has_prefix (cue_folded, previous_folded);
+
+	g_free (previous_folded);
+	g_free (cue_folded);
+
+	return extends;
+}
+
+static void
+set_completion_index_cue (ENameSelectorEntry *name_selector_entry,
+                          const gchar *cue_str)
+{
+	ENameSelectorEntryPrivate *priv = name_selector_entry->priv;
+	GSList *clients, *link;
+	gboolean refine;
+
+	/* Stop any views of a previous book query */
+	if (e_contact_store_peek_query (priv->contact_store))
+		e_contact_store_set_query (priv->contact_store, NULL);
+
+	/* When the cue only grew, the new matches are a subset
+	 * of the previous ones, thus filter those instead. */
+	refine = priv->index_cue && completion_cue_extends (priv->index_cue, cue_str);
+
+	clients = e_contact_store_get_clients (priv->contact_store);
+
+	for (link = clients; link; link = g_slist_next (link)) {
+		EBookClient *book_client = link->data;
+		GPtrArray *previous = NULL, *matches;
+
+		if (refine)
+			previous = g_hash_table_lookup (priv->index_results, book_client);
+
+		if (previous) {
+			guint ii;
+
+			matches = g_ptr_array_new_with_free_func (g_object_unref);
+
+			for (ii = 0; ii < previous->len; ii++) {
+				EContact *contact = g_ptr_array_index (previous, ii);
+
+				if (e_contact_index_contact_matches (contact, cue_str))
+					g_ptr_array_add (matches, g_object_ref (contact));
+			}
+		} else {
+			EContactIndex *contact_index;
+
+			contact_index = g_hash_table_lookup (priv->contact_indexes, book_client);
+			if (contact_index)
+				matches = e_contact_index_lookup (contact_index, cue_str);
+			else
+				matches = g_ptr_array_new_with_free_func (g_object_unref);
+		}
+
+		e_contact_store_set_contacts (priv->contact_store, book_client, matches);
+
+		g_hash_table_insert (priv->index_results, g_object_ref (book_client), matches);
+	}
+
+	g_slist_free (clients);
+
+	g_free (priv->index_cue);
+	priv->index_cue = g_strdup (cue_str);
+}
+
 static void
 set_completion_query (ENameSelectorEntry *name_selector_entry,
                       const gchar *cue_str)
@@ -844,9 +1050,18 @@ set_completion_query (ENameSelectorEntry *name_selector_entry,
 	if (!cue_str) {
 		/* Clear the store */
 		e_contact_store_set_query (name_selector_entry->priv->contact_store, NULL);
+		completion_index_results_clear (name_selector_entry);
+		return;
+	}
+
+	if (completion_indexes_ready (name_selector_entry)) {
+		set_completion_index_cue (name_selector_entry, cue_str);
 		return;
 	}
 
+	/* Still loading; the book query finds the contacts meanwhile */
+	completion_index_results_clear (name_selector_entry);
+
 	encoded_cue_str = escape_sexp_string (cue_str);
 	full_name_query_str = name_style_query ("full_name", cue_str);
 	file_as_query_str = name_style_query ("file_as",   cue_str);
@@ -1264,6 +1479,7 @@ clear_completion_model (ENameSelectorEntry *name_selector_entry)
 		return;
 
 	e_contact_store_set_query (name_selector_entry->priv->contact_store, NULL);
+	completion_index_results_clear (name_selector_entry);
 	g_hash_table_remove_all (name_selector_entry->priv->known_contacts);
 	priv->is_completing = FALSE;
 }
@@ -1588,6 +1804,18 @@ insert_unichar (ENameSelectorEntry *name_selector_entry,
 	return 1;
 }
 
+/* Lookups in the contact indexes are cheap, thus they do not need
+ * to wait for the user to stop typing, unlike the book queries. */
+static guint
+get_autocomplete_timeout (ENameSelectorEntry *name_selector_entry,
+                          guint index_timeout)
+{
+	if (completion_indexes_ready (name_selector_entry))
+		return index_timeout;
+
+	return AUTOCOMPLETE_TIMEOUT;
+}
+
 static void
 user_insert_text (ENameSelectorEntry *name_selector_entry,
                   gchar *new_text,
@@ -1636,11 +1864,11 @@ user_insert_text (ENameSelectorEntry *name_selector_entry,
 		re_set_timeout (
 			name_selector_entry->priv->update_completions_cb_id,
 			update_completions_on_timeout_cb,  name_selector_entry,
-			AUTOCOMPLETE_TIMEOUT);
+			get_autocomplete_timeout (name_selector_entry, 0));
 		re_set_timeout (
 			name_selector_entry->priv->type_ahead_complete_cb_id,
 			type_ahead_complete_on_timeout_cb, name_selector_entry,
-			AUTOCOMPLETE_TIMEOUT);
+			get_autocomplete_timeout (name_selector_entry, SHOW_RESULT_TIMEOUT));
 	}
 
 	g_signal_handlers_unblock_by_func (name_selector_entry, user_delete_text, name_selector_entry);
@@ -1686,7 +1914,7 @@ user_delete_text (ENameSelectorEntry *name_selector_entry,
 		re_set_timeout (
 			name_selector_entry->priv->update_completions_cb_id,
 			update_completions_on_timeout_cb, name_selector_entry,
-			AUTOCOMPLETE_TIMEOUT);
+			get_autocomplete_timeout (name_selector_entry, 0));
 	}
 
 	index_start = get_index_at_position (text, start_pos);
@@ -2060,6 +2288,9 @@ user_focus_in (ENameSelectorEntry *name_selector_entry,
 	GString *str = g_string_new ("");
 	gint sel_start_pos = -1, sel_end_pos = -1;
 
+	/* Start loading the contact indexes before the user types */
+	completion_indexes_ready (name_selector_entry);
+
 	/* To not send fake 'changed' signals, which can influence message composer */
 	name_selector_entry->priv->block_entry_changed_signal = TRUE;
 	g_signal_handlers_block_matched (name_selector_entry, G_SIGNAL_MATCH_DATA, 0, 0, NULL, NULL, name_selector_entry);
@@ -3418,6 +3649,8 @@ e_name_selector_entry_init (ENameSelectorEntry *name_selector_entry)
 	name_selector_entry->priv->show_address = FALSE;
 	name_selector_entry->priv->block_entry_changed_signal = FALSE;
 	name_selector_entry->priv->known_contacts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	name_selector_entry->priv->contact_indexes = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, g_object_unref);
+	name_selector_entry->priv->index_results = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, (GDestroyNotify) g_ptr_array_unref);
 
 	/* Edit signals */
 
@@ -3705,6 +3938,9 @@ e_name_selector_entry_set_contact_store (ENameSelectorEntry *name_selector_entry
 	if (contact_store == name_selector_entry->priv->contact_store)
 		return;
 
+	completion_index_results_clear (name_selector_entry);
+	completion_indexes_clear (name_selector_entry);
+
 	if (name_selector_entry->priv->contact_store)
 		g_object_unref (name_selector_entry->priv->contact_store);
 	name_selector_entry->priv->contact_store = contact_store;
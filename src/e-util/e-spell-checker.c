@@ -63,9 +63,13 @@ G_DEFINE_TYPE_EXTENDED (
  * and we also own the EnchantBroker. */
 static GHashTable *global_enchant_dicts;
 static GHashTable *global_language_tags; /* gchar * ~> NULL */
+static GHashTable *global_words_cache; /* gchar *language_code ~> GHashTable { gchar *recognized_word } */
 static EnchantBroker *global_broker;
 G_LOCK_DEFINE_STATIC (global_memory);
 
+/* The cache of one language is cleared when it grows over this size */
+#define MAX_CACHED_WORDS 20000
+
 static gboolean
 spell_checker_enchant_dicts_foreach_cb (gpointer key,
                                         gpointer value,
@@ -247,6 +251,9 @@ e_spell_checker_init_global_memory (void)
 		global_language_tags = g_hash_table_new_full (
 			g_str_hash, g_str_equal,
 			g_free, NULL);
+		global_words_cache = g_hash_table_new_full (
+			g_str_hash, g_str_equal,
+			g_free, (GDestroyNotify) g_hash_table_destroy);
 
 		enchant_broker_list_dicts (
 			global_broker,
@@ -287,6 +294,11 @@ e_spell_checker_free_global_memory (void)
 		global_language_tags = NULL;
 	}
 
+	if (global_words_cache) {
+		g_hash_table_destroy (global_words_cache);
+		global_words_cache = NULL;
+	}
+
 	G_UNLOCK (global_memory);
 }
 
@@ -415,6 +427,109 @@ e_spell_checker_get_enchant_dict (ESpellChecker *checker,
 	return dict;
 }
 
+/**
+ * e_spell_checker_lookup_cached_word:
+ * @checker: an #ESpellChecker
+ * @language_code: language code of a dictionary
+ * @word: a word to lookup
+ * @length: length of @word in bytes or -1 when %NULL-terminated
+ *
+ * Checks whether the @word is known to be recognized by the dictionary
+ * for @language_code, as stored by e_spell_checker_cache_word(). The cache
+ * is shared by all #ESpellChecker instances.
+ *
+ * Only recognized words are cached. A word can be learned meanwhile,
+ * even by another process sharing the personal dictionary, thus words
+ * not recognized are always checked by the dictionary again.
+ *
+ * Returns: %TRUE when the @word is known to be recognized, %FALSE when
+ *    it is not known
+ *
+ * Since: 3.28
+ **/
+gboolean
+e_spell_checker_lookup_cached_word (ESpellChecker *checker,
+                                    const gchar *language_code,
+                                    const gchar *word,
+                                    gsize length)
+{
+	GHashTable *words;
+	gboolean recognized = FALSE;
+	gchar buffer[64], *tmp = NULL;
+
+	g_return_val_if_fail (E_IS_SPELL_CHECKER (checker), FALSE);
+	g_return_val_if_fail (language_code != NULL, FALSE);
+	g_return_val_if_fail (word != NULL, FALSE);
+
+	/* This is called for every checked word, thus terminate
+	 * the usual short words on the stack, not on the heap. */
+	if (length != (gsize) -1 && length < sizeof (buffer)) {
+		memcpy (buffer, word, length);
+		buffer[length] = '\0';
+		word = buffer;
+	} else if (length != (gsize) -1) {
+		word = tmp = g_strndup (word, length);
+	}
+
+	e_spell_checker_init_global_memory ();
+
+	G_LOCK (global_memory);
+
+	words = g_hash_table_lookup (global_words_cache, language_code);
+	if (words)
+		recognized = g_hash_table_contains (words, word);
+
+	G_UNLOCK (global_memory);
+
+	g_free (tmp);
+
+	return recognized;
+}
+
+/**
+ * e_spell_checker_cache_word:
+ * @checker: an #ESpellChecker
+ * @language_code: language code of a dictionary
+ * @word: a recognized word
+ * @length: length of @word in bytes or -1 when %NULL-terminated
+ *
+ * Remembers that the @word is recognized by the dictionary for
+ * @language_code, thus the next check of the same word does not
+ * need to ask the spell-checking backend.
+ *
+ * Since: 3.28
+ **/
+void
+e_spell_checker_cache_word (ESpellChecker *checker,
+                            const gchar *language_code,
+                            const gchar *word,
+                            gsize length)
+{
+	GHashTable *words;
+
+	g_return_if_fail (E_IS_SPELL_CHECKER (checker));
+	g_return_if_fail (language_code != NULL);
+	g_return_if_fail (word != NULL);
+
+	e_spell_checker_init_global_memory ();
+
+	G_LOCK (global_memory);
+
+	words = g_hash_table_lookup (global_words_cache, language_code);
+	if (!words) {
+		words = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+		g_hash_table_insert (global_words_cache, g_strdup (language_code), words);
+	} else if (g_hash_table_size (words) >= MAX_CACHED_WORDS) {
+		g_hash_table_remove_all (words);
+	}
+
+	g_hash_table_add (
+		words,
+		length == (gsize) -1 ? g_strdup (word) : g_strndup (word, length));
+
+	G_UNLOCK (global_memory);
+}
+
 gboolean
 e_spell_checker_get_language_active (ESpellChecker *checker,
                                      const gchar *language_code)
@@ -74,6 +74,15 @@ ESpellDictionary *
 EnchantDict *	e_spell_checker_get_enchant_dict
 						(ESpellChecker *checker,
 						 const gchar *language_code);
+gboolean	e_spell_checker_lookup_cached_word
+						(ESpellChecker *checker,
+						 const gchar *language_code,
+						 const gchar *word,
+						 gsize length);
+void		e_spell_checker_cache_word	(ESpellChecker *checker,
+						 const gchar *language_code,
+						 const gchar *word,
+						 gsize length);
 gboolean	e_spell_checker_get_language_active
 						(ESpellChecker *checker,
 						 const gchar *language_code);
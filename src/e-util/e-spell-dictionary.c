@@ -625,6 +625,7 @@ e_spell_dictionary_check_word (ESpellDictionary *dictionary,
 {
 	ESpellChecker *spell_checker;
 	EnchantDict *enchant_dict;
+	const gchar *code;
 	gboolean recognized;
 
 	g_return_val_if_fail (E_IS_SPELL_DICTIONARY (dictionary), TRUE);
@@ -633,12 +634,24 @@ e_spell_dictionary_check_word (ESpellDictionary *dictionary,
 	spell_checker = e_spell_dictionary_ref_spell_checker (dictionary);
 	g_return_val_if_fail (spell_checker != NULL, TRUE);
 
-	enchant_dict = e_spell_checker_get_enchant_dict (
-		spell_checker, e_spell_dictionary_get_code (dictionary));
-	g_return_val_if_fail (enchant_dict != NULL, TRUE);
+	code = e_spell_dictionary_get_code (dictionary);
+
+	if (e_spell_checker_lookup_cached_word (spell_checker, code, word, length)) {
+		g_object_unref (spell_checker);
+		return TRUE;
+	}
+
+	enchant_dict = e_spell_checker_get_enchant_dict (spell_checker, code);
+	if (!enchant_dict) {
+		g_object_unref (spell_checker);
+		g_return_val_if_reached (TRUE);
+	}
 
 	recognized = (enchant_dict_check (enchant_dict, word, length) == 0);
 
+	if (recognized)
+		e_spell_checker_cache_word (spell_checker, code, word, length);
+
 	g_object_unref (spell_checker);
 
 	return recognized;
@@ -673,6 +686,10 @@ e_spell_dictionary_learn_word (ESpellDictionary *dictionary,
 
 	enchant_dict_add_to_personal (enchant_dict, word, length);
 
+	e_spell_checker_cache_word (
+		spell_checker, e_spell_dictionary_get_code (dictionary),
+		word, length);
+
 	g_object_unref (spell_checker);
 }
 
@@ -706,6 +723,10 @@ e_spell_dictionary_ignore_word (ESpellDictionary *dictionary,
 
 	enchant_dict_add_to_session (enchant_dict, word, length);
 
+	e_spell_checker_cache_word (
+		spell_checker, e_spell_dictionary_get_code (dictionary),
+		word, length);
+
 	g_object_unref (spell_checker);
 }
 
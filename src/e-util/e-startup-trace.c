@@ -0,0 +1,488 @@
+/*
+ * e-startup-trace.c
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * SECTION: e-startup-trace
+ * @include: e-util/e-util.h
+ * @short_description: Opt-in timeline of startup work
+ *
+ * The startup trace records named spans and instant marks with
+ * microsecond timestamps, so the critical path between launching
+ * Evolution and showing the first view can be measured.  Recording
+ * is enabled by e_startup_trace_enable(); until then
+ * e_startup_trace_begin() returns %NULL and costs only an atomic
+ * read.  The collected timeline can be exported as Chrome trace-event
+ * JSON (loadable in chrome://tracing or Perfetto) and summarized as
+ * per-span counters.
+ **/
+
+#include "evolution-config.h"
+
+#include <string.h>
+
+#include "e-startup-trace.h"
+
+/* Only one process is ever traced, thus use a constant process ID,
+ * which keeps the output portable and stable between runs. */
+#define TRACE_PID 1
+
+struct _EStartupTraceSpan {
+	gchar *category;
+	gchar *name;
+	gint64 start;
+	guint tid;
+};
+
+typedef struct _TraceEvent {
+	gchar *category;
+	gchar *name;
+	gint64 start;
+	gint64 duration;	/* -1 for instant marks */
+	guint tid;
+} TraceEvent;
+
+typedef struct _TraceCounter {
+	const gchar *category;
+	const gchar *name;
+	guint count;
+	gint64 total;
+	gint64 max;
+} TraceCounter;
+
+static volatile gint trace_enabled = 0;
+static gint64 trace_epoch = 0;
+static gchar *trace_filename = NULL;
+static GArray *trace_events = NULL;
+static GMutex trace_lock;
+
+static GPrivate trace_tid_key;
+static volatile gint trace_next_tid = 0;
+
+static guint
+startup_trace_get_tid (void)
+{
+	guint tid;
+
+	tid = GPOINTER_TO_UINT (g_private_get (&trace_tid_key));
+
+	if (tid == 0) {
+		tid = (guint) g_atomic_int_add (&trace_next_tid, 1) + 1;
+		g_private_set (&trace_tid_key, GUINT_TO_POINTER (tid));
+	}
+
+	return tid;
+}
+
+static void
+startup_trace_event_clear (gpointer data)
+{
+	TraceEvent *event = data;
+
+	g_free (event->category);
+	g_free (event->name);
+}
+
+static void
+startup_trace_append (gchar *category,
+                      gchar *name,
+                      gint64 start,
+                      gint64 duration,
+                      guint tid)
+{
+	TraceEvent event;
+
+	event.category = category;
+	event.name = name;
+	event.start = start;
+	event.duration = duration;
+	event.tid = tid;
+
+	g_mutex_lock (&trace_lock);
+	g_array_append_val (trace_events, event);
+	g_mutex_unlock (&trace_lock);
+}
+
+static void
+startup_trace_append_json_string (GString *json,
+                                  const gchar *str)
+{
+	const gchar *ptr;
+
+	g_string_append_c (json, '"');
+
+	for (ptr = str ? str : ""; *ptr; ptr++) {
+		guchar chr = (guchar) *ptr;
+
+		switch (chr) {
+		case '"':
+			g_string_append (json, "\\\"");
+			break;
+		case '\\':
+			g_string_append (json, "\\\\");
+			break;
+		case '\n':
+			g_string_append (json, "\\n");
+			break;
+		case '\t':
+			g_string_append (json, "\\t");
+			break;
+		default:
+			if (chr < 0x20)
+				g_string_append_printf (json, "\\u%04x", chr);
+			else
+				g_string_append_c (json, chr);
+			break;
+		}
+	}
+
+	g_string_append_c (json, '"');
+}
+
+static gint
+startup_trace_compare_counters (gconstpointer ptr1,
+                                gconstpointer ptr2)
+{
+	const TraceCounter *counter1 = *((const TraceCounter **) ptr1);
+	const TraceCounter *counter2 = *((const TraceCounter **) ptr2);
+
+	if (counter1->total == counter2->total)
+		return g_strcmp0 (counter1->name, counter2->name);
+
+	return counter1->total < counter2->total ? 1 : -1;
+}
+
+/**
+ * e_startup_trace_enable:
+ * @filename: (nullable): where to save the trace, or %NULL
+ *
+ * Starts recording spans and marks.  Timestamps are relative to the
+ * first call of this function.  When @filename is set, the timeline
+ * is written there by e_startup_trace_flush().
+ *
+ * Since: 3.28
+ **/
+void
+e_startup_trace_enable (const gchar *filename)
+{
+	g_mutex_lock (&trace_lock);
+
+	if (trace_events == NULL) {
+		trace_events = g_array_new (FALSE, FALSE, sizeof (TraceEvent));
+		g_array_set_clear_func (trace_events, startup_trace_event_clear);
+		trace_epoch = g_get_monotonic_time ();
+	}
+
+	if (filename && *filename) {
+		g_free (trace_filename);
+		trace_filename = g_strdup (filename);
+	}
+
+	g_mutex_unlock (&trace_lock);
+
+	g_atomic_int_set (&trace_enabled, 1);
+}
+
+/**
+ * e_startup_trace_is_enabled:
+ *
+ * Returns: whether e_startup_trace_enable() was called
+ *
+ * Since: 3.28
+ **/
+gboolean
+e_startup_trace_is_enabled (void)
+{
+	return g_atomic_int_get (&trace_enabled) != 0;
+}
+
+/**
+ * e_startup_trace_begin:
+ * @category: a category of the span, like "shell" or "mail"
+ * @name: a human readable name of the span
+ *
+ * Opens a new span.  The span can be closed from any thread with
+ * e_startup_trace_end().  When tracing is not enabled this does
+ * nothing and returns %NULL, which is also a valid argument for
+ * e_startup_trace_end().
+ *
+ * Returns: (transfer full) (nullable): an #EStartupTraceSpan, or %NULL
+ *
+ * Since: 3.28
+ **/
+EStartupTraceSpan *
+e_startup_trace_begin (const gchar *category,
+                       const gchar *name)
+{
+	EStartupTraceSpan *span;
+
+	if (!e_startup_trace_is_enabled ())
+		return NULL;
+
+	g_return_val_if_fail (name != NULL, NULL);
+
+	span = g_slice_new0 (EStartupTraceSpan);
+	span->category = g_strdup (category ? category : "evolution");
+	span->name = g_strdup (name);
+	span->tid = startup_trace_get_tid ();
+	span->start = g_get_monotonic_time ();
+
+	return span;
+}
+
+/**
+ * e_startup_trace_end:
+ * @span: (nullable) (transfer full): an #EStartupTraceSpan, or %NULL
+ *
+ * Closes the @span opened by e_startup_trace_begin() and records it
+ * into the timeline.  The @span is freed.
+ *
+ * Since: 3.28
+ **/
+void
+e_startup_trace_end (EStartupTraceSpan *span)
+{
+	gint64 now;
+
+	if (span == NULL)
+		return;
+
+	now = g_get_monotonic_time ();
+
+	/* The strings are handed over to the timeline. */
+	startup_trace_append (
+		span->category, span->name,
+		span->start, now - span->start, span->tid);
+
+	g_slice_free (EStartupTraceSpan, span);
+}
+
+/**
+ * e_startup_trace_mark:
+ * @category: a category of the mark
+ * @name: a human readable name of the mark
+ *
+ * Records an instant event into the timeline, when tracing is enabled.
+ *
+ * Since: 3.28
+ **/
+void
+e_startup_trace_mark (const gchar *category,
+                      const gchar *name)
+{
+	if (!e_startup_trace_is_enabled ())
+		return;
+
+	g_return_if_fail (name != NULL);
+
+	startup_trace_append (
+		g_strdup (category ? category : "evolution"),
+		g_strdup (name), g_get_monotonic_time (), -1,
+		startup_trace_get_tid ());
+}
+
+/**
+ * e_startup_trace_dup_summary:
+ *
+ * Aggregates the recorded spans by category and name into counters
+ * (number of occurrences, total and maximum duration) and formats
+ * them as a plain text table, sorted by the total duration.  Instant
+ * marks are listed with their offset from the trace start.
+ *
+ * Returns: (transfer full): a newly allocated string with the summary;
+ *    free it with g_free(), when no longer needed
+ *
+ * Since: 3.28
+ **/
+gchar *
+e_startup_trace_dup_summary (void)
+{
+	GHashTable *counters;
+	GPtrArray *sorted;
+	GHashTableIter iter;
+	GString *summary;
+	gpointer value;
+	guint ii;
+
+	summary = g_string_new ("");
+
+	if (!e_startup_trace_is_enabled ()) {
+		g_string_append (summary, "Startup trace is not enabled\n");
+		return g_string_free (summary, FALSE);
+	}
+
+	counters = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+	g_string_append_printf (
+		summary, "%-12s %-48s %6s %12s %12s\n",
+		"Category", "Span", "Count", "Total (ms)", "Max (ms)");
+
+	g_mutex_lock (&trace_lock);
+
+	for (ii = 0; ii < trace_events->len; ii++) {
+		TraceEvent *event = &g_array_index (trace_events, TraceEvent, ii);
+		TraceCounter *counter;
+		gchar *key;
+
+		if (event->duration < 0)
+			continue;
+
+		key = g_strconcat (event->category, "\n", event->name, NULL);
+		counter = g_hash_table_lookup (counters, key);
+
+		if (counter == NULL) {
+			counter = g_new0 (TraceCounter, 1);
+			counter->category = event->category;
+			counter->name = event->name;
+			g_hash_table_insert (counters, key, counter);
+		} else {
+			g_free (key);
+		}
+
+		counter->count++;
+		counter->total += event->duration;
+		counter->max = MAX (counter->max, event->duration);
+	}
+
+	sorted = g_ptr_array_sized_new (g_hash_table_size (counters));
+
+	g_hash_table_iter_init (&iter, counters);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		g_ptr_array_add (sorted, value);
+
+	g_ptr_array_sort (sorted, startup_trace_compare_counters);
+
+	for (ii = 0; ii < sorted->len; ii++) {
+		TraceCounter *counter = g_ptr_array_index (sorted, ii);
+
+		g_string_append_printf (
+			summary, "%-12s %-48s %6u %12.3f %12.3f\n",
+			counter->category, counter->name, counter->count,
+			counter->total / 1000.0, counter->max / 1000.0);
+	}
+
+	for (ii = 0; ii < trace_events->len; ii++) {
+		TraceEvent *event = &g_array_index (trace_events, TraceEvent, ii);
+
+		if (event->duration >= 0)
+			continue;
+
+		g_string_append_printf (
+			summary, "%-12s %-48s at %.3f ms\n",
+			event->category, event->name,
+			(event->start - trace_epoch) / 1000.0);
+	}
+
+	g_mutex_unlock (&trace_lock);
+
+	g_ptr_array_unref (sorted);
+	g_hash_table_destroy (counters);
+
+	return g_string_free (summary, FALSE);
+}
+
+/**
+ * e_startup_trace_write:
+ * @filename: a file to write the trace to
+ * @error: return location for a #GError, or %NULL
+ *
+ * Writes all recorded spans and marks into @filename in the Chrome
+ * trace-event JSON format.
+ *
+ * Returns: whether succeeded
+ *
+ * Since: 3.28
+ **/
+gboolean
+e_startup_trace_write (const gchar *filename,
+                       GError **error)
+{
+	GString *json;
+	gboolean success;
+	guint ii;
+
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	json = g_string_new ("{\"traceEvents\":[\n");
+
+	g_string_append_printf (
+		json,
+		"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":1,"
+		"\"args\":{\"name\":\"evolution\"}}",
+		TRACE_PID);
+
+	g_mutex_lock (&trace_lock);
+
+	for (ii = 0; trace_events && ii < trace_events->len; ii++) {
+		TraceEvent *event = &g_array_index (trace_events, TraceEvent, ii);
+
+		g_string_append (json, ",\n{\"name\":");
+		startup_trace_append_json_string (json, event->name);
+		g_string_append (json, ",\"cat\":");
+		startup_trace_append_json_string (json, event->category);
+
+		if (event->duration < 0) {
+			g_string_append (json, ",\"ph\":\"i\",\"s\":\"p\"");
+		} else {
+			g_string_append_printf (
+				json, ",\"ph\":\"X\",\"dur\":%" G_GINT64_FORMAT,
+				event->duration);
+		}
+
+		g_string_append_printf (
+			json, ",\"ts\":%" G_GINT64_FORMAT ",\"pid\":%d,\"tid\":%u}",
+			event->start - trace_epoch, TRACE_PID, event->tid);
+	}
+
+	g_mutex_unlock (&trace_lock);
+
+	g_string_append (json, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+	success = g_file_set_contents (filename, json->str, json->len, error);
+
+	g_string_free (json, TRUE);
+
+	return success;
+}
+
+/**
+ * e_startup_trace_flush:
+ * @error: return location for a #GError, or %NULL
+ *
+ * Writes the trace into the file set by e_startup_trace_enable().
+ * It does nothing when tracing is not enabled or no file was set.
+ *
+ * Returns: whether succeeded
+ *
+ * Since: 3.28
+ **/
+gboolean
+e_startup_trace_flush (GError **error)
+{
+	gchar *filename;
+	gboolean success = TRUE;
+
+	g_mutex_lock (&trace_lock);
+	filename = g_strdup (trace_filename);
+	g_mutex_unlock (&trace_lock);
+
+	if (filename != NULL && e_startup_trace_is_enabled ())
+		success = e_startup_trace_write (filename, error);
+
+	g_free (filename);
+
+	return success;
+}
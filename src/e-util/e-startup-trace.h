@@ -0,0 +1,46 @@
+/*
+ * e-startup-trace.h
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#if !defined (__E_UTIL_H_INSIDE__) && !defined (LIBEUTIL_COMPILATION)
+#error "Only <e-util/e-util.h> should be included directly."
+#endif
+
+#ifndef E_STARTUP_TRACE_H
+#define E_STARTUP_TRACE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _EStartupTraceSpan EStartupTraceSpan;
+
+void		e_startup_trace_enable		(const gchar *filename);
+gboolean	e_startup_trace_is_enabled	(void);
+EStartupTraceSpan *
+		e_startup_trace_begin		(const gchar *category,
+						 const gchar *name);
+void		e_startup_trace_end		(EStartupTraceSpan *span);
+void		e_startup_trace_mark		(const gchar *category,
+						 const gchar *name);
+gchar *		e_startup_trace_dup_summary	(void);
+gboolean	e_startup_trace_write		(const gchar *filename,
+						 GError **error);
+gboolean	e_startup_trace_flush		(GError **error);
+
+G_END_DECLS
+
+#endif /* E_STARTUP_TRACE_H */
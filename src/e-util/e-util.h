@@ -88,6 +88,7 @@
 #include <e-util/e-config-lookup-result.h>
 #include <e-util/e-config-lookup-result-simple.h>
 #include <e-util/e-conflict-search-selector.h>
+#include <e-util/e-contact-index.h>
 #include <e-util/e-contact-store.h>
 #include <e-util/e-content-editor.h>
 #include <e-util/e-content-request.h>
@@ -103,6 +104,7 @@
 #include <e-util/e-emoticon-tool-button.h>
 #include <e-util/e-emoticon.h>
 #include <e-util/e-event.h>
+#include <e-util/e-file-data-wrapper.h>
 #include <e-util/e-file-request.h>
 #include <e-util/e-file-utils.h>
 #include <e-util/e-filter-code.h>
@@ -210,6 +212,7 @@
 #include <e-util/e-spell-entry.h>
 #include <e-util/e-spell-text-view.h>
 #include <e-util/e-spinner.h>
+#include <e-util/e-startup-trace.h>
 #include <e-util/e-stock-request.h>
 #include <e-util/e-table-click-to-add.h>
 #include <e-util/e-table-col-dnd.h>
@@ -0,0 +1,163 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "evolution-config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <string.h>
+#include <time.h>
+#include <utime.h>
+
+#include <e-util/e-util.h>
+
+/* Longer than the expiry time of the files in e-mktemp.c */
+#define TEST_TEMP_AGE (3 * 60 * 60)
+
+/* More than one read buffer of the wrapper */
+#define TEST_CONTENT_SIZE (200 * 1024)
+
+static void
+test_age_path (const gchar *path)
+{
+	struct utimbuf times;
+
+	times.actime = time (NULL) - TEST_TEMP_AGE;
+	times.modtime = times.actime;
+
+	g_assert_cmpint (g_utime (path, &times), ==, 0);
+}
+
+static void
+test_remove_recursive (const gchar *path)
+{
+	if (g_file_test (path, G_FILE_TEST_IS_DIR)) {
+		GDir *dir;
+		const gchar *name;
+
+		dir = g_dir_open (path, 0, NULL);
+		while (dir && (name = g_dir_read_name (dir)) != NULL) {
+			gchar *child;
+
+			child = g_build_filename (path, name, NULL);
+			test_remove_recursive (child);
+			g_free (child);
+		}
+
+		if (dir)
+			g_dir_close (dir);
+
+		g_rmdir (path);
+	} else {
+		g_unlink (path);
+	}
+}
+
+static void
+test_file_data_wrapper_expired_temp (void)
+{
+	CamelDataWrapper *wrapper;
+	GFile *file;
+	gchar *content;
+	gchar *temp_dir;
+	gchar *dirname;
+	gchar *filename;
+	gchar *new_dirname;
+	gint ii;
+	GError *error = NULL;
+
+	content = g_malloc (TEST_CONTENT_SIZE);
+	for (ii = 0; ii < TEST_CONTENT_SIZE; ii++)
+		content[ii] = 'a' + (ii % 26);
+
+	/* Create the directory where e_mkdtemp() does, without calling it,
+	 * because its first call in the process runs the expiry. */
+	temp_dir = g_build_filename (e_get_user_cache_dir (), "tmp", NULL);
+	g_assert_cmpint (g_mkdir_with_parents (temp_dir, 0700), ==, 0);
+
+	dirname = g_build_filename (temp_dir, "evolution-attachment-XXXXXX", NULL);
+	g_assert (g_mkdtemp (dirname) != NULL);
+
+	filename = g_build_filename (dirname, "attachment.bin", NULL);
+	g_file_set_contents (filename, content, TEST_CONTENT_SIZE, &error);
+	g_assert_no_error (error);
+
+	file = g_file_new_for_path (filename);
+	wrapper = e_file_data_wrapper_new (file, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (wrapper != NULL);
+
+	/* Make both the file and its directory older than the expiry time. */
+	test_age_path (filename);
+	test_age_path (dirname);
+
+	new_dirname = e_mkdtemp ("test-file-data-wrapper-XXXXXX");
+	g_assert (new_dirname != NULL);
+
+	g_assert (!g_file_test (filename, G_FILE_TEST_EXISTS));
+	g_assert (!g_file_test (dirname, G_FILE_TEST_EXISTS));
+
+	/* Write twice, the content is read from its beginning each time. */
+	for (ii = 0; ii < 2; ii++) {
+		CamelStream *stream;
+		GByteArray *bytes;
+		gssize n_written;
+
+		bytes = g_byte_array_new ();
+		stream = camel_stream_mem_new_with_byte_array (bytes);
+
+		n_written = camel_data_wrapper_write_to_stream_sync (wrapper, stream, NULL, &error);
+		g_assert_no_error (error);
+		g_assert_cmpint (n_written, ==, TEST_CONTENT_SIZE);
+		g_assert_cmpuint (bytes->len, ==, TEST_CONTENT_SIZE);
+		g_assert (memcmp (bytes->data, content, TEST_CONTENT_SIZE) == 0);
+
+		g_object_unref (stream);
+	}
+
+	g_object_unref (wrapper);
+	g_object_unref (file);
+	g_rmdir (new_dirname);
+	g_free (new_dirname);
+	g_free (filename);
+	g_free (dirname);
+	g_free (temp_dir);
+	g_free (content);
+}
+
+gint
+main (gint argc,
+      gchar *argv[])
+{
+	gchar *cache_dir;
+	gint res;
+
+	/* Do not touch the user's cache directory. */
+	cache_dir = g_dir_make_tmp ("test-file-data-wrapper-XXXXXX", NULL);
+	g_return_val_if_fail (cache_dir != NULL, -1);
+
+	g_setenv ("XDG_CACHE_HOME", cache_dir, TRUE);
+
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/EFileDataWrapper/ExpiredTemporaryDirectory", test_file_data_wrapper_expired_temp);
+
+	res = g_test_run ();
+
+	test_remove_recursive (cache_dir);
+	g_free (cache_dir);
+
+	return res;
+}
@@ -20,6 +20,7 @@
 #include <glib/gstdio.h>
 
 #include <locale.h>
+#include <string.h>
 #include <e-util/e-util.h>
 
 #include "e-html-editor-private.h"
@@ -2182,6 +2183,56 @@ test_cite_reply_plain (TestFixture *fixture)
 		g_test_fail ();
 }
 
+static void
+test_cite_reply_plain_long_link (TestFixture *fixture)
+{
+	EContentEditor *cnt_editor;
+	GString *content;
+	gchar *text;
+	gint ii;
+
+	if (!test_utils_process_commands (fixture,
+		"mode:plain\n")) {
+		g_test_fail ();
+		return;
+	}
+
+	/* Long enough to be wrapped and quoted in one pass */
+	content = g_string_new ("<pre>");
+	for (ii = 0; ii < 30000; ii++)
+		g_string_append (content, "line\n");
+	g_string_append (content,
+		"Visit http://www.example.com/this-is-a-very-long-link-which-should-not-be-wrapped-into-multiple-lines now\n"
+		"</pre><span class=\"-x-evo-to-body\" data-credits=\"On Today, User wrote:\"></span>"
+		"<span class=\"-x-evo-cite-body\"></span>");
+
+	test_utils_insert_content (fixture, content->str,
+		E_CONTENT_EDITOR_INSERT_REPLACE_ALL | E_CONTENT_EDITOR_INSERT_TEXT_HTML);
+
+	g_string_free (content, TRUE);
+
+	cnt_editor = e_html_editor_get_content_editor (fixture->editor);
+
+	text = e_content_editor_get_content (cnt_editor, E_CONTENT_EDITOR_GET_PROCESSED | E_CONTENT_EDITOR_GET_TEXT_HTML, NULL, NULL);
+	if (!text || !strstr (text,
+		"<a href=\"http://www.example.com/this-is-a-very-long-link-which-should-not-be-wrapped-into-multiple-lines\">"
+		"http://www.example.com/this-is-a-very-long-link-which-should-not-be-wrapped-into-multiple-lines</a>")) {
+		g_warning ("%s: returned HTML does not contain the whole link", G_STRFUNC);
+		g_test_fail ();
+	}
+	g_free (text);
+
+	text = e_content_editor_get_content (cnt_editor, E_CONTENT_EDITOR_GET_PROCESSED | E_CONTENT_EDITOR_GET_TEXT_PLAIN, NULL, NULL);
+	if (!text || !strstr (text,
+		"> Visit\n"
+		"> http://www.example.com/this-is-a-very-long-link-which-should-not-be-wrapped-into-multiple-lines\n"
+		"> now")) {
+		g_warning ("%s: returned Plain does not contain the link on its own line", G_STRFUNC);
+		g_test_fail ();
+	}
+	g_free (text);
+}
+
 static void
 test_undo_text_typed (TestFixture *fixture)
 {
@@ -2872,6 +2923,7 @@ main (gint argc,
 	test_utils_add_test ("/cite/longline", test_cite_longline);
 	test_utils_add_test ("/cite/reply/html", test_cite_reply_html);
 	test_utils_add_test ("/cite/reply/plain", test_cite_reply_plain);
+	test_utils_add_test ("/cite/reply/plain/long-link", test_cite_reply_plain_long_link);
 	test_utils_add_test ("/undo/text/typed", test_undo_text_typed);
 	test_utils_add_test ("/undo/text/forward-delete", test_undo_text_forward_delete);
 	test_utils_add_test ("/undo/text/backward-delete", test_undo_text_backward_delete);
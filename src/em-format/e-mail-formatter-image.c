@@ -57,6 +57,32 @@ static const gchar *formatter_mime_types[] = {
 	NULL
 };
 
+static gchar *
+emfe_image_build_uri (EMailFormatterContext *context,
+                      EMailPart *part)
+{
+	CamelFolder *folder;
+	const gchar *message_uid;
+
+	if (!context->part_list)
+		return NULL;
+
+	folder = e_mail_part_list_get_folder (context->part_list);
+	message_uid = e_mail_part_list_get_message_uid (context->part_list);
+
+	if (!message_uid || !*message_uid)
+		return NULL;
+
+	/* Printing needs the full resolution, while the display
+	 * can do with an image not wider than the view itself. */
+	return e_mail_part_build_uri (
+		folder, message_uid,
+		"part_id", G_TYPE_STRING, e_mail_part_get_id (part),
+		"mode", G_TYPE_INT, E_MAIL_FORMATTER_MODE_RAW,
+		"preview", G_TYPE_BOOLEAN, context->mode != E_MAIL_FORMATTER_MODE_PRINTING,
+		NULL);
+}
+
 static gboolean
 emfe_image_format (EMailFormatterExtension *extension,
                    EMailFormatter *formatter,
@@ -82,12 +108,51 @@ emfe_image_format (EMailFormatterExtension *extension,
 	/* Skip TIFF images, which cannot be shown inline */
 	if (content_type && (
 	    camel_content_type_is (content_type, "image", "tiff") ||
-	    camel_content_type_is (content_type, "image", "tif")))
+	    camel_content_type_is (content_type, "image", "tif"))) {
+		g_object_unref (mime_part);
 		return FALSE;
+	}
 
 	dw = camel_medium_get_content (CAMEL_MEDIUM (mime_part));
 	g_return_val_if_fail (dw, FALSE);
 
+	if (context->mode == E_MAIL_FORMATTER_MODE_RAW &&
+	    e_mail_formatter_get_animate_images (formatter)) {
+		/* Nothing to change, decode directly into the output. */
+		camel_data_wrapper_decode_to_output_stream_sync (
+			dw, stream, cancellable, NULL);
+
+		g_object_unref (mime_part);
+
+		return TRUE;
+	}
+
+	if (context->mode != E_MAIL_FORMATTER_MODE_RAW) {
+		gchar *uri;
+
+		/* The image is streamed by the mail URI handler
+		 * on demand, rather than pasted into the HTML. */
+		uri = emfe_image_build_uri (context, part);
+		if (uri) {
+			gchar *buffer;
+
+			buffer = g_strdup_printf (
+				"<img src=\"%s\" "
+				"     style=\"max-width: 100%%;\" />",
+				uri);
+
+			g_output_stream_write_all (
+				stream, buffer, strlen (buffer),
+				NULL, cancellable, NULL);
+
+			g_free (buffer);
+			g_free (uri);
+			g_object_unref (mime_part);
+
+			return TRUE;
+		}
+	}
+
 	raw_content = g_memory_output_stream_new_resizable ();
 	camel_data_wrapper_decode_to_output_stream_sync (
 		dw, raw_content, cancellable, NULL);
@@ -97,34 +162,23 @@ emfe_image_format (EMailFormatterExtension *extension,
 		G_MEMORY_OUTPUT_STREAM (raw_content));
 
 	if (context->mode == E_MAIL_FORMATTER_MODE_RAW) {
+		gchar *buff;
+		gsize len;
 
-		if (!e_mail_formatter_get_animate_images (formatter)) {
-
-			gchar *buff;
-			gsize len;
-
-			e_mail_part_animation_extract_frame (
-				bytes, &buff, &len);
-
-			g_output_stream_write_all (
-				stream, buff, len, NULL, cancellable, NULL);
-
-			g_free (buff);
-
-		} else {
-			gconstpointer data;
-			gsize size;
+		e_mail_part_animation_extract_frame (
+			bytes, &buff, &len);
 
-			data = g_bytes_get_data (bytes, &size);
+		g_output_stream_write_all (
+			stream, buff, len, NULL, cancellable, NULL);
 
-			g_output_stream_write_all (
-				stream, data, size, NULL, cancellable, NULL);
-		}
+		g_free (buff);
 
 	} else {
 		gchar *buffer;
 		const gchar *mime_type;
 
+		/* Not part of a message, thus cannot be referenced
+		 * by a mail URI; inline the image into the HTML. */
 		if (!e_mail_formatter_get_animate_images (formatter)) {
 
 			gchar *buff;
@@ -0,0 +1,1699 @@
+/*
+ * e-mail-body-index.c
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * SECTION: e-mail-body-index
+ * @include: libemail-engine/libemail-engine.h
+ * @short_description: Local full-text index of message bodies
+ *
+ * #EMailBodyIndex maintains an inverted index over the text parts of
+ * messages, which are available in the offline cache. The index is built
+ * by a background thread, at a limited rate, and it is saved to the disk
+ * regularly, thus the indexing continues where it stopped on the next run.
+ *
+ * The index answers body searches of the free form expressions. The search
+ * expression lists, per folder, the messages known to the index, thus it can
+ * tell them apart from those which should be searched as before, like
+ * messages received after the expression was built. Messages themselves
+ * are not changed by the index.
+ **/
+
+#include "evolution-config.h"
+
+#include <string.h>
+
+#include "e-mail-folder-utils.h"
+#include "mail-folder-cache.h"
+
+#include "e-mail-body-index.h"
+
+#define E_MAIL_BODY_INDEX_GET_PRIVATE(obj) \
+	(G_TYPE_INSTANCE_GET_PRIVATE \
+	((obj), E_TYPE_MAIL_BODY_INDEX, EMailBodyIndexPrivate))
+
+/* Change when the file format or the tokenizer changes */
+#define BODY_INDEX_MAGIC		"EVOBIDX3"
+#define BODY_INDEX_FILENAME		"body-index.bin"
+
+#define BODY_INDEX_MIN_TOKEN		2
+#define BODY_INDEX_MAX_TOKEN		32	/* in characters, longer words are cut */
+#define BODY_INDEX_MAX_TEXT		(256 * 1024)	/* per message */
+#define BODY_INDEX_MESSAGES_PER_SECOND	20
+#define BODY_INDEX_SAVE_INTERVAL	(60 * G_USEC_PER_SEC)
+#define BODY_INDEX_RESCAN_INTERVAL	(10 * 60 * G_USEC_PER_SEC)
+#define BODY_INDEX_RETRY_INTERVAL	(60 * 60 * G_USEC_PER_SEC)	/* for messages not in the cache */
+#define BODY_INDEX_COMPACT_MIN		1000	/* forgotten documents, also at least a quarter of all */
+
+/* Longer lists of UIDs make the expression too slow to evaluate */
+#define BODY_INDEX_MAX_HITS		5000
+#define BODY_INDEX_MAX_KNOWN		50000	/* only looked up, not searched */
+
+/* Terms are found by any pair of their bytes */
+#define BODY_INDEX_N_PAIRS		65536
+#define BODY_INDEX_PAIR(str)		((((guint8) (str)[0]) << 8) | ((guint8) (str)[1]))
+
+typedef struct _FolderState FolderState;
+
+typedef struct _Posting {
+	const gchar *term;	/* owned by the terms table */
+	GByteArray *bytes;	/* delta-encoded document numbers, as varints */
+	guint32 last_doc;
+	guint32 n_docs;
+} Posting;
+
+typedef struct _Document {
+	FolderState *folder;	/* NULL when the message is gone */
+	gchar *uid;
+} Document;
+
+struct _FolderState {
+	gchar *uri;
+	GHashTable *docs;	/* gchar *uid ~> document number + 1 */
+	GHashTable *uncached;	/* gchar *uid, not in the offline cache when scanned */
+	gboolean complete;	/* all messages are in docs or in uncached */
+	gint64 retry_at;	/* when to look for the uncached messages again */
+	guint n_changes;	/* counts changes of the folder content */
+};
+
+struct _EMailBodyIndexPrivate {
+	GWeakRef session;
+	MailFolderCache *folder_cache;
+	gulong folder_changed_id;
+	gulong folder_deleted_id;
+	gulong folder_renamed_id;
+
+	GThread *thread;
+	GCancellable *cancellable;
+
+	GMutex lock;
+	GCond cond;
+	gboolean stop;
+	gboolean wakeup;
+	gboolean loaded;
+	gboolean changed;	/* not saved yet */
+	gint64 last_save;
+
+	GPtrArray *documents;	/* Document *, indexed by document number */
+	GHashTable *folders;	/* gchar *uri ~> FolderState * */
+	guint n_forgotten;	/* documents without a folder */
+
+	/* Changed only by the indexer thread, with the lock held */
+	GHashTable *terms;	/* gchar *term ~> Posting * */
+	GPtrArray *term_list;	/* Posting *, indexed by term number */
+	GArray **pairs;		/* term numbers with a pair of bytes, indexed by the pair */
+};
+
+G_DEFINE_TYPE (EMailBodyIndex, e_mail_body_index, G_TYPE_OBJECT)
+
+static GWeakRef default_body_index;
+
+static void
+posting_free (gpointer ptr)
+{
+	Posting *posting = ptr;
+
+	if (posting) {
+		g_byte_array_unref (posting->bytes);
+		g_slice_free (Posting, posting);
+	}
+}
+
+static void
+document_free (gpointer ptr)
+{
+	Document *doc = ptr;
+
+	if (doc) {
+		g_free (doc->uid);
+		g_slice_free (Document, doc);
+	}
+}
+
+static FolderState *
+folder_state_new (const gchar *uri)
+{
+	FolderState *state;
+
+	state = g_slice_new0 (FolderState);
+	state->uri = g_strdup (uri);
+	/* The keys are owned by the Document-s */
+	state->docs = g_hash_table_new (g_str_hash, g_str_equal);
+	state->uncached = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	return state;
+}
+
+static void
+folder_state_free (gpointer ptr)
+{
+	FolderState *state = ptr;
+
+	if (state) {
+		g_hash_table_destroy (state->docs);
+		g_hash_table_destroy (state->uncached);
+		g_free (state->uri);
+		g_slice_free (FolderState, state);
+	}
+}
+
+static void
+body_index_put_uint (GByteArray *bytes,
+                     guint32 value)
+{
+	guint8 byte;
+
+	while (value >= 0x80) {
+		byte = (value & 0x7F) | 0x80;
+		g_byte_array_append (bytes, &byte, 1);
+		value >>= 7;
+	}
+
+	byte = value;
+	g_byte_array_append (bytes, &byte, 1);
+}
+
+static gboolean
+body_index_get_uint (const guint8 **pdata,
+                     const guint8 *end,
+                     guint32 *out_value)
+{
+	const guint8 *data = *pdata;
+	guint32 value = 0;
+	guint shift = 0;
+
+	while (data < end && shift < 32) {
+		value |= ((guint32) (*data & 0x7F)) << shift;
+
+		if (!(*data & 0x80)) {
+			*pdata = data + 1;
+			*out_value = value;
+			return TRUE;
+		}
+
+		data++;
+		shift += 7;
+	}
+
+	return FALSE;
+}
+
+static void
+body_index_put_string (GByteArray *bytes,
+                       const gchar *str)
+{
+	guint32 len = str ? strlen (str) : 0;
+
+	body_index_put_uint (bytes, len);
+	g_byte_array_append (bytes, (const guint8 *) str, len);
+}
+
+static gchar *
+body_index_get_string (const guint8 **pdata,
+                       const guint8 *end)
+{
+	guint32 len;
+	gchar *str;
+
+	if (!body_index_get_uint (pdata, end, &len) || len > end - *pdata)
+		return NULL;
+
+	str = g_strndup ((const gchar *) *pdata, len);
+	*pdata += len;
+
+	return str;
+}
+
+static void
+posting_add (Posting *posting,
+             guint32 doc)
+{
+	if (posting->n_docs > 0 && doc <= posting->last_doc)
+		return;
+
+	body_index_put_uint (posting->bytes, doc - posting->last_doc);
+
+	posting->last_doc = doc;
+	posting->n_docs++;
+}
+
+/* Adds document numbers of the @posting into the @docs set */
+static void
+posting_collect (Posting *posting,
+                 GHashTable *docs)
+{
+	const guint8 *data, *end;
+	guint32 doc = 0, delta;
+
+	data = posting->bytes->data;
+	end = data + posting->bytes->len;
+
+	while (body_index_get_uint (&data, end, &delta)) {
+		doc += delta;
+		g_hash_table_add (docs, GUINT_TO_POINTER (doc + 1));
+	}
+}
+
+typedef void (* BodyIndexTokenFunc) (const gchar *word,
+				     gpointer user_data);
+
+static void
+body_index_tokenize (const gchar *text,
+                     gsize len,
+                     gboolean is_html,
+                     BodyIndexTokenFunc func,
+                     gpointer user_data)
+{
+	const gchar *ptr, *end;
+	GString *word;
+	gboolean in_tag = FALSE;
+	guint n_chars = 0;
+
+	word = g_string_sized_new (BODY_INDEX_MAX_TOKEN * 2);
+
+	for (ptr = text, end = text + len; ptr <= end; ) {
+		gunichar chr = 0;
+
+		if (ptr < end) {
+			chr = g_utf8_get_char_validated (ptr, end - ptr);
+
+			if (chr == (gunichar) -1 || chr == (gunichar) -2) {
+				/* Skip invalid bytes */
+				ptr++;
+				chr = ' ';
+			} else {
+				ptr = g_utf8_next_char (ptr);
+			}
+
+			if (is_html) {
+				if (chr == '<')
+					in_tag = TRUE;
+
+				if (in_tag) {
+					if (chr == '>')
+						in_tag = FALSE;
+					chr = ' ';
+				}
+			}
+		} else {
+			ptr++;
+		}
+
+		if (chr && g_unichar_isalnum (chr)) {
+			if (n_chars < BODY_INDEX_MAX_TOKEN)
+				g_string_append_unichar (word, g_unichar_tolower (chr));
+			n_chars++;
+			continue;
+		}
+
+		if (n_chars >= BODY_INDEX_MIN_TOKEN)
+			func (word->str, user_data);
+
+		g_string_truncate (word, 0);
+		n_chars = 0;
+	}
+
+	g_string_free (word, TRUE);
+}
+
+static void
+body_index_add_term_cb (const gchar *word,
+                        gpointer user_data)
+{
+	GHashTable *terms = user_data;
+
+	if (!g_hash_table_contains (terms, word))
+		g_hash_table_add (terms, g_strdup (word));
+}
+
+/* Collects terms of the text parts of the @part, including
+ * text attachments, into the @terms set. */
+static void
+body_index_collect_part (CamelMimePart *part,
+                         GHashTable *terms,
+                         gsize *budget,
+                         GCancellable *cancellable)
+{
+	CamelDataWrapper *content;
+	CamelContentType *ct;
+	GOutputStream *stream;
+	const gchar *charset;
+	gchar *data, *converted = NULL;
+	gsize size;
+
+	if (*budget == 0 || g_cancellable_is_cancelled (cancellable))
+		return;
+
+	content = camel_medium_get_content (CAMEL_MEDIUM (part));
+	if (!content)
+		return;
+
+	if (CAMEL_IS_MULTIPART (content)) {
+		guint ii, n_parts;
+
+		n_parts = camel_multipart_get_number (CAMEL_MULTIPART (content));
+
+		for (ii = 0; ii < n_parts; ii++) {
+			body_index_collect_part (camel_multipart_get_part (CAMEL_MULTIPART (content), ii),
+				terms, budget, cancellable);
+		}
+
+		return;
+	}
+
+	if (CAMEL_IS_MIME_MESSAGE (content)) {
+		body_index_collect_part (CAMEL_MIME_PART (content), terms, budget, cancellable);
+		return;
+	}
+
+	ct = camel_data_wrapper_get_mime_type_field (content);
+	if (!ct || !camel_content_type_is (ct, "text", "*"))
+		return;
+
+	stream = g_memory_output_stream_new_resizable ();
+
+	if (camel_data_wrapper_decode_to_output_stream_sync (content, stream, cancellable, NULL) < 0 ||
+	    !g_output_stream_close (stream, cancellable, NULL)) {
+		g_object_unref (stream);
+		return;
+	}
+
+	data = g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (stream));
+	size = g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (stream));
+
+	if (size > *budget)
+		size = *budget;
+
+	charset = camel_content_type_param (ct, "charset");
+	if (data && size && charset && g_ascii_strcasecmp (charset, "utf-8") != 0 && g_ascii_strcasecmp (charset, "us-ascii") != 0) {
+		gsize written = 0;
+
+		converted = g_convert_with_fallback (data, size, "UTF-8", camel_iconv_charset_name (charset), " ", NULL, &written, NULL);
+		if (converted) {
+			data = converted;
+			size = written;
+		}
+	}
+
+	if (data && size) {
+		body_index_tokenize (data, size, camel_content_type_is (ct, "text", "html"),
+			body_index_add_term_cb, terms);
+	}
+
+	size = g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (stream));
+	*budget = size >= *budget ? 0 : *budget - size;
+
+	g_free (converted);
+	g_object_unref (stream);
+}
+
+/* Call with the lock held */
+static void
+body_index_forget_document (EMailBodyIndex *body_index,
+                            guint32 doc_num)
+{
+	Document *doc;
+
+	doc = g_ptr_array_index (body_index->priv->documents, doc_num);
+
+	if (doc->folder) {
+		g_hash_table_remove (doc->folder->docs, doc->uid);
+		doc->folder = NULL;
+		body_index->priv->n_forgotten++;
+	}
+
+	g_clear_pointer (&doc->uid, g_free);
+
+	body_index->priv->changed = TRUE;
+}
+
+/* Call with the lock held */
+static void
+body_index_forget_folder (EMailBodyIndex *body_index,
+                          const gchar *folder_uri)
+{
+	FolderState *state;
+	GHashTableIter iter;
+	gpointer value;
+
+	state = g_hash_table_lookup (body_index->priv->folders, folder_uri);
+	if (!state)
+		return;
+
+	g_hash_table_iter_init (&iter, state->docs);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		Document *doc;
+
+		doc = g_ptr_array_index (body_index->priv->documents, GPOINTER_TO_UINT (value) - 1);
+		doc->folder = NULL;
+		g_clear_pointer (&doc->uid, g_free);
+
+		body_index->priv->n_forgotten++;
+	}
+
+	g_hash_table_remove (body_index->priv->folders, folder_uri);
+
+	body_index->priv->changed = TRUE;
+}
+
+/* Call with the lock held; gives the @posting the next term number */
+static void
+body_index_list_term (EMailBodyIndex *body_index,
+                      Posting *posting)
+{
+	guint32 term_num;
+	gsize ii, len;
+
+	term_num = body_index->priv->term_list->len;
+
+	g_ptr_array_add (body_index->priv->term_list, posting);
+
+	len = strlen (posting->term);
+
+	for (ii = 0; ii + 1 < len; ii++) {
+		GArray **ppair = &body_index->priv->pairs[BODY_INDEX_PAIR (posting->term + ii)];
+
+		if (!*ppair)
+			*ppair = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+		/* The same pair can repeat in the term */
+		if (!(*ppair)->len || g_array_index (*ppair, guint32, (*ppair)->len - 1) != term_num)
+			g_array_append_val (*ppair, term_num);
+	}
+}
+
+/* Call with the lock held; takes ownership of the @term */
+static Posting *
+body_index_new_term (EMailBodyIndex *body_index,
+                     gchar *term)
+{
+	Posting *posting;
+
+	posting = g_slice_new0 (Posting);
+	posting->term = term;
+	posting->bytes = g_byte_array_new ();
+
+	g_hash_table_insert (body_index->priv->terms, term, posting);
+	body_index_list_term (body_index, posting);
+
+	return posting;
+}
+
+/* Call with the lock held; returns the new document number */
+static guint32
+body_index_add_document (EMailBodyIndex *body_index,
+                         FolderState *state,
+                         const gchar *uid,
+                         GHashTable *terms)
+{
+	Document *doc;
+	GHashTableIter iter;
+	gpointer key;
+	guint32 doc_num;
+
+	doc_num = body_index->priv->documents->len;
+
+	doc = g_slice_new0 (Document);
+	doc->folder = state;
+	doc->uid = g_strdup (uid);
+
+	g_ptr_array_add (body_index->priv->documents, doc);
+	g_hash_table_insert (state->docs, doc->uid, GUINT_TO_POINTER (doc_num + 1));
+	g_hash_table_remove (state->uncached, uid);
+
+	g_hash_table_iter_init (&iter, terms);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		Posting *posting;
+
+		posting = g_hash_table_lookup (body_index->priv->terms, key);
+		if (!posting)
+			posting = body_index_new_term (body_index, g_strdup (key));
+
+		posting_add (posting, doc_num);
+	}
+
+	body_index->priv->changed = TRUE;
+
+	return doc_num;
+}
+
+static gchar *
+body_index_dup_filename (void)
+{
+	return g_build_filename (mail_session_get_cache_dir (), BODY_INDEX_FILENAME, NULL);
+}
+
+/* Call with the lock held */
+static void
+body_index_clear_pairs (EMailBodyIndex *body_index)
+{
+	guint ii;
+
+	for (ii = 0; ii < BODY_INDEX_N_PAIRS; ii++) {
+		if (body_index->priv->pairs[ii])
+			g_clear_pointer (&body_index->priv->pairs[ii], g_array_unref);
+	}
+}
+
+/* Call with the lock held */
+static void
+body_index_reset (EMailBodyIndex *body_index)
+{
+	g_ptr_array_set_size (body_index->priv->documents, 0);
+	g_hash_table_remove_all (body_index->priv->folders);
+	g_ptr_array_set_size (body_index->priv->term_list, 0);
+	g_hash_table_remove_all (body_index->priv->terms);
+	body_index_clear_pairs (body_index);
+
+	body_index->priv->n_forgotten = 0;
+	body_index->priv->changed = TRUE;
+}
+
+/* Call with the lock held, from the indexer thread. Drops the forgotten
+ * documents, renumbers the others and removes terms left without any. */
+static void
+body_index_compact (EMailBodyIndex *body_index)
+{
+	GPtrArray *documents, *term_list;
+	guint32 *doc_nums, n_docs, ii;
+
+	n_docs = body_index->priv->documents->len;
+
+	/* Old document number ~> new document number + 1, or 0 when forgotten */
+	doc_nums = g_new0 (guint32, n_docs);
+	documents = g_ptr_array_new_with_free_func (document_free);
+
+	for (ii = 0; ii < n_docs; ii++) {
+		Document *doc = g_ptr_array_index (body_index->priv->documents, ii);
+
+		if (!doc->folder)
+			continue;
+
+		g_ptr_array_add (documents, doc);
+		doc_nums[ii] = documents->len;
+
+		g_hash_table_insert (doc->folder->docs, doc->uid, GUINT_TO_POINTER (documents->len));
+
+		/* The new array owns it now */
+		body_index->priv->documents->pdata[ii] = NULL;
+	}
+
+	g_ptr_array_unref (body_index->priv->documents);
+	body_index->priv->documents = documents;
+
+	term_list = body_index->priv->term_list;
+	body_index->priv->term_list = g_ptr_array_new ();
+	body_index_clear_pairs (body_index);
+
+	for (ii = 0; ii < term_list->len; ii++) {
+		Posting *posting = g_ptr_array_index (term_list, ii);
+		Posting renumbered = { 0 };
+		const guint8 *data, *end;
+		guint32 doc = 0, delta;
+
+		renumbered.bytes = g_byte_array_new ();
+
+		data = posting->bytes->data;
+		end = data + posting->bytes->len;
+
+		while (body_index_get_uint (&data, end, &delta)) {
+			doc += delta;
+
+			if (doc < n_docs && doc_nums[doc])
+				posting_add (&renumbered, doc_nums[doc] - 1);
+		}
+
+		g_byte_array_unref (posting->bytes);
+		posting->bytes = renumbered.bytes;
+		posting->last_doc = renumbered.last_doc;
+		posting->n_docs = renumbered.n_docs;
+
+		if (posting->n_docs)
+			body_index_list_term (body_index, posting);
+		else
+			g_hash_table_remove (body_index->priv->terms, posting->term);
+	}
+
+	g_ptr_array_unref (term_list);
+	g_free (doc_nums);
+
+	body_index->priv->n_forgotten = 0;
+	body_index->priv->changed = TRUE;
+}
+
+static gboolean
+body_index_parse (EMailBodyIndex *body_index,
+                  const guint8 *data,
+                  const guint8 *end)
+{
+	GPtrArray *folders;
+	guint32 ii, count, value;
+	gboolean success = FALSE;
+
+	folders = g_ptr_array_new ();
+
+	if ((gsize) (end - data) < strlen (BODY_INDEX_MAGIC) ||
+	    memcmp (data, BODY_INDEX_MAGIC, strlen (BODY_INDEX_MAGIC)) != 0)
+		goto exit;
+
+	data += strlen (BODY_INDEX_MAGIC);
+
+	if (!body_index_get_uint (&data, end, &count))
+		goto exit;
+
+	for (ii = 0; ii < count; ii++) {
+		FolderState *state;
+		guint32 jj, n_uncached;
+		gchar *uri;
+
+		uri = body_index_get_string (&data, end);
+		if (!uri || !body_index_get_uint (&data, end, &value) ||
+		    !body_index_get_uint (&data, end, &n_uncached)) {
+			g_free (uri);
+			goto exit;
+		}
+
+		state = folder_state_new (uri);
+		state->complete = value != 0;
+
+		g_hash_table_insert (body_index->priv->folders, state->uri, state);
+		g_ptr_array_add (folders, state);
+
+		g_free (uri);
+
+		for (jj = 0; jj < n_uncached; jj++) {
+			gchar *uid;
+
+			uid = body_index_get_string (&data, end);
+			if (!uid)
+				goto exit;
+
+			g_hash_table_add (state->uncached, uid);
+		}
+	}
+
+	if (!body_index_get_uint (&data, end, &count))
+		goto exit;
+
+	for (ii = 0; ii < count; ii++) {
+		Document *doc;
+
+		if (!body_index_get_uint (&data, end, &value) || value > folders->len)
+			goto exit;
+
+		doc = g_slice_new0 (Document);
+		doc->uid = body_index_get_string (&data, end);
+
+		g_ptr_array_add (body_index->priv->documents, doc);
+
+		if (!doc->uid)
+			goto exit;
+
+		if (value > 0) {
+			doc->folder = g_ptr_array_index (folders, value - 1);
+			g_hash_table_insert (doc->folder->docs, doc->uid, GUINT_TO_POINTER (ii + 1));
+		} else {
+			g_clear_pointer (&doc->uid, g_free);
+			body_index->priv->n_forgotten++;
+		}
+	}
+
+	if (!body_index_get_uint (&data, end, &count))
+		goto exit;
+
+	for (ii = 0; ii < count; ii++) {
+		Posting *posting;
+		gchar *term;
+
+		term = body_index_get_string (&data, end);
+		if (!term || g_hash_table_contains (body_index->priv->terms, term)) {
+			g_free (term);
+			goto exit;
+		}
+
+		posting = body_index_new_term (body_index, term);
+
+		if (!body_index_get_uint (&data, end, &posting->n_docs) ||
+		    !body_index_get_uint (&data, end, &posting->last_doc) ||
+		    !body_index_get_uint (&data, end, &value) ||
+		    value > end - data)
+			goto exit;
+
+		g_byte_array_append (posting->bytes, data, value);
+		data += value;
+	}
+
+	success = data == end;
+
+ exit:
+	g_ptr_array_free (folders, TRUE);
+
+	return success;
+}
+
+static void
+body_index_load (EMailBodyIndex *body_index)
+{
+	gchar *filename, *contents = NULL;
+	gsize length = 0;
+
+	filename = body_index_dup_filename ();
+
+	g_mutex_lock (&body_index->priv->lock);
+
+	if (!g_file_get_contents (filename, &contents, &length, NULL) ||
+	    !body_index_parse (body_index, (const guint8 *) contents, (const guint8 *) contents + length)) {
+		if (contents)
+			g_debug ("%s: Index file '%s' is broken, starting from scratch", G_STRFUNC, filename);
+
+		body_index_reset (body_index);
+	} else {
+		body_index->priv->changed = FALSE;
+	}
+
+	body_index->priv->loaded = TRUE;
+	body_index->priv->last_save = g_get_monotonic_time ();
+
+	g_mutex_unlock (&body_index->priv->lock);
+
+	g_free (contents);
+	g_free (filename);
+}
+
+/* Call with the lock held; writes everything but the terms */
+static void
+body_index_write_documents (EMailBodyIndex *body_index,
+                            GByteArray *bytes)
+{
+	GHashTable *folder_nums;
+	GHashTableIter iter;
+	gpointer key, value;
+	guint32 ii;
+
+	folder_nums = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	g_byte_array_append (bytes, (const guint8 *) BODY_INDEX_MAGIC, strlen (BODY_INDEX_MAGIC));
+
+	body_index_put_uint (bytes, g_hash_table_size (body_index->priv->folders));
+
+	g_hash_table_iter_init (&iter, body_index->priv->folders);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		FolderState *state = value;
+		GHashTableIter uiter;
+
+		g_hash_table_insert (folder_nums, state, GUINT_TO_POINTER (g_hash_table_size (folder_nums) + 1));
+
+		body_index_put_string (bytes, state->uri);
+		body_index_put_uint (bytes, state->complete ? 1 : 0);
+		body_index_put_uint (bytes, g_hash_table_size (state->uncached));
+
+		g_hash_table_iter_init (&uiter, state->uncached);
+		while (g_hash_table_iter_next (&uiter, &key, NULL))
+			body_index_put_string (bytes, key);
+	}
+
+	body_index_put_uint (bytes, body_index->priv->documents->len);
+
+	for (ii = 0; ii < body_index->priv->documents->len; ii++) {
+		Document *doc = g_ptr_array_index (body_index->priv->documents, ii);
+
+		body_index_put_uint (bytes, doc->folder ? GPOINTER_TO_UINT (g_hash_table_lookup (folder_nums, doc->folder)) : 0);
+		body_index_put_string (bytes, doc->uid);
+	}
+
+	g_hash_table_destroy (folder_nums);
+}
+
+/* Writes the terms in the order of their numbers. Only the indexer thread
+ * changes them, thus it can call this without holding the lock. */
+static void
+body_index_write_terms (EMailBodyIndex *body_index,
+                        GByteArray *bytes)
+{
+	guint32 ii;
+
+	body_index_put_uint (bytes, body_index->priv->term_list->len);
+
+	for (ii = 0; ii < body_index->priv->term_list->len; ii++) {
+		Posting *posting = g_ptr_array_index (body_index->priv->term_list, ii);
+
+		body_index_put_string (bytes, posting->term);
+		body_index_put_uint (bytes, posting->n_docs);
+		body_index_put_uint (bytes, posting->last_doc);
+		body_index_put_uint (bytes, posting->bytes->len);
+		g_byte_array_append (bytes, posting->bytes->data, posting->bytes->len);
+	}
+}
+
+/* Call from the indexer thread only */
+static void
+body_index_save (EMailBodyIndex *body_index)
+{
+	GByteArray *bytes;
+	gchar *filename;
+	GError *error = NULL;
+
+	g_mutex_lock (&body_index->priv->lock);
+
+	if (!body_index->priv->loaded || !body_index->priv->changed) {
+		g_mutex_unlock (&body_index->priv->lock);
+		return;
+	}
+
+	/* Forgotten documents stay in the postings until this */
+	if (body_index->priv->n_forgotten >= BODY_INDEX_COMPACT_MIN &&
+	    body_index->priv->n_forgotten >= body_index->priv->documents->len / 4)
+		body_index_compact (body_index);
+
+	bytes = g_byte_array_new ();
+
+	body_index_write_documents (body_index, bytes);
+
+	body_index->priv->changed = FALSE;
+	body_index->priv->last_save = g_get_monotonic_time ();
+
+	g_mutex_unlock (&body_index->priv->lock);
+
+	/* The postings are the bulk of the index; do not block searches */
+	body_index_write_terms (body_index, bytes);
+
+	filename = body_index_dup_filename ();
+
+	if (!g_file_set_contents (filename, (const gchar *) bytes->data, bytes->len, &error)) {
+		g_warning ("%s: Failed to save '%s': %s", G_STRFUNC, filename, error ? error->message : "Unknown error");
+		g_clear_error (&error);
+
+		g_mutex_lock (&body_index->priv->lock);
+		body_index->priv->changed = TRUE;
+		g_mutex_unlock (&body_index->priv->lock);
+	}
+
+	g_byte_array_unref (bytes);
+	g_free (filename);
+}
+
+/* Waits for the @until, or for the stop; returns FALSE on the stop */
+static gboolean
+body_index_wait (EMailBodyIndex *body_index,
+                 gint64 until,
+                 gboolean wakeable)
+{
+	gboolean stop;
+
+	g_mutex_lock (&body_index->priv->lock);
+
+	while (!body_index->priv->stop && (!wakeable || !body_index->priv->wakeup)) {
+		if (!g_cond_wait_until (&body_index->priv->cond, &body_index->priv->lock, until))
+			break;
+	}
+
+	if (wakeable)
+		body_index->priv->wakeup = FALSE;
+
+	stop = body_index->priv->stop;
+
+	g_mutex_unlock (&body_index->priv->lock);
+
+	return !stop;
+}
+
+static void
+body_index_scan_folder (EMailBodyIndex *body_index,
+                        CamelStore *store,
+                        const gchar *full_name)
+{
+	CamelFolder *folder;
+	FolderState *state;
+	GPtrArray *uids;
+	GHashTable *present;
+	GPtrArray *missing;
+	gchar *folder_uri;
+	gboolean complete, retry_uncached;
+	gint64 now;
+	guint ii, n_changes;
+
+	folder_uri = e_mail_folder_uri_build (store, full_name);
+	now = g_get_monotonic_time ();
+
+	g_mutex_lock (&body_index->priv->lock);
+
+	state = g_hash_table_lookup (body_index->priv->folders, folder_uri);
+	if (!state) {
+		state = folder_state_new (folder_uri);
+		g_hash_table_insert (body_index->priv->folders, state->uri, state);
+	}
+
+	complete = state->complete &&
+		(!g_hash_table_size (state->uncached) || now < state->retry_at);
+
+	/* The folder is complete only when it did not change
+	 * since its list of messages was read below. */
+	n_changes = state->n_changes;
+
+	g_mutex_unlock (&body_index->priv->lock);
+
+	/* Nothing changed since the last scan */
+	if (complete) {
+		g_free (folder_uri);
+		return;
+	}
+
+	complete = TRUE;
+
+	folder = camel_store_get_folder_sync (store, full_name, 0, body_index->priv->cancellable, NULL);
+	if (!folder) {
+		g_free (folder_uri);
+		return;
+	}
+
+	uids = camel_folder_get_uids (folder);
+	if (!uids) {
+		g_object_unref (folder);
+		g_free (folder_uri);
+		return;
+	}
+
+	present = g_hash_table_new (g_str_hash, g_str_equal);
+	missing = g_ptr_array_new ();
+
+	for (ii = 0; ii < uids->len; ii++)
+		g_hash_table_add (present, uids->pdata[ii]);
+
+	g_mutex_lock (&body_index->priv->lock);
+
+	state = g_hash_table_lookup (body_index->priv->folders, folder_uri);
+	if (state) {
+		GHashTableIter iter;
+		gpointer key, value;
+		GSList *gone = NULL, *link;
+
+		g_hash_table_iter_init (&iter, state->docs);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			if (!g_hash_table_contains (present, key))
+				gone = g_slist_prepend (gone, value);
+		}
+
+		for (link = gone; link; link = g_slist_next (link)) {
+			body_index_forget_document (body_index, GPOINTER_TO_UINT (link->data) - 1);
+		}
+
+		g_slist_free (gone);
+
+		g_hash_table_iter_init (&iter, state->uncached);
+		while (g_hash_table_iter_next (&iter, &key, NULL)) {
+			if (!g_hash_table_contains (present, key)) {
+				g_hash_table_iter_remove (&iter);
+				body_index->priv->changed = TRUE;
+			}
+		}
+	} else {
+		/* Deleted meanwhile */
+		g_mutex_unlock (&body_index->priv->lock);
+		g_ptr_array_free (missing, TRUE);
+		g_hash_table_destroy (present);
+		camel_folder_free_uids (folder, uids);
+		g_object_unref (folder);
+		g_free (folder_uri);
+		return;
+	}
+
+	/* Messages not in the offline cache are looked for only once
+	 * in a while, not on every scan of the folder. */
+	retry_uncached = now >= state->retry_at;
+	if (retry_uncached)
+		state->retry_at = now + BODY_INDEX_RETRY_INTERVAL;
+
+	for (ii = 0; ii < uids->len; ii++) {
+		if (!g_hash_table_contains (state->docs, uids->pdata[ii]) &&
+		    (retry_uncached || !g_hash_table_contains (state->uncached, uids->pdata[ii])))
+			g_ptr_array_add (missing, uids->pdata[ii]);
+	}
+
+	g_mutex_unlock (&body_index->priv->lock);
+
+	for (ii = 0; ii < missing->len; ii++) {
+		const gchar *uid = missing->pdata[ii];
+		CamelMimeMessage *message;
+		GHashTable *terms;
+		gsize budget = BODY_INDEX_MAX_TEXT;
+		gboolean added = FALSE;
+
+		/* Only messages available offline are indexed, nothing is downloaded */
+		message = camel_folder_get_message_cached (folder, uid, body_index->priv->cancellable);
+		if (!message) {
+			if (g_cancellable_is_cancelled (body_index->priv->cancellable)) {
+				complete = FALSE;
+				break;
+			}
+
+			g_mutex_lock (&body_index->priv->lock);
+			if (g_hash_table_lookup (body_index->priv->folders, folder_uri) == state &&
+			    !g_hash_table_contains (state->uncached, uid)) {
+				g_hash_table_add (state->uncached, g_strdup (uid));
+				body_index->priv->changed = TRUE;
+			}
+			g_mutex_unlock (&body_index->priv->lock);
+
+			continue;
+		}
+
+		/* Do not slow down the user; only the actual indexing is throttled */
+		if (!body_index_wait (body_index, g_get_monotonic_time () + G_USEC_PER_SEC / BODY_INDEX_MESSAGES_PER_SECOND, FALSE)) {
+			g_object_unref (message);
+			complete = FALSE;
+			break;
+		}
+
+		terms = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+		body_index_collect_part (CAMEL_MIME_PART (message), terms, &budget, body_index->priv->cancellable);
+
+		g_mutex_lock (&body_index->priv->lock);
+
+		/* The folder could be deleted meanwhile */
+		if (g_hash_table_lookup (body_index->priv->folders, folder_uri) == state) {
+			body_index_add_document (body_index, state, uid, terms);
+			added = TRUE;
+		} else {
+			complete = FALSE;
+		}
+
+		g_mutex_unlock (&body_index->priv->lock);
+
+		g_hash_table_destroy (terms);
+		g_object_unref (message);
+
+		if (g_get_monotonic_time () - body_index->priv->last_save > BODY_INDEX_SAVE_INTERVAL)
+			body_index_save (body_index);
+
+		if (!added)
+			break;
+	}
+
+	g_mutex_lock (&body_index->priv->lock);
+	if (g_hash_table_lookup (body_index->priv->folders, folder_uri) == state &&
+	    state->complete != (complete && state->n_changes == n_changes)) {
+		state->complete = complete && state->n_changes == n_changes;
+		body_index->priv->changed = TRUE;
+	}
+	g_mutex_unlock (&body_index->priv->lock);
+
+	g_ptr_array_free (missing, TRUE);
+	g_hash_table_destroy (present);
+	camel_folder_free_uids (folder, uids);
+	g_object_unref (folder);
+	g_free (folder_uri);
+}
+
+static void
+body_index_scan_folder_info (EMailBodyIndex *body_index,
+                             CamelStore *store,
+                             CamelFolderInfo *fi)
+{
+	while (fi && !g_cancellable_is_cancelled (body_index->priv->cancellable)) {
+		if (!(fi->flags & (CAMEL_FOLDER_NOSELECT | CAMEL_FOLDER_VIRTUAL)))
+			body_index_scan_folder (body_index, store, fi->full_name);
+
+		body_index_scan_folder_info (body_index, store, fi->child);
+
+		fi = fi->next;
+	}
+}
+
+static void
+body_index_scan_session (EMailBodyIndex *body_index,
+                         EMailSession *session)
+{
+	ESourceRegistry *registry;
+	GList *list, *link;
+
+	registry = e_mail_session_get_registry (session);
+	list = camel_session_list_services (CAMEL_SESSION (session));
+
+	for (link = list; link && !g_cancellable_is_cancelled (body_index->priv->cancellable); link = g_list_next (link)) {
+		CamelService *service = link->data;
+		CamelFolderInfo *fi;
+		ESource *source;
+		gboolean enabled;
+
+		if (!CAMEL_IS_STORE (service) ||
+		    g_strcmp0 (camel_service_get_uid (service), E_MAIL_SESSION_VFOLDER_UID) == 0)
+			continue;
+
+		source = e_source_registry_ref_source (registry, camel_service_get_uid (service));
+		enabled = source && e_source_registry_check_enabled (registry, source);
+		g_clear_object (&source);
+
+		if (!enabled)
+			continue;
+
+		/* Do not contact the server, only the known folders are interesting */
+		fi = camel_store_get_folder_info_sync (CAMEL_STORE (service), NULL,
+			CAMEL_STORE_FOLDER_INFO_RECURSIVE |
+			CAMEL_STORE_FOLDER_INFO_FAST |
+			CAMEL_STORE_FOLDER_INFO_SUBSCRIBED,
+			body_index->priv->cancellable, NULL);
+
+		if (fi) {
+			body_index_scan_folder_info (body_index, CAMEL_STORE (service), fi);
+			camel_folder_info_free (fi);
+		}
+	}
+
+	g_list_free_full (list, g_object_unref);
+}
+
+static gpointer
+body_index_thread (gpointer user_data)
+{
+	EMailBodyIndex *body_index = user_data;
+
+	body_index_load (body_index);
+
+	for (;;) {
+		EMailSession *session;
+
+		session = g_weak_ref_get (&body_index->priv->session);
+		if (!session)
+			break;
+
+		body_index_scan_session (body_index, session);
+		g_object_unref (session);
+
+		body_index_save (body_index);
+
+		if (!body_index_wait (body_index, g_get_monotonic_time () + BODY_INDEX_RESCAN_INTERVAL, TRUE))
+			break;
+	}
+
+	body_index_save (body_index);
+
+	return NULL;
+}
+
+static void
+body_index_folder_changed_cb (MailFolderCache *folder_cache,
+                              CamelStore *store,
+                              const gchar *folder_name,
+                              gint new_messages,
+                              const gchar *msg_uid,
+                              const gchar *msg_sender,
+                              const gchar *msg_subject,
+                              EMailBodyIndex *body_index)
+{
+	FolderState *state;
+	gchar *folder_uri;
+
+	folder_uri = e_mail_folder_uri_build (store, folder_name);
+
+	g_mutex_lock (&body_index->priv->lock);
+
+	state = g_hash_table_lookup (body_index->priv->folders, folder_uri);
+	if (state) {
+		state->n_changes++;
+
+		if (state->complete) {
+			state->complete = FALSE;
+			body_index->priv->changed = TRUE;
+			body_index->priv->wakeup = TRUE;
+			g_cond_signal (&body_index->priv->cond);
+		}
+	}
+
+	g_mutex_unlock (&body_index->priv->lock);
+
+	g_free (folder_uri);
+}
+
+static void
+body_index_folder_deleted_cb (MailFolderCache *folder_cache,
+                              CamelStore *store,
+                              const gchar *folder_name,
+                              EMailBodyIndex *body_index)
+{
+	gchar *folder_uri;
+
+	folder_uri = e_mail_folder_uri_build (store, folder_name);
+
+	g_mutex_lock (&body_index->priv->lock);
+	body_index_forget_folder (body_index, folder_uri);
+	g_mutex_unlock (&body_index->priv->lock);
+
+	g_free (folder_uri);
+}
+
+static void
+body_index_folder_renamed_cb (MailFolderCache *folder_cache,
+                              CamelStore *store,
+                              const gchar *old_folder_name,
+                              const gchar *new_folder_name,
+                              EMailBodyIndex *body_index)
+{
+	/* The messages will be indexed under the new name */
+	body_index_folder_deleted_cb (folder_cache, store, old_folder_name, body_index);
+}
+
+static void
+mail_body_index_dispose (GObject *object)
+{
+	EMailBodyIndex *body_index = E_MAIL_BODY_INDEX (object);
+
+	e_mail_body_index_stop (body_index);
+
+	if (body_index->priv->folder_cache) {
+		g_signal_handler_disconnect (body_index->priv->folder_cache, body_index->priv->folder_changed_id);
+		g_signal_handler_disconnect (body_index->priv->folder_cache, body_index->priv->folder_deleted_id);
+		g_signal_handler_disconnect (body_index->priv->folder_cache, body_index->priv->folder_renamed_id);
+		g_clear_object (&body_index->priv->folder_cache);
+	}
+
+	/* Chain up to parent's method. */
+	G_OBJECT_CLASS (e_mail_body_index_parent_class)->dispose (object);
+}
+
+static void
+mail_body_index_finalize (GObject *object)
+{
+	EMailBodyIndex *body_index = E_MAIL_BODY_INDEX (object);
+
+	g_weak_ref_clear (&body_index->priv->session);
+	g_clear_object (&body_index->priv->cancellable);
+	g_ptr_array_unref (body_index->priv->documents);
+	g_hash_table_destroy (body_index->priv->folders);
+	g_ptr_array_unref (body_index->priv->term_list);
+	g_hash_table_destroy (body_index->priv->terms);
+	body_index_clear_pairs (body_index);
+	g_free (body_index->priv->pairs);
+	g_mutex_clear (&body_index->priv->lock);
+	g_cond_clear (&body_index->priv->cond);
+
+	/* Chain up to parent's method. */
+	G_OBJECT_CLASS (e_mail_body_index_parent_class)->finalize (object);
+}
+
+static void
+e_mail_body_index_class_init (EMailBodyIndexClass *class)
+{
+	GObjectClass *object_class;
+
+	g_type_class_add_private (class, sizeof (EMailBodyIndexPrivate));
+
+	object_class = G_OBJECT_CLASS (class);
+	object_class->dispose = mail_body_index_dispose;
+	object_class->finalize = mail_body_index_finalize;
+}
+
+static void
+e_mail_body_index_init (EMailBodyIndex *body_index)
+{
+	body_index->priv = E_MAIL_BODY_INDEX_GET_PRIVATE (body_index);
+
+	g_weak_ref_init (&body_index->priv->session, NULL);
+	g_mutex_init (&body_index->priv->lock);
+	g_cond_init (&body_index->priv->cond);
+
+	body_index->priv->cancellable = g_cancellable_new ();
+	body_index->priv->documents = g_ptr_array_new_with_free_func (document_free);
+	body_index->priv->folders = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, folder_state_free);
+	body_index->priv->terms = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, posting_free);
+	body_index->priv->term_list = g_ptr_array_new ();
+	body_index->priv->pairs = g_new0 (GArray *, BODY_INDEX_N_PAIRS);
+}
+
+/**
+ * e_mail_body_index_new:
+ * @session: an #EMailSession
+ *
+ * Creates a new #EMailBodyIndex for messages of the @session and makes
+ * it the default index, as returned by e_mail_body_index_ref_default().
+ * The indexing starts with e_mail_body_index_start().
+ *
+ * Returns: (transfer full): a new #EMailBodyIndex
+ *
+ * Since: 3.28
+ **/
+EMailBodyIndex *
+e_mail_body_index_new (EMailSession *session)
+{
+	EMailBodyIndex *body_index;
+	MailFolderCache *folder_cache;
+
+	g_return_val_if_fail (E_IS_MAIL_SESSION (session), NULL);
+
+	body_index = g_object_new (E_TYPE_MAIL_BODY_INDEX, NULL);
+
+	g_weak_ref_set (&body_index->priv->session, session);
+
+	folder_cache = e_mail_session_get_folder_cache (session);
+	body_index->priv->folder_cache = g_object_ref (folder_cache);
+
+	body_index->priv->folder_changed_id = g_signal_connect (
+		folder_cache, "folder-changed",
+		G_CALLBACK (body_index_folder_changed_cb), body_index);
+
+	body_index->priv->folder_deleted_id = g_signal_connect (
+		folder_cache, "folder-deleted",
+		G_CALLBACK (body_index_folder_deleted_cb), body_index);
+
+	body_index->priv->folder_renamed_id = g_signal_connect (
+		folder_cache, "folder-renamed",
+		G_CALLBACK (body_index_folder_renamed_cb), body_index);
+
+	g_weak_ref_set (&default_body_index, body_index);
+
+	return body_index;
+}
+
+/**
+ * e_mail_body_index_ref_default:
+ *
+ * Returns the last created #EMailBodyIndex, if it still exists.
+ * Unref it with g_object_unref(), when done with it.
+ *
+ * Returns: (transfer full) (nullable): the default #EMailBodyIndex, or %NULL
+ *
+ * Since: 3.28
+ **/
+EMailBodyIndex *
+e_mail_body_index_ref_default (void)
+{
+	return g_weak_ref_get (&default_body_index);
+}
+
+/**
+ * e_mail_body_index_start:
+ * @body_index: an #EMailBodyIndex
+ *
+ * Starts the background indexer. It loads the saved index, then
+ * indexes messages, which are available offline and which are not
+ * indexed yet. It does nothing, when the indexer is already running.
+ *
+ * Since: 3.28
+ **/
+void
+e_mail_body_index_start (EMailBodyIndex *body_index)
+{
+	g_return_if_fail (E_IS_MAIL_BODY_INDEX (body_index));
+
+	if (body_index->priv->thread)
+		return;
+
+	body_index->priv->stop = FALSE;
+	g_cancellable_reset (body_index->priv->cancellable);
+
+	body_index->priv->thread = g_thread_new ("EMailBodyIndex", body_index_thread, body_index);
+}
+
+/**
+ * e_mail_body_index_stop:
+ * @body_index: an #EMailBodyIndex
+ *
+ * Stops the background indexer and waits for it to save the index.
+ * The indexing continues with the next e_mail_body_index_start().
+ *
+ * Since: 3.28
+ **/
+void
+e_mail_body_index_stop (EMailBodyIndex *body_index)
+{
+	g_return_if_fail (E_IS_MAIL_BODY_INDEX (body_index));
+
+	if (!body_index->priv->thread)
+		return;
+
+	g_mutex_lock (&body_index->priv->lock);
+	body_index->priv->stop = TRUE;
+	g_cond_signal (&body_index->priv->cond);
+	g_mutex_unlock (&body_index->priv->lock);
+
+	g_cancellable_cancel (body_index->priv->cancellable);
+
+	g_thread_join (body_index->priv->thread);
+	body_index->priv->thread = NULL;
+}
+
+static void
+body_index_add_query_token_cb (const gchar *word,
+                               gpointer user_data)
+{
+	GPtrArray *tokens = user_data;
+
+	g_ptr_array_add (tokens, g_strdup (word));
+}
+
+/* Call with the lock held. Returns document numbers + 1 of documents,
+ * which contain the @word as a part of a word, or NULL when there are
+ * too many of them. */
+static GHashTable *
+body_index_lookup_token (EMailBodyIndex *body_index,
+                         const gchar *word)
+{
+	GHashTable *docs;
+	GArray *candidates = NULL;
+	gsize ii, len;
+
+	docs = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	/* Only terms with the rarest pair of bytes of the word can contain it */
+	len = strlen (word);
+	for (ii = 0; ii + 1 < len; ii++) {
+		GArray *pair = body_index->priv->pairs[BODY_INDEX_PAIR (word + ii)];
+
+		if (!pair)
+			return docs;
+
+		if (!candidates || pair->len < candidates->len)
+			candidates = pair;
+	}
+
+	for (ii = 0; candidates && ii < candidates->len; ii++) {
+		Posting *posting;
+
+		posting = g_ptr_array_index (body_index->priv->term_list, g_array_index (candidates, guint32, ii));
+
+		if (strstr (posting->term, word)) {
+			posting_collect (posting, docs);
+
+			if (g_hash_table_size (docs) > BODY_INDEX_MAX_HITS * 4) {
+				g_hash_table_destroy (docs);
+				return NULL;
+			}
+		}
+	}
+
+	return docs;
+}
+
+static void
+body_index_append_uid_list (GString *sexp,
+                            GHashTable *uids)
+{
+	GHashTableIter iter;
+	gpointer key;
+
+	g_string_append (sexp, "(uid");
+
+	g_hash_table_iter_init (&iter, uids);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		g_string_append_c (sexp, ' ');
+		camel_sexp_encode_string (sexp, key);
+	}
+
+	g_string_append_c (sexp, ')');
+}
+
+/* Call with the lock held. Adds an expression matching messages of the
+ * folder of the @state, which contain the @encoded_word; the @hits are UIDs
+ * of the folder, which the index found. Returns FALSE, when the index does
+ * not know enough about the folder, thus it should be searched as before. */
+static gboolean
+body_index_append_folder_sexp (GString *sexp,
+                               FolderState *state,
+                               GHashTable *hits,
+                               const gchar *encoded_word)
+{
+	guint n_hits = hits ? g_hash_table_size (hits) : 0;
+
+	if (!g_hash_table_size (state->docs) ||
+	    n_hits > BODY_INDEX_MAX_HITS ||
+	    g_hash_table_size (state->docs) > BODY_INDEX_MAX_KNOWN)
+		return FALSE;
+
+	g_string_append (sexp, " (and (message-location ");
+	camel_sexp_encode_string (sexp, state->uri);
+	g_string_append (sexp, ") (or");
+
+	if (n_hits) {
+		g_string_append_c (sexp, ' ');
+		body_index_append_uid_list (sexp, hits);
+	}
+
+	/* Messages not indexed, which are those not in the offline cache,
+	 * and those received since the expression was built, even when
+	 * the folder was complete by now, can match too. */
+	g_string_append (sexp, " (not ");
+	body_index_append_uid_list (sexp, state->docs);
+	g_string_append (sexp, "))");
+
+	/* The hits are verified, the index does not know where
+	 * the words are in the message. */
+	g_string_append_printf (sexp, " (body-contains %s))", encoded_word);
+
+	return TRUE;
+}
+
+/**
+ * e_mail_body_index_build_sexp:
+ * @body_index: an #EMailBodyIndex
+ * @word: a text to search for in message bodies
+ *
+ * Builds a search expression, which matches messages containing the @word
+ * in their body. Messages known to the index are matched against index hits
+ * only, which avoids reading (or downloading) all other messages. The hits
+ * are verified with body-contains, thus the result is the same as with it.
+ * Messages not known to the index, at the time the expression is built,
+ * are searched with body-contains.
+ *
+ * Returns: (transfer full) (nullable): a search expression, or %NULL, when
+ *    the index cannot help with the @word; free it with g_free()
+ *
+ * Since: 3.28
+ **/
+gchar *
+e_mail_body_index_build_sexp (EMailBodyIndex *body_index,
+                              const gchar *word)
+{
+	GPtrArray *tokens;
+	GHashTable *hits = NULL, *by_folder;
+	GHashTableIter iter;
+	GString *sexp, *encoded_word;
+	GPtrArray *known_folders;
+	gpointer key, value;
+	guint ii;
+
+	g_return_val_if_fail (E_IS_MAIL_BODY_INDEX (body_index), NULL);
+
+	if (!word || !*word)
+		return NULL;
+
+	tokens = g_ptr_array_new_with_free_func (g_free);
+
+	body_index_tokenize (word, strlen (word), FALSE, body_index_add_query_token_cb, tokens);
+
+	if (!tokens->len) {
+		g_ptr_array_unref (tokens);
+		return NULL;
+	}
+
+	g_mutex_lock (&body_index->priv->lock);
+
+	if (!body_index->priv->loaded || !body_index->priv->documents->len) {
+		g_mutex_unlock (&body_index->priv->lock);
+		g_ptr_array_unref (tokens);
+		return NULL;
+	}
+
+	for (ii = 0; ii < tokens->len; ii++) {
+		GHashTable *docs;
+
+		docs = body_index_lookup_token (body_index, tokens->pdata[ii]);
+		if (!docs)
+			continue;
+
+		if (!hits) {
+			hits = docs;
+		} else {
+			g_hash_table_iter_init (&iter, hits);
+			while (g_hash_table_iter_next (&iter, &key, NULL)) {
+				if (!g_hash_table_contains (docs, key))
+					g_hash_table_iter_remove (&iter);
+			}
+
+			g_hash_table_destroy (docs);
+		}
+	}
+
+	if (!hits || g_hash_table_size (hits) > BODY_INDEX_MAX_HITS) {
+		g_mutex_unlock (&body_index->priv->lock);
+		if (hits)
+			g_hash_table_destroy (hits);
+		g_ptr_array_unref (tokens);
+		return NULL;
+	}
+
+	/* FolderState * ~> GHashTable { gchar *uid } */
+	by_folder = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) g_hash_table_destroy);
+
+	g_hash_table_iter_init (&iter, hits);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		Document *doc;
+		GHashTable *uids;
+
+		doc = g_ptr_array_index (body_index->priv->documents, GPOINTER_TO_UINT (key) - 1);
+		if (!doc->folder)
+			continue;
+
+		uids = g_hash_table_lookup (by_folder, doc->folder);
+		if (!uids) {
+			/* The UIDs are owned by the Document-s */
+			uids = g_hash_table_new (g_str_hash, g_str_equal);
+			g_hash_table_insert (by_folder, doc->folder, uids);
+		}
+
+		g_hash_table_add (uids, doc->uid);
+	}
+
+	encoded_word = g_string_new ("");
+	camel_sexp_encode_string (encoded_word, word);
+
+	sexp = g_string_new ("(match-all (or");
+	known_folders = g_ptr_array_new ();
+
+	g_hash_table_iter_init (&iter, body_index->priv->folders);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		FolderState *state = value;
+
+		if (body_index_append_folder_sexp (sexp, state, g_hash_table_lookup (by_folder, state), encoded_word->str))
+			g_ptr_array_add (known_folders, state->uri);
+	}
+
+	/* Messages of folders the index cannot answer for */
+	g_string_append (sexp, " (and");
+
+	if (known_folders->len) {
+		g_string_append (sexp, " (not (or");
+
+		for (ii = 0; ii < known_folders->len; ii++) {
+			g_string_append (sexp, " (message-location ");
+			camel_sexp_encode_string (sexp, known_folders->pdata[ii]);
+			g_string_append_c (sexp, ')');
+		}
+
+		g_string_append (sexp, "))");
+	}
+
+	g_string_append_printf (sexp, " (body-contains %s))))", encoded_word->str);
+
+	g_mutex_unlock (&body_index->priv->lock);
+
+	g_ptr_array_free (known_folders, TRUE);
+	g_string_free (encoded_word, TRUE);
+	g_hash_table_destroy (by_folder);
+	g_hash_table_destroy (hits);
+	g_ptr_array_unref (tokens);
+
+	return g_string_free (sexp, FALSE);
+}
@@ -0,0 +1,81 @@
+/*
+ * e-mail-body-index.h
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#if !defined (__LIBEMAIL_ENGINE_H_INSIDE__) && !defined (LIBEMAIL_ENGINE_COMPILATION)
+#error "Only <libemail-engine/libemail-engine.h> should be included directly."
+#endif
+
+#ifndef E_MAIL_BODY_INDEX_H
+#define E_MAIL_BODY_INDEX_H
+
+#include <libemail-engine/e-mail-session.h>
+
+/* Standard GObject macros */
+#define E_TYPE_MAIL_BODY_INDEX \
+	(e_mail_body_index_get_type ())
+#define E_MAIL_BODY_INDEX(obj) \
+	(G_TYPE_CHECK_INSTANCE_CAST \
+	((obj), E_TYPE_MAIL_BODY_INDEX, EMailBodyIndex))
+#define E_MAIL_BODY_INDEX_CLASS(cls) \
+	(G_TYPE_CHECK_CLASS_CAST \
+	((cls), E_TYPE_MAIL_BODY_INDEX, EMailBodyIndexClass))
+#define E_IS_MAIL_BODY_INDEX(obj) \
+	(G_TYPE_CHECK_INSTANCE_TYPE \
+	((obj), E_TYPE_MAIL_BODY_INDEX))
+#define E_IS_MAIL_BODY_INDEX_CLASS(cls) \
+	(G_TYPE_CHECK_CLASS_TYPE \
+	((cls), E_TYPE_MAIL_BODY_INDEX))
+#define E_MAIL_BODY_INDEX_GET_CLASS(obj) \
+	(G_TYPE_INSTANCE_GET_CLASS \
+	((obj), E_TYPE_MAIL_BODY_INDEX, EMailBodyIndexClass))
+
+G_BEGIN_DECLS
+
+typedef struct _EMailBodyIndex EMailBodyIndex;
+typedef struct _EMailBodyIndexClass EMailBodyIndexClass;
+typedef struct _EMailBodyIndexPrivate EMailBodyIndexPrivate;
+
+/**
+ * EMailBodyIndex:
+ *
+ * Contains only private data that should be read and manipulated using the
+ * functions below.
+ *
+ * Since: 3.28
+ **/
+struct _EMailBodyIndex {
+	GObject parent;
+	EMailBodyIndexPrivate *priv;
+};
+
+struct _EMailBodyIndexClass {
+	GObjectClass parent_class;
+};
+
+GType		e_mail_body_index_get_type	(void) G_GNUC_CONST;
+EMailBodyIndex *
+		e_mail_body_index_new		(EMailSession *session);
+EMailBodyIndex *
+		e_mail_body_index_ref_default	(void);
+void		e_mail_body_index_start		(EMailBodyIndex *body_index);
+void		e_mail_body_index_stop		(EMailBodyIndex *body_index);
+gchar *		e_mail_body_index_build_sexp	(EMailBodyIndex *body_index,
+						 const gchar *word);
+
+G_END_DECLS
+
+#endif /* E_MAIL_BODY_INDEX_H */
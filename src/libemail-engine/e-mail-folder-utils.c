@@ -42,6 +42,8 @@ struct _AsyncContext {
 	GFile *destination;
 	gchar *fwd_subject;
 	gchar *message_uid;
+	gboolean dry_run;
+	guint64 bytes_reclaimed;
 };
 
 static void
@@ -656,99 +658,228 @@ mail_folder_find_duplicate_messages_thread (GSimpleAsyncResult *simple,
 		g_simple_async_result_take_error (simple, error);
 }
 
+/* How many messages are retrieved in parallel when looking for duplicates. */
+#define FIND_DUPLICATES_MAX_WORKERS 4
+
+/* Digest of the message content, remembered in the message info,
+ * thus the next search for duplicates doesn't need to download it. */
+#define CONTENT_DIGEST_USER_TAG "content-digest"
+
+typedef struct _DigestsData {
+	GMutex lock;
+	CamelFolder *folder;
+	GCancellable *cancellable;
+	GHashTable *digests;	/* MessageUID ~> digest-as-string */
+	guint n_done;
+	guint n_total;
+	GError *error;
+} DigestsData;
+
+/* Sets the @out_digest to NULL when the message has no content. */
+static gboolean
+emfu_get_message_digest_sync (CamelFolder *folder,
+                              const gchar *uid,
+                              gchar **out_digest,
+                              GCancellable *cancellable,
+                              GError **error)
+{
+	CamelMimeMessage *message;
+	CamelDataWrapper *content;
+	gchar *digest = NULL;
+
+	*out_digest = NULL;
+
+	message = camel_folder_get_message_sync (
+		folder, uid, cancellable, error);
+
+	if (!CAMEL_IS_MIME_MESSAGE (message))
+		return FALSE;
+
+	/* Generate a digest string from the message's content. */
+	content = camel_medium_get_content (CAMEL_MEDIUM (message));
+
+	if (content != NULL) {
+		CamelStream *stream;
+		GByteArray *buffer;
+		gssize n_bytes;
+
+		stream = camel_stream_mem_new ();
+
+		n_bytes = camel_data_wrapper_decode_to_stream_sync (
+			content, stream, cancellable, error);
+
+		if (n_bytes >= 0) {
+			guint data_len;
+
+			/* The CamelStreamMem owns the buffer. */
+			buffer = camel_stream_mem_get_byte_array (
+				CAMEL_STREAM_MEM (stream));
+
+			data_len = buffer ? buffer->len : 0;
+
+			/* Strip trailing white-spaces and empty lines */
+			while (data_len > 0 && g_ascii_isspace (buffer->data[data_len - 1]))
+				data_len--;
+
+			if (data_len > 0)
+				digest = g_compute_checksum_for_data (G_CHECKSUM_SHA256, buffer->data, data_len);
+		}
+
+		g_object_unref (stream);
+	}
+
+	g_object_unref (message);
+
+	if (digest) {
+		CamelMessageInfo *info;
+
+		info = camel_folder_get_message_info (folder, uid);
+		if (info) {
+			camel_message_info_set_user_tag (info, CONTENT_DIGEST_USER_TAG, digest);
+			g_object_unref (info);
+		}
+	}
+
+	*out_digest = digest;
+
+	return TRUE;
+}
+
+static void
+emfu_get_message_digest_thread (gpointer data,
+                                gpointer user_data)
+{
+	const gchar *uid = data;
+	DigestsData *dd = user_data;
+	gchar *digest = NULL;
+	gboolean skip;
+	guint percent;
+	GError *local_error = NULL;
+
+	g_mutex_lock (&dd->lock);
+	skip = dd->error != NULL;
+	g_mutex_unlock (&dd->lock);
+
+	/* This is an all or nothing operation, thus do not
+	 * retrieve any other message after the first failure. */
+	if (!skip)
+		emfu_get_message_digest_sync (dd->folder, uid, &digest, dd->cancellable, &local_error);
+
+	g_mutex_lock (&dd->lock);
+
+	if (local_error) {
+		if (!dd->error)
+			dd->error = local_error;
+		else
+			g_clear_error (&local_error);
+	} else if (!skip) {
+		g_hash_table_insert (dd->digests, (gpointer) uid, digest);
+	}
+
+	dd->n_done++;
+	percent = (dd->n_done * 100) / dd->n_total;
+
+	g_mutex_unlock (&dd->lock);
+
+	camel_operation_progress (dd->cancellable, percent);
+}
+
+/* Returns { MessageUID : digest-as-string } for the @message_uids,
+ * the digest being NULL for messages without content. The digests
+ * remembered in the message infos are used, the rest is retrieved
+ * in parallel. */
 static GHashTable *
 emfu_get_messages_hash_sync (CamelFolder *folder,
                              GPtrArray *message_uids,
                              GCancellable *cancellable,
                              GError **error)
 {
-	GHashTable *hash_table;
-	CamelMimeMessage *message;
+	DigestsData dd;
+	GPtrArray *to_retrieve;
 	guint ii;
 
 	g_return_val_if_fail (CAMEL_IS_FOLDER (folder), NULL);
 	g_return_val_if_fail (message_uids != NULL, NULL);
 
-	camel_operation_push_message (
-		cancellable,
-		ngettext (
-			"Retrieving %d message",
-			"Retrieving %d messages",
-			message_uids->len),
-		message_uids->len);
-
-	hash_table = g_hash_table_new_full (
+	g_mutex_init (&dd.lock);
+	dd.folder = folder;
+	dd.cancellable = cancellable;
+	dd.n_done = 0;
+	dd.n_total = 0;
+	dd.error = NULL;
+	dd.digests = g_hash_table_new_full (
 		(GHashFunc) g_str_hash,
 		(GEqualFunc) g_str_equal,
-		(GDestroyNotify) g_free,
+		(GDestroyNotify) NULL,
 		(GDestroyNotify) g_free);
 
-	/* This is an all or nothing operation.  Destroy the
-	 * hash table if we fail to retrieve any message. */
+	to_retrieve = g_ptr_array_new ();
 
 	for (ii = 0; ii < message_uids->len; ii++) {
-		const gchar *uid;
-		gint percent;
-
-		uid = g_ptr_array_index (message_uids, ii);
-		percent = ((ii + 1) * 100) / message_uids->len;
-
-		message = camel_folder_get_message_sync (
-			folder, uid, cancellable, error);
+		const gchar *uid = g_ptr_array_index (message_uids, ii);
+		CamelMessageInfo *info;
+		gchar *digest = NULL;
 
-		camel_operation_progress (cancellable, percent);
+		info = camel_folder_get_message_info (folder, uid);
+		if (info) {
+			digest = camel_message_info_dup_user_tag (info, CONTENT_DIGEST_USER_TAG);
+			g_object_unref (info);
+		}
 
-		if (CAMEL_IS_MIME_MESSAGE (message)) {
-			CamelDataWrapper *content;
-			gchar *digest = NULL;
+		if (digest && *digest)
+			g_hash_table_insert (dd.digests, (gpointer) uid, digest);
+		else {
+			g_ptr_array_add (to_retrieve, (gpointer) uid);
+			g_free (digest);
+		}
+	}
 
-			/* Generate a digest string from the message's content. */
-			content = camel_medium_get_content (CAMEL_MEDIUM (message));
+	if (to_retrieve->len > 0) {
+		GThreadPool *thread_pool;
+		GError *local_error = NULL;
 
-			if (content != NULL) {
-				CamelStream *stream;
-				GByteArray *buffer;
-				gssize n_bytes;
+		camel_operation_push_message (
+			cancellable,
+			ngettext (
+				"Retrieving %d message",
+				"Retrieving %d messages",
+				to_retrieve->len),
+			to_retrieve->len);
 
-				stream = camel_stream_mem_new ();
+		dd.n_total = to_retrieve->len;
 
-				n_bytes = camel_data_wrapper_decode_to_stream_sync (
-					content, stream, cancellable, error);
+		thread_pool = g_thread_pool_new (
+			emfu_get_message_digest_thread, &dd,
+			MIN (to_retrieve->len, FIND_DUPLICATES_MAX_WORKERS),
+			FALSE, &local_error);
 
-				if (n_bytes >= 0) {
-					guint data_len;
+		if (thread_pool) {
+			for (ii = 0; ii < to_retrieve->len; ii++)
+				g_thread_pool_push (thread_pool, g_ptr_array_index (to_retrieve, ii), NULL);
 
-					/* The CamelStreamMem owns the buffer. */
-					buffer = camel_stream_mem_get_byte_array (
-						CAMEL_STREAM_MEM (stream));
-					g_return_val_if_fail (buffer != NULL, NULL);
+			/* Waits for all the pushed messages. */
+			g_thread_pool_free (thread_pool, FALSE, TRUE);
+		} else {
+			for (ii = 0; ii < to_retrieve->len; ii++)
+				emfu_get_message_digest_thread (g_ptr_array_index (to_retrieve, ii), &dd);
 
-					data_len = buffer->len;
+			g_clear_error (&local_error);
+		}
 
-					/* Strip trailing white-spaces and empty lines */
-					while (data_len > 0 && g_ascii_isspace (buffer->data[data_len - 1]))
-						data_len--;
+		camel_operation_pop_message (cancellable);
+	}
 
-					if (data_len > 0)
-						digest = g_compute_checksum_for_data (G_CHECKSUM_SHA256, buffer->data, data_len);
-				}
+	g_ptr_array_free (to_retrieve, TRUE);
+	g_mutex_clear (&dd.lock);
 
-				g_object_unref (stream);
-			}
+	if (dd.error) {
+		g_propagate_error (error, dd.error);
+		g_hash_table_destroy (dd.digests);
 
-			g_hash_table_insert (
-				hash_table, g_strdup (uid), digest);
-			g_object_unref (message);
-		} else {
-			g_hash_table_destroy (hash_table);
-			hash_table = NULL;
-			break;
-		}
+		return NULL;
 	}
 
-	camel_operation_pop_message (cancellable);
-
-	return hash_table;
+	return dd.digests;
 }
 
 GHashTable *
@@ -757,90 +888,125 @@ e_mail_folder_find_duplicate_messages_sync (CamelFolder *folder,
                                             GCancellable *cancellable,
                                             GError **error)
 {
-	GQueue trash = G_QUEUE_INIT;
 	GHashTable *hash_table;
-	GHashTable *unique_ids;
+	GHashTable *digests;
+	GHashTable *groups;
+	GPtrArray *candidates;
 	GHashTableIter iter;
-	gpointer key, value;
+	gpointer value;
+	guint ii;
 
 	g_return_val_if_fail (CAMEL_IS_FOLDER (folder), NULL);
 	g_return_val_if_fail (message_uids != NULL, NULL);
 
-	/* hash_table = { MessageUID : digest-as-string } */
-	hash_table = emfu_get_messages_hash_sync (
-		folder, message_uids, cancellable, error);
-
-	if (hash_table == NULL)
-		return NULL;
-
 	camel_operation_push_message (
 		cancellable, _("Scanning messages for duplicates"));
 
-	unique_ids = g_hash_table_new_full (
+	/* Only messages with the same Message-ID can be duplicates,
+	 * thus group them by it first, using just the summary.
+	 * groups = { Message-ID : GPtrArray of MessageUID } */
+	groups = g_hash_table_new_full (
 		(GHashFunc) g_int64_hash,
 		(GEqualFunc) g_int64_equal,
 		(GDestroyNotify) g_free,
-		(GDestroyNotify) g_free);
-
-	g_hash_table_iter_init (&iter, hash_table);
+		(GDestroyNotify) g_ptr_array_unref);
 
-	while (g_hash_table_iter_next (&iter, &key, &value)) {
-		CamelSummaryMessageID message_id;
-		CamelMessageFlags flags;
+	for (ii = 0; ii < message_uids->len; ii++) {
+		const gchar *uid = g_ptr_array_index (message_uids, ii);
 		CamelMessageInfo *info;
-		gboolean duplicate;
-		const gchar *digest;
+		GPtrArray *group;
+		gint64 message_id;
 
-		info = camel_folder_get_message_info (folder, key);
+		info = camel_folder_get_message_info (folder, uid);
 		if (!info)
 			continue;
 
-		message_id.id.id = camel_message_info_get_message_id (info);
-		flags = camel_message_info_get_flags (info);
-
 		/* Skip messages marked for deletion. */
-		if (flags & CAMEL_MESSAGE_DELETED) {
-			g_queue_push_tail (&trash, key);
-			g_clear_object (&info);
+		if ((camel_message_info_get_flags (info) & CAMEL_MESSAGE_DELETED) != 0) {
+			g_object_unref (info);
 			continue;
 		}
 
-		digest = value;
+		message_id = (gint64) camel_message_info_get_message_id (info);
 
-		if (digest == NULL) {
-			g_queue_push_tail (&trash, key);
-			g_clear_object (&info);
-			continue;
+		g_object_unref (info);
+
+		group = g_hash_table_lookup (groups, &message_id);
+		if (!group) {
+			gint64 *v_int64;
+
+			v_int64 = g_new0 (gint64, 1);
+			*v_int64 = message_id;
+
+			group = g_ptr_array_new ();
+			g_hash_table_insert (groups, v_int64, group);
 		}
 
-		/* Determine if the message a duplicate. */
+		g_ptr_array_add (group, (gpointer) uid);
+	}
 
-		value = g_hash_table_lookup (unique_ids, &message_id.id.id);
-		duplicate = (value != NULL) && g_str_equal (digest, value);
+	camel_operation_pop_message (cancellable);
 
-		if (!duplicate) {
-			gint64 *v_int64;
+	/* Only the messages in colliding groups need their content. */
+	candidates = g_ptr_array_new ();
 
-			/* XXX Might be better to create a GArray
-			 *     of 64-bit integers and have the hash
-			 *     table keys point to array elements. */
-			v_int64 = g_new0 (gint64, 1);
-			*v_int64 = (gint64) message_id.id.id;
+	g_hash_table_iter_init (&iter, groups);
 
-			g_hash_table_insert (unique_ids, v_int64, g_strdup (digest));
-			g_queue_push_tail (&trash, key);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		GPtrArray *group = value;
+
+		if (group->len > 1) {
+			for (ii = 0; ii < group->len; ii++)
+				g_ptr_array_add (candidates, g_ptr_array_index (group, ii));
 		}
+	}
+
+	/* digests = { MessageUID : digest-as-string } */
+	digests = emfu_get_messages_hash_sync (
+		folder, candidates, cancellable, error);
 
-		g_clear_object (&info);
+	g_ptr_array_free (candidates, TRUE);
+
+	if (digests == NULL) {
+		g_hash_table_destroy (groups);
+		return NULL;
 	}
 
-	/* Delete all non-duplicate messages from the hash table. */
-	while ((key = g_queue_pop_head (&trash)) != NULL)
-		g_hash_table_remove (hash_table, key);
+	/* hash_table = { MessageUID : digest-as-string } of duplicates only;
+	 * the first message with the given content in the group is kept. */
+	hash_table = g_hash_table_new_full (
+		(GHashFunc) g_str_hash,
+		(GEqualFunc) g_str_equal,
+		(GDestroyNotify) g_free,
+		(GDestroyNotify) g_free);
 
-	camel_operation_pop_message (cancellable);
+	g_hash_table_iter_init (&iter, groups);
+
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		GPtrArray *group = value;
+		const gchar *unique_digest = NULL;
+
+		if (group->len <= 1)
+			continue;
+
+		for (ii = 0; ii < group->len; ii++) {
+			const gchar *uid = g_ptr_array_index (group, ii);
+			const gchar *digest;
 
-	g_hash_table_destroy (unique_ids);
+			digest = g_hash_table_lookup (digests, uid);
+
+			if (digest == NULL)
+				continue;
+
+			if (!unique_digest)
+				unique_digest = digest;
+			else if (g_str_equal (digest, unique_digest))
+				g_hash_table_insert (hash_table, g_strdup (uid), g_strdup (digest));
+		}
+	}
+
+	g_hash_table_destroy (digests);
+	g_hash_table_destroy (groups);
 
 	return hash_table;
 }
@@ -1272,8 +1438,9 @@ mail_folder_remove_attachments_thread (GSimpleAsyncResult *simple,
 
 	context = g_simple_async_result_get_op_res_gpointer (simple);
 
-	e_mail_folder_remove_attachments_sync (
+	e_mail_folder_remove_attachments_full_sync (
 		CAMEL_FOLDER (object), context->ptr_array,
+		context->dry_run, &context->bytes_reclaimed,
 		cancellable, &error);
 
 	if (error != NULL)
@@ -1351,104 +1518,322 @@ mail_folder_strip_message_level (CamelMimePart *in_part,
 	return modified;
 }
 
-/* Helper for e_mail_folder_remove_attachments_sync() */
-static gboolean
-mail_folder_strip_message (CamelFolder *folder,
-                           CamelMimeMessage *message,
-                           const gchar *message_uid,
-                           GCancellable *cancellable,
-                           GError **error)
+/* How many messages are retrieved and stripped in parallel. */
+#define REMOVE_ATTACHMENTS_MAX_WORKERS 4
+/* How many messages can be retrieved ahead of the one being appended;
+ * this limits how many stripped messages are held in memory at once. */
+#define REMOVE_ATTACHMENTS_WINDOW 20
+
+typedef struct _StripBatchData {
+	GMutex lock;
+	GCond cond;
+	GCancellable *cancellable;
+} StripBatchData;
+
+typedef struct _StripMessageData {
+	StripBatchData *batch;
+	CamelFolder *folder;		/* the real folder of the message */
+	gchar *message_uid;		/* UID in the real folder */
+	CamelMimeMessage *message;	/* set only when it was modified */
+	gsize stripped_size;
+	guint64 bytes_reclaimed;
+	gboolean done;
+	GError *error;
+} StripMessageData;
+
+static void
+strip_message_data_free (gpointer ptr)
 {
-	gboolean modified;
-	gboolean success = TRUE;
+	StripMessageData *smd = ptr;
+
+	if (smd) {
+		g_clear_object (&smd->folder);
+		g_clear_object (&smd->message);
+		g_clear_error (&smd->error);
+		g_free (smd->message_uid);
+		g_slice_free (StripMessageData, smd);
+	}
+}
+
+/* Helper for e_mail_folder_remove_attachments_full_sync() */
+static void
+mail_folder_strip_message_thread (gpointer data,
+                                  gpointer user_data)
+{
+	StripMessageData *smd = data;
+	StripBatchData *batch = smd->batch;
+	CamelMimeMessage *message;
+	GError *local_error = NULL;
+
+	message = camel_folder_get_message_sync (
+		smd->folder, smd->message_uid, batch->cancellable, &local_error);
+
+	if (message) {
+		CamelMessageInfo *info;
+		gsize original_size = 0;
 
-	modified = mail_folder_strip_message_level (CAMEL_MIME_PART (message), cancellable);
+		info = camel_folder_get_message_info (smd->folder, smd->message_uid);
+		if (info) {
+			original_size = camel_message_info_get_size (info);
+			g_object_unref (info);
+		}
+
+		if (!original_size)
+			original_size = camel_data_wrapper_calculate_size_sync (
+				CAMEL_DATA_WRAPPER (message), batch->cancellable, NULL);
+
+		if (mail_folder_strip_message_level (CAMEL_MIME_PART (message), batch->cancellable)) {
+			smd->stripped_size = camel_data_wrapper_calculate_size_sync (
+				CAMEL_DATA_WRAPPER (message), batch->cancellable, NULL);
+
+			if (original_size > smd->stripped_size)
+				smd->bytes_reclaimed = original_size - smd->stripped_size;
+
+			smd->message = message;
+		} else {
+			g_object_unref (message);
+		}
+	} else if (!local_error) {
+		local_error = g_error_new (
+			CAMEL_FOLDER_ERROR, CAMEL_FOLDER_ERROR_INVALID_UID,
+			_("No such message %s"), smd->message_uid);
+	}
+
+	g_mutex_lock (&batch->lock);
+	smd->error = local_error;
+	smd->done = TRUE;
+	g_cond_broadcast (&batch->cond);
+	g_mutex_unlock (&batch->lock);
+}
+
+/* Helper for e_mail_folder_remove_attachments_full_sync() */
+static gboolean
+mail_folder_append_stripped_message (StripMessageData *smd,
+                                     GCancellable *cancellable,
+                                     GError **error)
+{
+	CamelMessageInfo *orig_info;
+	CamelMessageInfo *copy_info;
+	CamelMessageFlags flags;
+	const CamelNameValueArray *headers;
+	gboolean success;
 
 	/* Append the modified message with removed attachments to
 	 * the folder and mark the original message for deletion. */
-	if (modified) {
-		CamelMessageInfo *orig_info;
-		CamelMessageInfo *copy_info;
-		CamelMessageFlags flags;
-		const CamelNameValueArray *headers;
-
-		headers = camel_medium_get_headers (CAMEL_MEDIUM (message));
-		orig_info = camel_folder_get_message_info (folder, message_uid);
-		copy_info = camel_message_info_new_from_headers (NULL, headers);
-
-		flags = camel_folder_get_message_flags (folder, message_uid);
-		camel_message_info_set_flags (copy_info, flags, flags);
-
-		success = camel_folder_append_message_sync (
-			folder, message, copy_info, NULL, cancellable, error);
-		if (success)
-			camel_message_info_set_flags (
-				orig_info,
-				CAMEL_MESSAGE_DELETED,
-				CAMEL_MESSAGE_DELETED);
-
-		g_clear_object (&orig_info);
-		g_clear_object (&copy_info);
-	}
+	headers = camel_medium_get_headers (CAMEL_MEDIUM (smd->message));
+	orig_info = camel_folder_get_message_info (smd->folder, smd->message_uid);
+	copy_info = camel_message_info_new_from_headers (NULL, headers);
+
+	flags = camel_folder_get_message_flags (smd->folder, smd->message_uid);
+	camel_message_info_set_flags (copy_info, flags, flags);
+	camel_message_info_set_size (copy_info, smd->stripped_size);
+
+	success = camel_folder_append_message_sync (
+		smd->folder, smd->message, copy_info, NULL, cancellable, error);
+	if (success && orig_info)
+		camel_message_info_set_flags (
+			orig_info,
+			CAMEL_MESSAGE_DELETED,
+			CAMEL_MESSAGE_DELETED);
+
+	g_clear_object (&orig_info);
+	g_clear_object (&copy_info);
 
 	return success;
 }
 
+/* Helper for e_mail_folder_remove_attachments_full_sync() */
+static void
+mail_folder_remove_attachments_report (GCancellable *cancellable,
+                                       gboolean dry_run,
+                                       guint64 bytes_reclaimed)
+{
+	gchar *size;
+
+	size = g_format_size (bytes_reclaimed);
+
+	camel_operation_pop_message (cancellable);
+	if (dry_run)
+		camel_operation_push_message (
+			cancellable,
+			/* Translators: The '%s' is a size, like "1.2 MB". */
+			_("Computing space used by attachments (%s)"), size);
+	else
+		camel_operation_push_message (
+			cancellable,
+			/* Translators: The '%s' is a size, like "1.2 MB". */
+			_("Removing attachments (%s reclaimed)"), size);
+
+	g_free (size);
+}
+
 gboolean
 e_mail_folder_remove_attachments_sync (CamelFolder *folder,
                                        GPtrArray *message_uids,
                                        GCancellable *cancellable,
                                        GError **error)
 {
+	return e_mail_folder_remove_attachments_full_sync (
+		folder, message_uids, FALSE, NULL, cancellable, error);
+}
+
+/**
+ * e_mail_folder_remove_attachments_full_sync:
+ * @folder: a #CamelFolder
+ * @message_uids: (element-type utf8): UIDs of the messages to strip
+ * @dry_run: %TRUE to only compute the space, without changing the @folder
+ * @out_bytes_reclaimed: (out) (optional): return location for the space
+ *    reclaimed by the removal, or %NULL
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Removes attachments from the messages with @message_uids. The messages
+ * are retrieved and stripped in parallel, ahead of the stripped copies
+ * being appended in the original order. Each original is flagged for
+ * deletion right after its copy is appended. The involved folders are
+ * synchronized once, at the end.
+ *
+ * With @dry_run set, the @folder is not changed at all and only the space
+ * which would be reclaimed is computed, thus it can be shown to the user
+ * before the actual removal.
+ *
+ * Returns: %TRUE on success, %FALSE on error
+ *
+ * Since: 3.28
+ **/
+gboolean
+e_mail_folder_remove_attachments_full_sync (CamelFolder *folder,
+                                            GPtrArray *message_uids,
+                                            gboolean dry_run,
+                                            guint64 *out_bytes_reclaimed,
+                                            GCancellable *cancellable,
+                                            GError **error)
+{
+	StripBatchData batch;
+	GThreadPool *thread_pool;
+	GPtrArray *strip_data;
+	GHashTable *changed_folders;
+	GHashTableIter iter;
+	gpointer key;
+	guint64 bytes_reclaimed = 0;
 	gboolean success = TRUE;
-	guint ii;
+	guint ii, n_pushed = 0;
 
 	g_return_val_if_fail (CAMEL_IS_FOLDER (folder), FALSE);
 	g_return_val_if_fail (message_uids != NULL, FALSE);
 
-	camel_folder_freeze (folder);
+	if (out_bytes_reclaimed)
+		*out_bytes_reclaimed = 0;
 
-	camel_operation_push_message (cancellable, _("Removing attachments"));
+	thread_pool = g_thread_pool_new (
+		mail_folder_strip_message_thread, NULL,
+		REMOVE_ATTACHMENTS_MAX_WORKERS, FALSE, error);
 
-	for (ii = 0; success && ii < message_uids->len; ii++) {
-		CamelMimeMessage *message;
-		CamelFolder *real_folder = NULL, *use_folder;
+	if (!thread_pool)
+		return FALSE;
+
+	g_mutex_init (&batch.lock);
+	g_cond_init (&batch.cond);
+	batch.cancellable = cancellable;
+
+	strip_data = g_ptr_array_new_with_free_func (strip_message_data_free);
+
+	for (ii = 0; ii < message_uids->len; ii++) {
+		StripMessageData *smd;
+		CamelFolder *real_folder = NULL;
 		gchar *real_message_uid = NULL;
-		const gchar *uid, *use_message_uid;
-		gint percent;
+		const gchar *uid;
 
 		uid = g_ptr_array_index (message_uids, ii);
 
 		em_utils_get_real_folder_and_message_uid (folder, uid, &real_folder, NULL, &real_message_uid);
 
-		use_folder = real_folder ? real_folder : folder;
-		use_message_uid = real_message_uid ? real_message_uid : uid;
-		message = camel_folder_get_message_sync (use_folder, use_message_uid, cancellable, error);
+		smd = g_slice_new0 (StripMessageData);
+		smd->batch = &batch;
+		smd->folder = real_folder ? real_folder : g_object_ref (folder);
+		smd->message_uid = real_message_uid ? real_message_uid : g_strdup (uid);
+
+		g_ptr_array_add (strip_data, smd);
+	}
+
+	/* CamelFolder ~> NULL, the folders to be synchronized */
+	changed_folders = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, NULL);
+
+	if (!dry_run)
+		camel_folder_freeze (folder);
+
+	camel_operation_push_message (cancellable, _("Removing attachments"));
+
+	/* The workers retrieve and strip the next messages while
+	 * the stripped ones are being appended, in the original order. */
+	for (ii = 0; success && ii < strip_data->len; ii++) {
+		StripMessageData *smd;
+
+		while (n_pushed < strip_data->len && n_pushed < ii + REMOVE_ATTACHMENTS_WINDOW) {
+			g_thread_pool_push (thread_pool, g_ptr_array_index (strip_data, n_pushed), NULL);
+			n_pushed++;
+		}
+
+		smd = g_ptr_array_index (strip_data, ii);
+
+		g_mutex_lock (&batch.lock);
+		while (!smd->done)
+			g_cond_wait (&batch.cond, &batch.lock);
+		g_mutex_unlock (&batch.lock);
 
-		if (message == NULL) {
-			g_clear_object (&real_folder);
-			g_free (real_message_uid);
+		if (smd->error) {
+			g_propagate_error (error, smd->error);
+			smd->error = NULL;
 			success = FALSE;
 			break;
 		}
 
-		success = mail_folder_strip_message (use_folder, message, use_message_uid, cancellable, error);
+		if (smd->message) {
+			if (!dry_run) {
+				success = mail_folder_append_stripped_message (smd, cancellable, error);
 
-		percent = ((ii + 1) * 100) / message_uids->len;
-		camel_operation_progress (cancellable, percent);
+				if (success && !g_hash_table_contains (changed_folders, smd->folder))
+					g_hash_table_add (changed_folders, g_object_ref (smd->folder));
+			}
 
-		g_clear_object (&real_folder);
-		g_clear_object (&message);
-		g_free (real_message_uid);
+			if (success)
+				bytes_reclaimed += smd->bytes_reclaimed;
+
+			g_clear_object (&smd->message);
+		}
+
+		if (success && ((ii + 1) % REMOVE_ATTACHMENTS_WINDOW == 0 || ii + 1 == strip_data->len)) {
+			mail_folder_remove_attachments_report (cancellable, dry_run, bytes_reclaimed);
+			camel_operation_progress (cancellable, ((ii + 1) * 100) / strip_data->len);
+		}
 	}
 
+	/* Waits also for the messages still being stripped after an error. */
+	g_thread_pool_free (thread_pool, FALSE, TRUE);
+
 	camel_operation_pop_message (cancellable);
 
-	if (success)
-		camel_folder_synchronize_sync (
+	/* Store the changes of all the involved folders at the end. */
+	g_hash_table_iter_init (&iter, changed_folders);
+	while (success && g_hash_table_iter_next (&iter, &key, NULL)) {
+		success = camel_folder_synchronize_sync (
+			key, FALSE, cancellable, error);
+	}
+
+	if (success && !dry_run && !g_hash_table_contains (changed_folders, folder))
+		success = camel_folder_synchronize_sync (
 			folder, FALSE, cancellable, error);
 
-	camel_folder_thaw (folder);
+	if (!dry_run)
+		camel_folder_thaw (folder);
+
+	g_hash_table_destroy (changed_folders);
+	g_ptr_array_unref (strip_data);
+	g_mutex_clear (&batch.lock);
+	g_cond_clear (&batch.cond);
+
+	if (out_bytes_reclaimed)
+		*out_bytes_reclaimed = bytes_reclaimed;
 
 	return success;
 }
@@ -1460,6 +1845,49 @@ e_mail_folder_remove_attachments (CamelFolder *folder,
                                   GCancellable *cancellable,
                                   GAsyncReadyCallback callback,
                                   gpointer user_data)
+{
+	e_mail_folder_remove_attachments_full (
+		folder, message_uids, FALSE, io_priority,
+		cancellable, callback, user_data);
+}
+
+gboolean
+e_mail_folder_remove_attachments_finish (CamelFolder *folder,
+                                         GAsyncResult *result,
+                                         GError **error)
+{
+	return e_mail_folder_remove_attachments_full_finish (
+		folder, result, NULL, error);
+}
+
+/**
+ * e_mail_folder_remove_attachments_full:
+ * @folder: a #CamelFolder
+ * @message_uids: (element-type utf8): UIDs of the messages to strip
+ * @dry_run: %TRUE to only compute the space, without changing the @folder
+ * @io_priority: the I/O priority of the request
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @callback: a #GAsyncReadyCallback to call when the request is satisfied
+ * @user_data: data to pass to the callback function
+ *
+ * Asynchronously removes attachments from the messages with @message_uids,
+ * or only computes the space it would reclaim when @dry_run is %TRUE.
+ * See e_mail_folder_remove_attachments_full_sync() for details.
+ *
+ * When the operation is finished, @callback will be called. You can then
+ * call e_mail_folder_remove_attachments_full_finish() to get the result
+ * of the operation.
+ *
+ * Since: 3.28
+ **/
+void
+e_mail_folder_remove_attachments_full (CamelFolder *folder,
+                                       GPtrArray *message_uids,
+                                       gboolean dry_run,
+                                       gint io_priority,
+                                       GCancellable *cancellable,
+                                       GAsyncReadyCallback callback,
+                                       gpointer user_data)
 {
 	GSimpleAsyncResult *simple;
 	AsyncContext *context;
@@ -1469,10 +1897,11 @@ e_mail_folder_remove_attachments (CamelFolder *folder,
 
 	context = g_slice_new0 (AsyncContext);
 	context->ptr_array = g_ptr_array_ref (message_uids);
+	context->dry_run = dry_run;
 
 	simple = g_simple_async_result_new (
 		G_OBJECT (folder), callback, user_data,
-		e_mail_folder_remove_attachments);
+		e_mail_folder_remove_attachments_full);
 
 	g_simple_async_result_set_check_cancellable (simple, cancellable);
 
@@ -1486,19 +1915,41 @@ e_mail_folder_remove_attachments (CamelFolder *folder,
 	g_object_unref (simple);
 }
 
+/**
+ * e_mail_folder_remove_attachments_full_finish:
+ * @folder: a #CamelFolder
+ * @result: a #GAsyncResult
+ * @out_bytes_reclaimed: (out) (optional): return location for the space
+ *    reclaimed by the removal, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes the operation started with e_mail_folder_remove_attachments_full().
+ * With a dry run, the @out_bytes_reclaimed is the space which would be
+ * reclaimed by the actual removal.
+ *
+ * Returns: %TRUE on success, %FALSE on error
+ *
+ * Since: 3.28
+ **/
 gboolean
-e_mail_folder_remove_attachments_finish (CamelFolder *folder,
-                                         GAsyncResult *result,
-                                         GError **error)
+e_mail_folder_remove_attachments_full_finish (CamelFolder *folder,
+                                              GAsyncResult *result,
+                                              guint64 *out_bytes_reclaimed,
+                                              GError **error)
 {
 	GSimpleAsyncResult *simple;
+	AsyncContext *context;
 
 	g_return_val_if_fail (
 		g_simple_async_result_is_valid (
 		result, G_OBJECT (folder),
-		e_mail_folder_remove_attachments), FALSE);
+		e_mail_folder_remove_attachments_full), FALSE);
 
 	simple = G_SIMPLE_ASYNC_RESULT (result);
+	context = g_simple_async_result_get_op_res_gpointer (simple);
+
+	if (out_bytes_reclaimed)
+		*out_bytes_reclaimed = context->bytes_reclaimed;
 
 	/* Assume success unless a GError is set. */
 	return !g_simple_async_result_propagate_error (simple, error);
@@ -1558,6 +2009,89 @@ mail_folder_save_prepare_part (CamelMimePart *mime_part)
 	}
 }
 
+/* How many messages are retrieved ahead of the one being saved. */
+#define SAVE_MESSAGES_PREFETCH 4
+
+typedef struct _SaveMessagesData {
+	GMutex lock;
+	GCond cond;
+	CamelFolder *folder;
+	GCancellable *cancellable;
+} SaveMessagesData;
+
+typedef struct _SaveMessagesSlot {
+	SaveMessagesData *smd;
+	const gchar *uid;
+	CamelMimeMessage *message;
+	GError *error;
+	gboolean done;
+} SaveMessagesSlot;
+
+/* Helper for e_mail_folder_save_messages_sync() */
+static void
+mail_folder_save_fetch_thread (gpointer data,
+                               gpointer user_data)
+{
+	SaveMessagesSlot *slot = data;
+	SaveMessagesData *smd = slot->smd;
+	CamelMimeMessage *message;
+	GError *local_error = NULL;
+
+	message = camel_folder_get_message_sync (
+		smd->folder, slot->uid, smd->cancellable, &local_error);
+
+	if (!message && !local_error)
+		local_error = g_error_new (
+			CAMEL_FOLDER_ERROR, CAMEL_FOLDER_ERROR_INVALID_UID,
+			_("No such message %s"), slot->uid);
+
+	g_mutex_lock (&smd->lock);
+	slot->message = message;
+	slot->error = local_error;
+	slot->done = TRUE;
+	g_cond_broadcast (&smd->cond);
+	g_mutex_unlock (&smd->lock);
+}
+
+/* Helper for e_mail_folder_save_messages_sync() */
+static void
+mail_folder_save_slot_free (gpointer ptr)
+{
+	SaveMessagesSlot *slot = ptr;
+
+	if (slot) {
+		g_clear_object (&slot->message);
+		g_clear_error (&slot->error);
+		g_slice_free (SaveMessagesSlot, slot);
+	}
+}
+
+/* Helper for e_mail_folder_save_messages_sync() */
+static void
+mail_folder_save_report_rate (GCancellable *cancellable,
+                              guint n_saved,
+                              guint n_total,
+                              goffset n_bytes,
+                              gdouble elapsed)
+{
+	gchar *bytes_per_second;
+
+	if (elapsed <= 0.0)
+		return;
+
+	bytes_per_second = g_format_size ((guint64) (n_bytes / elapsed));
+
+	camel_operation_pop_message (cancellable);
+	camel_operation_push_message (
+		cancellable,
+		/* Translators: The first two '%d' are numbers of messages, the '%.1f' is
+		 * a number of messages per second and the '%s' is a size, like "1.2 MB". */
+		_("Saving messages (%d of %d, %.1f messages/s, %s/s)"),
+		n_saved, n_total, n_saved / elapsed, bytes_per_second);
+
+	g_free (bytes_per_second);
+}
+
 gboolean
 e_mail_folder_save_messages_sync (CamelFolder *folder,
                                   GPtrArray *message_uids,
@@ -1565,11 +2099,17 @@ e_mail_folder_save_messages_sync (CamelFolder *folder,
                                   GCancellable *cancellable,
                                   GError **error)
 {
+	SaveMessagesData smd;
 	GFileOutputStream *file_output_stream;
-	CamelStream *base_stream = NULL;
-	GByteArray *byte_array;
+	GInputStream *dummy_input_stream;
+	GIOStream *io_stream;
+	GThreadPool *thread_pool;
+	GPtrArray *slots;
+	GTimer *timer;
+	CamelStream *base_stream;
 	gboolean success = TRUE;
-	guint ii;
+	gdouble last_report = 0.0;
+	guint ii, n_pushed = 0;
 
 	g_return_val_if_fail (CAMEL_IS_FOLDER (folder), FALSE);
 	g_return_val_if_fail (message_uids != NULL, FALSE);
@@ -1596,97 +2136,148 @@ e_mail_folder_save_messages_sync (CamelFolder *folder,
 		return FALSE;
 	}
 
-	byte_array = g_byte_array_new ();
+	thread_pool = g_thread_pool_new (
+		mail_folder_save_fetch_thread, NULL,
+		SAVE_MESSAGES_PREFETCH, FALSE, error);
+
+	if (thread_pool == NULL) {
+		g_object_unref (file_output_stream);
+		camel_operation_pop_message (cancellable);
+		g_file_delete (destination, NULL, NULL);
+		return FALSE;
+	}
+
+	/* The messages are written directly into the file, through
+	 * the CamelStream, which requires a GIOStream. */
+	dummy_input_stream = g_memory_input_stream_new ();
+	io_stream = g_simple_io_stream_new (
+		dummy_input_stream, G_OUTPUT_STREAM (file_output_stream));
+	base_stream = camel_stream_new (io_stream);
+
+	g_mutex_init (&smd.lock);
+	g_cond_init (&smd.cond);
+	smd.folder = folder;
+	smd.cancellable = cancellable;
+
+	slots = g_ptr_array_new_with_free_func (mail_folder_save_slot_free);
+	timer = g_timer_new ();
 
 	for (ii = 0; ii < message_uids->len; ii++) {
+		SaveMessagesSlot *slot;
 		CamelMimeMessage *message;
 		CamelMimeFilter *filter;
 		CamelStream *stream;
-		const gchar *uid;
 		gchar *from_line;
+		gdouble elapsed;
 		gint percent;
-		gint retval;
 
-		if (base_stream != NULL)
-			g_object_unref (base_stream);
+		/* Keep up to SAVE_MESSAGES_PREFETCH messages being retrieved
+		 * while the current one is written. */
+		while (n_pushed < message_uids->len && n_pushed <= ii + SAVE_MESSAGES_PREFETCH) {
+			slot = g_slice_new0 (SaveMessagesSlot);
+			slot->smd = &smd;
+			slot->uid = g_ptr_array_index (message_uids, n_pushed);
 
-		/* CamelStreamMem does NOT take ownership of the byte
-		 * array when set with camel_stream_mem_set_byte_array().
-		 * This allows us to reuse the same memory slab for each
-		 * message, which is slightly more efficient. */
-		base_stream = camel_stream_mem_new ();
-		camel_stream_mem_set_byte_array (
-			CAMEL_STREAM_MEM (base_stream), byte_array);
+			g_ptr_array_add (slots, slot);
+			g_thread_pool_push (thread_pool, slot, NULL);
 
-		uid = g_ptr_array_index (message_uids, ii);
+			n_pushed++;
+		}
 
-		message = camel_folder_get_message_sync (
-			folder, uid, cancellable, error);
-		if (message == NULL) {
+		slot = g_ptr_array_index (slots, ii);
+
+		g_mutex_lock (&smd.lock);
+		while (!slot->done)
+			g_cond_wait (&smd.cond, &smd.lock);
+		g_mutex_unlock (&smd.lock);
+
+		if (slot->error) {
+			g_propagate_error (error, slot->error);
+			slot->error = NULL;
 			success = FALSE;
-			goto exit;
+			break;
 		}
 
+		message = slot->message;
+		slot->message = NULL;
+
 		mail_folder_save_prepare_part (CAMEL_MIME_PART (message));
 
 		from_line = camel_mime_message_build_mbox_from (message);
-		g_return_val_if_fail (from_line != NULL, FALSE);
+		g_warn_if_fail (from_line != NULL);
 
-		success = g_output_stream_write_all (
-			G_OUTPUT_STREAM (file_output_stream),
-			from_line, strlen (from_line), NULL,
-			cancellable, error);
+		success = camel_stream_write_string (
+			base_stream, from_line ? from_line : "From -\n",
+			cancellable, error) != -1;
 
 		g_free (from_line);
 
 		if (!success) {
 			g_object_unref (message);
-			goto exit;
+			break;
 		}
 
+		/* Stream the message through the From-line escaping filter,
+		 * without making a copy of the whole message in memory. */
 		filter = camel_mime_filter_from_new ();
 		stream = camel_stream_filter_new (base_stream);
 		camel_stream_filter_add (CAMEL_STREAM_FILTER (stream), filter);
 
-		retval = camel_data_wrapper_write_to_stream_sync (
+		success = camel_data_wrapper_write_to_stream_sync (
 			CAMEL_DATA_WRAPPER (message),
-			stream, cancellable, error);
+			stream, cancellable, error) != -1 &&
+			camel_stream_flush (stream, cancellable, error) != -1;
 
 		g_object_unref (filter);
 		g_object_unref (stream);
+		g_object_unref (message);
 
-		if (retval == -1) {
-			g_object_unref (message);
-			goto exit;
-		}
-
-		g_byte_array_append (byte_array, (guint8 *) "\n", 1);
+		if (!success)
+			break;
 
-		success = g_output_stream_write_all (
-			G_OUTPUT_STREAM (file_output_stream),
-			byte_array->data, byte_array->len,
-			NULL, cancellable, error);
+		success = camel_stream_write_string (
+			base_stream, "\n", cancellable, error) != -1;
 
-		if (!success) {
-			g_object_unref (message);
-			goto exit;
-		}
+		if (!success)
+			break;
 
 		percent = ((ii + 1) * 100) / message_uids->len;
 		camel_operation_progress (cancellable, percent);
 
-		/* Reset the byte array for the next message. */
-		g_byte_array_set_size (byte_array, 0);
+		/* Report the rate about once per second. */
+		elapsed = g_timer_elapsed (timer, NULL);
+		if (elapsed - last_report >= 1.0) {
+			mail_folder_save_report_rate (
+				cancellable, ii + 1, message_uids->len,
+				g_seekable_tell (G_SEEKABLE (file_output_stream)),
+				elapsed);
+			last_report = elapsed;
+		}
 
-		g_object_unref (message);
+		/* Free the slot early, the message is not needed anymore. */
+		g_ptr_array_index (slots, ii) = NULL;
+		mail_folder_save_slot_free (slot);
 	}
 
-exit:
-	if (base_stream != NULL)
-		g_object_unref (base_stream);
+	/* Drop the not started retrievals and wait for the running ones. */
+	g_thread_pool_free (thread_pool, TRUE, TRUE);
+
+	if (success)
+		success = camel_stream_flush (base_stream, cancellable, error) != -1;
 
-	g_byte_array_free (byte_array, TRUE);
+	g_timer_destroy (timer);
+	g_ptr_array_unref (slots);
+	g_mutex_clear (&smd.lock);
+	g_cond_clear (&smd.cond);
+
+	/* Close it before the GIOStream does, to not miss an error. */
+	if (success)
+		success = g_output_stream_close (
+			G_OUTPUT_STREAM (file_output_stream), cancellable, error);
 
+	g_object_unref (base_stream);
+	g_object_unref (io_stream);
+	g_object_unref (dummy_input_stream);
 	g_object_unref (file_output_stream);
 
 	camel_operation_pop_message (cancellable);
@@ -129,6 +129,13 @@ gboolean	e_mail_folder_remove_attachments_sync
 						 GPtrArray *message_uids,
 						 GCancellable *cancellable,
 						 GError **error);
+gboolean	e_mail_folder_remove_attachments_full_sync
+						(CamelFolder *folder,
+						 GPtrArray *message_uids,
+						 gboolean dry_run,
+						 guint64 *out_bytes_reclaimed,
+						 GCancellable *cancellable,
+						 GError **error);
 void		e_mail_folder_remove_attachments
 						(CamelFolder *folder,
 						 GPtrArray *message_uids,
@@ -140,6 +147,19 @@ gboolean	e_mail_folder_remove_attachments_finish
 						(CamelFolder *folder,
 						 GAsyncResult *result,
 						 GError **error);
+void		e_mail_folder_remove_attachments_full
+						(CamelFolder *folder,
+						 GPtrArray *message_uids,
+						 gboolean dry_run,
+						 gint io_priority,
+						 GCancellable *cancellable,
+						 GAsyncReadyCallback callback,
+						 gpointer user_data);
+gboolean	e_mail_folder_remove_attachments_full_finish
+						(CamelFolder *folder,
+						 GAsyncResult *result,
+						 guint64 *out_bytes_reclaimed,
+						 GError **error);
 
 gboolean	e_mail_folder_save_messages_sync
 						(CamelFolder *folder,
@@ -22,6 +22,7 @@
 
 #include <libemail-engine/camel-null-store.h>
 #include <libemail-engine/camel-sasl-xoauth2.h>
+#include <libemail-engine/e-mail-body-index.h>
 #include <libemail-engine/e-mail-engine-enums.h>
 #include <libemail-engine/e-mail-engine-enumtypes.h>
 #include <libemail-engine/e-mail-folder-utils.h>
@@ -2066,6 +2066,7 @@ mail_folder_cache_note_store_thread (GSimpleAsyncResult *simple,
 	StoreInfo *store_info;
 	GQueue result_queue = G_QUEUE_INIT;
 	AsyncContext *async_context;
+	EStartupTraceSpan *trace_span = NULL;
 	gboolean success = FALSE;
 	GError *local_error = NULL;
 
@@ -2076,6 +2077,22 @@ mail_folder_cache_note_store_thread (GSimpleAsyncResult *simple,
 	service = CAMEL_SERVICE (store_info->store);
 	session = camel_service_ref_session (service);
 
+	if (e_startup_trace_is_enabled ()) {
+		g_mutex_lock (&store_info->lock);
+
+		if (store_info->first_update != E_FIRST_UPDATE_DONE) {
+			gchar *span_name;
+
+			span_name = g_strdup_printf (
+				"first folder tree of %s",
+				camel_service_get_display_name (service));
+			trace_span = e_startup_trace_begin ("mail", span_name);
+			g_free (span_name);
+		}
+
+		g_mutex_unlock (&store_info->lock);
+	}
+
 	/* We might get a race when setting up a store, such that it is
 	 * still left in offline mode, after we've gone online.  This
 	 * catches and fixes it up when the shell opens us.
@@ -2152,6 +2169,8 @@ exit:
 	e_queue_transfer (&store_info->folderinfo_updates, &result_queue);
 	g_mutex_unlock (&store_info->lock);
 
+	e_startup_trace_end (trace_span);
+
 	while (!g_queue_is_empty (&result_queue)) {
 		GSimpleAsyncResult *queued_result;
 
@@ -559,20 +559,47 @@ struct _send_queue_msg {
 
 	void (*done)(gpointer data);
 	gpointer data;
+
+	/* Used when sending the messages in parallel */
+	GMutex lock;		/* status, errors and the fields below */
+	GMutex driver_lock;	/* the filter driver is not thread safe */
+	GHashTable *sync_folders; /* CamelFolder * ~> NULL, to sync at the end */
+	guint n_unsynced;	/* deleted from the queue, but not synced yet */
+	GCond preloaded_cond;	/* signalled when a read message is sent */
+	gsize preloaded_size;	/* of the read messages, not sent yet */
+	guint n_started;
+	guint n_processed;	/* tried to be sent, without being cancelled */
+	guint n_failed;
 };
 
+/* At most this many transports are used in parallel */
+#define SEND_QUEUE_MAX_WORKERS 4
+
+/* Sync the Outbox after this many sent messages, thus a crash
+ * does not cause sending too many of them again on next start */
+#define SEND_QUEUE_SYNC_BATCH 10
+
+/* Messages are read ahead of sending them until their total size reaches
+ * this; reading then waits for some of them to be sent */
+#define SEND_QUEUE_MAX_PRELOADED_SIZE (32 * 1024 * 1024)
+
 static void	report_status		(struct _send_queue_msg *m,
 					 enum camel_filter_status_t status,
 					 gint pc,
 					 const gchar *desc,
 					 ...);
 
-/* send 1 message to a specific transport */
+/* Sends 1 message to a specific transport.  When @inout_connected is
+ * not NULL, then the transport is left connected for the next message
+ * and it's returned in it; the caller disconnects it when done.  The
+ * @preloaded is the message of the @uid, when it was read already. */
 static void
 mail_send_message (struct _send_queue_msg *m,
                    CamelFolder *queue,
                    const gchar *uid,
+                   CamelMimeMessage *preloaded,
                    CamelFilterDriver *driver,
+                   CamelService **inout_connected,
                    GCancellable *cancellable,
                    GError **error)
 {
@@ -592,8 +619,11 @@ mail_send_message (struct _send_queue_msg *m,
 	gboolean did_connect = FALSE;
 	gboolean sent_message_saved = FALSE;
 
-	message = camel_folder_get_message_sync (
-		queue, uid, cancellable, error);
+	if (preloaded)
+		message = g_object_ref (preloaded);
+	else
+		message = camel_folder_get_message_sync (
+			queue, uid, cancellable, error);
 	if (!message)
 		return;
 
@@ -720,10 +750,14 @@ mail_send_message (struct _send_queue_msg *m,
 	mail_tool_restore_xevolution_headers (message, xev_headers);
 
 	if (local_error == NULL && driver) {
+		g_mutex_lock (&m->driver_lock);
+
 		camel_filter_driver_filter_message (
 			driver, message, info, NULL, NULL,
 			NULL, "", cancellable, &local_error);
 
+		g_mutex_unlock (&m->driver_lock);
+
 		if (local_error != NULL) {
 			if (g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
 				goto exit;
@@ -853,13 +887,26 @@ mail_send_message (struct _send_queue_msg *m,
 	}
 
 	if (local_error == NULL) {
+		gboolean sync_queue = TRUE;
+
 		camel_folder_set_message_flags (
 			queue, uid, CAMEL_MESSAGE_DELETED |
 			CAMEL_MESSAGE_SEEN, ~0);
+
+		if (m->sync_folders) {
+			g_mutex_lock (&m->lock);
+			m->n_unsynced++;
+			sync_queue = m->n_unsynced >= SEND_QUEUE_SYNC_BATCH;
+			if (sync_queue)
+				m->n_unsynced = 0;
+			g_mutex_unlock (&m->lock);
+		}
+
 		/* Sync it to disk, since if it crashes in between,
 		 * we keep sending it again on next start. */
 		/* FIXME Not passing a GCancellable or GError here. */
-		camel_folder_synchronize_sync (queue, FALSE, NULL, NULL);
+		if (sync_queue)
+			camel_folder_synchronize_sync (queue, FALSE, NULL, NULL);
 	}
 
 	if (local_error == NULL && err->len > 0) {
@@ -870,10 +917,18 @@ mail_send_message (struct _send_queue_msg *m,
 	}
 
 exit:
-	if (did_connect) {
+	if (did_connect && inout_connected && !local_error &&
+	    !g_cancellable_is_cancelled (cancellable)) {
+		/* Keep it connected for the next message */
+		if (!*inout_connected)
+			*inout_connected = g_object_ref (service);
+	} else if (did_connect) {
 		/* Disconnect regardless of error or cancellation,
 		 * but be mindful of these conditions when calling
 		 * camel_service_disconnect_sync(). */
+		if (inout_connected)
+			g_clear_object (inout_connected);
+
 		if (g_cancellable_is_cancelled (cancellable)) {
 			camel_service_disconnect_sync (service, FALSE, NULL, NULL);
 		} else if (local_error != NULL) {
@@ -891,7 +946,14 @@ exit:
 
 	/* FIXME Not passing a GCancellable or GError here. */
 	if (folder != NULL) {
-		camel_folder_synchronize_sync (folder, FALSE, NULL, NULL);
+		if (m->sync_folders) {
+			g_mutex_lock (&m->lock);
+			if (!g_hash_table_contains (m->sync_folders, folder))
+				g_hash_table_add (m->sync_folders, g_object_ref (folder));
+			g_mutex_unlock (&m->lock);
+		} else {
+			camel_folder_synchronize_sync (folder, FALSE, NULL, NULL);
+		}
 		g_object_unref (folder);
 	}
 
@@ -921,11 +983,263 @@ report_status (struct _send_queue_msg *m,
 		va_start (ap, desc);
 		str = g_strdup_vprintf (desc, ap);
 		va_end (ap);
+		g_mutex_lock (&m->lock);
 		m->status (m->driver, status, pc, str, m->status_data);
+		g_mutex_unlock (&m->lock);
 		g_free (str);
 	}
 }
 
+/* Merges the @error into the operation error; returns whether
+ * the sending had been cancelled. Call with m->lock held. */
+static gboolean
+send_queue_take_error (struct _send_queue_msg *m,
+                       GError *error)
+{
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		/* transfer the USER_CANCEL error to the
+		 * async op exception and then break */
+		if (m->base.error == NULL)
+			g_propagate_error (&m->base.error, error);
+		else
+			g_error_free (error);
+
+		return TRUE;
+	}
+
+	/* merge exceptions into one */
+	if (m->base.error != NULL) {
+		gchar *old_message;
+
+		old_message = g_strdup (m->base.error->message);
+		g_clear_error (&m->base.error);
+		g_set_error (
+			&m->base.error, CAMEL_ERROR,
+			CAMEL_ERROR_GENERIC,
+			"%s\n\n%s", old_message,
+			error->message);
+		g_free (old_message);
+
+		g_error_free (error);
+	} else {
+		g_propagate_error (&m->base.error, error);
+	}
+
+	/* keep track of the number of failures */
+	m->n_failed++;
+
+	return FALSE;
+}
+
+/* A message of the queue, read and waiting to be sent */
+typedef struct _SendQueueItem {
+	const gchar *uid;
+	CamelMimeMessage *message;
+	GError *error;		/* when the message could not be read */
+	gsize size;
+} SendQueueItem;
+
+static void
+send_queue_item_free (SendQueueItem *item)
+{
+	g_clear_object (&item->message);
+	g_clear_error (&item->error);
+	g_slice_free (SendQueueItem, item);
+}
+
+/* Messages of the queue, which are sent through the same transport */
+typedef struct _SendQueueGroup {
+	struct _send_queue_msg *m;
+	GQueue items;		/* SendQueueItem *, guarded by m->lock */
+	gboolean running;	/* a worker sends the items, guarded by m->lock */
+	gboolean stopped;	/* sending had been cancelled */
+	CamelService *connected;
+	guint n_total;
+	GCancellable *cancellable;
+} SendQueueGroup;
+
+static void
+send_queue_group_free (gpointer ptr)
+{
+	SendQueueGroup *group = ptr;
+
+	if (group) {
+		g_queue_free_full (&group->items, (GDestroyNotify) send_queue_item_free);
+
+		if (group->connected) {
+			if (g_cancellable_is_cancelled (group->cancellable))
+				camel_service_disconnect_sync (group->connected, FALSE, NULL, NULL);
+			else
+				camel_service_disconnect_sync (group->connected, TRUE, group->cancellable, NULL);
+
+			g_object_unref (group->connected);
+		}
+
+		g_clear_object (&group->cancellable);
+		g_slice_free (SendQueueGroup, group);
+	}
+}
+
+/* Sends the read messages of one transport, in the order they are in
+ * the queue, until there is none left; the transport connection is
+ * reused for all of them. */
+static void
+send_queue_group_run (SendQueueGroup *group,
+                      gpointer user_data)
+{
+	struct _send_queue_msg *m = group->m;
+
+	while (TRUE) {
+		SendQueueItem *item;
+		GError *local_error = NULL;
+		gboolean do_send;
+		guint nth = 0;
+
+		g_mutex_lock (&m->lock);
+		item = g_queue_pop_head (&group->items);
+		if (!item)
+			group->running = FALSE;
+		do_send = item && !group->stopped && !g_cancellable_is_cancelled (group->cancellable);
+		if (do_send)
+			nth = ++m->n_started;
+		g_mutex_unlock (&m->lock);
+
+		if (!item)
+			break;
+
+		if (do_send) {
+			report_status (
+				m, CAMEL_FILTER_STATUS_START, (100 * (nth - 1)) / group->n_total,
+				_("Sending message %d of %d"), nth,
+				group->n_total);
+
+			camel_operation_progress (
+				group->cancellable, nth * 100 / group->n_total);
+
+			if (item->error) {
+				local_error = item->error;
+				item->error = NULL;
+			} else {
+				mail_send_message (
+					m, m->queue, item->uid, item->message,
+					m->driver, &group->connected, group->cancellable, &local_error);
+			}
+		}
+
+		g_mutex_lock (&m->lock);
+		if (local_error && send_queue_take_error (m, local_error))
+			group->stopped = TRUE;
+		else if (do_send)
+			m->n_processed++;
+		m->preloaded_size -= item->size;
+		g_cond_broadcast (&m->preloaded_cond);
+		g_mutex_unlock (&m->lock);
+
+		/* Free the memory as soon as possible */
+		send_queue_item_free (item);
+	}
+}
+
+/* Reads the @send_uids, splits them into groups by the transport they are
+ * sent with and sends the groups in parallel, while the next messages are
+ * being read.  Each message is read only once; the reading waits when the
+ * read messages, which are not sent yet, are too large.  Appends to the Sent
+ * folders and deletions from the queue are synced in batches. */
+static void
+send_queue_run_pipelined (struct _send_queue_msg *m,
+                          GPtrArray *send_uids,
+                          GCancellable *cancellable)
+{
+	GHashTable *groups; /* transport UID ~> SendQueueGroup * */
+	GHashTableIter iter;
+	GThreadPool *pool;
+	gpointer value;
+	guint ii;
+
+	groups = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, send_queue_group_free);
+	m->sync_folders = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, NULL);
+
+	pool = g_thread_pool_new (
+		(GFunc) send_queue_group_run, NULL,
+		SEND_QUEUE_MAX_WORKERS, FALSE, NULL);
+
+	for (ii = 0; ii < send_uids->len && !g_cancellable_is_cancelled (cancellable); ii++) {
+		const gchar *uid = send_uids->pdata[ii];
+		CamelMessageInfo *info;
+		CamelService *service = NULL;
+		SendQueueGroup *group;
+		SendQueueItem *item;
+		gchar *transport_uid;
+		gboolean start;
+
+		item = g_slice_new0 (SendQueueItem);
+		item->uid = uid;
+
+		info = camel_folder_get_message_info (m->queue, uid);
+		if (info) {
+			item->size = camel_message_info_get_size (info);
+			g_clear_object (&info);
+		}
+
+		/* Always let at least one message in, whatever its size is */
+		g_mutex_lock (&m->lock);
+		while (m->preloaded_size > 0 && m->preloaded_size + item->size > SEND_QUEUE_MAX_PRELOADED_SIZE)
+			g_cond_wait (&m->preloaded_cond, &m->lock);
+		m->preloaded_size += item->size;
+		g_mutex_unlock (&m->lock);
+
+		/* Failures are reported when sending the message */
+		item->message = camel_folder_get_message_sync (m->queue, uid, cancellable, &item->error);
+		if (item->message)
+			service = e_mail_session_ref_transport_for_message (m->session, item->message);
+
+		transport_uid = g_strdup (service ? camel_service_get_uid (service) : "");
+
+		group = g_hash_table_lookup (groups, transport_uid);
+		if (!group) {
+			group = g_slice_new0 (SendQueueGroup);
+			group->m = m;
+			g_queue_init (&group->items);
+			group->n_total = send_uids->len;
+			group->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+
+			g_hash_table_insert (groups, transport_uid, group);
+		} else {
+			g_free (transport_uid);
+		}
+
+		g_clear_object (&service);
+
+		g_mutex_lock (&m->lock);
+		g_queue_push_tail (&group->items, item);
+		start = !group->running;
+		group->running = TRUE;
+		g_mutex_unlock (&m->lock);
+
+		/* Run it in this thread, when the pool cannot be used */
+		if (start && (!pool || !g_thread_pool_push (pool, group, NULL)))
+			send_queue_group_run (group, NULL);
+	}
+
+	/* Waits for all the groups to be sent */
+	if (pool)
+		g_thread_pool_free (pool, FALSE, TRUE);
+
+	g_hash_table_destroy (groups);
+
+	/* FIXME Not passing a GCancellable or GError here. */
+	if (m->n_unsynced > 0)
+		camel_folder_synchronize_sync (m->queue, FALSE, NULL, NULL);
+
+	/* FIXME Not passing a GCancellable or GError here. */
+	g_hash_table_iter_init (&iter, m->sync_folders);
+	while (g_hash_table_iter_next (&iter, &value, NULL))
+		camel_folder_synchronize_sync (value, FALSE, NULL, NULL);
+
+	g_hash_table_destroy (m->sync_folders);
+	m->sync_folders = NULL;
+}
+
 static void
 send_queue_exec (struct _send_queue_msg *m,
                  GCancellable *cancellable,
@@ -986,55 +1300,39 @@ send_queue_exec (struct _send_queue_msg *m,
 	 *     fatal problems, it is also used as a mechanism to accumualte
 	 *     warning messages and present them back to the user. */
 
-	for (i = 0, j = 0; i < send_uids->len; i++) {
-		gint pc = (100 * i) / send_uids->len;
+	if (send_uids->len > 1) {
+		send_queue_run_pipelined (m, send_uids, cancellable);
+	} else {
+		for (i = 0; i < send_uids->len; i++) {
+			gint pc = (100 * i) / send_uids->len;
 
-		report_status (
-			m, CAMEL_FILTER_STATUS_START, pc,
-			_("Sending message %d of %d"), i + 1,
-			send_uids->len);
+			report_status (
+				m, CAMEL_FILTER_STATUS_START, pc,
+				_("Sending message %d of %d"), i + 1,
+				send_uids->len);
 
-		camel_operation_progress (
-			cancellable, (i + 1) * 100 / send_uids->len);
+			camel_operation_progress (
+				cancellable, (i + 1) * 100 / send_uids->len);
 
-		mail_send_message (
-			m, m->queue, send_uids->pdata[i],
-			m->driver, cancellable, &local_error);
-		if (local_error != NULL) {
-			if (!g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
-				/* merge exceptions into one */
-				if (m->base.error != NULL) {
-					gchar *old_message;
-
-					old_message = g_strdup (
-						m->base.error->message);
-					g_clear_error (&m->base.error);
-					g_set_error (
-						&m->base.error, CAMEL_ERROR,
-						CAMEL_ERROR_GENERIC,
-						"%s\n\n%s", old_message,
-						local_error->message);
-					g_free (old_message);
-
-					g_clear_error (&local_error);
-				} else {
-					g_propagate_error (&m->base.error, local_error);
-					local_error = NULL;
-				}
+			mail_send_message (
+				m, m->queue, send_uids->pdata[i], NULL,
+				m->driver, NULL, cancellable, &local_error);
+			if (local_error != NULL) {
+				gboolean cancelled;
 
-				/* keep track of the number of failures */
-				j++;
-			} else {
-				/* transfer the USER_CANCEL error to the
-				 * async op exception and then break */
-				g_propagate_error (&m->base.error, local_error);
+				cancelled = send_queue_take_error (m, local_error);
 				local_error = NULL;
-				break;
+
+				if (cancelled)
+					break;
 			}
+
+			m->n_processed++;
 		}
 	}
 
-	j += (send_uids->len - i);
+	/* count also the messages not tried to be sent */
+	j = m->n_failed + (send_uids->len - m->n_processed);
 
 	if (j > 0)
 		report_status (
@@ -1088,6 +1386,10 @@ send_queue_desc (struct _send_queue_msg *m)
 static void
 send_queue_free (struct _send_queue_msg *m)
 {
+	g_mutex_clear (&m->lock);
+	g_mutex_clear (&m->driver_lock);
+	g_cond_clear (&m->preloaded_cond);
+
 	if (m->session != NULL)
 		g_object_unref (m->session);
 	if (m->driver != NULL)
@@ -1128,6 +1430,9 @@ mail_send_queue (EMailSession *session,
 	e_mail_session_cancel_scheduled_outbox_flush (session);
 
 	m = mail_msg_new (&send_queue_info);
+	g_mutex_init (&m->lock);
+	g_mutex_init (&m->driver_lock);
+	g_cond_init (&m->preloaded_cond);
 	m->session = g_object_ref (session);
 	m->queue = g_object_ref (queue);
 	m->transport = g_object_ref (transport);
@@ -0,0 +1,389 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The tested functions are static, thus test them from the inside */
+#include "e-mail-body-index.c"
+
+#define TEST_FOLDER_URI "folder://test/INBOX"
+
+static void
+test_collect_word_cb (const gchar *word,
+                      gpointer user_data)
+{
+	GString *words = user_data;
+
+	if (words->len)
+		g_string_append_c (words, ' ');
+
+	g_string_append (words, word);
+}
+
+static gchar *
+test_tokenize (const gchar *text,
+               gboolean is_html)
+{
+	GString *words;
+
+	words = g_string_new ("");
+
+	body_index_tokenize (text, strlen (text), is_html, test_collect_word_cb, words);
+
+	return g_string_free (words, FALSE);
+}
+
+static EMailBodyIndex *
+test_body_index_new (void)
+{
+	EMailBodyIndex *body_index;
+
+	body_index = g_object_new (E_TYPE_MAIL_BODY_INDEX, NULL);
+	body_index->priv->loaded = TRUE;
+
+	return body_index;
+}
+
+static void
+test_add_document (EMailBodyIndex *body_index,
+                   const gchar *uid,
+                   const gchar *text)
+{
+	FolderState *state;
+	GHashTable *terms;
+
+	state = g_hash_table_lookup (body_index->priv->folders, TEST_FOLDER_URI);
+	if (!state) {
+		state = folder_state_new (TEST_FOLDER_URI);
+		g_hash_table_insert (body_index->priv->folders, state->uri, state);
+	}
+
+	terms = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	body_index_tokenize (text, strlen (text), FALSE, body_index_add_term_cb, terms);
+
+	body_index_add_document (body_index, state, uid, terms);
+
+	g_hash_table_destroy (terms);
+}
+
+static gint
+test_compare_uids (gconstpointer ptr1,
+                   gconstpointer ptr2)
+{
+	return g_strcmp0 (*((const gchar **) ptr1), *((const gchar **) ptr2));
+}
+
+/* Returns UIDs of the documents with the @word, sorted and space-separated */
+static gchar *
+test_lookup (EMailBodyIndex *body_index,
+             const gchar *word)
+{
+	GHashTable *docs;
+	GHashTableIter iter;
+	GPtrArray *uids;
+	gpointer key;
+	gchar *result;
+
+	docs = body_index_lookup_token (body_index, word);
+	g_assert_nonnull (docs);
+
+	uids = g_ptr_array_new ();
+
+	g_hash_table_iter_init (&iter, docs);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		Document *doc;
+
+		doc = g_ptr_array_index (body_index->priv->documents, GPOINTER_TO_UINT (key) - 1);
+		if (doc->uid)
+			g_ptr_array_add (uids, doc->uid);
+	}
+
+	g_ptr_array_sort (uids, test_compare_uids);
+	g_ptr_array_add (uids, NULL);
+
+	result = g_strjoinv (" ", (gchar **) uids->pdata);
+
+	g_ptr_array_free (uids, TRUE);
+	g_hash_table_destroy (docs);
+
+	return result;
+}
+
+static void
+test_body_index_varint (void)
+{
+	const guint32 values[] = { 0, 1, 127, 128, 16383, 16384, 2097151, 2097152, G_MAXUINT32 };
+	GByteArray *bytes;
+	const guint8 *data, *end;
+	guint32 value;
+	guint ii;
+
+	bytes = g_byte_array_new ();
+
+	for (ii = 0; ii < G_N_ELEMENTS (values); ii++)
+		body_index_put_uint (bytes, values[ii]);
+
+	/* One byte per 7 bits */
+	g_assert_cmpuint (bytes->len, ==, 1 + 1 + 1 + 2 + 2 + 3 + 3 + 4 + 5);
+
+	data = bytes->data;
+	end = data + bytes->len;
+
+	for (ii = 0; ii < G_N_ELEMENTS (values); ii++) {
+		g_assert_true (body_index_get_uint (&data, end, &value));
+		g_assert_cmpuint (value, ==, values[ii]);
+	}
+
+	g_assert_true (data == end);
+	g_assert_false (body_index_get_uint (&data, end, &value));
+
+	/* The last value cut in the middle */
+	data = bytes->data + bytes->len - 5;
+	g_assert_false (body_index_get_uint (&data, end - 1, &value));
+
+	g_byte_array_unref (bytes);
+}
+
+static void
+test_body_index_tokenizer (void)
+{
+	gchar *words;
+
+	words = test_tokenize ("Hello, World! A x2 \xc3\x84hnlich mailboxes", FALSE);
+	g_assert_cmpstr (words, ==, "hello world x2 \xc3\xa4hnlich mailboxes");
+	g_free (words);
+
+	/* Tags are skipped, words are not stemmed */
+	words = test_tokenize ("<p class=\"quoted\">Running</p><b>tests</b>", TRUE);
+	g_assert_cmpstr (words, ==, "running tests");
+	g_free (words);
+
+	/* Invalid UTF-8 splits words */
+	words = test_tokenize ("ab\xff" "cd", FALSE);
+	g_assert_cmpstr (words, ==, "ab cd");
+	g_free (words);
+
+	/* Long words are cut */
+	words = test_tokenize ("0123456789012345678901234567890123456789 end", FALSE);
+	g_assert_cmpstr (words, ==, "01234567890123456789012345678901 end");
+	g_free (words);
+}
+
+static void
+test_body_index_postings (void)
+{
+	Posting posting = { 0 };
+	GHashTable *docs;
+
+	posting.bytes = g_byte_array_new ();
+
+	posting_add (&posting, 3);
+	posting_add (&posting, 5);
+	posting_add (&posting, 5);
+	posting_add (&posting, 4);
+	posting_add (&posting, 200);
+	posting_add (&posting, 70000);
+
+	g_assert_cmpuint (posting.n_docs, ==, 4);
+	g_assert_cmpuint (posting.last_doc, ==, 70000);
+
+	docs = g_hash_table_new (g_direct_hash, g_direct_equal);
+	posting_collect (&posting, docs);
+
+	g_assert_cmpuint (g_hash_table_size (docs), ==, 4);
+	g_assert_true (g_hash_table_contains (docs, GUINT_TO_POINTER (3 + 1)));
+	g_assert_true (g_hash_table_contains (docs, GUINT_TO_POINTER (5 + 1)));
+	g_assert_true (g_hash_table_contains (docs, GUINT_TO_POINTER (200 + 1)));
+	g_assert_true (g_hash_table_contains (docs, GUINT_TO_POINTER (70000 + 1)));
+
+	g_hash_table_destroy (docs);
+	g_byte_array_unref (posting.bytes);
+}
+
+static void
+test_body_index_lookup (void)
+{
+	EMailBodyIndex *body_index;
+	gchar *uids;
+
+	body_index = test_body_index_new ();
+
+	test_add_document (body_index, "1", "Check the mailbox");
+	test_add_document (body_index, "2", "A box of boxes");
+	test_add_document (body_index, "3", "Nothing here");
+
+	/* Parts of words match, like with body-contains */
+	uids = test_lookup (body_index, "box");
+	g_assert_cmpstr (uids, ==, "1 2");
+	g_free (uids);
+
+	uids = test_lookup (body_index, "oxes");
+	g_assert_cmpstr (uids, ==, "2");
+	g_free (uids);
+
+	uids = test_lookup (body_index, "here");
+	g_assert_cmpstr (uids, ==, "3");
+	g_free (uids);
+
+	uids = test_lookup (body_index, "zz");
+	g_assert_cmpstr (uids, ==, "");
+	g_free (uids);
+
+	g_object_unref (body_index);
+}
+
+static void
+test_body_index_round_trip (void)
+{
+	EMailBodyIndex *body_index, *loaded;
+	GByteArray *bytes;
+	FolderState *state;
+	gchar *uids;
+
+	body_index = test_body_index_new ();
+
+	test_add_document (body_index, "1", "first message");
+	test_add_document (body_index, "2", "second message");
+	test_add_document (body_index, "3", "third message");
+
+	state = g_hash_table_lookup (body_index->priv->folders, TEST_FOLDER_URI);
+	g_hash_table_add (state->uncached, g_strdup ("4"));
+	state->complete = TRUE;
+
+	body_index_forget_document (body_index, 1);
+
+	bytes = g_byte_array_new ();
+	body_index_write_documents (body_index, bytes);
+	body_index_write_terms (body_index, bytes);
+
+	loaded = test_body_index_new ();
+	g_assert_true (body_index_parse (loaded, bytes->data, bytes->data + bytes->len));
+
+	g_assert_cmpuint (loaded->priv->documents->len, ==, 3);
+	g_assert_cmpuint (loaded->priv->n_forgotten, ==, 1);
+	g_assert_cmpuint (loaded->priv->term_list->len, ==, body_index->priv->term_list->len);
+
+	state = g_hash_table_lookup (loaded->priv->folders, TEST_FOLDER_URI);
+	g_assert_nonnull (state);
+	g_assert_true (state->complete);
+	g_assert_cmpuint (g_hash_table_size (state->docs), ==, 2);
+	g_assert_true (g_hash_table_contains (state->uncached, "4"));
+
+	uids = test_lookup (loaded, "message");
+	g_assert_cmpstr (uids, ==, "1 3");
+	g_free (uids);
+
+	/* A truncated file is refused */
+	g_object_unref (loaded);
+	loaded = test_body_index_new ();
+	g_assert_false (body_index_parse (loaded, bytes->data, bytes->data + bytes->len - 1));
+
+	g_object_unref (loaded);
+	g_byte_array_unref (bytes);
+	g_object_unref (body_index);
+}
+
+static void
+test_body_index_compact (void)
+{
+	EMailBodyIndex *body_index;
+	FolderState *state;
+	gchar *uids;
+
+	body_index = test_body_index_new ();
+
+	test_add_document (body_index, "1", "alpha common");
+	test_add_document (body_index, "2", "beta common");
+	test_add_document (body_index, "3", "gamma common");
+
+	body_index_forget_document (body_index, 0);
+	body_index_forget_document (body_index, 1);
+
+	g_assert_cmpuint (body_index->priv->n_forgotten, ==, 2);
+
+	body_index_compact (body_index);
+
+	g_assert_cmpuint (body_index->priv->n_forgotten, ==, 0);
+	g_assert_cmpuint (body_index->priv->documents->len, ==, 1);
+
+	/* Terms of the forgotten documents only are gone */
+	g_assert_false (g_hash_table_contains (body_index->priv->terms, "alpha"));
+	g_assert_false (g_hash_table_contains (body_index->priv->terms, "beta"));
+	g_assert_cmpuint (body_index->priv->term_list->len, ==, 2);
+
+	state = g_hash_table_lookup (body_index->priv->folders, TEST_FOLDER_URI);
+	g_assert_cmpuint (GPOINTER_TO_UINT (g_hash_table_lookup (state->docs, "3")), ==, 1);
+
+	uids = test_lookup (body_index, "common");
+	g_assert_cmpstr (uids, ==, "3");
+	g_free (uids);
+
+	uids = test_lookup (body_index, "alpha");
+	g_assert_cmpstr (uids, ==, "");
+	g_free (uids);
+
+	/* New documents continue after the compacted ones */
+	test_add_document (body_index, "4", "delta common");
+
+	uids = test_lookup (body_index, "common");
+	g_assert_cmpstr (uids, ==, "3 4");
+	g_free (uids);
+
+	g_object_unref (body_index);
+}
+
+static void
+test_body_index_sexp (void)
+{
+	EMailBodyIndex *body_index;
+	FolderState *state;
+	gchar *sexp;
+
+	body_index = test_body_index_new ();
+
+	test_add_document (body_index, "1", "the mailbox is full");
+	test_add_document (body_index, "2", "nothing");
+
+	state = g_hash_table_lookup (body_index->priv->folders, TEST_FOLDER_URI);
+	state->complete = TRUE;
+
+	sexp = e_mail_body_index_build_sexp (body_index, "box");
+	g_assert_nonnull (sexp);
+
+	/* The hit, and messages the index does not know, even in a complete folder */
+	g_assert_nonnull (strstr (sexp, "(or (uid \"1\") (not (uid "));
+	g_assert_nonnull (strstr (sexp, "(body-contains \"box\")"));
+
+	g_free (sexp);
+
+	/* Too short to be indexed */
+	g_assert_null (e_mail_body_index_build_sexp (body_index, "x"));
+
+	g_object_unref (body_index);
+}
+
+gint
+main (gint argc,
+      gchar *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/EMailBodyIndex/Varint", test_body_index_varint);
+	g_test_add_func ("/EMailBodyIndex/Tokenizer", test_body_index_tokenizer);
+	g_test_add_func ("/EMailBodyIndex/Postings", test_body_index_postings);
+	g_test_add_func ("/EMailBodyIndex/Lookup", test_body_index_lookup);
+	g_test_add_func ("/EMailBodyIndex/RoundTrip", test_body_index_round_trip);
+	g_test_add_func ("/EMailBodyIndex/Compact", test_body_index_compact);
+	g_test_add_func ("/EMailBodyIndex/Sexp", test_body_index_sexp);
+
+	return g_test_run ();
+}
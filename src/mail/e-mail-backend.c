@@ -57,6 +57,7 @@ struct _EMailBackendPrivate {
 	EMailSendAccountOverride *send_account_override;
 	EMailRemoteContent *remote_content;
 	EMailProperties *mail_properties;
+	EMailBodyIndex *body_index;
 };
 
 enum {
@@ -389,6 +390,9 @@ mail_backend_prepare_for_quit_cb (EShell *shell,
 	camel_operation_cancel_all ();
 	mail_vfolder_shutdown ();
 
+	if (backend->priv->body_index)
+		e_mail_body_index_stop (backend->priv->body_index);
+
 	cancellable = e_activity_get_cancellable (activity);
 	if (cancellable) {
 		/* Maybe the cancellable just got cancelled when the above
@@ -983,6 +987,11 @@ mail_backend_dispose (GObject *object)
 
 	priv = E_MAIL_BACKEND_GET_PRIVATE (object);
 
+	if (priv->body_index != NULL) {
+		e_mail_body_index_stop (priv->body_index);
+		g_clear_object (&priv->body_index);
+	}
+
 	if (priv->session != NULL) {
 		em_folder_tree_model_free_default ();
 
@@ -1262,6 +1271,10 @@ mail_backend_constructed (GObject *object)
 
 	mail_config_init (priv->session);
 
+	/* Answers body searches from messages available offline */
+	priv->body_index = e_mail_body_index_new (priv->session);
+	e_mail_body_index_start (priv->body_index);
+
 	mail_msg_register_activities (
 		mail_mt_create_activity,
 		mail_mt_submit_activity,
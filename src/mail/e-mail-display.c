@@ -50,6 +50,11 @@
 
 #define d(x)
 
+/* Images wider than the view are served downscaled; the width
+ * is rounded up to this step, thus small resizes do not matter. */
+#define PREVIEW_WIDTH_STEP 256
+#define PREVIEW_MIN_WIDTH 1024
+
 #define E_MAIL_DISPLAY_GET_PRIVATE(obj) \
 	(G_TYPE_INSTANCE_GET_PRIVATE \
 	((obj), E_TYPE_MAIL_DISPLAY, EMailDisplayPrivate))
@@ -1728,6 +1733,36 @@ mail_display_uri_requested_cb (EWebView *web_view,
 
 		g_free (*redirect_to_uri);
 		*redirect_to_uri = new_uri;
+
+	} else if (g_str_has_prefix (uri, "mail:")) {
+		SoupURI *soup_uri;
+		GHashTable *query = NULL;
+
+		/* Only the images shown in the view are downscaled; saving
+		 * or copying the image requests the URI without the width. */
+		soup_uri = soup_uri_new (uri);
+		if (soup_uri && soup_uri->query)
+			query = soup_form_decode (soup_uri->query);
+
+		if (query && g_strcmp0 (g_hash_table_lookup (query, "preview"), "1") == 0 &&
+		    !g_hash_table_contains (query, "preview_width")) {
+			GtkWidget *widget = GTK_WIDGET (display);
+			gint width;
+
+			width = gtk_widget_get_allocated_width (widget) *
+				gtk_widget_get_scale_factor (widget);
+			width = MAX (width, PREVIEW_MIN_WIDTH);
+			width = (width + PREVIEW_WIDTH_STEP - 1) /
+				PREVIEW_WIDTH_STEP * PREVIEW_WIDTH_STEP;
+
+			g_free (*redirect_to_uri);
+			*redirect_to_uri = g_strdup_printf ("%s&preview_width=%d", uri, width);
+		}
+
+		if (query)
+			g_hash_table_unref (query);
+		if (soup_uri)
+			soup_uri_free (soup_uri);
 	}
 }
 
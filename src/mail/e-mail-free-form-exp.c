@@ -25,6 +25,7 @@
 #include <camel/camel.h>
 #include <e-util/e-util.h>
 #include <libedataserver/libedataserver.h>
+#include <libemail-engine/libemail-engine.h>
 
 #include "e-mail-free-form-exp.h"
 
@@ -358,6 +359,20 @@ mail_ffe_body (const gchar *word,
 			cmp = "regex";
 	}
 
+	if (g_strcmp0 (cmp, "contains") == 0) {
+		EMailBodyIndex *body_index;
+
+		/* Prefer the local index, it avoids reading all the messages */
+		body_index = e_mail_body_index_ref_default ();
+		if (body_index) {
+			sexp = e_mail_body_index_build_sexp (body_index, word);
+			g_object_unref (body_index);
+
+			if (sexp)
+				return sexp;
+		}
+	}
+
 	encoded_word = g_string_new ("");
 	camel_sexp_encode_string (encoded_word, word);
 
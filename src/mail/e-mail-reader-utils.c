@@ -1704,6 +1704,7 @@ mail_reader_remove_attachments_cb (GObject *source_object,
 	EActivity *activity;
 	EAlertSink *alert_sink;
 	AsyncContext *async_context;
+	guint64 bytes_reclaimed = 0;
 	GError *local_error = NULL;
 
 	async_context = (AsyncContext *) user_data;
@@ -1711,8 +1712,9 @@ mail_reader_remove_attachments_cb (GObject *source_object,
 	activity = async_context->activity;
 	alert_sink = e_activity_get_alert_sink (activity);
 
-	e_mail_folder_remove_attachments_finish (
-		CAMEL_FOLDER (source_object), result, &local_error);
+	e_mail_folder_remove_attachments_full_finish (
+		CAMEL_FOLDER (source_object), result,
+		&bytes_reclaimed, &local_error);
 
 	if (e_activity_handle_cancellation (activity, local_error)) {
 		g_error_free (local_error);
@@ -1723,11 +1725,49 @@ mail_reader_remove_attachments_cb (GObject *source_object,
 			"mail:remove-attachments",
 			local_error->message, NULL);
 		g_error_free (local_error);
+
+	} else {
+		gchar *size;
+
+		e_activity_set_state (activity, E_ACTIVITY_COMPLETED);
+
+		size = g_format_size (bytes_reclaimed);
+		e_alert_submit (
+			alert_sink,
+			"mail:info-remove-attachments",
+			size, NULL);
+		g_free (size);
 	}
 
 	async_context_free (async_context);
 }
 
+/* Estimates the space reclaimed by removing attachments from the messages
+ * with @uids from their summary only, without downloading any of them;
+ * it is the size of the messages, which have attachments. */
+static guint64
+mail_reader_estimate_attachments_size (CamelFolder *folder,
+                                       GPtrArray *uids)
+{
+	guint64 size = 0;
+	guint ii;
+
+	for (ii = 0; ii < uids->len; ii++) {
+		CamelMessageInfo *info;
+
+		info = camel_folder_get_message_info (folder, g_ptr_array_index (uids, ii));
+		if (!info)
+			continue;
+
+		if ((camel_message_info_get_flags (info) & CAMEL_MESSAGE_ATTACHMENTS) != 0)
+			size += camel_message_info_get_size (info);
+
+		g_object_unref (info);
+	}
+
+	return size;
+}
+
 void
 e_mail_reader_remove_attachments (EMailReader *reader)
 {
@@ -1736,13 +1776,27 @@ e_mail_reader_remove_attachments (EMailReader *reader)
 	GCancellable *cancellable;
 	CamelFolder *folder;
 	GPtrArray *uids;
+	gchar *size;
 
 	g_return_if_fail (E_IS_MAIL_READER (reader));
 
 	uids = e_mail_reader_get_selected_uids (reader);
 	g_return_if_fail (uids != NULL);
 
-	/* Remove attachments asynchronously. */
+	folder = e_mail_reader_ref_folder (reader);
+
+	/* Only estimate the space from the summary; a dry run would
+	 * download and strip every message just to ask the question. */
+	size = g_format_size (mail_reader_estimate_attachments_size (folder, uids));
+
+	if (!e_util_prompt_user (
+		e_mail_reader_get_window (reader), "org.gnome.evolution.mail", NULL,
+		"mail:ask-remove-attachments", size, NULL)) {
+		g_object_unref (folder);
+		g_ptr_array_unref (uids);
+		g_free (size);
+		return;
+	}
 
 	activity = e_mail_reader_new_activity (reader);
 	cancellable = e_activity_get_cancellable (activity);
@@ -1751,20 +1805,17 @@ e_mail_reader_remove_attachments (EMailReader *reader)
 	async_context->activity = g_object_ref (activity);
 	async_context->reader = g_object_ref (reader);
 
-	folder = e_mail_reader_ref_folder (reader);
-
-	e_mail_folder_remove_attachments (
-		folder, uids,
+	e_mail_folder_remove_attachments_full (
+		folder, uids, FALSE,
 		G_PRIORITY_DEFAULT,
 		cancellable,
 		mail_reader_remove_attachments_cb,
 		async_context);
 
 	g_object_unref (folder);
-
 	g_object_unref (activity);
-
 	g_ptr_array_unref (uids);
+	g_free (size);
 }
 
 static void
@@ -36,10 +36,24 @@
 
 #define d(x)
 
+/* Total size of the previews kept in the memory. */
+#define PREVIEW_CACHE_MAX_SIZE (16 * 1024 * 1024)
+
 struct _EMailRequestPrivate {
 	gint dummy;
 };
 
+typedef struct _PreviewCacheItem {
+	gchar *uri;
+	GBytes *bytes;
+	gchar *mime_type;
+} PreviewCacheItem;
+
+static GMutex preview_cache_lock;
+static GHashTable *preview_cache = NULL;	/* gchar *uri, with the preview_width ~> GList * in preview_cache_queue */
+static GQueue preview_cache_queue = G_QUEUE_INIT;	/* PreviewCacheItem *, the most recent first */
+static gsize preview_cache_size = 0;
+
 static void e_mail_request_content_request_init (EContentRequestInterface *iface);
 
 G_DEFINE_TYPE_WITH_CODE (EMailRequest, e_mail_request, G_TYPE_OBJECT,
@@ -84,6 +98,184 @@ save_gicon_to_stream (GIcon *icon,
 	g_object_unref (icon);
 }
 
+static void
+preview_cache_item_free (gpointer ptr)
+{
+	PreviewCacheItem *item = ptr;
+
+	if (item) {
+		g_free (item->uri);
+		g_bytes_unref (item->bytes);
+		g_free (item->mime_type);
+		g_slice_free (PreviewCacheItem, item);
+	}
+}
+
+static gboolean
+mail_request_preview_cache_lookup (const gchar *uri,
+				   GInputStream **out_stream,
+				   gint64 *out_stream_length,
+				   gchar **out_mime_type)
+{
+	GList *link;
+	gboolean found = FALSE;
+
+	g_mutex_lock (&preview_cache_lock);
+
+	link = preview_cache ? g_hash_table_lookup (preview_cache, uri) : NULL;
+	if (link) {
+		PreviewCacheItem *item = link->data;
+
+		/* Move to the head, it's the most recently used now. */
+		g_queue_unlink (&preview_cache_queue, link);
+		g_queue_push_head_link (&preview_cache_queue, link);
+
+		*out_stream = g_memory_input_stream_new_from_bytes (item->bytes);
+		*out_stream_length = g_bytes_get_size (item->bytes);
+		*out_mime_type = g_strdup (item->mime_type);
+
+		found = TRUE;
+	}
+
+	g_mutex_unlock (&preview_cache_lock);
+
+	return found;
+}
+
+static void
+mail_request_preview_cache_add (const gchar *uri,
+				GBytes *bytes,
+				const gchar *mime_type)
+{
+	PreviewCacheItem *item;
+
+	if (g_bytes_get_size (bytes) > PREVIEW_CACHE_MAX_SIZE / 4)
+		return;
+
+	g_mutex_lock (&preview_cache_lock);
+
+	if (!preview_cache)
+		preview_cache = g_hash_table_new (g_str_hash, g_str_equal);
+
+	if (g_hash_table_contains (preview_cache, uri)) {
+		g_mutex_unlock (&preview_cache_lock);
+		return;
+	}
+
+	item = g_slice_new0 (PreviewCacheItem);
+	item->uri = g_strdup (uri);
+	item->bytes = g_bytes_ref (bytes);
+	item->mime_type = g_strdup (mime_type);
+
+	g_queue_push_head (&preview_cache_queue, item);
+	g_hash_table_insert (preview_cache, item->uri, g_queue_peek_head_link (&preview_cache_queue));
+	preview_cache_size += g_bytes_get_size (bytes);
+
+	while (preview_cache_size > PREVIEW_CACHE_MAX_SIZE) {
+		item = g_queue_pop_tail (&preview_cache_queue);
+
+		g_hash_table_remove (preview_cache, item->uri);
+		preview_cache_size -= g_bytes_get_size (item->bytes);
+
+		preview_cache_item_free (item);
+	}
+
+	g_mutex_unlock (&preview_cache_lock);
+}
+
+typedef struct _PreviewSizeData {
+	gint max_width;
+	gboolean decided;
+	gboolean scale;
+} PreviewSizeData;
+
+static void
+mail_request_preview_size_prepared_cb (GdkPixbufLoader *loader,
+				       gint width,
+				       gint height,
+				       PreviewSizeData *psd)
+{
+	psd->decided = TRUE;
+
+	if (width > psd->max_width) {
+		gint new_height;
+
+		new_height = MAX (1, (gint64) height * psd->max_width / width);
+
+		/* Loaders like the JPEG one can scale while decoding. */
+		gdk_pixbuf_loader_set_size (loader, psd->max_width, new_height);
+
+		psd->scale = TRUE;
+	}
+}
+
+/* Returns a downscaled copy of the image in the @bytes, or %NULL, when
+ * the image is not wider than the @max_width or it cannot be decoded. */
+static GBytes *
+mail_request_create_preview (GBytes *bytes,
+			     gint max_width,
+			     gchar **out_mime_type,
+			     GCancellable *cancellable)
+{
+	GdkPixbufLoader *loader;
+	GdkPixbuf *pixbuf;
+	PreviewSizeData psd = { 0 };
+	const guchar *data;
+	gchar *buffer = NULL;
+	gsize size, offset, length = 0;
+	gboolean success;
+
+	psd.max_width = max_width;
+
+	loader = gdk_pixbuf_loader_new ();
+	g_signal_connect (
+		loader, "size-prepared",
+		G_CALLBACK (mail_request_preview_size_prepared_cb), &psd);
+
+	data = g_bytes_get_data (bytes, &size);
+	success = TRUE;
+
+	for (offset = 0; success && offset < size; offset += 65536) {
+		if (g_cancellable_is_cancelled (cancellable) ||
+		    (psd.decided && !psd.scale)) {
+			success = FALSE;
+			break;
+		}
+
+		success = gdk_pixbuf_loader_write (
+			loader, data + offset, MIN (65536, size - offset), NULL);
+	}
+
+	/* Closing a partially written image fails; that's expected. */
+	success = gdk_pixbuf_loader_close (loader, NULL) && success && psd.scale;
+
+	pixbuf = success ? gdk_pixbuf_loader_get_pixbuf (loader) : NULL;
+
+	if (pixbuf) {
+		if (gdk_pixbuf_get_has_alpha (pixbuf)) {
+			success = gdk_pixbuf_save_to_buffer (
+				pixbuf, &buffer, &length, "png", NULL, NULL);
+			*out_mime_type = g_strdup ("image/png");
+		} else {
+			success = gdk_pixbuf_save_to_buffer (
+				pixbuf, &buffer, &length, "jpeg", NULL,
+				"quality", "90", NULL);
+			*out_mime_type = g_strdup ("image/jpeg");
+		}
+	}
+
+	g_object_unref (loader);
+
+	if (!pixbuf || !success) {
+		g_clear_pointer (out_mime_type, g_free);
+		g_free (buffer);
+		return NULL;
+	}
+
+	/* Takes ownership of the buffer. */
+	return g_bytes_new_take (buffer, length);
+}
+
 static gboolean
 mail_request_process_mail_sync (EContentRequest *request,
 				SoupURI *suri,
@@ -245,6 +437,11 @@ mail_request_process_mail_sync (EContentRequest *request,
 
 		part_converted_to_utf8 = e_mail_part_get_converted_to_utf8 (part);
 
+		/* Raw images are served as themselves, not as HTML. */
+		if (context.mode == E_MAIL_FORMATTER_MODE_RAW && mime_type &&
+		    g_ascii_strncasecmp (mime_type, "image/", 6) == 0)
+			use_mime_type = g_strdup (mime_type);
+
 		g_object_unref (part);
 
 	} else {
@@ -371,6 +568,122 @@ mail_request_process_contact_photo_sync (EContentRequest *request,
 	return TRUE;
 }
 
+/* Decodes a raw image part in the calling thread, without the formatter,
+ * and downscales it to the preview_width, when the mail display asked for
+ * it. Returns %FALSE when the @suri does not reference such an image. */
+static gboolean
+mail_request_process_image_sync (SoupURI *suri,
+				 GHashTable *uri_query,
+				 const gchar *uri,
+				 GInputStream **out_stream,
+				 gint64 *out_stream_length,
+				 gchar **out_mime_type,
+				 GCancellable *cancellable)
+{
+	CamelObjectBag *registry;
+	CamelDataWrapper *dw = NULL;
+	CamelMimePart *mime_part;
+	EMailPartList *part_list;
+	EMailPart *part = NULL;
+	GOutputStream *output_stream;
+	GBytes *bytes, *preview = NULL;
+	const gchar *val;
+	gchar *tmp, *mime_type = NULL;
+	gint preview_width = 0;
+
+	if (!uri_query || g_hash_table_contains (uri_query, "attachment_icon"))
+		return FALSE;
+
+	val = g_hash_table_lookup (uri_query, "mode");
+	if (!val || atoi (val) != E_MAIL_FORMATTER_MODE_RAW)
+		return FALSE;
+
+	val = g_hash_table_lookup (uri_query, "part_id");
+	if (!val)
+		return FALSE;
+
+	tmp = g_strdup_printf ("%s://%s%s", suri->scheme, suri->host, suri->path);
+
+	registry = e_mail_part_list_get_registry ();
+	part_list = camel_object_bag_get (registry, tmp);
+
+	g_free (tmp);
+
+	if (part_list) {
+		tmp = soup_uri_decode (val);
+		part = e_mail_part_list_ref_part (part_list, tmp);
+		g_free (tmp);
+
+		g_object_unref (part_list);
+	}
+
+	if (!part)
+		return FALSE;
+
+	val = g_hash_table_lookup (uri_query, "mime_type");
+	if (!val)
+		val = e_mail_part_get_mime_type (part);
+
+	/* Animations, vector and TIFF images are left to the formatter. */
+	if (val && g_ascii_strncasecmp (val, "image/", 6) == 0 &&
+	    g_ascii_strcasecmp (val, "image/gif") != 0 &&
+	    g_ascii_strncasecmp (val, "image/svg", 9) != 0 &&
+	    g_ascii_strncasecmp (val, "image/tif", 9) != 0)
+		mime_type = g_strdup (val);
+
+	mime_part = mime_type ? e_mail_part_ref_mime_part (part) : NULL;
+	if (mime_part)
+		dw = camel_medium_get_content (CAMEL_MEDIUM (mime_part));
+
+	g_object_unref (part);
+
+	if (!dw) {
+		g_clear_object (&mime_part);
+		g_free (mime_type);
+		return FALSE;
+	}
+
+	output_stream = g_memory_output_stream_new_resizable ();
+	camel_data_wrapper_decode_to_output_stream_sync (
+		dw, output_stream, cancellable, NULL);
+	g_output_stream_close (output_stream, NULL, NULL);
+
+	bytes = g_memory_output_stream_steal_as_bytes (
+		G_MEMORY_OUTPUT_STREAM (output_stream));
+
+	g_object_unref (output_stream);
+	g_object_unref (mime_part);
+
+	val = g_hash_table_lookup (uri_query, "preview_width");
+	if (val)
+		preview_width = atoi (val);
+
+	if (preview_width > 0) {
+		gchar *preview_mime_type = NULL;
+
+		preview = mail_request_create_preview (
+			bytes, preview_width, &preview_mime_type, cancellable);
+
+		if (preview) {
+			mail_request_preview_cache_add (uri, preview, preview_mime_type);
+
+			g_bytes_unref (bytes);
+			bytes = preview;
+
+			g_free (mime_type);
+			mime_type = preview_mime_type;
+		}
+	}
+
+	*out_stream = g_memory_input_stream_new_from_bytes (bytes);
+	*out_stream_length = g_bytes_get_size (bytes);
+	*out_mime_type = mime_type;
+
+	g_bytes_unref (bytes);
+
+	return TRUE;
+}
+
 typedef struct _MailIdleData
 {
 	EContentRequest *request;
@@ -439,6 +752,12 @@ e_mail_request_process_sync (EContentRequest *request,
 	if (g_strcmp0 (suri->host, "contact-photo") == 0) {
 		success = mail_request_process_contact_photo_sync (request, suri, uri_query, requester,
 			out_stream, out_stream_length, out_mime_type, cancellable, error);
+	} else if (uri_query && g_hash_table_contains (uri_query, "preview_width") &&
+		   mail_request_preview_cache_lookup (uri, out_stream, out_stream_length, out_mime_type)) {
+		success = TRUE;
+	} else if (mail_request_process_image_sync (suri, uri_query, uri,
+		   out_stream, out_stream_length, out_mime_type, cancellable)) {
+		success = TRUE;
 	} else {
 		MailIdleData mid;
 
@@ -36,9 +36,16 @@
 	((folder_info) != NULL && \
 	((folder_info)->flags & CAMEL_FOLDER_SUBSCRIBED) != 0)
 
+/* Length of the n-grams, in characters, in the folder name index. */
+#define INDEX_NGRAM_LENGTH 3
+
+/* Maximum number of search results shown in the list. */
+#define MAX_SEARCH_RESULTS 5000
+
 typedef struct _AsyncContext AsyncContext;
 typedef struct _TreeRowData TreeRowData;
 typedef struct _StoreData StoreData;
+typedef struct _FolderIndex FolderIndex;
 
 struct _EMSubscriptionEditorPrivate {
 	EMailSession *session;
@@ -46,6 +53,7 @@ struct _EMSubscriptionEditorPrivate {
 
 	GtkWidget *combo_box;		/* not referenced */
 	GtkWidget *entry;		/* not referenced */
+	GtkWidget *search_info_label;	/* not referenced */
 	GtkWidget *notebook;		/* not referenced */
 	GtkWidget *subscribe_button;	/* not referenced */
 	GtkWidget *subscribe_arrow;	/* not referenced */
@@ -78,6 +86,16 @@ struct _AsyncContext {
 	GQueue *tree_rows;
 };
 
+/* Substring index over casefolded folder full names.  Each n-gram
+ * maps to an ascending list of positions in the 'infos' array, thus
+ * a search verifies only the folders sharing its rarest n-gram,
+ * instead of testing every folder of the store. */
+struct _FolderIndex {
+	GPtrArray *infos;	/* CamelFolderInfo *, not referenced */
+	GPtrArray *casefolded;	/* gchar *, full names */
+	GHashTable *ngrams;	/* gchar * ~> GArray * of guint */
+};
+
 struct _StoreData {
 	CamelStore *store;
 	GtkTreeView *tree_view;
@@ -85,6 +103,7 @@ struct _StoreData {
 	GtkTreeModel *tree_store;
 	GCancellable *cancellable;
 	CamelFolderInfo *folder_info;
+	FolderIndex *index;		/* built on the first search */
 	gboolean filtered_view;
 	gboolean needs_refresh;
 };
@@ -105,6 +124,9 @@ enum {
 
 G_DEFINE_TYPE (EMSubscriptionEditor, em_subscription_editor, GTK_TYPE_DIALOG)
 
+/* Forward Declarations */
+static void	subscription_editor_update_view	(EMSubscriptionEditor *editor);
+
 static void
 tree_row_data_free (TreeRowData *tree_row_data)
 {
@@ -142,6 +164,143 @@ async_context_free (AsyncContext *context)
 	g_slice_free (AsyncContext, context);
 }
 
+static void
+folder_index_add_folders (FolderIndex *index,
+                          CamelFolderInfo *folder_info)
+{
+	while (folder_info != NULL) {
+		if (FOLDER_CAN_SELECT (folder_info) && folder_info->full_name && *folder_info->full_name) {
+			const gchar *ngram, *end;
+			gchar *casefolded;
+			guint pos, len;
+
+			casefolded = g_utf8_casefold (folder_info->full_name, -1);
+			pos = index->infos->len;
+
+			g_ptr_array_add (index->infos, folder_info);
+			g_ptr_array_add (index->casefolded, casefolded);
+
+			len = g_utf8_strlen (casefolded, -1);
+			ngram = casefolded;
+			end = g_utf8_offset_to_pointer (casefolded, MIN (len, INDEX_NGRAM_LENGTH));
+
+			while (len >= INDEX_NGRAM_LENGTH) {
+				GArray *positions;
+				gchar *key;
+
+				key = g_strndup (ngram, end - ngram);
+				positions = g_hash_table_lookup (index->ngrams, key);
+
+				if (positions == NULL) {
+					positions = g_array_new (FALSE, FALSE, sizeof (guint));
+					g_hash_table_insert (index->ngrams, key, positions);
+				} else {
+					g_free (key);
+				}
+
+				/* The same n-gram can repeat in one name. */
+				if (positions->len == 0 ||
+				    g_array_index (positions, guint, positions->len - 1) != pos)
+					g_array_append_val (positions, pos);
+
+				ngram = g_utf8_next_char (ngram);
+				end = g_utf8_next_char (end);
+				len--;
+			}
+		}
+
+		if (folder_info->child != NULL)
+			folder_index_add_folders (index, folder_info->child);
+
+		folder_info = folder_info->next;
+	}
+}
+
+static FolderIndex *
+folder_index_new (CamelFolderInfo *folder_info)
+{
+	FolderIndex *index;
+
+	index = g_slice_new0 (FolderIndex);
+	index->infos = g_ptr_array_new ();
+	index->casefolded = g_ptr_array_new_with_free_func (g_free);
+	index->ngrams = g_hash_table_new_full (
+		g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify) g_array_unref);
+
+	folder_index_add_folders (index, folder_info);
+
+	return index;
+}
+
+static void
+folder_index_free (FolderIndex *index)
+{
+	if (index == NULL)
+		return;
+
+	g_ptr_array_unref (index->infos);
+	g_ptr_array_unref (index->casefolded);
+	g_hash_table_destroy (index->ngrams);
+
+	g_slice_free (FolderIndex, index);
+}
+
+/* Returns positions in index->infos of folders containing the
+ * casefolded @needle, in the folder hierarchy order. */
+static GArray *
+folder_index_search (FolderIndex *index,
+                     const gchar *needle)
+{
+	GArray *matches;
+	GArray *candidates = NULL;
+	guint ii, n_candidates;
+
+	matches = g_array_new (FALSE, FALSE, sizeof (guint));
+
+	if (g_utf8_strlen (needle, -1) >= INDEX_NGRAM_LENGTH) {
+		const gchar *ngram, *end;
+
+		ngram = needle;
+		end = g_utf8_offset_to_pointer (needle, INDEX_NGRAM_LENGTH);
+
+		/* Pick the n-gram with the fewest folders; when any
+		 * of the n-grams is not indexed, nothing can match. */
+		while (ngram != NULL) {
+			GArray *positions;
+			gchar *key;
+
+			key = g_strndup (ngram, end - ngram);
+			positions = g_hash_table_lookup (index->ngrams, key);
+			g_free (key);
+
+			if (positions == NULL)
+				return matches;
+
+			if (candidates == NULL || positions->len < candidates->len)
+				candidates = positions;
+
+			if (!*end)
+				break;
+
+			ngram = g_utf8_next_char (ngram);
+			end = g_utf8_next_char (end);
+		}
+	}
+
+	n_candidates = candidates ? candidates->len : index->infos->len;
+
+	for (ii = 0; ii < n_candidates; ii++) {
+		guint pos = candidates ? g_array_index (candidates, guint, ii) : ii;
+		const gchar *casefolded = g_ptr_array_index (index->casefolded, pos);
+
+		if (strstr (casefolded, needle) != NULL)
+			g_array_append_val (matches, pos);
+	}
+
+	return matches;
+}
+
 static void
 store_data_free (StoreData *data)
 {
@@ -162,42 +321,60 @@ store_data_free (StoreData *data)
 		g_object_unref (data->cancellable);
 	}
 
+	folder_index_free (data->index);
 	camel_folder_info_free (data->folder_info);
 
 	g_slice_free (StoreData, data);
 }
 
+/* Collects folders, which have a subscribed folder in their subtree,
+ * into the @ancestors set; returns whether the @folder_info list has
+ * any subscribed folder. */
+static gboolean
+subscription_editor_collect_ancestors (CamelFolderInfo *folder_info,
+                                       GHashTable *ancestors)
+{
+	gboolean any_subscribed = FALSE;
+
+	while (folder_info != NULL) {
+		if (FOLDER_SUBSCRIBED (folder_info))
+			any_subscribed = TRUE;
+
+		if (folder_info->child != NULL &&
+		    subscription_editor_collect_ancestors (folder_info->child, ancestors)) {
+			g_hash_table_add (ancestors, folder_info);
+			any_subscribed = TRUE;
+		}
+
+		folder_info = folder_info->next;
+	}
+
+	return any_subscribed;
+}
+
+/* Adds the @folder_info list under the @parent row.  Only subtrees
+ * in the @ancestors set (can be NULL) are descended into, any other
+ * folder with children gets a placeholder row (with no folder info),
+ * which is replaced with the real children when the row is expanded,
+ * thus huge hierarchies do not need to be added to the model at once. */
 static void
 subscription_editor_populate (EMSubscriptionEditor *editor,
                               CamelFolderInfo *folder_info,
                               GtkTreeIter *parent,
+                              GHashTable *ancestors,
                               GList **expand_paths)
 {
-	GtkListStore *list_store;
 	GtkTreeStore *tree_store;
 
-	list_store = GTK_LIST_STORE (editor->priv->active->list_store);
 	tree_store = GTK_TREE_STORE (editor->priv->active->tree_store);
 
 	while (folder_info != NULL) {
 		GtkTreeIter iter;
 		const gchar *icon_name;
-		gchar *casefolded;
 
 		icon_name =
 			em_folder_utils_get_icon_name (folder_info->flags);
 
-		casefolded = g_utf8_casefold (folder_info->full_name, -1);
-
-		gtk_list_store_append (list_store, &iter);
-
-		gtk_list_store_set (
-			list_store, &iter,
-			COL_CASEFOLDED, casefolded,
-			COL_FOLDER_ICON, icon_name,
-			COL_FOLDER_NAME, folder_info->full_name,
-			COL_FOLDER_INFO, folder_info, -1);
-
 		gtk_tree_store_append (tree_store, &iter, parent);
 
 		gtk_tree_store_set (
@@ -207,7 +384,7 @@ subscription_editor_populate (EMSubscriptionEditor *editor,
 			COL_FOLDER_NAME, folder_info->display_name,
 			COL_FOLDER_INFO, folder_info, -1);
 
-		if (FOLDER_SUBSCRIBED (folder_info)) {
+		if (expand_paths != NULL && FOLDER_SUBSCRIBED (folder_info)) {
 			GtkTreePath *path;
 
 			path = gtk_tree_model_get_path (
@@ -215,17 +392,113 @@ subscription_editor_populate (EMSubscriptionEditor *editor,
 			*expand_paths = g_list_prepend (*expand_paths, path);
 		}
 
-		g_free (casefolded);
+		if (folder_info->child != NULL) {
+			if (ancestors != NULL && g_hash_table_contains (ancestors, folder_info)) {
+				subscription_editor_populate (
+					editor, folder_info->child,
+					&iter, ancestors, expand_paths);
+			} else {
+				GtkTreeIter placeholder;
 
-		if (folder_info->child != NULL)
-			subscription_editor_populate (
-				editor, folder_info->child,
-				&iter, expand_paths);
+				gtk_tree_store_append (tree_store, &placeholder, &iter);
+			}
+		}
 
 		folder_info = folder_info->next;
 	}
 }
 
+/* Replaces the placeholder child of the @parent row with the real
+ * children; with @recursive set it does the same for the whole
+ * subtree, or the whole tree, when the @parent is NULL. */
+static void
+subscription_editor_populate_children (EMSubscriptionEditor *editor,
+                                       GtkTreeIter *parent,
+                                       gboolean recursive)
+{
+	GtkTreeModel *tree_model;
+	GtkTreeIter child;
+	CamelFolderInfo *folder_info = NULL;
+
+	tree_model = editor->priv->active->tree_store;
+
+	if (!gtk_tree_model_iter_children (tree_model, &child, parent))
+		return;
+
+	gtk_tree_model_get (tree_model, &child, COL_FOLDER_INFO, &folder_info, -1);
+
+	if (folder_info == NULL && parent != NULL) {
+		CamelFolderInfo *parent_info = NULL;
+
+		gtk_tree_model_get (tree_model, parent, COL_FOLDER_INFO, &parent_info, -1);
+		g_return_if_fail (parent_info != NULL);
+
+		/* Add the children first, to not have the parent row
+		 * without children, which would collapse it. */
+		subscription_editor_populate (
+			editor, parent_info->child, parent, NULL, NULL);
+		gtk_tree_store_remove (GTK_TREE_STORE (tree_model), &child);
+
+		if (!recursive || !gtk_tree_model_iter_children (tree_model, &child, parent))
+			return;
+	} else if (!recursive) {
+		return;
+	}
+
+	do {
+		if (gtk_tree_model_iter_has_child (tree_model, &child))
+			subscription_editor_populate_children (editor, &child, TRUE);
+	} while (gtk_tree_model_iter_next (tree_model, &child));
+}
+
+static gboolean
+subscription_editor_test_expand_row_cb (GtkTreeView *tree_view,
+                                        GtkTreeIter *iter,
+                                        GtkTreePath *path,
+                                        EMSubscriptionEditor *editor)
+{
+	/* The search results are not hierarchical. */
+	if (editor->priv->active->filtered_view)
+		return FALSE;
+
+	subscription_editor_populate_children (editor, iter, FALSE);
+
+	/* Allow the expansion. */
+	return FALSE;
+}
+
+/* GtkTreeView emits "test-expand-row" only for the cursor row when
+ * expanding it with all its descendants from the keyboard, thus
+ * populate its whole subtree before the default handler expands it. */
+static gboolean
+subscription_editor_expand_collapse_cursor_row_cb (GtkTreeView *tree_view,
+                                                   gboolean logical,
+                                                   gboolean expand,
+                                                   gboolean open_all,
+                                                   EMSubscriptionEditor *editor)
+{
+	GtkTreePath *path = NULL;
+	GtkTreeIter iter;
+
+	if (editor->priv->active->filtered_view || !open_all)
+		return FALSE;
+
+	if (logical && gtk_widget_get_direction (GTK_WIDGET (tree_view)) == GTK_TEXT_DIR_RTL)
+		expand = !expand;
+
+	if (!expand)
+		return FALSE;
+
+	gtk_tree_view_get_cursor (tree_view, &path, NULL);
+
+	if (path && gtk_tree_model_get_iter (editor->priv->active->tree_store, &iter, path))
+		subscription_editor_populate_children (editor, &iter, TRUE);
+
+	gtk_tree_path_free (path);
+
+	return FALSE;
+}
+
 static void
 expand_paths_cb (gpointer path,
                  gpointer tree_view)
@@ -246,6 +519,7 @@ subscription_editor_get_folder_info_done (CamelStore *store,
 	GtkTreeSelection *selection;
 	CamelFolderInfo *folder_info;
 	GdkWindow *window;
+	GHashTable *ancestors;
 	GList *expand_paths = NULL;
 	GError *error = NULL;
 
@@ -276,9 +550,6 @@ subscription_editor_get_folder_info_done (CamelStore *store,
 
 	g_return_if_fail (folder_info != NULL);
 
-	camel_folder_info_free (editor->priv->active->folder_info);
-	editor->priv->active->folder_info = folder_info;
-
 	tree_view = editor->priv->active->tree_view;
 	list_store = editor->priv->active->list_store;
 	tree_store = editor->priv->active->tree_store;
@@ -286,11 +557,30 @@ subscription_editor_get_folder_info_done (CamelStore *store,
 	gtk_list_store_clear (GTK_LIST_STORE (list_store));
 	gtk_tree_store_clear (GTK_TREE_STORE (tree_store));
 
+	/* The index points into the old folder info. */
+	folder_index_free (editor->priv->active->index);
+	editor->priv->active->index = NULL;
+
+	camel_folder_info_free (editor->priv->active->folder_info);
+	editor->priv->active->folder_info = folder_info;
+
+	/* Only subtrees with subscribed folders are populated right
+	 * away, because those are expanded; the rest is populated
+	 * on demand, when the user expands the rows. */
+	ancestors = g_hash_table_new (g_direct_hash, g_direct_equal);
+	subscription_editor_collect_ancestors (folder_info, ancestors);
+
 	model = gtk_tree_view_get_model (tree_view);
 	gtk_tree_view_set_model (tree_view, NULL);
-	subscription_editor_populate (editor, folder_info, NULL, &expand_paths);
+	subscription_editor_populate (editor, folder_info, NULL, ancestors, &expand_paths);
 	gtk_tree_view_set_model (tree_view, model);
 
+	g_hash_table_destroy (ancestors);
+
+	/* Refresh search results, if any. */
+	if (editor->priv->active->filtered_view)
+		subscription_editor_update_view (editor);
+
 	g_list_foreach (expand_paths, expand_paths_cb, tree_view);
 	g_list_foreach (expand_paths, (GFunc) gtk_tree_path_free, NULL);
 	g_list_free (expand_paths);
@@ -306,16 +596,37 @@ exit:
 	g_object_unref (editor);
 }
 
+static void
+subscription_editor_tree_row_changed (EMSubscriptionEditor *editor,
+                                      TreeRowData *tree_row_data)
+{
+	GtkTreeModel *tree_model;
+	GtkTreePath *path = NULL;
+	GtkTreeIter iter;
+
+	if (tree_row_data->reference != NULL)
+		path = gtk_tree_row_reference_get_path (tree_row_data->reference);
+
+	/* The row can be gone from the search results or not populated
+	 * in the tree yet, then just make sure the view is up to date. */
+	if (path == NULL) {
+		gtk_widget_queue_draw (GTK_WIDGET (editor->priv->active->tree_view));
+		return;
+	}
+
+	tree_model = gtk_tree_row_reference_get_model (tree_row_data->reference);
+	if (gtk_tree_model_get_iter (tree_model, &iter, path))
+		gtk_tree_model_row_changed (tree_model, path, &iter);
+	gtk_tree_path_free (path);
+}
+
 static void
 subscription_editor_subscribe_folder_done (CamelSubscribable *subscribable,
                                            GAsyncResult *result,
                                            AsyncContext *context)
 {
 	GtkTreeView *tree_view;
-	GtkTreeModel *tree_model;
 	GtkTreeSelection *selection;
-	GtkTreePath *path;
-	GtkTreeIter iter;
 	GdkWindow *window;
 	GError *error = NULL;
 	TreeRowData *tree_row_data;
@@ -344,11 +655,7 @@ subscription_editor_subscribe_folder_done (CamelSubscribable *subscribable,
 	}
 
 	/* Update the toggle renderer in the selected row. */
-	tree_model = gtk_tree_row_reference_get_model (tree_row_data->reference);
-	path = gtk_tree_row_reference_get_path (tree_row_data->reference);
-	gtk_tree_model_get_iter (tree_model, &iter, path);
-	gtk_tree_model_row_changed (tree_model, path, &iter);
-	gtk_tree_path_free (path);
+	subscription_editor_tree_row_changed (context->editor, tree_row_data);
 
 	tree_row_data_free (tree_row_data);
 
@@ -442,10 +749,7 @@ subscription_editor_unsubscribe_folder_done (CamelSubscribable *subscribable,
                                              AsyncContext *context)
 {
 	GtkTreeView *tree_view;
-	GtkTreeModel *tree_model;
 	GtkTreeSelection *selection;
-	GtkTreePath *path;
-	GtkTreeIter iter;
 	GdkWindow *window;
 	GError *error = NULL;
 	TreeRowData *tree_row_data;
@@ -474,11 +778,7 @@ subscription_editor_unsubscribe_folder_done (CamelSubscribable *subscribable,
 	}
 
 	/* Update the toggle renderer in the selected row. */
-	tree_model = gtk_tree_row_reference_get_model (tree_row_data->reference);
-	path = gtk_tree_row_reference_get_path (tree_row_data->reference);
-	gtk_tree_model_get_iter (tree_model, &iter, path);
-	gtk_tree_model_row_changed (tree_model, path, &iter);
-	gtk_tree_path_free (path);
+	subscription_editor_tree_row_changed (context->editor, tree_row_data);
 
 	tree_row_data_free (tree_row_data);
 
@@ -665,6 +965,34 @@ pick_all_cb (GtkTreeModel *model,
 	return FALSE;
 }
 
+static void
+pick_all_folder_infos (CamelFolderInfo *folder_info,
+                       struct PickAllData *data)
+{
+	while (folder_info != NULL) {
+		if (can_pick_folder_info (folder_info, data->mode) &&
+		    (data->skip_folder_infos == NULL ||
+		    !g_hash_table_contains (
+				data->skip_folder_infos,
+				folder_info))) {
+			TreeRowData *tree_row_data;
+
+			/* The row can be not populated yet, thus
+			 * do not reference it; the whole view is
+			 * redrawn after the change instead. */
+			tree_row_data = g_slice_new0 (TreeRowData);
+			tree_row_data->folder_info = folder_info;
+
+			g_queue_push_tail (data->out_tree_rows, tree_row_data);
+		}
+
+		if (folder_info->child != NULL)
+			pick_all_folder_infos (folder_info->child, data);
+
+		folder_info = folder_info->next;
+	}
+}
+
 /* skip_folder_infos contains CamelFolderInfo-s to skip;
  * these should come from the tree view; can be NULL
  * to include everything.
@@ -687,7 +1015,13 @@ subscription_editor_pick_all (EMSubscriptionEditor *editor,
 	data.skip_folder_infos = skip_folder_infos;
 	data.out_tree_rows = out_tree_rows;
 
-	gtk_tree_model_foreach (tree_model, pick_all_cb, &data);
+	/* The tree is populated lazily, thus walk the folder
+	 * hierarchy instead, but the search results are "all"
+	 * the rows of the list store. */
+	if (editor->priv->active->filtered_view)
+		gtk_tree_model_foreach (tree_model, pick_all_cb, &data);
+	else
+		pick_all_folder_infos (editor->priv->active->folder_info, &data);
 }
 
 static void
@@ -978,7 +1312,21 @@ subscription_editor_collapse_all (EMSubscriptionEditor *editor)
 static void
 subscription_editor_expand_all (EMSubscriptionEditor *editor)
 {
-	gtk_tree_view_expand_all (editor->priv->active->tree_view);
+	GtkTreeView *tree_view;
+	GtkTreeModel *model;
+
+	tree_view = editor->priv->active->tree_view;
+
+	/* GtkTreeView does not emit "test-expand-row" for the descendants
+	 * when expanding all, thus populate the whole tree beforehand. */
+	model = gtk_tree_view_get_model (tree_view);
+	g_object_ref (model);
+	gtk_tree_view_set_model (tree_view, NULL);
+	subscription_editor_populate_children (editor, NULL, TRUE);
+	gtk_tree_view_set_model (tree_view, model);
+	g_object_unref (model);
+
+	gtk_tree_view_expand_all (tree_view);
 }
 
 static void
@@ -1040,31 +1388,49 @@ subscription_editor_stop (EMSubscriptionEditor *editor)
 	gdk_window_set_cursor (window, NULL);
 }
 
-static gboolean
-subscription_editor_filter_cb (GtkTreeModel *tree_model,
-                               GtkTreeIter *iter,
-                               EMSubscriptionEditor *editor)
+/* Replaces content of the list store with folders matching the search
+ * string, as found by the index; limited to MAX_SEARCH_RESULTS.  Returns
+ * how many folders match, which can be more than the list store holds. */
+static guint
+subscription_editor_fill_search_results (EMSubscriptionEditor *editor)
 {
-	CamelFolderInfo *folder_info;
-	gchar *casefolded;
-	gboolean match;
+	StoreData *data = editor->priv->active;
+	GtkListStore *list_store;
+	GArray *matches;
+	guint ii, n_matches;
 
-	/* If there's no search string let everything through. */
-	if (editor->priv->search_string == NULL)
-		return TRUE;
+	list_store = GTK_LIST_STORE (data->list_store);
+	gtk_list_store_clear (list_store);
 
-	gtk_tree_model_get (
-		tree_model, iter,
-		COL_CASEFOLDED, &casefolded,
-		COL_FOLDER_INFO, &folder_info, -1);
+	if (data->folder_info == NULL)
+		return 0;
+
+	if (data->index == NULL)
+		data->index = folder_index_new (data->folder_info);
 
-	match = FOLDER_CAN_SELECT (folder_info) &&
-		(casefolded != NULL) && (*casefolded != '\0') &&
-		(strstr (casefolded, editor->priv->search_string) != NULL);
+	matches = folder_index_search (data->index, editor->priv->search_string);
+
+	for (ii = 0; ii < matches->len && ii < MAX_SEARCH_RESULTS; ii++) {
+		CamelFolderInfo *folder_info;
+		GtkTreeIter iter;
+		guint pos;
 
-	g_free (casefolded);
+		pos = g_array_index (matches, guint, ii);
+		folder_info = g_ptr_array_index (data->index->infos, pos);
 
-	return match;
+		gtk_list_store_insert_with_values (
+			list_store, &iter, -1,
+			COL_CASEFOLDED, g_ptr_array_index (data->index->casefolded, pos),
+			COL_FOLDER_ICON, em_folder_utils_get_icon_name (folder_info->flags),
+			COL_FOLDER_NAME, folder_info->full_name,
+			COL_FOLDER_INFO, folder_info, -1);
+	}
+
+	n_matches = matches->len;
+
+	g_array_unref (matches);
+
+	return n_matches;
 }
 
 static void
@@ -1083,35 +1449,41 @@ subscription_editor_update_view (EMSubscriptionEditor *editor)
 	text = gtk_entry_get_text (entry);
 
 	if (text != NULL && *text != '\0') {
+		GtkTreeSelection *selection;
+		GtkTreePath *path;
+		guint n_matches;
+
 		g_free (editor->priv->search_string);
 		editor->priv->search_string = g_utf8_casefold (text, -1);
 
-		/* Install the list store in the tree view if needed. */
-		if (!editor->priv->active->filtered_view) {
-			GtkTreeSelection *selection;
-			GtkTreePath *path;
-
-			tree_model = gtk_tree_model_filter_new (
-				editor->priv->active->list_store, NULL);
-			gtk_tree_model_filter_set_visible_func (
-				GTK_TREE_MODEL_FILTER (tree_model),
-				(GtkTreeModelFilterVisibleFunc)
-				subscription_editor_filter_cb, editor,
-				(GDestroyNotify) NULL);
-			gtk_tree_view_set_model (tree_view, tree_model);
-			g_object_unref (tree_model);
-
-			path = gtk_tree_path_new_first ();
-			selection = gtk_tree_view_get_selection (tree_view);
-			gtk_tree_selection_select_path (selection, path);
-			gtk_tree_path_free (path);
-
-			editor->priv->active->filtered_view = TRUE;
+		/* Fill the list store with the view detached,
+		 * then install it in the tree view. */
+		tree_model = editor->priv->active->list_store;
+		gtk_tree_view_set_model (tree_view, NULL);
+		n_matches = subscription_editor_fill_search_results (editor);
+		gtk_tree_view_set_model (tree_view, tree_model);
+
+		if (n_matches > MAX_SEARCH_RESULTS) {
+			gchar *info;
+
+			info = g_strdup_printf (
+				ngettext (
+				"Showing only the first %u of %u matching folder, refine the search to see the rest.",
+				"Showing only the first %u of %u matching folders, refine the search to see the rest.",
+				n_matches), (guint) MAX_SEARCH_RESULTS, n_matches);
+			gtk_label_set_text (GTK_LABEL (editor->priv->search_info_label), info);
+			gtk_widget_show (editor->priv->search_info_label);
+			g_free (info);
+		} else {
+			gtk_widget_hide (editor->priv->search_info_label);
 		}
 
-		tree_model = gtk_tree_view_get_model (tree_view);
-		gtk_tree_model_filter_refilter (
-			GTK_TREE_MODEL_FILTER (tree_model));
+		path = gtk_tree_path_new_first ();
+		selection = gtk_tree_view_get_selection (tree_view);
+		gtk_tree_selection_select_path (selection, path);
+		gtk_tree_path_free (path);
+
+		editor->priv->active->filtered_view = TRUE;
 
 		gtk_entry_set_icon_sensitive (
 			entry, GTK_ENTRY_ICON_SECONDARY, TRUE);
@@ -1130,6 +1502,8 @@ subscription_editor_update_view (EMSubscriptionEditor *editor)
 			tree_model = editor->priv->active->tree_store;
 			gtk_tree_view_set_model (tree_view, tree_model);
 
+			gtk_list_store_clear (GTK_LIST_STORE (editor->priv->active->list_store));
+
 			path = gtk_tree_path_new_first ();
 			selection = gtk_tree_view_get_selection (tree_view);
 			gtk_tree_selection_select_path (selection, path);
@@ -1141,6 +1515,8 @@ subscription_editor_update_view (EMSubscriptionEditor *editor)
 		gtk_entry_set_icon_sensitive (
 			entry, GTK_ENTRY_ICON_SECONDARY, FALSE);
 
+		gtk_widget_hide (editor->priv->search_info_label);
+
 		gtk_widget_set_sensitive (
 			editor->priv->collapse_all_button, TRUE);
 		gtk_widget_set_sensitive (
@@ -1399,6 +1775,14 @@ subscription_editor_add_store (EMSubscriptionEditor *editor,
 		renderer, "toggled",
 		G_CALLBACK (subscription_editor_renderer_toggled_cb), editor);
 
+	g_signal_connect (
+		widget, "test-expand-row",
+		G_CALLBACK (subscription_editor_test_expand_row_cb), editor);
+
+	g_signal_connect (
+		widget, "expand-collapse-cursor-row",
+		G_CALLBACK (subscription_editor_expand_collapse_cursor_row_cb), editor);
+
 	column = gtk_tree_view_column_new ();
 	gtk_tree_view_append_column (GTK_TREE_VIEW (widget), column);
 	gtk_tree_view_set_expander_column (GTK_TREE_VIEW (widget), column);
@@ -1796,7 +2180,13 @@ em_subscription_editor_init (EMSubscriptionEditor *editor)
 	gtk_grid_attach (GTK_GRID (container), widget, 0, 1, 1, 1);
 	gtk_widget_show (widget);
 
-	container = box;
+	/* Shown when the search results are capped. */
+	widget = gtk_label_new (NULL);
+	gtk_label_set_line_wrap (GTK_LABEL (widget), TRUE);
+	gtk_misc_set_alignment (GTK_MISC (widget), 0.0, 0.5);
+	gtk_grid_attach (GTK_GRID (container), widget, 1, 2, 1, 1);
+	editor->priv->search_info_label = widget;
+	gtk_widget_set_no_show_all (widget, TRUE);
 
 	widget = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
 	gtk_box_pack_start (GTK_BOX (container), widget, TRUE, TRUE, 0);
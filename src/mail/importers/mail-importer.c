@@ -265,28 +265,356 @@ import_mbox_free (struct _import_mbox_msg *m)
 	g_free (m->path);
 }
 
+struct _MailImporterCheckpoint {
+	gchar *group;
+	gchar *source_path;
+	gchar *destination_uri;
+	gint64 source_size;
+	gint64 source_mtime;
+	guint64 position;
+	gchar *marker;
+	guint64 n_uncommitted;
+};
+
+/* Checkpoints of imports not continued for this long are dropped */
+#define CHECKPOINT_MAX_AGE (30 * 24 * 60 * 60)
+
+/* Guards the checkpoints file, more imports can run at once */
+static GMutex checkpoints_lock;
+
+static gchar *
+mail_importer_checkpoints_filename (void)
+{
+	return g_build_filename (mail_session_get_data_dir (), "import-checkpoints.ini", NULL);
+}
+
+static GKeyFile *
+mail_importer_checkpoints_read (void)
+{
+	GKeyFile *key_file;
+	gchar *filename;
+
+	filename = mail_importer_checkpoints_filename ();
+	key_file = g_key_file_new ();
+
+	/* The file does not exist when nothing was interrupted */
+	g_key_file_load_from_file (key_file, filename, G_KEY_FILE_NONE, NULL);
+
+	g_free (filename);
+
+	return key_file;
+}
+
+static void
+mail_importer_checkpoints_write (GKeyFile *key_file)
+{
+	gchar *filename, *contents;
+	gsize length = 0;
+	GError *error = NULL;
+
+	filename = mail_importer_checkpoints_filename ();
+	contents = g_key_file_to_data (key_file, &length, NULL);
+
+	if (!g_file_set_contents (filename, contents, length, &error)) {
+		g_warning ("%s: Failed to write '%s': %s", G_STRFUNC, filename, error ? error->message : "Unknown error");
+		g_clear_error (&error);
+	}
+
+	g_free (contents);
+	g_free (filename);
+}
+
+/**
+ * mail_importer_checkpoint_load:
+ * @source_path: a file or a directory being imported
+ * @destination_uri: (nullable): a folder URI the @source_path is imported to
+ * @destination: the folder opened for the @destination_uri
+ *
+ * Reads the checkpoint of a previous, interrupted import of the @source_path
+ * into the @destination_uri. When there is none, the source file changed
+ * since then, the checkpoint is too old or the @destination has fewer
+ * messages than when the checkpoint was committed, like when it had been
+ * deleted meanwhile, the import starts over and the position is zero.
+ * Free the returned structure with mail_importer_checkpoint_free().
+ *
+ * Returns: (transfer full): a new #MailImporterCheckpoint
+ **/
+MailImporterCheckpoint *
+mail_importer_checkpoint_load (const gchar *source_path,
+                               const gchar *destination_uri,
+                               CamelFolder *destination)
+{
+	MailImporterCheckpoint *checkpoint;
+	GKeyFile *key_file;
+	GStatBuf st;
+	gchar *key;
+	gchar **groups;
+	gint64 now;
+	gboolean changed = FALSE;
+	guint ii;
+
+	g_return_val_if_fail (source_path != NULL, NULL);
+
+	if (!destination_uri)
+		destination_uri = "";
+
+	checkpoint = g_slice_new0 (MailImporterCheckpoint);
+	checkpoint->source_path = g_strdup (source_path);
+	checkpoint->destination_uri = g_strdup (destination_uri);
+
+	key = g_strconcat (source_path, "\n", destination_uri, NULL);
+	checkpoint->group = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+	g_free (key);
+
+	/* Directories change with each stored message, thus
+	 * the size and the time are checked only for files. */
+	if (g_stat (source_path, &st) == 0 && S_ISREG (st.st_mode)) {
+		checkpoint->source_size = st.st_size;
+		checkpoint->source_mtime = st.st_mtime;
+	}
+
+	now = g_get_real_time () / G_USEC_PER_SEC;
+
+	g_mutex_lock (&checkpoints_lock);
+
+	key_file = mail_importer_checkpoints_read ();
+
+	if (g_key_file_has_group (key_file, checkpoint->group) &&
+	    g_key_file_get_int64 (key_file, checkpoint->group, "SourceSize", NULL) == checkpoint->source_size &&
+	    g_key_file_get_int64 (key_file, checkpoint->group, "SourceMtime", NULL) == checkpoint->source_mtime &&
+	    g_key_file_get_int64 (key_file, checkpoint->group, "Time", NULL) + CHECKPOINT_MAX_AGE > now) {
+		guint64 committed_count, count;
+
+		committed_count = g_key_file_get_uint64 (key_file, checkpoint->group, "DestinationCount", NULL);
+		count = destination ? camel_folder_get_total_message_count (destination) : 0;
+
+		/* Messages stored after the last commit are in the destination
+		 * already; fewer messages mean it is not the same destination. */
+		if (count >= committed_count) {
+			checkpoint->position = g_key_file_get_uint64 (key_file, checkpoint->group, "Position", NULL);
+			checkpoint->marker = g_key_file_get_string (key_file, checkpoint->group, "Marker", NULL);
+			checkpoint->n_uncommitted = count - committed_count;
+		}
+	}
+
+	/* Forget this checkpoint, when it cannot be used, and also
+	 * the checkpoints of imports not continued for too long */
+	groups = g_key_file_get_groups (key_file, NULL);
+
+	for (ii = 0; groups && groups[ii]; ii++) {
+		if ((checkpoint->position == 0 && g_strcmp0 (groups[ii], checkpoint->group) == 0) ||
+		    g_key_file_get_int64 (key_file, groups[ii], "Time", NULL) + CHECKPOINT_MAX_AGE <= now) {
+			g_key_file_remove_group (key_file, groups[ii], NULL);
+			changed = TRUE;
+		}
+	}
+
+	g_strfreev (groups);
+
+	if (changed)
+		mail_importer_checkpoints_write (key_file);
+
+	g_key_file_free (key_file);
+
+	g_mutex_unlock (&checkpoints_lock);
+
+	return checkpoint;
+}
+
+void
+mail_importer_checkpoint_free (MailImporterCheckpoint *checkpoint)
+{
+	if (checkpoint) {
+		g_free (checkpoint->group);
+		g_free (checkpoint->source_path);
+		g_free (checkpoint->destination_uri);
+		g_free (checkpoint->marker);
+		g_slice_free (MailImporterCheckpoint, checkpoint);
+	}
+}
+
+/* Where to continue; meaning of it is up to the importer. */
+guint64
+mail_importer_checkpoint_get_position (MailImporterCheckpoint *checkpoint)
+{
+	g_return_val_if_fail (checkpoint != NULL, 0);
+
+	return checkpoint->position;
+}
+
+/* How many messages were stored after the checkpoint had been committed;
+ * the importer skips that many more messages it would store. */
+guint64
+mail_importer_checkpoint_get_n_uncommitted (MailImporterCheckpoint *checkpoint)
+{
+	g_return_val_if_fail (checkpoint != NULL, 0);
+
+	return checkpoint->n_uncommitted;
+}
+
+/* An importer-defined string, which can help to verify the position. */
+const gchar *
+mail_importer_checkpoint_get_marker (MailImporterCheckpoint *checkpoint)
+{
+	g_return_val_if_fail (checkpoint != NULL, NULL);
+
+	return checkpoint->marker;
+}
+
+/**
+ * mail_importer_checkpoint_commit:
+ * @checkpoint: a #MailImporterCheckpoint
+ * @destination: the folder the messages are stored to
+ * @position: where to continue the import
+ * @marker: (nullable): an optional string to verify the @position with
+ *
+ * Stores the @checkpoint, together with the count of messages in the
+ * @destination. Call it only after everything before the @position had
+ * been saved to the disk.
+ **/
+void
+mail_importer_checkpoint_commit (MailImporterCheckpoint *checkpoint,
+                                 CamelFolder *destination,
+                                 guint64 position,
+                                 const gchar *marker)
+{
+	GKeyFile *key_file;
+
+	g_return_if_fail (checkpoint != NULL);
+	g_return_if_fail (CAMEL_IS_FOLDER (destination));
+
+	checkpoint->position = position;
+
+	if (g_strcmp0 (checkpoint->marker, marker) != 0) {
+		g_free (checkpoint->marker);
+		checkpoint->marker = g_strdup (marker);
+	}
+
+	g_mutex_lock (&checkpoints_lock);
+
+	key_file = mail_importer_checkpoints_read ();
+
+	g_key_file_set_string (key_file, checkpoint->group, "Source", checkpoint->source_path);
+	g_key_file_set_string (key_file, checkpoint->group, "Destination", checkpoint->destination_uri);
+	g_key_file_set_int64 (key_file, checkpoint->group, "SourceSize", checkpoint->source_size);
+	g_key_file_set_int64 (key_file, checkpoint->group, "SourceMtime", checkpoint->source_mtime);
+	g_key_file_set_uint64 (key_file, checkpoint->group, "Position", position);
+	g_key_file_set_uint64 (key_file, checkpoint->group, "DestinationCount", camel_folder_get_total_message_count (destination));
+	g_key_file_set_int64 (key_file, checkpoint->group, "Time", g_get_real_time () / G_USEC_PER_SEC);
+
+	if (marker)
+		g_key_file_set_string (key_file, checkpoint->group, "Marker", marker);
+	else
+		g_key_file_remove_key (key_file, checkpoint->group, "Marker", NULL);
+
+	mail_importer_checkpoints_write (key_file);
+
+	g_key_file_free (key_file);
+
+	g_mutex_unlock (&checkpoints_lock);
+}
+
+/* Forgets the checkpoint, when the whole source had been imported. */
+void
+mail_importer_checkpoint_finish (MailImporterCheckpoint *checkpoint)
+{
+	GKeyFile *key_file;
+
+	g_return_if_fail (checkpoint != NULL);
+
+	checkpoint->position = 0;
+	g_clear_pointer (&checkpoint->marker, g_free);
+
+	g_mutex_lock (&checkpoints_lock);
+
+	key_file = mail_importer_checkpoints_read ();
+
+	if (g_key_file_remove_group (key_file, checkpoint->group, NULL))
+		mail_importer_checkpoints_write (key_file);
+
+	g_key_file_free (key_file);
+
+	g_mutex_unlock (&checkpoints_lock);
+}
+
+static gint
+import_kmail_compare_names (gconstpointer ptr1,
+                            gconstpointer ptr2)
+{
+	return strcmp (*((const gchar **) ptr1), *((const gchar **) ptr2));
+}
+
+/* Returns "subdir/filename" of all messages in the maildir at @k_path,
+ * in a stable order, thus an interrupted import can continue. */
+static GPtrArray *
+import_kmail_list_messages (const gchar *k_path)
+{
+	const gchar *special_folders []= {"cur", "tmp", "new", NULL};
+	GPtrArray *messages;
+	gint i;
+
+	messages = g_ptr_array_new_with_free_func (g_free);
+
+	for (i = 0; special_folders [i]; i++) {
+		gchar *special_path;
+		const gchar *d;
+		GPtrArray *names;
+		GDir *dir;
+		guint ii;
+
+		special_path = g_build_filename (k_path, special_folders[i], NULL);
+		dir = g_dir_open (special_path, 0, NULL);
+		g_free (special_path);
+
+		if (!dir)
+			continue;
+
+		names = g_ptr_array_new ();
+
+		while ((d = g_dir_read_name (dir))) {
+			if ((strcmp (d, ".") == 0) || (strcmp (d, "..") == 0)) {
+				continue;
+			}
+			g_ptr_array_add (names, g_build_filename (special_folders[i], d, NULL));
+		}
+
+		g_dir_close (dir);
+
+		g_ptr_array_sort (names, import_kmail_compare_names);
+
+		for (ii = 0; ii < names->len; ii++)
+			g_ptr_array_add (messages, names->pdata[ii]);
+
+		g_ptr_array_free (names, TRUE);
+	}
+
+	return messages;
+}
+
 static void
 import_kmail_folder (struct _import_mbox_msg *m,
                      gchar *k_path_in,
                      GCancellable *cancellable,
                      GError **error)
 {
-	const gchar *special_folders []= {"cur", "tmp", "new", NULL};
-	gchar *special_path;
 	const CamelStore *store;
 	CamelFolder *folder;
 	CamelMimeParser *mp = NULL;
 	CamelMessageInfo *info;
 	CamelMimeMessage *msg;
-	guint32 flags = 0;
+	MailImporterCheckpoint *checkpoint;
+	GPtrArray *messages;
+	guint32 flags;
 
 	gchar *e_uri, *e_path;
 	gchar *k_path;
-	const gchar *d;
+	const gchar *marker;
 	gchar *mail_url;
-	GDir *dir;
 	struct stat st;
-	gint fd, i;
+	gint fd;
+	guint ii, first, n_batch = 0;
+	guint64 n_skip;
+	gboolean success;
 
 	e_uri = kuri_to_euri (k_path_in);
 	/* we need to drop some folders, like: Trash */
@@ -303,73 +631,127 @@ import_kmail_folder (struct _import_mbox_msg *m,
 			cancellable, NULL);
 
 	if (folder == NULL) {
+		g_free (e_uri);
 		g_free (k_path);
 		g_warning ("evolution error: cannot get the folder\n");
 		return;
 	}
 
-	camel_operation_push_message (
-			cancellable, _("Importing “%s”"),
-			camel_folder_get_display_name (folder));
-	camel_folder_freeze (folder);
+	messages = import_kmail_list_messages (k_path);
 
-	for (i = 0; special_folders [i]; i++) {
-		camel_operation_progress (cancellable, 100*i/3);
-		special_path = g_build_filename (k_path, special_folders[i], NULL);
-		dir = g_dir_open (special_path, 0, NULL);
-		while ((d = g_dir_read_name (dir))) {
-			if ((strcmp (d, ".") == 0) || (strcmp (d, "..") == 0)) {
-				continue;
-			}
-			mail_url = g_build_filename (special_path, d, NULL);
-			if (g_stat (mail_url, &st) == -1) {
-				g_free (mail_url);
-				continue;
-			}
-			if (S_ISREG (st.st_mode)) {
-				fd = g_open (mail_url, O_RDONLY | O_BINARY, 0);
-				g_free (mail_url);
-				if (fd == -1) {
-					continue;
-				}
-				mp = camel_mime_parser_new ();
-				camel_mime_parser_scan_from (mp, FALSE);
-				if (camel_mime_parser_init_with_fd (mp, fd) == -1) {
-					/* will never happen - 0 is unconditionally returned */
-					g_object_unref (mp);
-					continue;
-				}
-				msg = camel_mime_message_new ();
-				if (!camel_mime_part_construct_from_parser_sync (
-						(CamelMimePart *) msg, mp, NULL, NULL)) {
-					/* set exception? */
-					g_object_unref (mp);
-					g_object_unref (msg);
-					continue;
-				}
-				info = camel_message_info_new (NULL);
-				if (strcmp (special_folders[i], "cur") == 0) {
-					flags |= CAMEL_MESSAGE_SEEN;
-				} else if (strcmp (special_folders[i], "tmp") == 0) {
-					flags |= CAMEL_MESSAGE_DELETED; /* Mark the 'tmp' mails as 'deleted' */
-				}
-				camel_message_info_set_flags (info, flags, ~0);
-				camel_folder_append_message_sync (
-					folder, msg, info, NULL,
-					cancellable, error);
-				g_clear_object (&info);
-				g_object_unref (msg);
-				g_object_unref (mp);
-			} else {
-				g_free (mail_url);
+	/* Continue after the last stored message of an interrupted import */
+	checkpoint = mail_importer_checkpoint_load (k_path, e_uri, folder);
+	first = mail_importer_checkpoint_get_position (checkpoint);
+	marker = mail_importer_checkpoint_get_marker (checkpoint);
+	n_skip = mail_importer_checkpoint_get_n_uncommitted (checkpoint);
+
+	if (first > messages->len || (first > 0 && g_strcmp0 (marker, messages->pdata[first - 1]) != 0)) {
+		/* The maildir changed meanwhile, find the message by its name */
+		first = 0;
+
+		for (ii = 0; marker && ii < messages->len; ii++) {
+			if (g_strcmp0 (marker, messages->pdata[ii]) == 0) {
+				first = ii + 1;
+				break;
 			}
 		}
+
+		if (first == 0)
+			n_skip = 0;
+	}
+
+	if (first > 0 || n_skip > 0)
+		camel_operation_push_message (
+				cancellable, _("Continuing interrupted import of “%s”"),
+				camel_folder_get_display_name (folder));
+	else
+		camel_operation_push_message (
+				cancellable, _("Importing “%s”"),
+				camel_folder_get_display_name (folder));
+	camel_folder_freeze (folder);
+
+	for (ii = first; ii < messages->len && !g_cancellable_is_cancelled (cancellable); ii++) {
+		const gchar *name = messages->pdata[ii];
+
+		camel_operation_progress (cancellable, 100 * ii / messages->len);
+
+		mail_url = g_build_filename (k_path, name, NULL);
+		if (g_stat (mail_url, &st) == -1 || !S_ISREG (st.st_mode)) {
+			g_free (mail_url);
+			continue;
+		}
+		fd = g_open (mail_url, O_RDONLY | O_BINARY, 0);
+		g_free (mail_url);
+		if (fd == -1) {
+			continue;
+		}
+		mp = camel_mime_parser_new ();
+		camel_mime_parser_scan_from (mp, FALSE);
+		if (camel_mime_parser_init_with_fd (mp, fd) == -1) {
+			/* will never happen - 0 is unconditionally returned */
+			g_object_unref (mp);
+			continue;
+		}
+		msg = camel_mime_message_new ();
+		if (!camel_mime_part_construct_from_parser_sync (
+				(CamelMimePart *) msg, mp, NULL, NULL)) {
+			/* set exception? */
+			g_object_unref (mp);
+			g_object_unref (msg);
+			continue;
+		}
+		/* Stored already, after the last commit */
+		if (n_skip > 0) {
+			n_skip--;
+			g_object_unref (mp);
+			g_object_unref (msg);
+			continue;
+		}
+		info = camel_message_info_new (NULL);
+		flags = 0;
+		if (g_str_has_prefix (name, "cur" G_DIR_SEPARATOR_S)) {
+			flags |= CAMEL_MESSAGE_SEEN;
+		} else if (g_str_has_prefix (name, "tmp" G_DIR_SEPARATOR_S)) {
+			flags |= CAMEL_MESSAGE_DELETED; /* Mark the 'tmp' mails as 'deleted' */
+		}
+		camel_message_info_set_flags (info, flags, ~0);
+		success = camel_folder_append_message_sync (
+			folder, msg, info, NULL,
+			cancellable, error);
+		g_clear_object (&info);
+		g_object_unref (msg);
+		g_object_unref (mp);
+
+		/* Do not skip the message on resume */
+		if (!success && g_cancellable_is_cancelled (cancellable))
+			break;
+
+		n_batch++;
+
+		/* Save the summary once per batch, then remember the progress */
+		if (n_batch >= MAIL_IMPORTER_BATCH_SIZE) {
+			n_batch = 0;
+
+			if (camel_folder_synchronize_sync (folder, FALSE, cancellable, NULL))
+				mail_importer_checkpoint_commit (checkpoint, folder, ii + 1, name);
+		}
 	}
 	camel_operation_progress (cancellable, 100);
-	camel_folder_synchronize_sync (folder, FALSE, NULL, NULL);
+
+	if (camel_folder_synchronize_sync (folder, FALSE, NULL, NULL)) {
+		if (ii >= messages->len)
+			mail_importer_checkpoint_finish (checkpoint);
+		else if (ii > 0)
+			mail_importer_checkpoint_commit (checkpoint, folder, ii, messages->pdata[ii - 1]);
+	}
+
 	camel_folder_thaw (folder);
 	camel_operation_pop_message (cancellable);
 
+	mail_importer_checkpoint_free (checkpoint);
+	g_ptr_array_unref (messages);
+	g_object_unref (folder);
+	g_free (e_uri);
 	g_free (k_path);
 }
 
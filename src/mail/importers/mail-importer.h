@@ -78,6 +78,32 @@ typedef struct _MailImporterSpecial MailImporterSpecial;
 /* mozilla format subdirs */
 #define MAIL_IMPORTER_MOZFMT (1<<0)
 
+/* Messages are stored in batches of this size; the import
+ * checkpoint is committed after each batch. */
+#define MAIL_IMPORTER_BATCH_SIZE 100
+
+/* Remembers how far an import of one source got, thus an interrupted
+ * import can continue where it stopped, without duplicates.  Messages
+ * stored after the last commit are found by the destination's count. */
+typedef struct _MailImporterCheckpoint MailImporterCheckpoint;
+
+MailImporterCheckpoint *
+		mail_importer_checkpoint_load	(const gchar *source_path,
+						 const gchar *destination_uri,
+						 CamelFolder *destination);
+void		mail_importer_checkpoint_free	(MailImporterCheckpoint *checkpoint);
+guint64		mail_importer_checkpoint_get_position
+						(MailImporterCheckpoint *checkpoint);
+guint64		mail_importer_checkpoint_get_n_uncommitted
+						(MailImporterCheckpoint *checkpoint);
+const gchar *	mail_importer_checkpoint_get_marker
+						(MailImporterCheckpoint *checkpoint);
+void		mail_importer_checkpoint_commit	(MailImporterCheckpoint *checkpoint,
+						 CamelFolder *destination,
+						 guint64 position,
+						 const gchar *marker);
+void		mail_importer_checkpoint_finish	(MailImporterCheckpoint *checkpoint);
+
 /* api in flux */
 void		mail_importer_import_folders_sync
 						(EMailSession *session,
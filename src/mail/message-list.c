@@ -170,6 +170,9 @@ struct _RegenData {
 	gchar *select_uid;
 	gboolean select_all;
 	gboolean select_use_fallback;
+
+	/* Set only for the first regen, when the startup trace is enabled. */
+	EStartupTraceSpan *trace_span;
 };
 
 enum {
@@ -537,6 +540,8 @@ regen_data_unref (RegenData *regen_data)
 		g_mutex_clear (&regen_data->select_lock);
 		g_free (regen_data->select_uid);
 
+		e_startup_trace_end (regen_data->trace_span);
+
 		g_slice_free (RegenData, regen_data);
 	}
 }
@@ -6263,6 +6268,9 @@ message_list_regen_done_cb (GObject *source_object,
 
 	message_list->priv->any_row_changed = FALSE;
 	message_list->just_set_folder = FALSE;
+
+	e_startup_trace_end (regen_data->trace_span);
+	regen_data->trace_span = NULL;
 }
 
 static gboolean
@@ -6457,6 +6465,13 @@ mail_regen_list (MessageList *message_list,
 	new_regen_data->search = g_strdup (search);
 	new_regen_data->folder_changed = folder_changed;
 
+	if (e_startup_trace_is_enabled ()) {
+		static volatile gint first_regen_traced = 0;
+
+		if (g_atomic_int_compare_and_exchange (&first_regen_traced, 0, 1))
+			new_regen_data->trace_span = e_startup_trace_begin ("mail", "first message list regen");
+	}
+
 	/* We generate the message list content in a worker thread, and
 	 * then supply our own GAsyncReadyCallback to redraw the widget. */
 
@@ -346,8 +346,10 @@ book_shell_content_check_state_foreach (gint row,
 		GList *list;
 	} *foreach_data = user_data;
 
+	/* Rows of a virtual model not fetched yet are not considered */
 	contact = e_addressbook_model_get_contact (foreach_data->model, row);
-	g_return_if_fail (E_IS_CONTACT (contact));
+	if (!contact)
+		return;
 
 	foreach_data->list = g_list_prepend (foreach_data->list, contact);
 }
@@ -624,27 +624,58 @@ action_contact_find_cb (GtkAction *action,
 	e_preview_pane_show_search_bar (preview_pane);
 }
 
+/* The selected contacts can be fetched in a thread, thus the actions on
+ * them finish in a callback; returns NULL when there are none to act on */
+static GSList *
+book_shell_view_dup_selected_finish (EBookShellView *book_shell_view,
+                                     GObject *source_object,
+                                     GAsyncResult *result)
+{
+	EShellView *shell_view;
+	EShellContent *shell_content;
+	GSList *list;
+	GError *local_error = NULL;
+
+	list = e_addressbook_model_dup_contacts_finish (
+		E_ADDRESSBOOK_MODEL (source_object), result, &local_error);
+
+	if (local_error != NULL) {
+		shell_view = E_SHELL_VIEW (book_shell_view);
+		shell_content = e_shell_view_get_shell_content (shell_view);
+
+		e_alert_submit (
+			E_ALERT_SINK (shell_content),
+			"addressbook:search-error",
+			local_error->message, NULL);
+
+		g_error_free (local_error);
+	}
+
+	return list;
+}
+
 static void
-action_contact_forward_cb (GtkAction *action,
-                           EBookShellView *book_shell_view)
+contact_forward_selected_cb (GObject *source_object,
+                             GAsyncResult *result,
+                             gpointer user_data)
 {
+	EBookShellView *book_shell_view = user_data;
 	EShell *shell;
 	EShellView *shell_view;
 	EShellWindow *shell_window;
-	EBookShellContent *book_shell_content;
-	EAddressbookView *view;
 	GSList *list, *iter;
 
 	shell_view = E_SHELL_VIEW (book_shell_view);
 	shell_window = e_shell_view_get_shell_window (shell_view);
 	shell = e_shell_window_get_shell (shell_window);
 
-	book_shell_content = book_shell_view->priv->book_shell_content;
-	view = e_book_shell_content_get_current_view (book_shell_content);
-	g_return_if_fail (view != NULL);
+	list = book_shell_view_dup_selected_finish (
+		book_shell_view, source_object, result);
 
-	list = e_addressbook_view_get_selected (view);
-	g_return_if_fail (list != NULL);
+	if (list == NULL) {
+		g_object_unref (book_shell_view);
+		return;
+	}
 
 	/* Convert the list of contacts to a list of destinations. */
 	for (iter = list; iter != NULL; iter = iter->next) {
@@ -661,6 +692,24 @@ action_contact_forward_cb (GtkAction *action,
 	eab_send_as_attachment (shell, list);
 
 	g_slist_free_full (list, (GDestroyNotify) g_object_unref);
+
+	g_object_unref (book_shell_view);
+}
+
+static void
+action_contact_forward_cb (GtkAction *action,
+                           EBookShellView *book_shell_view)
+{
+	EBookShellContent *book_shell_content;
+	EAddressbookView *view;
+
+	book_shell_content = book_shell_view->priv->book_shell_content;
+	view = e_book_shell_content_get_current_view (book_shell_content);
+	g_return_if_fail (view != NULL);
+
+	e_addressbook_view_dup_selected (
+		view, NULL, contact_forward_selected_cb,
+		g_object_ref (book_shell_view));
 }
 
 static void
@@ -801,15 +850,15 @@ action_contact_print_cb (GtkAction *action,
 }
 
 static void
-action_contact_save_as_cb (GtkAction *action,
-                           EBookShellView *book_shell_view)
+contact_save_as_selected_cb (GObject *source_object,
+                             GAsyncResult *result,
+                             gpointer user_data)
 {
+	EBookShellView *book_shell_view = user_data;
 	EShell *shell;
 	EShellView *shell_view;
 	EShellWindow *shell_window;
 	EShellBackend *shell_backend;
-	EBookShellContent *book_shell_content;
-	EAddressbookView *view;
 	EActivity *activity;
 	GSList *list;
 	GFile *file;
@@ -820,11 +869,8 @@ action_contact_save_as_cb (GtkAction *action,
 	shell_backend = e_shell_view_get_shell_backend (shell_view);
 	shell = e_shell_window_get_shell (shell_window);
 
-	book_shell_content = book_shell_view->priv->book_shell_content;
-	view = e_book_shell_content_get_current_view (book_shell_content);
-	g_return_if_fail (view != NULL);
-
-	list = e_addressbook_view_get_selected (view);
+	list = book_shell_view_dup_selected_finish (
+		book_shell_view, source_object, result);
 
 	if (list == NULL)
 		goto exit;
@@ -868,29 +914,48 @@ action_contact_save_as_cb (GtkAction *action,
 
  exit:
 	g_slist_free_full (list, (GDestroyNotify) g_object_unref);
+
+	g_object_unref (book_shell_view);
 }
 
 static void
-action_contact_send_message_cb (GtkAction *action,
-                                EBookShellView *book_shell_view)
+action_contact_save_as_cb (GtkAction *action,
+                           EBookShellView *book_shell_view)
 {
+	EBookShellContent *book_shell_content;
+	EAddressbookView *view;
+
+	book_shell_content = book_shell_view->priv->book_shell_content;
+	view = e_book_shell_content_get_current_view (book_shell_content);
+	g_return_if_fail (view != NULL);
+
+	e_addressbook_view_dup_selected (
+		view, NULL, contact_save_as_selected_cb,
+		g_object_ref (book_shell_view));
+}
+
+static void
+contact_send_message_selected_cb (GObject *source_object,
+                                  GAsyncResult *result,
+                                  gpointer user_data)
+{
+	EBookShellView *book_shell_view = user_data;
 	EShell *shell;
 	EShellView *shell_view;
 	EShellWindow *shell_window;
-	EBookShellContent *book_shell_content;
-	EAddressbookView *view;
 	GSList *list, *iter;
 
 	shell_view = E_SHELL_VIEW (book_shell_view);
 	shell_window = e_shell_view_get_shell_window (shell_view);
 	shell = e_shell_window_get_shell (shell_window);
 
-	book_shell_content = book_shell_view->priv->book_shell_content;
-	view = e_book_shell_content_get_current_view (book_shell_content);
-	g_return_if_fail (view != NULL);
+	list = book_shell_view_dup_selected_finish (
+		book_shell_view, source_object, result);
 
-	list = e_addressbook_view_get_selected (view);
-	g_return_if_fail (list != NULL);
+	if (list == NULL) {
+		g_object_unref (book_shell_view);
+		return;
+	}
 
 	/* Convert the list of contacts to a list of destinations. */
 	for (iter = list; iter != NULL; iter = iter->next) {
@@ -907,6 +972,24 @@ action_contact_send_message_cb (GtkAction *action,
 	eab_send_as_to (shell, list);
 
 	g_slist_free_full (list, (GDestroyNotify) g_object_unref);
+
+	g_object_unref (book_shell_view);
+}
+
+static void
+action_contact_send_message_cb (GtkAction *action,
+                                EBookShellView *book_shell_view)
+{
+	EBookShellContent *book_shell_content;
+	EAddressbookView *view;
+
+	book_shell_content = book_shell_view->priv->book_shell_content;
+	view = e_book_shell_content_get_current_view (book_shell_content);
+	g_return_if_fail (view != NULL);
+
+	e_addressbook_view_dup_selected (
+		view, NULL, contact_send_message_selected_cb,
+		g_object_ref (book_shell_view));
 }
 
 static void
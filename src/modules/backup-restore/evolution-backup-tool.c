@@ -54,6 +54,14 @@
 
 #define KEY_FILE_GROUP "Evolution Backup"
 
+/* Sidecar file with sizes and modification times of the archived
+ * files, which an incremental back up compares against. */
+#define MANIFEST_SUFFIX ".manifest"
+#define MANIFEST_HEADER "# Evolution back up manifest 1"
+
+#define TAR_BLOCK_SIZE 512
+#define COPY_BUFFER_SIZE (256 * 1024)
+
 static gboolean backup_op = FALSE;
 static gchar *bk_file = NULL;
 static gboolean restore_op = FALSE;
@@ -62,12 +70,18 @@ static gboolean check_op = FALSE;
 static gchar *chk_file = NULL;
 static gboolean restart_arg = FALSE;
 static gboolean gui_arg = FALSE;
+static gchar *incremental_from = NULL;
 static gchar **opt_remaining = NULL;
 static gint result = 0;
 static GtkWidget *progress_dialog;
 static GtkWidget *pbar;
 static gchar *txt = NULL;
 
+/* Byte-accurate progress of the archiving; guarded by progress_lock. */
+static GMutex progress_lock;
+static guint64 progress_total = 0;
+static guint64 progress_done = 0;
+
 static GOptionEntry options[] = {
 	{ "backup", '\0', 0, G_OPTION_ARG_NONE, &backup_op,
 	  N_("Back up Evolution directory"), NULL },
@@ -79,6 +93,8 @@ static GOptionEntry options[] = {
 	  N_("Restart Evolution"), NULL },
 	{ "gui", '\0', 0, G_OPTION_ARG_NONE, &gui_arg,
 	  N_("With Graphical User Interface"), NULL },
+	{ "incremental-from", '\0', 0, G_OPTION_ARG_FILENAME, &incremental_from,
+	  N_("Back up only files changed since the given back up"), N_("FILE") },
 	{ G_OPTION_REMAINING, '\0', 0,
 	  G_OPTION_ARG_STRING_ARRAY, &opt_remaining },
 	{ NULL }
@@ -236,7 +252,7 @@ run_evolution_no_wait (void)
 }
 
 static void
-write_dir_file (void)
+write_dir_file (const gchar *base_archive)
 {
 	GString *content, *filename;
 	GError *error = NULL;
@@ -252,6 +268,23 @@ write_dir_file (void)
 		, TRUE);
 	g_return_if_fail (content != NULL);
 
+	/* An incremental back up refers to the back up it is based on. */
+	if (base_archive != NULL) {
+		GKeyFile *key_file;
+		gchar *data;
+		gsize length = 0;
+
+		key_file = g_key_file_new ();
+		g_key_file_load_from_data (key_file, content->str, content->len, G_KEY_FILE_NONE, NULL);
+		g_key_file_set_string (key_file, KEY_FILE_GROUP, "BaseArchive", base_archive);
+
+		data = g_key_file_to_data (key_file, &length, NULL);
+		g_string_assign (content, data ? data : "");
+
+		g_key_file_free (key_file);
+		g_free (data);
+	}
+
 	g_file_set_contents (filename->str, content->str, content->len, &error);
 
 	if (error != NULL) {
@@ -278,13 +311,579 @@ get_filename_is_xz (const gchar *filename)
 	return g_ascii_strcasecmp (filename + len - 3, ".xz") == 0;
 }
 
+typedef struct _ArchiveEntry {
+	gchar *member;		/* name in the archive, '/'-separated */
+	gchar *path;		/* file name on the disk */
+	gchar *link_target;	/* set for symbolic links */
+	gboolean is_dir;
+	gboolean changed;	/* to be stored in the archive */
+	guint mode;
+	guint64 size;
+	gint64 mtime;
+} ArchiveEntry;
+
+static void
+archive_entry_free (gpointer ptr)
+{
+	ArchiveEntry *entry = ptr;
+
+	if (entry != NULL) {
+		g_free (entry->member);
+		g_free (entry->path);
+		g_free (entry->link_target);
+		g_slice_free (ArchiveEntry, entry);
+	}
+}
+
+static void
+progress_set (guint64 done,
+              guint64 total)
+{
+	g_mutex_lock (&progress_lock);
+	progress_done = done;
+	progress_total = total;
+	g_mutex_unlock (&progress_lock);
+}
+
+/* Returns a hash table of escaped member name ~> "size mtime" of files
+ * stored in the back up @archive_filename, or NULL when it has none. */
+static GHashTable *
+archive_read_manifest (const gchar *archive_filename)
+{
+	GHashTable *manifest;
+	gchar *filename, *contents = NULL;
+	gchar **lines;
+	gint ii;
+	GError *error = NULL;
+
+	filename = g_strconcat (archive_filename, MANIFEST_SUFFIX, NULL);
+
+	if (!g_file_get_contents (filename, &contents, NULL, &error)) {
+		g_warning ("Failed to read back up manifest '%s': %s", filename, error ? error->message : "Unknown error");
+		g_clear_error (&error);
+		g_free (filename);
+		return NULL;
+	}
+
+	lines = g_strsplit (contents, "\n", -1);
+	g_free (contents);
+
+	if (!lines[0] || g_strcmp0 (lines[0], MANIFEST_HEADER) != 0) {
+		g_warning ("File '%s' is not a back up manifest", filename);
+		g_strfreev (lines);
+		g_free (filename);
+		return NULL;
+	}
+
+	manifest = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+	/* Each line is "<size> <mtime> <escaped member name>" */
+	for (ii = 1; lines[ii]; ii++) {
+		gchar *sep;
+
+		sep = strchr (lines[ii], ' ');
+		if (sep)
+			sep = strchr (sep + 1, ' ');
+		if (!sep)
+			continue;
+
+		*sep = '\0';
+
+		g_hash_table_insert (manifest, g_strdup (sep + 1), g_strdup (lines[ii]));
+	}
+
+	g_strfreev (lines);
+	g_free (filename);
+
+	return manifest;
+}
+
+static gint
+archive_compare_names (gconstpointer ptr1,
+                       gconstpointer ptr2)
+{
+	const gchar * const *pname1 = ptr1, * const *pname2 = ptr2;
+
+	return g_strcmp0 (*pname1, *pname2);
+}
+
+/* Walks the @path recursively and adds all directories, regular files
+ * and symbolic links into @entries.  Symbolic links are stored as links,
+ * not followed.  The files are compared with the @base_manifest, when
+ * set, and all files and links are noted into the @manifest of the new
+ * back up, which lets the restore remove files deleted since the base. */
+static void
+archive_collect_entries (GPtrArray *entries,
+                         const gchar *path,
+                         const gchar *member,
+                         GHashTable *base_manifest,
+                         GString *manifest,
+                         guint64 *total_bytes)
+{
+	ArchiveEntry *entry;
+	GStatBuf st;
+
+	if (g_lstat (path, &st) != 0) {
+		g_warning ("Failed to stat '%s': %s", path, g_strerror (errno));
+		return;
+	}
+
+	if (!S_ISDIR (st.st_mode) && !S_ISREG (st.st_mode) && !S_ISLNK (st.st_mode))
+		return;
+
+	entry = g_slice_new0 (ArchiveEntry);
+	entry->member = g_strdup (member);
+	entry->path = g_strdup (path);
+	entry->is_dir = S_ISDIR (st.st_mode);
+	entry->mode = st.st_mode & 07777;
+	entry->mtime = st.st_mtime;
+	entry->changed = TRUE;
+
+	if (S_ISLNK (st.st_mode)) {
+		GError *error = NULL;
+
+		entry->link_target = g_file_read_link (path, &error);
+
+		if (!entry->link_target) {
+			g_warning ("Skipping '%s': %s", path, error ? error->message : "Unknown error");
+			g_clear_error (&error);
+			archive_entry_free (entry);
+			return;
+		}
+
+		entry->mode = 0777;
+	}
+
+	if (entry->link_target) {
+		gchar *escaped;
+
+		/* Links are tiny, they are always stored. */
+		escaped = g_strescape (member, NULL);
+		g_string_append_printf (manifest, "0 %" G_GINT64_FORMAT " %s\n", entry->mtime, escaped);
+		g_free (escaped);
+	} else if (!entry->is_dir) {
+		gchar *escaped, *value;
+
+		entry->size = st.st_size;
+
+		escaped = g_strescape (member, NULL);
+		value = g_strdup_printf ("%" G_GUINT64_FORMAT " %" G_GINT64_FORMAT, entry->size, entry->mtime);
+
+		entry->changed = !base_manifest ||
+			g_strcmp0 (g_hash_table_lookup (base_manifest, escaped), value) != 0;
+
+		g_string_append_printf (manifest, "%s %s\n", value, escaped);
+
+		if (entry->changed)
+			*total_bytes += entry->size;
+
+		g_free (escaped);
+		g_free (value);
+	}
+
+	g_ptr_array_add (entries, entry);
+
+	if (entry->is_dir) {
+		GDir *dir;
+		GPtrArray *names;
+		const gchar *name;
+		guint ii;
+		GError *error = NULL;
+
+		dir = g_dir_open (path, 0, &error);
+		if (!dir) {
+			g_warning ("Failed to open folder '%s': %s", path, error ? error->message : "Unknown error");
+			g_clear_error (&error);
+			return;
+		}
+
+		names = g_ptr_array_new_with_free_func (g_free);
+
+		while ((name = g_dir_read_name (dir)) != NULL)
+			g_ptr_array_add (names, g_strdup (name));
+
+		g_dir_close (dir);
+
+		/* Stable order makes the archives comparable. */
+		g_ptr_array_sort (names, archive_compare_names);
+
+		for (ii = 0; ii < names->len; ii++) {
+			gchar *child_path, *child_member;
+
+			name = g_ptr_array_index (names, ii);
+			child_path = g_build_filename (path, name, NULL);
+			child_member = g_strconcat (member, "/", name, NULL);
+
+			archive_collect_entries (entries, child_path, child_member, base_manifest, manifest, total_bytes);
+
+			g_free (child_path);
+			g_free (child_member);
+		}
+
+		g_ptr_array_unref (names);
+	}
+}
+
+static void
+tar_set_number (gchar *field,
+                gsize field_len,
+                guint64 value)
+{
+	if (value >> (3 * (field_len - 1))) {
+		gint ii;
+
+		/* GNU base-256 encoding for values not fitting the octal */
+		for (ii = field_len - 1; ii > 0; ii--) {
+			field[ii] = (gchar) (value & 0xFF);
+			value = value >> 8;
+		}
+
+		field[0] = (gchar) 0x80;
+	} else {
+		g_snprintf (field, field_len, "%0*" G_GINT64_MODIFIER "o", (gint) field_len - 1, value);
+	}
+}
+
+static gboolean
+tar_write_padding (GOutputStream *output,
+                   guint64 size,
+                   GCancellable *cancellable,
+                   GError **error)
+{
+	gchar zeros[TAR_BLOCK_SIZE] = { 0 };
+	gsize padding = (TAR_BLOCK_SIZE - (size % TAR_BLOCK_SIZE)) % TAR_BLOCK_SIZE;
+
+	return padding == 0 ||
+		g_output_stream_write_all (output, zeros, padding, NULL, cancellable, error);
+}
+
+static gboolean
+tar_write_long_name (GOutputStream *output,
+                     const gchar *name,
+                     gsize name_len,
+                     gchar typeflag,
+                     GCancellable *cancellable,
+                     GError **error);
+
+static gboolean
+tar_write_header (GOutputStream *output,
+                  const gchar *name,
+                  const gchar *link_target,
+                  gchar typeflag,
+                  guint mode,
+                  guint64 size,
+                  gint64 mtime,
+                  GCancellable *cancellable,
+                  GError **error)
+{
+	gchar header[TAR_BLOCK_SIZE];
+	gsize name_len, link_len = 0, ii;
+	guint checksum = 0;
+
+	name_len = strlen (name);
+	if (link_target)
+		link_len = strlen (link_target);
+
+	/* Names and link targets longer than the header fields are
+	 * stored in preceding GNU long name pseudo-entries. */
+	if (link_len >= 100) {
+		if (!tar_write_long_name (output, link_target, link_len, 'K', cancellable, error))
+			return FALSE;
+
+		link_len = 99;
+	}
+
+	if (name_len >= 100) {
+		if (!tar_write_long_name (output, name, name_len, 'L', cancellable, error))
+			return FALSE;
+
+		name_len = 99;
+	}
+
+	memset (header, 0, sizeof (header));
+	memcpy (header, name, name_len);
+
+	if (link_len)
+		memcpy (header + 157, link_target, link_len);
+
+	tar_set_number (header + 100, 8, mode);
+	tar_set_number (header + 108, 8, 0);
+	tar_set_number (header + 116, 8, 0);
+	tar_set_number (header + 124, 12, size);
+	tar_set_number (header + 136, 12, mtime > 0 ? mtime : 0);
+	header[156] = typeflag;
+
+	/* GNU format magic and version, "ustar  \0" */
+	memcpy (header + 257, "ustar  ", 8);
+
+	memset (header + 148, ' ', 8);
+
+	for (ii = 0; ii < TAR_BLOCK_SIZE; ii++)
+		checksum += (guchar) header[ii];
+
+	g_snprintf (header + 148, 8, "%06o", checksum);
+	header[155] = ' ';
+
+	return g_output_stream_write_all (output, header, TAR_BLOCK_SIZE, NULL, cancellable, error);
+}
+
+static gboolean
+tar_write_long_name (GOutputStream *output,
+                     const gchar *name,
+                     gsize name_len,
+                     gchar typeflag,
+                     GCancellable *cancellable,
+                     GError **error)
+{
+	return tar_write_header (output, "././@LongLink", NULL, typeflag, 0644, name_len + 1, 0, cancellable, error) &&
+		g_output_stream_write_all (output, name, name_len + 1, NULL, cancellable, error) &&
+		tar_write_padding (output, name_len + 1, cancellable, error);
+}
+
+static gboolean
+tar_write_entry (GOutputStream *output,
+                 ArchiveEntry *entry,
+                 gchar *buffer,
+                 guint64 *done_bytes,
+                 guint64 total_bytes,
+                 GCancellable *cancellable,
+                 GError **error)
+{
+	GFile *file;
+	GInputStream *input;
+	guint64 remaining;
+	gboolean success = TRUE;
+	GError *local_error = NULL;
+
+	if (entry->is_dir) {
+		gchar *name = g_strconcat (entry->member, "/", NULL);
+
+		success = tar_write_header (output, name, NULL, '5', entry->mode, 0, entry->mtime, cancellable, error);
+		g_free (name);
+
+		return success;
+	}
+
+	if (entry->link_target)
+		return tar_write_header (output, entry->member, entry->link_target, '2', entry->mode, 0, entry->mtime, cancellable, error);
+
+	file = g_file_new_for_path (entry->path);
+	input = G_INPUT_STREAM (g_file_read (file, cancellable, &local_error));
+	g_object_unref (file);
+
+	/* Like tar, an unreadable file is skipped, not a reason
+	 * to give up the whole back up. */
+	if (!input) {
+		if (g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			g_propagate_error (error, local_error);
+			return FALSE;
+		}
+
+		g_warning ("Skipping '%s': %s", entry->path, local_error ? local_error->message : "Unknown error");
+		g_clear_error (&local_error);
+
+		*done_bytes += entry->size;
+		progress_set (*done_bytes, total_bytes);
+
+		return TRUE;
+	}
+
+	if (!tar_write_header (output, entry->member, NULL, '0', entry->mode, entry->size, entry->mtime, cancellable, error)) {
+		g_object_unref (input);
+		return FALSE;
+	}
+
+	/* The file can change while being archived; write exactly
+	 * the size from the header, padding it with zeros if needed. */
+	remaining = entry->size;
+
+	while (success && remaining > 0) {
+		gssize n_read;
+
+		n_read = input ? g_input_stream_read (input, buffer, MIN (remaining, COPY_BUFFER_SIZE), cancellable, &local_error) : 0;
+
+		if (n_read < 0) {
+			if (g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+				g_propagate_error (error, local_error);
+				success = FALSE;
+				break;
+			}
+
+			/* The header is written already, thus the rest
+			 * of the file is stored as zeros. */
+			g_warning ("Failed to read '%s': %s", entry->path, local_error ? local_error->message : "Unknown error");
+			g_clear_error (&local_error);
+			g_clear_object (&input);
+		} else {
+			if (n_read == 0) {
+				n_read = MIN (remaining, COPY_BUFFER_SIZE);
+				memset (buffer, 0, n_read);
+			}
+
+			success = g_output_stream_write_all (output, buffer, n_read, NULL, cancellable, error);
+			remaining -= n_read;
+			*done_bytes += n_read;
+
+			progress_set (*done_bytes, total_bytes);
+		}
+	}
+
+	g_clear_object (&input);
+
+	return success && tar_write_padding (output, entry->size, cancellable, error);
+}
+
+/* Opens the compressed output stream for the archive.  The gzip
+ * compression runs in-process, the xz compression is piped into
+ * a multi-threaded 'xz' process. */
+static GOutputStream *
+archive_open_output (const gchar *filename,
+                     GSubprocess **out_compressor,
+                     GError **error)
+{
+	GOutputStream *output;
+
+	*out_compressor = NULL;
+
+	if (get_filename_is_xz (filename)) {
+		GSubprocessLauncher *launcher;
+
+		launcher = g_subprocess_launcher_new (G_SUBPROCESS_FLAGS_STDIN_PIPE);
+		g_subprocess_launcher_set_stdout_file_path (launcher, filename);
+
+		/* '-T0' uses as many threads as there are CPU cores. */
+		*out_compressor = g_subprocess_launcher_spawn (launcher, error, "xz", "-z", "-c", "-T0", NULL);
+
+		g_object_unref (launcher);
+
+		if (!*out_compressor)
+			return NULL;
+
+		output = g_object_ref (g_subprocess_get_stdin_pipe (*out_compressor));
+	} else {
+		GFile *file;
+		GFileOutputStream *file_output;
+		GZlibCompressor *compressor;
+
+		file = g_file_new_for_path (filename);
+		file_output = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_PRIVATE, NULL, error);
+		g_object_unref (file);
+
+		if (!file_output)
+			return NULL;
+
+		compressor = g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP, -1);
+		output = g_converter_output_stream_new (G_OUTPUT_STREAM (file_output), G_CONVERTER (compressor));
+
+		g_object_unref (compressor);
+		g_object_unref (file_output);
+	}
+
+	return output;
+}
+
+/* Streams the Evolution data and config directories, together with
+ * the EVOLUTION_DIR_FILE, into a compressed tar archive @filename.
+ * With a @base_manifest only files changed since the base back up
+ * are stored.  A manifest of the new back up is saved beside it. */
+static gboolean
+archive_write (const gchar *filename,
+               GHashTable *base_manifest,
+               GCancellable *cancellable,
+               GError **error)
+{
+	GOutputStream *output, *buffered;
+	GSubprocess *compressor = NULL;
+	GPtrArray *entries;
+	GString *manifest;
+	GString *path, *member;
+	gchar *buffer;
+	guint64 total_bytes = 0, done_bytes = 0;
+	guint ii;
+	gboolean success = TRUE;
+
+	entries = g_ptr_array_new_with_free_func (archive_entry_free);
+	manifest = g_string_new (MANIFEST_HEADER "\n");
+
+	path = replace_variables ("$HOME/$STRIPDATADIR", TRUE);
+	member = replace_variables ("$STRIPDATADIR", TRUE);
+	archive_collect_entries (entries, path->str, member->str, base_manifest, manifest, &total_bytes);
+	g_string_free (path, TRUE);
+	g_string_free (member, TRUE);
+
+	path = replace_variables ("$HOME/$STRIPCONFIGDIR", TRUE);
+	member = replace_variables ("$STRIPCONFIGDIR", TRUE);
+	archive_collect_entries (entries, path->str, member->str, base_manifest, manifest, &total_bytes);
+	g_string_free (path, TRUE);
+	g_string_free (member, TRUE);
+
+	path = replace_variables ("$HOME/" EVOLUTION_DIR_FILE, TRUE);
+	archive_collect_entries (entries, path->str, EVOLUTION_DIR_FILE, NULL, manifest, &total_bytes);
+	g_string_free (path, TRUE);
+
+	progress_set (0, total_bytes);
+
+	output = archive_open_output (filename, &compressor, error);
+	if (!output) {
+		g_ptr_array_unref (entries);
+		g_string_free (manifest, TRUE);
+		return FALSE;
+	}
+
+	buffered = g_buffered_output_stream_new_sized (output, COPY_BUFFER_SIZE);
+	buffer = g_malloc (COPY_BUFFER_SIZE);
+
+	for (ii = 0; success && ii < entries->len; ii++) {
+		ArchiveEntry *entry = g_ptr_array_index (entries, ii);
+
+		if (!entry->changed)
+			continue;
+
+		success = tar_write_entry (buffered, entry, buffer, &done_bytes, total_bytes, cancellable, error);
+	}
+
+	/* The end-of-archive marker is two zero blocks. */
+	if (success) {
+		memset (buffer, 0, 2 * TAR_BLOCK_SIZE);
+		success = g_output_stream_write_all (buffered, buffer, 2 * TAR_BLOCK_SIZE, NULL, cancellable, error);
+	}
+
+	/* Closes also the base stream. */
+	if (!g_output_stream_close (buffered, success ? cancellable : NULL, success ? error : NULL))
+		success = FALSE;
+
+	if (compressor) {
+		if (success)
+			success = g_subprocess_wait_check (compressor, cancellable, error);
+		else
+			g_subprocess_force_exit (compressor);
+	}
+
+	if (success) {
+		gchar *manifest_filename;
+
+		manifest_filename = g_strconcat (filename, MANIFEST_SUFFIX, NULL);
+		success = g_file_set_contents (manifest_filename, manifest->str, manifest->len, error);
+		g_free (manifest_filename);
+	}
+
+	g_clear_object (&compressor);
+	g_object_unref (buffered);
+	g_object_unref (output);
+	g_ptr_array_unref (entries);
+	g_string_free (manifest, TRUE);
+	g_free (buffer);
+
+	return success;
+}
+
 static void
 backup (const gchar *filename,
         GCancellable *cancellable)
 {
-	gchar *command;
-	gchar *quotedfname;
-	gboolean use_xz;
+	GHashTable *base_manifest = NULL;
+	gchar *base_archive = NULL;
+	GError *error = NULL;
 
 	g_return_if_fail (filename && *filename);
 
@@ -312,24 +911,47 @@ backup (const gchar *filename,
 		EVOLUTION_DIR DCONF_DUMP_FILE_EVO,
 		e_get_user_data_dir (), EVOUSERDATADIR_MAGIC);
 
-	write_dir_file ();
+	/* Without a readable manifest of the base back up
+	 * do the full back up instead of the incremental. */
+	if (incremental_from && *incremental_from) {
+		base_manifest = archive_read_manifest (incremental_from);
 
-	if (g_cancellable_is_cancelled (cancellable))
+		if (base_manifest) {
+			if (g_path_is_absolute (incremental_from)) {
+				base_archive = g_strdup (incremental_from);
+			} else {
+				gchar *current_dir = g_get_current_dir ();
+
+				base_archive = g_build_filename (current_dir, incremental_from, NULL);
+
+				g_free (current_dir);
+			}
+		}
+	}
+
+	write_dir_file (base_archive);
+
+	if (g_cancellable_is_cancelled (cancellable)) {
+		if (base_manifest)
+			g_hash_table_destroy (base_manifest);
+		g_free (base_archive);
 		return;
+	}
 
 	txt = _("Backing Evolution data (Mails, Contacts, Calendar, Tasks, Memos)");
 
-	quotedfname = g_shell_quote (filename);
-	use_xz = get_filename_is_xz (filename);
+	if (!archive_write (filename, base_manifest, cancellable, &error)) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("Failed to write back up '%s': %s", filename, error ? error->message : "Unknown error");
+		g_clear_error (&error);
+		result = 1;
+	}
 
-	command = g_strdup_printf (
-		"cd $HOME && tar chf - $STRIPDATADIR "
-		"$STRIPCONFIGDIR " EVOLUTION_DIR_FILE " | "
-		"%s > %s", use_xz ? "xz -z" : "gzip", quotedfname);
-	run_cmd (command);
+	if (base_manifest)
+		g_hash_table_destroy (base_manifest);
+	g_free (base_archive);
 
-	g_free (command);
-	g_free (quotedfname);
+	progress_set (0, 0);
 
 	run_cmd ("rm $HOME/" EVOLUTION_DIR_FILE);
 
@@ -350,7 +972,8 @@ static void
 extract_backup_data (const gchar *filename,
                      gchar **restored_version,
                      gchar **data_dir,
-                     gchar **config_dir)
+                     gchar **config_dir,
+                     gchar **base_archive)
 {
 	GKeyFile *key_file;
 	GError *error = NULL;
@@ -388,6 +1011,11 @@ extract_backup_data (const gchar *filename,
 			*config_dir = g_shell_quote (tmp);
 		g_free (tmp);
 
+		/* Set only by incremental back ups. */
+		if (base_archive != NULL)
+			*base_archive = g_key_file_get_string (
+				key_file, KEY_FILE_GROUP, "BaseArchive", NULL);
+
 	/* This is the legacy format with no version information. */
 	} else if (g_key_file_has_group (key_file, "dirs")) {
 		gchar *tmp;
@@ -464,6 +1092,189 @@ get_source_manager_reload_command (void)
 	return command;
 }
 
+/* Incremental back ups form a chain, which is not supposed to be long. */
+#define MAX_BASE_ARCHIVES 64
+
+/* Removes files and links under the restored @path, which are not listed
+ * in the @manifest, with @member being the @path's name in the archive. */
+static void
+archive_remove_deleted (const gchar *path,
+                        const gchar *member,
+                        GHashTable *manifest)
+{
+	GDir *dir;
+	const gchar *name;
+
+	dir = g_dir_open (path, 0, NULL);
+	if (!dir)
+		return;
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		gchar *child_path, *child_member;
+		GStatBuf st;
+
+		child_path = g_build_filename (path, name, NULL);
+		child_member = g_strconcat (member, "/", name, NULL);
+
+		if (g_lstat (child_path, &st) == 0) {
+			if (S_ISDIR (st.st_mode)) {
+				archive_remove_deleted (child_path, child_member, manifest);
+			} else {
+				gchar *escaped;
+
+				escaped = g_strescape (child_member, NULL);
+
+				if (!g_hash_table_contains (manifest, escaped) && g_unlink (child_path) != 0)
+					g_warning ("Failed to remove '%s': %s", child_path, g_strerror (errno));
+
+				g_free (escaped);
+			}
+		}
+
+		g_free (child_path);
+		g_free (child_member);
+	}
+
+	g_dir_close (dir);
+}
+
+/* The base chain restores also files, which had been deleted before
+ * the incremental back up @filename was made; its manifest lists all
+ * the files, thus remove those not in it. */
+static void
+restore_remove_deleted (const gchar *filename,
+                        const gchar *data_dir,
+                        const gchar *config_dir)
+{
+	GHashTable *manifest;
+	GString *path;
+	gchar *member;
+
+	manifest = archive_read_manifest (filename);
+	if (!manifest)
+		return;
+
+	path = replace_variables ("$DATADIR", TRUE);
+	member = g_shell_unquote (data_dir, NULL);
+	if (path && member)
+		archive_remove_deleted (path->str, member, manifest);
+	if (path)
+		g_string_free (path, TRUE);
+	g_free (member);
+
+	path = replace_variables ("$CONFIGDIR", TRUE);
+	member = g_shell_unquote (config_dir, NULL);
+	if (path && member)
+		archive_remove_deleted (path->str, member, manifest);
+	if (path)
+		g_string_free (path, TRUE);
+	g_free (member);
+
+	g_hash_table_destroy (manifest);
+}
+
+/* Extracts the data and config directories from the @filename.
+ * An incremental back up holds only files changed since its base
+ * back up, thus the base chain is extracted first, oldest first,
+ * and the newer files overwrite the older. */
+static gboolean
+restore_archive_data (const gchar *filename,
+                      gint depth,
+                      gchar **restored_version)
+{
+	GString *dir_fn;
+	gchar *command;
+	gchar *quotedfname;
+	gchar *data_dir = NULL;
+	gchar *config_dir = NULL;
+	gchar *base_archive = NULL;
+	gchar *version = NULL;
+	const gchar *tar_opts;
+	gboolean base_restored = FALSE;
+
+	if (get_filename_is_xz (filename))
+		tar_opts = "-xJf";
+	else
+		tar_opts = "-xzf";
+
+	quotedfname = g_shell_quote (filename);
+
+	command = g_strdup_printf (
+		"cd $TMP && tar %s %s " EVOLUTION_DIR_FILE,
+		tar_opts, quotedfname);
+	run_cmd (command);
+	g_free (command);
+
+	dir_fn = replace_variables ("$TMP" G_DIR_SEPARATOR_S EVOLUTION_DIR_FILE, TRUE);
+	if (!dir_fn) {
+		g_warning ("Failed to create evolution's dir filename");
+		g_free (quotedfname);
+		return FALSE;
+	}
+
+	/* data_dir and config_dir are quoted inside extract_backup_data */
+	extract_backup_data (
+		dir_fn->str,
+		&version,
+		&data_dir,
+		&config_dir,
+		&base_archive);
+
+	g_unlink (dir_fn->str);
+	g_string_free (dir_fn, TRUE);
+
+	if (!data_dir || !config_dir) {
+		g_warning (
+			"Failed to get old data_dir (%p)/"
+			"config_dir (%p)", data_dir, config_dir);
+		g_free (data_dir);
+		g_free (config_dir);
+		g_free (base_archive);
+		g_free (version);
+		g_free (quotedfname);
+		return FALSE;
+	}
+
+	if (base_archive && *base_archive) {
+		if (depth >= MAX_BASE_ARCHIVES)
+			g_warning ("Too many base back ups of '%s', restoring only changed files", filename);
+		else if (!g_file_test (base_archive, G_FILE_TEST_IS_REGULAR))
+			g_warning ("Base back up '%s' not found, restoring only changed files", base_archive);
+		else if (!restore_archive_data (base_archive, depth + 1, NULL))
+			g_warning ("Failed to restore base back up '%s', restoring only changed files", base_archive);
+		else
+			base_restored = TRUE;
+	}
+
+	command = g_strdup_printf (
+		"cd $DATADIR && tar --strip-components %d %s %s %s",
+		 get_dir_level (data_dir), tar_opts, quotedfname, data_dir);
+	run_cmd (command);
+	g_free (command);
+
+	command = g_strdup_printf (
+		"cd $CONFIGDIR && tar --strip-components %d %s %s %s",
+		get_dir_level (config_dir), tar_opts, quotedfname, config_dir);
+	run_cmd (command);
+	g_free (command);
+
+	/* Only the newest back up knows which files exist. */
+	if (base_restored && depth == 0)
+		restore_remove_deleted (filename, data_dir, config_dir);
+
+	if (restored_version)
+		*restored_version = version;
+	else
+		g_free (version);
+
+	g_free (data_dir);
+	g_free (config_dir);
+	g_free (base_archive);
+	g_free (quotedfname);
+
+	return TRUE;
+}
+
 static void
 unset_eds_migrated_flag (void)
 {
@@ -511,62 +1322,15 @@ restore (const gchar *filename,
 	txt = _("Extracting files from back up");
 
 	if (is_new_format) {
-		GString *dir_fn;
-		gchar *data_dir = NULL;
-		gchar *config_dir = NULL;
 		gchar *restored_version = NULL;
-		const gchar *tar_opts;
-
-		if (get_filename_is_xz (filename))
-			tar_opts = "-xJf";
-		else
-			tar_opts = "-xzf";
-
-		command = g_strdup_printf (
-			"cd $TMP && tar %s %s " EVOLUTION_DIR_FILE,
-			tar_opts, quotedfname);
-		run_cmd (command);
-		g_free (command);
-
-		dir_fn = replace_variables ("$TMP" G_DIR_SEPARATOR_S EVOLUTION_DIR_FILE, TRUE);
-		if (!dir_fn) {
-			g_warning ("Failed to create evolution's dir filename");
-			goto end;
-		}
-
-		/* data_dir and config_dir are quoted inside extract_backup_data */
-		extract_backup_data (
-			dir_fn->str,
-			&restored_version,
-			&data_dir,
-			&config_dir);
-
-		g_unlink (dir_fn->str);
-		g_string_free (dir_fn, TRUE);
-
-		if (!data_dir || !config_dir) {
-			g_warning (
-				"Failed to get old data_dir (%p)/"
-				"config_dir (%p)", data_dir, config_dir);
-			g_free (data_dir);
-			g_free (config_dir);
-			goto end;
-		}
 
 		g_mkdir_with_parents (e_get_user_data_dir (), 0700);
 		g_mkdir_with_parents (e_get_user_config_dir (), 0700);
 
-		command = g_strdup_printf (
-			"cd $DATADIR && tar --strip-components %d %s %s %s",
-			 get_dir_level (data_dir), tar_opts, quotedfname, data_dir);
-		run_cmd (command);
-		g_free (command);
-
-		command = g_strdup_printf (
-			"cd $CONFIGDIR && tar --strip-components %d %s %s %s",
-			get_dir_level (config_dir), tar_opts, quotedfname, config_dir);
-		run_cmd (command);
-		g_free (command);
+		if (!restore_archive_data (filename, 0, &restored_version)) {
+			g_free (quotedfname);
+			goto end;
+		}
 
 		/* If the back file had version information, set the last
 		 * used version in GSettings before restarting Evolution. */
@@ -579,8 +1343,6 @@ restore (const gchar *filename,
 			g_object_unref (settings);
 		}
 
-		g_free (data_dir);
-		g_free (config_dir);
 		g_free (restored_version);
 	} else {
 		const gchar *decr_opts;
@@ -797,9 +1559,32 @@ static gboolean
 pbar_update (gpointer user_data)
 {
 	GCancellable *cancellable = G_CANCELLABLE (user_data);
+	guint64 done, total;
+
+	g_mutex_lock (&progress_lock);
+	done = progress_done;
+	total = progress_total;
+	g_mutex_unlock (&progress_lock);
 
-	gtk_progress_bar_pulse ((GtkProgressBar *) pbar);
-	gtk_progress_bar_set_text ((GtkProgressBar *) pbar, txt);
+	if (total > 0) {
+		gchar *done_str, *total_str, *text;
+
+		done_str = g_format_size (done);
+		total_str = g_format_size (total);
+		/* Translators: the first '%s' is an operation description, like "Backing Evolution data",
+		   the second '%s' is the size done so far and the third '%s' is the total size, like "1.2 GB of 30.0 GB" */
+		text = g_strdup_printf (_("%s (%s of %s)"), txt, done_str, total_str);
+
+		gtk_progress_bar_set_fraction ((GtkProgressBar *) pbar, (gdouble) done / total);
+		gtk_progress_bar_set_text ((GtkProgressBar *) pbar, text);
+
+		g_free (done_str);
+		g_free (total_str);
+		g_free (text);
+	} else {
+		gtk_progress_bar_pulse ((GtkProgressBar *) pbar);
+		gtk_progress_bar_set_text ((GtkProgressBar *) pbar, txt);
+	}
 
 	/* Return TRUE to reschedule the timeout. */
 	return !g_cancellable_is_cancelled (cancellable);
@@ -20,6 +20,8 @@
 #include "e-autosave-utils.h"
 
 #include <errno.h>
+#include <fcntl.h>
+#include <string.h>
 #include <glib/gstdio.h>
 #include <camel/camel.h>
 
@@ -29,8 +31,22 @@
 #define SNAPSHOT_FILE_PREFIX	".evolution-composer.autosave"
 #define SNAPSHOT_FILE_SEED	SNAPSHOT_FILE_PREFIX "-XXXXXX"
 
+/* Attachments are stored only once, named by their checksum, in a side
+ * directory beside the snapshot file.  The snapshot file itself holds
+ * the message with stub parts, each with a header with the checksum,
+ * thus the periodic saves rewrite only the body and the headers. */
+#define SNAPSHOT_PARTS_KEY	"e-composer-snapshot-parts"
+#define SNAPSHOT_PARTS_SUFFIX	".parts"
+#define SNAPSHOT_PART_HEADER	"X-Evolution-Autosave-Part"
+
+/* Smaller attachments are kept inline in the snapshot file. */
+#define SNAPSHOT_PART_MIN_SIZE	(16 * 1024)
+
 typedef struct _LoadContext LoadContext;
 typedef struct _SaveContext SaveContext;
+typedef struct _SnapshotParts SnapshotParts;
+typedef struct _SnapshotPartState SnapshotPartState;
+typedef struct _WriteSnapshotData WriteSnapshotData;
 
 struct _LoadContext {
 	EMsgComposer *composer;
@@ -41,6 +57,29 @@ struct _SaveContext {
 	GOutputStream *output_stream;
 };
 
+/* Attached to the composer.  The lock serializes the snapshot writes,
+ * the checksums are of the attachments stored by the last snapshot,
+ * CamelMimePart ~> SnapshotPartState, so that the unchanged attachments
+ * are not serialized again. */
+struct _SnapshotParts {
+	GMutex lock;
+	GHashTable *checksums;
+};
+
+/* The headers are compared too, because the stored file includes them
+ * and they can change on the same part, like the file name. */
+struct _SnapshotPartState {
+	gchar *headers;
+	gchar *checksum;	/* an empty string when kept inline */
+};
+
+struct _WriteSnapshotData {
+	GOutputStream *output_stream;
+	SnapshotParts *parts;
+	gchar *parts_dir;
+	EMsgComposer *composer;
+};
+
 static void
 load_context_free (LoadContext *context)
 {
@@ -62,13 +101,384 @@ save_context_free (SaveContext *context)
 	g_slice_free (SaveContext, context);
 }
 
+static void
+snapshot_part_state_free (gpointer ptr)
+{
+	SnapshotPartState *state = ptr;
+
+	if (state != NULL) {
+		g_free (state->headers);
+		g_free (state->checksum);
+		g_slice_free (SnapshotPartState, state);
+	}
+}
+
+static void
+snapshot_parts_free (SnapshotParts *parts)
+{
+	g_mutex_clear (&parts->lock);
+	g_hash_table_destroy (parts->checksums);
+
+	g_slice_free (SnapshotParts, parts);
+}
+
+static SnapshotParts *
+snapshot_parts_get (EMsgComposer *composer)
+{
+	SnapshotParts *parts;
+
+	parts = g_object_get_data (G_OBJECT (composer), SNAPSHOT_PARTS_KEY);
+
+	if (parts == NULL) {
+		parts = g_slice_new0 (SnapshotParts);
+		g_mutex_init (&parts->lock);
+		parts->checksums = g_hash_table_new_full (
+			g_direct_hash, g_direct_equal,
+			g_object_unref, snapshot_part_state_free);
+
+		g_object_set_data_full (
+			G_OBJECT (composer),
+			SNAPSHOT_PARTS_KEY, parts,
+			(GDestroyNotify) snapshot_parts_free);
+	}
+
+	return parts;
+}
+
+static void
+write_snapshot_data_free (WriteSnapshotData *data)
+{
+	g_clear_object (&data->output_stream);
+	g_clear_object (&data->composer);
+	g_free (data->parts_dir);
+
+	g_slice_free (WriteSnapshotData, data);
+}
+
+static gchar *
+snapshot_parts_dir_path (GFile *snapshot_file)
+{
+	gchar *path, *parts_dir;
+
+	path = g_file_get_path (snapshot_file);
+	if (path == NULL)
+		return NULL;
+
+	parts_dir = g_strconcat (path, SNAPSHOT_PARTS_SUFFIX, NULL);
+
+	g_free (path);
+
+	return parts_dir;
+}
+
+static gboolean
+snapshot_checksum_is_valid (const gchar *checksum)
+{
+	/* It's used as a file name, thus be strict. */
+	return checksum != NULL && *checksum != '\0' &&
+		strspn (checksum, "0123456789abcdef") == strlen (checksum);
+}
+
+/* Deletes files in the parts directory which are not in the @keep set,
+ * and the directory itself, when @keep is NULL. */
+static void
+snapshot_parts_dir_prune (const gchar *parts_dir,
+                          GHashTable *keep)
+{
+	GDir *dir;
+	const gchar *basename;
+
+	if (parts_dir == NULL)
+		return;
+
+	dir = g_dir_open (parts_dir, 0, NULL);
+	if (dir == NULL)
+		return;
+
+	while ((basename = g_dir_read_name (dir)) != NULL) {
+		gchar *filename;
+
+		if (keep != NULL && g_hash_table_contains (keep, basename))
+			continue;
+
+		filename = g_build_filename (parts_dir, basename, NULL);
+		g_unlink (filename);
+		g_free (filename);
+	}
+
+	g_dir_close (dir);
+
+	if (keep == NULL)
+		g_rmdir (parts_dir);
+}
+
 static void
 delete_snapshot_file (GFile *snapshot_file)
 {
+	gchar *parts_dir;
+
+	parts_dir = snapshot_parts_dir_path (snapshot_file);
+	snapshot_parts_dir_prune (parts_dir, NULL);
+	g_free (parts_dir);
+
 	g_file_delete (snapshot_file, NULL, NULL);
 	g_object_unref (snapshot_file);
 }
 
+static gchar *
+snapshot_part_headers (CamelMimePart *part)
+{
+	const CamelNameValueArray *headers;
+	GString *str;
+	guint ii, length;
+
+	str = g_string_new ("");
+	headers = camel_medium_get_headers (CAMEL_MEDIUM (part));
+	length = camel_name_value_array_get_length (headers);
+
+	for (ii = 0; ii < length; ii++) {
+		const gchar *name = NULL, *value = NULL;
+
+		if (camel_name_value_array_get (headers, ii, &name, &value))
+			g_string_append_printf (str, "%s: %s\n", name, value ? value : "");
+	}
+
+	return g_string_free (str, FALSE);
+}
+
+/* Writes the @part into @parts_dir, named by its checksum, and returns
+ * the checksum, or an empty string when the @part is too small to be
+ * stored separately.  The part goes through a temporary file, so that
+ * large attachments are never held in memory. */
+static gchar *
+snapshot_store_part (CamelMimePart *part,
+                     const gchar *parts_dir,
+                     GCancellable *cancellable,
+                     GError **error)
+{
+	CamelStream *stream;
+	GChecksum *checksum;
+	FILE *file;
+	gchar *tmp_filename, *filename, *result = NULL;
+	gchar *buffer;
+	gsize n_read, total = 0;
+	gint fd;
+
+	tmp_filename = g_build_filename (parts_dir, ".part-XXXXXX", NULL);
+	fd = g_mkstemp (tmp_filename);
+
+	if (fd == -1) {
+		g_set_error (
+			error, G_FILE_ERROR,
+			g_file_error_from_errno (errno),
+			"%s", g_strerror (errno));
+		g_free (tmp_filename);
+		return NULL;
+	}
+
+	stream = camel_stream_fs_new_with_fd (fd);
+
+	if (camel_data_wrapper_write_to_stream_sync (CAMEL_DATA_WRAPPER (part), stream, cancellable, error) < 0 ||
+	    camel_stream_flush (stream, cancellable, error) == -1) {
+		g_object_unref (stream);
+		g_unlink (tmp_filename);
+		g_free (tmp_filename);
+		return NULL;
+	}
+
+	g_object_unref (stream);
+
+	file = g_fopen (tmp_filename, "rb");
+
+	if (file == NULL) {
+		g_set_error (
+			error, G_FILE_ERROR,
+			g_file_error_from_errno (errno),
+			"%s", g_strerror (errno));
+		g_unlink (tmp_filename);
+		g_free (tmp_filename);
+		return NULL;
+	}
+
+	checksum = g_checksum_new (G_CHECKSUM_SHA256);
+	buffer = g_malloc (65536);
+
+	while ((n_read = fread (buffer, 1, 65536, file)) > 0) {
+		g_checksum_update (checksum, (const guchar *) buffer, n_read);
+		total += n_read;
+	}
+
+	fclose (file);
+	g_free (buffer);
+
+	if (total < SNAPSHOT_PART_MIN_SIZE) {
+		g_unlink (tmp_filename);
+		result = g_strdup ("");
+	} else {
+		result = g_strdup (g_checksum_get_string (checksum));
+		filename = g_build_filename (parts_dir, result, NULL);
+
+		if (g_file_test (filename, G_FILE_TEST_EXISTS)) {
+			g_unlink (tmp_filename);
+		} else if (g_rename (tmp_filename, filename) == -1) {
+			g_set_error (
+				error, G_FILE_ERROR,
+				g_file_error_from_errno (errno),
+				"%s", g_strerror (errno));
+			g_unlink (tmp_filename);
+			g_clear_pointer (&result, g_free);
+		}
+
+		g_free (filename);
+	}
+
+	g_checksum_free (checksum);
+	g_free (tmp_filename);
+
+	return result;
+}
+
+/* Replaces attachment parts of the @multipart with stub parts and
+ * writes the attachments, which are not there yet, into @parts_dir.
+ * The @seen is filled with the CamelMimePart ~> SnapshotPartState pairs
+ * and the @referenced with the checksums used by the snapshot. */
+static gboolean
+snapshot_store_parts (CamelMultipart *multipart,
+                      const gchar *parts_dir,
+                      SnapshotParts *parts,
+                      GHashTable *seen,
+                      GHashTable *referenced,
+                      GCancellable *cancellable,
+                      GError **error)
+{
+	guint ii, n_parts;
+
+	n_parts = camel_multipart_get_number (multipart);
+
+	for (ii = 0; ii < n_parts; ii++) {
+		CamelMimePart *part, *stub;
+		CamelDataWrapper *content;
+		SnapshotPartState *state;
+		const gchar *disposition;
+		gchar *checksum, *headers;
+
+		part = camel_multipart_get_part (multipart, ii);
+		content = camel_medium_get_content (CAMEL_MEDIUM (part));
+
+		if (CAMEL_IS_MULTIPART (content)) {
+			if (!snapshot_store_parts (CAMEL_MULTIPART (content), parts_dir, parts, seen, referenced, cancellable, error))
+				return FALSE;
+			continue;
+		}
+
+		disposition = camel_mime_part_get_disposition (part);
+
+		if (camel_mime_part_get_filename (part) == NULL &&
+		    g_strcmp0 (disposition, "attachment") != 0)
+			continue;
+
+		headers = snapshot_part_headers (part);
+		state = g_hash_table_lookup (parts->checksums, part);
+
+		if (state != NULL && g_strcmp0 (state->headers, headers) == 0) {
+			checksum = g_strdup (state->checksum);
+		} else {
+			checksum = snapshot_store_part (part, parts_dir, cancellable, error);
+
+			if (checksum == NULL) {
+				g_free (headers);
+				return FALSE;
+			}
+		}
+
+		state = g_slice_new0 (SnapshotPartState);
+		state->headers = headers;
+		state->checksum = g_strdup (checksum);
+
+		g_hash_table_insert (seen, g_object_ref (part), state);
+
+		if (*checksum == '\0') {
+			g_free (checksum);
+			continue;
+		}
+
+		stub = camel_mime_part_new ();
+		camel_medium_set_header (CAMEL_MEDIUM (stub), SNAPSHOT_PART_HEADER, checksum);
+		camel_mime_part_set_content (stub, "", 0, "application/octet-stream");
+
+		camel_multipart_remove_part_at (multipart, ii);
+		camel_multipart_add_part_at (multipart, stub, ii);
+
+		g_object_unref (stub);
+
+		g_hash_table_add (referenced, checksum);
+	}
+
+	return TRUE;
+}
+
+/* Replaces stub parts of the @multipart with the stored attachments. */
+static void
+snapshot_restore_parts (CamelMultipart *multipart,
+                        const gchar *parts_dir,
+                        GCancellable *cancellable)
+{
+	guint ii, n_parts;
+
+	n_parts = camel_multipart_get_number (multipart);
+
+	for (ii = 0; ii < n_parts; ii++) {
+		CamelMimePart *part;
+		CamelDataWrapper *content;
+		CamelStream *stream;
+		const gchar *checksum;
+		gchar *filename;
+		GError *local_error = NULL;
+
+		part = camel_multipart_get_part (multipart, ii);
+		content = camel_medium_get_content (CAMEL_MEDIUM (part));
+
+		if (CAMEL_IS_MULTIPART (content)) {
+			snapshot_restore_parts (CAMEL_MULTIPART (content), parts_dir, cancellable);
+			continue;
+		}
+
+		checksum = camel_medium_get_header (CAMEL_MEDIUM (part), SNAPSHOT_PART_HEADER);
+
+		if (checksum == NULL)
+			continue;
+
+		if (!snapshot_checksum_is_valid (checksum) || parts_dir == NULL) {
+			g_warning ("%s: Invalid attachment reference '%s'", G_STRFUNC, checksum);
+			continue;
+		}
+
+		filename = g_build_filename (parts_dir, checksum, NULL);
+		stream = camel_stream_fs_new_with_name (filename, O_RDONLY, 0, &local_error);
+
+		if (stream != NULL) {
+			CamelMimePart *stored;
+
+			stored = camel_mime_part_new ();
+
+			if (camel_data_wrapper_construct_from_stream_sync (CAMEL_DATA_WRAPPER (stored), stream, cancellable, &local_error)) {
+				camel_multipart_remove_part_at (multipart, ii);
+				camel_multipart_add_part_at (multipart, stored, ii);
+			}
+
+			g_object_unref (stored);
+			g_object_unref (stream);
+		}
+
+		if (local_error != NULL) {
+			g_warning ("%s: Failed to restore attachment '%s': %s", G_STRFUNC, filename, local_error->message);
+			g_clear_error (&local_error);
+		}
+
+		g_free (filename);
+	}
+}
+
 static GFile *
 create_snapshot_file (EMsgComposer *composer,
                       GError **error)
@@ -160,39 +570,17 @@ load_snapshot_loaded_cb (GFile *snapshot_file,
 	GObject *object;
 	LoadContext *context;
 	CamelMimeMessage *message;
-	CamelStream *camel_stream;
-	gchar *contents = NULL;
-	gsize length;
 	CreateComposerData *ccd;
 	GError *local_error = NULL;
 
 	context = g_simple_async_result_get_op_res_gpointer (simple);
 
-	g_file_load_contents_finish (
-		snapshot_file, result, &contents, &length, NULL, &local_error);
-
-	if (local_error != NULL) {
-		g_warn_if_fail (contents == NULL);
-		g_simple_async_result_take_error (simple, local_error);
-		g_simple_async_result_complete (simple);
-		g_object_unref (simple);
-		return;
-	}
-
-	/* Create an in-memory buffer for the MIME parser to read from.
-	 * We have to do this because CamelStreams are syncrhonous-only,
-	 * and feeding the parser a direct file stream would block. */
-	message = camel_mime_message_new ();
-	camel_stream = camel_stream_mem_new_with_buffer (contents, length);
-	camel_data_wrapper_construct_from_stream_sync (
-		CAMEL_DATA_WRAPPER (message), camel_stream, NULL, &local_error);
-	g_object_unref (camel_stream);
-	g_free (contents);
+	message = g_task_propagate_pointer (G_TASK (result), &local_error);
 
 	if (local_error != NULL) {
+		g_warn_if_fail (message == NULL);
 		g_simple_async_result_take_error (simple, local_error);
 		g_simple_async_result_complete (simple);
-		g_object_unref (message);
 		g_object_unref (simple);
 		return;
 	}
@@ -216,6 +604,55 @@ load_snapshot_loaded_cb (GFile *snapshot_file,
 	g_object_unref (object);
 }
 
+static void
+load_snapshot_thread (GTask *task,
+                      gpointer source_object,
+                      gpointer task_data,
+                      GCancellable *cancellable)
+{
+	GFile *snapshot_file;
+	CamelMimeMessage *message;
+	CamelDataWrapper *content;
+	CamelStream *camel_stream;
+	gchar *contents = NULL;
+	gsize length = 0;
+	GError *local_error = NULL;
+
+	snapshot_file = G_FILE (source_object);
+
+	if (!g_file_load_contents (snapshot_file, cancellable, &contents, &length, NULL, &local_error)) {
+		g_task_return_error (task, local_error);
+		return;
+	}
+
+	/* Parse from an in-memory buffer, the snapshot file is small,
+	 * the attachments are read from the parts directory. */
+	message = camel_mime_message_new ();
+	camel_stream = camel_stream_mem_new_with_buffer (contents, length);
+	camel_data_wrapper_construct_from_stream_sync (
+		CAMEL_DATA_WRAPPER (message), camel_stream, cancellable, &local_error);
+	g_object_unref (camel_stream);
+	g_free (contents);
+
+	if (local_error != NULL) {
+		g_task_return_error (task, local_error);
+		g_object_unref (message);
+		return;
+	}
+
+	content = camel_medium_get_content (CAMEL_MEDIUM (message));
+
+	if (CAMEL_IS_MULTIPART (content)) {
+		gchar *parts_dir;
+
+		parts_dir = snapshot_parts_dir_path (snapshot_file);
+		snapshot_restore_parts (CAMEL_MULTIPART (content), parts_dir, cancellable);
+		g_free (parts_dir);
+	}
+
+	g_task_return_pointer (task, message, g_object_unref);
+}
+
 static void
 save_snapshot_splice_cb (CamelDataWrapper *data_wrapper,
                          GAsyncResult *result,
@@ -241,17 +678,56 @@ write_message_to_stream_thread (GTask *task,
 				gpointer task_data,
 				GCancellable *cancellable)
 {
-	GOutputStream *output_stream;
-	gssize bytes_written;
+	WriteSnapshotData *data;
+	CamelDataWrapper *content;
+	GHashTable *seen, *referenced;
+	gssize bytes_written = -1;
 	GError *local_error = NULL;
 
-	output_stream = task_data;
+	data = task_data;
+
+	seen = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, snapshot_part_state_free);
+	referenced = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	g_mutex_lock (&data->parts->lock);
 
-	bytes_written = camel_data_wrapper_decode_to_output_stream_sync (
-		CAMEL_DATA_WRAPPER (source_object),
-		output_stream, cancellable, &local_error);
+	content = camel_medium_get_content (CAMEL_MEDIUM (source_object));
+
+	if (CAMEL_IS_MULTIPART (content) && data->parts_dir != NULL) {
+		if (g_mkdir_with_parents (data->parts_dir, 0700) == -1) {
+			g_set_error (
+				&local_error, G_FILE_ERROR,
+				g_file_error_from_errno (errno),
+				"%s", g_strerror (errno));
+		} else {
+			snapshot_store_parts (
+				CAMEL_MULTIPART (content), data->parts_dir,
+				data->parts, seen, referenced,
+				cancellable, &local_error);
+		}
+	}
+
+	if (local_error == NULL)
+		bytes_written = camel_data_wrapper_decode_to_output_stream_sync (
+			CAMEL_DATA_WRAPPER (source_object),
+			data->output_stream, cancellable, &local_error);
+
+	g_output_stream_close (data->output_stream, cancellable, local_error ? NULL : &local_error);
+
+	/* Remember the stored attachments and forget the removed. */
+	if (local_error == NULL) {
+		g_hash_table_destroy (data->parts->checksums);
+		data->parts->checksums = seen;
+		seen = NULL;
+
+		snapshot_parts_dir_prune (data->parts_dir, referenced);
+	}
 
-	g_output_stream_close (output_stream, cancellable, local_error ? NULL : &local_error);
+	g_mutex_unlock (&data->parts->lock);
+
+	if (seen != NULL)
+		g_hash_table_destroy (seen);
+	g_hash_table_destroy (referenced);
 
 	if (local_error != NULL) {
 		g_task_return_error (task, local_error);
@@ -267,6 +743,7 @@ save_snapshot_get_message_cb (EMsgComposer *composer,
 {
 	SaveContext *context;
 	CamelMimeMessage *message;
+	WriteSnapshotData *data;
 	GTask *task;
 	GError *local_error = NULL;
 
@@ -285,9 +762,15 @@ save_snapshot_get_message_cb (EMsgComposer *composer,
 
 	g_return_if_fail (CAMEL_IS_MIME_MESSAGE (message));
 
+	data = g_slice_new0 (WriteSnapshotData);
+	data->output_stream = g_object_ref (context->output_stream);
+	data->composer = g_object_ref (composer);
+	data->parts = snapshot_parts_get (composer);
+	data->parts_dir = snapshot_parts_dir_path (e_composer_get_snapshot_file (composer));
+
 	task = g_task_new (message, context->cancellable, (GAsyncReadyCallback) save_snapshot_splice_cb, simple);
 
-	g_task_set_task_data (task, g_object_ref (context->output_stream), g_object_unref);
+	g_task_set_task_data (task, data, (GDestroyNotify) write_snapshot_data_free);
 
 	g_task_run_in_thread (task, write_message_to_stream_thread);
 
@@ -406,6 +889,24 @@ e_composer_find_orphans (GQueue *registry,
 			continue;
 		}
 
+		/* Attachments directory of a snapshot file; delete it
+		 * when its snapshot file does not exist anymore. */
+		if (S_ISDIR (st.st_mode)) {
+			if (g_str_has_suffix (filename, SNAPSHOT_PARTS_SUFFIX)) {
+				gchar *snapshot_filename;
+
+				snapshot_filename = g_strndup (filename, strlen (filename) - strlen (SNAPSHOT_PARTS_SUFFIX));
+
+				if (!g_file_test (snapshot_filename, G_FILE_TEST_EXISTS))
+					snapshot_parts_dir_prune (filename, NULL);
+
+				g_free (snapshot_filename);
+			}
+
+			g_free (filename);
+			continue;
+		}
+
 		/* If the file is empty, delete it.  Failure here
 		 * is non-fatal; just emit a warning and move on. */
 		if (st.st_size == 0) {
@@ -438,6 +939,7 @@ e_composer_load_snapshot (EShell *shell,
 {
 	GSimpleAsyncResult *simple;
 	LoadContext *context;
+	GTask *task;
 
 	g_return_if_fail (E_IS_SHELL (shell));
 	g_return_if_fail (G_IS_FILE (snapshot_file));
@@ -453,9 +955,13 @@ e_composer_load_snapshot (EShell *shell,
 	g_simple_async_result_set_op_res_gpointer (
 		simple, context, (GDestroyNotify) load_context_free);
 
-	g_file_load_contents_async (
+	task = g_task_new (
 		snapshot_file, cancellable, (GAsyncReadyCallback)
 		load_snapshot_loaded_cb, simple);
+
+	g_task_run_in_thread (task, load_snapshot_thread);
+
+	g_object_unref (task);
 }
 
 EMsgComposer *
@@ -0,0 +1,716 @@
+/*
+ * itip-uid-index.c
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Remembers which calendars contain which component UIDs, thus
+ * the iTIP view does not need to ask every calendar whether it
+ * contains the component of the shown invitation.  Each enabled
+ * calendar has a running ECalClientView, which keeps the index
+ * up to date.  Calendars whose view did not complete (yet) are
+ * not known to the index and should be searched as before.
+ *
+ * The content of each calendar is also saved into the user cache
+ * directory, together with the calendar revision.  When the revision
+ * did not change since the save, the saved content is used until
+ * the view completes, thus the index is usable right after start.
+ * The revision is always read before the content it is saved with,
+ * because a revision newer than the content would hide components
+ * added meanwhile. */
+
+#include "evolution-config.h"
+
+#include "itip-uid-index.h"
+
+typedef struct _SourceWatch {
+	ItipUidIndex *uid_index;
+	gchar *source_uid;
+	GCancellable *cancellable;
+	ECalClient *client;
+	ECalClientView *view;
+	gboolean complete;
+	gboolean from_cache;	/* content loaded from the saved index */
+	gchar *revision;	/* read before the content it describes */
+	gboolean revision_pending;
+	gboolean changed;	/* since the revision was read */
+	gboolean unsaved;	/* the content with the revision */
+} SourceWatch;
+
+struct _ItipUidIndex {
+	EClientCache *client_cache;
+	ESourceRegistry *registry;
+	const gchar *extension_name;
+
+	GHashTable *watches;	/* source UID ~> SourceWatch * */
+	GHashTable *uids;	/* component UID ~> GHashTable { source UID ~> GHashTable { RID } } */
+
+	gchar *filename;
+	GKeyFile *saved;	/* source UID ~> Revision, UIDs and RIDs */
+	gboolean saved_changed;	/* not written to the file yet */
+	guint save_id;
+};
+
+static ItipUidIndex *uid_indexes[3];	/* one per ECalClientSourceType */
+
+/* Delay between a change and the save of the index */
+#define UID_INDEX_SAVE_TIMEOUT_SECONDS 10
+
+static void uid_index_schedule_save (ItipUidIndex *uid_index);
+
+static void
+source_watch_free (gpointer ptr)
+{
+	SourceWatch *watch = ptr;
+
+	if (watch) {
+		g_object_set_data (G_OBJECT (watch->cancellable), "itip-uid-index-watch", NULL);
+		g_cancellable_cancel (watch->cancellable);
+		g_object_unref (watch->cancellable);
+
+		if (watch->view) {
+			g_signal_handlers_disconnect_by_data (watch->view, watch);
+			e_cal_client_view_stop (watch->view, NULL);
+			g_object_unref (watch->view);
+		}
+
+		g_clear_object (&watch->client);
+
+		g_free (watch->revision);
+		g_free (watch->source_uid);
+		g_free (watch);
+	}
+}
+
+static gchar *
+uid_index_dup_rid (icalcomponent *icalcomp)
+{
+	struct icaltimetype rid;
+
+	rid = icalcomponent_get_recurrenceid (icalcomp);
+
+	if (icaltime_is_null_time (rid) || !icaltime_is_valid_time (rid))
+		return g_strdup ("");
+
+	return g_strdup (icaltime_as_ical_string (rid));
+}
+
+static void
+uid_index_add (ItipUidIndex *uid_index,
+               const gchar *source_uid,
+               const gchar *uid,
+               gchar *rid) /* (transfer full) */
+{
+	GHashTable *sources, *rids;
+
+	sources = g_hash_table_lookup (uid_index->uids, uid);
+	if (!sources) {
+		sources = g_hash_table_new_full (
+			g_str_hash, g_str_equal, g_free,
+			(GDestroyNotify) g_hash_table_destroy);
+		g_hash_table_insert (uid_index->uids, g_strdup (uid), sources);
+	}
+
+	rids = g_hash_table_lookup (sources, source_uid);
+	if (!rids) {
+		rids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+		g_hash_table_insert (sources, g_strdup (source_uid), rids);
+	}
+
+	g_hash_table_add (rids, rid);
+}
+
+static void
+uid_index_remove (ItipUidIndex *uid_index,
+                  const gchar *source_uid,
+                  const gchar *uid,
+                  const gchar *rid)
+{
+	GHashTable *sources, *rids;
+
+	sources = g_hash_table_lookup (uid_index->uids, uid);
+	rids = sources ? g_hash_table_lookup (sources, source_uid) : NULL;
+
+	if (!rids)
+		return;
+
+	g_hash_table_remove (rids, rid ? rid : "");
+
+	if (!g_hash_table_size (rids)) {
+		g_hash_table_remove (sources, source_uid);
+
+		if (!g_hash_table_size (sources))
+			g_hash_table_remove (uid_index->uids, uid);
+	}
+}
+
+static void
+uid_index_remove_source (ItipUidIndex *uid_index,
+                         const gchar *source_uid)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	g_hash_table_iter_init (&iter, uid_index->uids);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		GHashTable *sources = value;
+
+		g_hash_table_remove (sources, source_uid);
+
+		if (!g_hash_table_size (sources))
+			g_hash_table_iter_remove (&iter);
+	}
+}
+
+static void
+source_watch_changed (SourceWatch *watch)
+{
+	watch->changed = TRUE;
+
+	if (watch->complete)
+		uid_index_schedule_save (watch->uid_index);
+}
+
+/* Calendars with an unknown content are searched, thus
+ * there is no need to keep what cannot be trusted. */
+static void
+source_watch_forget_content (SourceWatch *watch)
+{
+	watch->complete = FALSE;
+	watch->from_cache = FALSE;
+
+	uid_index_remove_source (watch->uid_index, watch->source_uid);
+}
+
+static void
+source_watch_objects_added_cb (ECalClientView *view,
+                               const GSList *objects,
+                               SourceWatch *watch)
+{
+	const GSList *link;
+
+	for (link = objects; link; link = g_slist_next (link)) {
+		icalcomponent *icalcomp = link->data;
+		const gchar *uid;
+
+		uid = icalcomponent_get_uid (icalcomp);
+		if (uid && *uid)
+			uid_index_add (watch->uid_index, watch->source_uid, uid, uid_index_dup_rid (icalcomp));
+	}
+
+	source_watch_changed (watch);
+}
+
+static void
+source_watch_objects_removed_cb (ECalClientView *view,
+                                 const GSList *ids,
+                                 SourceWatch *watch)
+{
+	const GSList *link;
+
+	for (link = ids; link; link = g_slist_next (link)) {
+		ECalComponentId *id = link->data;
+
+		if (id && id->uid)
+			uid_index_remove (watch->uid_index, watch->source_uid, id->uid, id->rid);
+	}
+
+	source_watch_changed (watch);
+}
+
+static void
+source_watch_complete_cb (ECalClientView *view,
+                          const GError *error,
+                          SourceWatch *watch)
+{
+	/* Keep it unknown on error, thus the calendar is searched */
+	if (error) {
+		source_watch_forget_content (watch);
+		return;
+	}
+
+	/* The revision was read before the view started, thus
+	 * the content is not older than it. */
+	watch->complete = TRUE;
+	watch->changed = FALSE;
+	watch->unsaved = TRUE;
+
+	uid_index_schedule_save (watch->uid_index);
+}
+
+/* The asynchronous calls get a reference of the watch's cancellable
+ * as their user data, because the watch can be freed meanwhile. */
+static SourceWatch *
+source_watch_from_cancellable (GCancellable *cancellable)
+{
+	if (g_cancellable_is_cancelled (cancellable))
+		return NULL;
+
+	return g_object_get_data (G_OBJECT (cancellable), "itip-uid-index-watch");
+}
+
+static void
+source_watch_load_saved_content (SourceWatch *watch)
+{
+	ItipUidIndex *uid_index = watch->uid_index;
+	gchar **uids, **rids;
+	gsize n_uids = 0, n_rids = 0, ii;
+
+	uids = g_key_file_get_string_list (uid_index->saved, watch->source_uid, "UIDs", &n_uids, NULL);
+	rids = g_key_file_get_string_list (uid_index->saved, watch->source_uid, "RIDs", &n_rids, NULL);
+
+	if (uids && rids && n_uids == n_rids) {
+		for (ii = 0; ii < n_uids; ii++) {
+			if (*uids[ii])
+				uid_index_add (uid_index, watch->source_uid, uids[ii], g_strdup (rids[ii]));
+		}
+
+		watch->from_cache = TRUE;
+	}
+
+	g_strfreev (uids);
+	g_strfreev (rids);
+}
+
+static void
+source_watch_view_ready_cb (GObject *source_object,
+                            GAsyncResult *result,
+                            gpointer user_data)
+{
+	GCancellable *cancellable = user_data;
+	SourceWatch *watch;
+	ECalClientView *view = NULL;
+	GSList *fields;
+	GError *error = NULL;
+
+	if (!e_cal_client_get_view_finish (E_CAL_CLIENT (source_object), result, &view, &error)) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("%s: Failed to get view: %s", G_STRFUNC, error ? error->message : "Unknown error");
+		g_clear_error (&error);
+
+		watch = source_watch_from_cancellable (cancellable);
+		if (watch)
+			source_watch_forget_content (watch);
+
+		g_object_unref (cancellable);
+		return;
+	}
+
+	watch = source_watch_from_cancellable (cancellable);
+	g_object_unref (cancellable);
+
+	if (!watch) {
+		g_object_unref (view);
+		return;
+	}
+
+	watch->view = view;
+
+	g_signal_connect (view, "objects-added", G_CALLBACK (source_watch_objects_added_cb), watch);
+	g_signal_connect (view, "objects-modified", G_CALLBACK (source_watch_objects_added_cb), watch);
+	g_signal_connect (view, "objects-removed", G_CALLBACK (source_watch_objects_removed_cb), watch);
+	g_signal_connect (view, "complete", G_CALLBACK (source_watch_complete_cb), watch);
+
+	/* Only the identity of the components is interesting */
+	fields = g_slist_prepend (NULL, (gpointer) "RECURRENCE-ID");
+	fields = g_slist_prepend (fields, (gpointer) "UID");
+	e_cal_client_view_set_fields_of_interest (view, fields, NULL);
+	g_slist_free (fields);
+
+	e_cal_client_view_start (view, &error);
+
+	if (error) {
+		g_warning ("%s: Failed to start view: %s", G_STRFUNC, error->message);
+		g_clear_error (&error);
+
+		source_watch_forget_content (watch);
+	}
+}
+
+static void
+source_watch_revision_ready_cb (GObject *source_object,
+                                GAsyncResult *result,
+                                gpointer user_data)
+{
+	GCancellable *cancellable = user_data;
+	SourceWatch *watch;
+	gchar *revision = NULL, *saved_revision;
+
+	if (!e_client_get_backend_property_finish (E_CLIENT (source_object), result, &revision, NULL))
+		g_clear_pointer (&revision, g_free);
+
+	watch = source_watch_from_cancellable (cancellable);
+
+	if (!watch) {
+		g_object_unref (cancellable);
+		g_free (revision);
+		return;
+	}
+
+	if (revision && *revision) {
+		saved_revision = g_key_file_get_string (watch->uid_index->saved, watch->source_uid, "Revision", NULL);
+
+		/* The calendar did not change since the index was saved */
+		if (g_strcmp0 (revision, saved_revision) == 0)
+			source_watch_load_saved_content (watch);
+
+		g_free (saved_revision);
+
+		watch->revision = revision;
+	} else {
+		g_free (revision);
+	}
+
+	/* Passes the reference of the cancellable */
+	e_cal_client_get_view (
+		watch->client, "#t", cancellable,
+		source_watch_view_ready_cb, cancellable);
+}
+
+static void
+source_watch_client_ready_cb (GObject *source_object,
+                              GAsyncResult *result,
+                              gpointer user_data)
+{
+	GCancellable *cancellable = user_data;
+	SourceWatch *watch;
+	EClient *client;
+	GError *error = NULL;
+
+	client = e_client_cache_get_client_finish (E_CLIENT_CACHE (source_object), result, &error);
+
+	if (!client) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_debug ("%s: Failed to open calendar: %s", G_STRFUNC, error ? error->message : "Unknown error");
+		g_clear_error (&error);
+		g_object_unref (cancellable);
+		return;
+	}
+
+	watch = source_watch_from_cancellable (cancellable);
+
+	if (watch) {
+		watch->client = E_CAL_CLIENT (g_object_ref (client));
+
+		/* The view is started after the revision is read, thus the
+		 * revision is not newer than the content; this passes the
+		 * reference of the cancellable. */
+		e_client_get_backend_property (
+			client, CLIENT_BACKEND_PROPERTY_REVISION, cancellable,
+			source_watch_revision_ready_cb, cancellable);
+	} else {
+		g_object_unref (cancellable);
+	}
+
+	g_object_unref (client);
+}
+
+static void
+uid_index_watch_source (ItipUidIndex *uid_index,
+                        ESource *source)
+{
+	SourceWatch *watch;
+	const gchar *source_uid;
+
+	source_uid = e_source_get_uid (source);
+
+	if (!e_source_has_extension (source, uid_index->extension_name) ||
+	    !e_source_registry_check_enabled (uid_index->registry, source) ||
+	    g_hash_table_contains (uid_index->watches, source_uid))
+		return;
+
+	watch = g_new0 (SourceWatch, 1);
+	watch->uid_index = uid_index;
+	watch->source_uid = g_strdup (source_uid);
+	watch->cancellable = g_cancellable_new ();
+
+	g_object_set_data (G_OBJECT (watch->cancellable), "itip-uid-index-watch", watch);
+
+	g_hash_table_insert (uid_index->watches, watch->source_uid, watch);
+
+	e_client_cache_get_client (
+		uid_index->client_cache, source, uid_index->extension_name, 30,
+		watch->cancellable, source_watch_client_ready_cb, g_object_ref (watch->cancellable));
+}
+
+static void
+uid_index_unwatch_source (ItipUidIndex *uid_index,
+                          ESource *source)
+{
+	const gchar *source_uid;
+
+	source_uid = e_source_get_uid (source);
+
+	if (g_hash_table_remove (uid_index->watches, source_uid))
+		uid_index_remove_source (uid_index, source_uid);
+
+	if (g_key_file_remove_group (uid_index->saved, source_uid, NULL)) {
+		uid_index->saved_changed = TRUE;
+		uid_index_schedule_save (uid_index);
+	}
+}
+
+static void
+uid_index_write_file (ItipUidIndex *uid_index)
+{
+	gchar *contents;
+	gsize length = 0;
+	GError *error = NULL;
+
+	contents = g_key_file_to_data (uid_index->saved, &length, NULL);
+
+	if (!g_file_set_contents (uid_index->filename, contents, length, &error)) {
+		g_warning ("%s: Failed to save '%s': %s", G_STRFUNC, uid_index->filename, error ? error->message : "Unknown error");
+		g_clear_error (&error);
+	}
+
+	g_free (contents);
+}
+
+/* Stores the content of the calendar with its revision into the key file */
+static void
+source_watch_store_content (SourceWatch *watch)
+{
+	GKeyFile *saved = watch->uid_index->saved;
+	GPtrArray *uids, *rids;
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_key_file_remove_group (saved, watch->source_uid, NULL);
+
+	watch->uid_index->saved_changed = TRUE;
+
+	/* Nothing to tell the content is still valid with */
+	if (!watch->revision)
+		return;
+
+	uids = g_ptr_array_new ();
+	rids = g_ptr_array_new ();
+
+	g_hash_table_iter_init (&iter, watch->uid_index->uids);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		GHashTable *rids_set;
+		GHashTableIter riter;
+		gpointer rid;
+
+		rids_set = g_hash_table_lookup (value, watch->source_uid);
+		if (!rids_set)
+			continue;
+
+		g_hash_table_iter_init (&riter, rids_set);
+		while (g_hash_table_iter_next (&riter, &rid, NULL)) {
+			g_ptr_array_add (uids, key);
+			g_ptr_array_add (rids, rid);
+		}
+	}
+
+	g_key_file_set_string (saved, watch->source_uid, "Revision", watch->revision);
+	g_key_file_set_string_list (saved, watch->source_uid, "UIDs",
+		(const gchar * const *) uids->pdata, uids->len);
+	g_key_file_set_string_list (saved, watch->source_uid, "RIDs",
+		(const gchar * const *) rids->pdata, rids->len);
+
+	g_ptr_array_free (uids, TRUE);
+	g_ptr_array_free (rids, TRUE);
+}
+
+static void
+source_watch_save_revision_ready_cb (GObject *source_object,
+                                     GAsyncResult *result,
+                                     gpointer user_data)
+{
+	GCancellable *cancellable = user_data;
+	SourceWatch *watch;
+	gchar *revision = NULL;
+
+	if (!e_client_get_backend_property_finish (E_CLIENT (source_object), result, &revision, NULL))
+		g_clear_pointer (&revision, g_free);
+
+	watch = source_watch_from_cancellable (cancellable);
+	g_object_unref (cancellable);
+
+	if (!watch) {
+		g_free (revision);
+		return;
+	}
+
+	watch->revision_pending = FALSE;
+
+	if (!watch->complete) {
+		g_free (revision);
+		return;
+	}
+
+	g_free (watch->revision);
+	watch->revision = (revision && *revision) ? revision : NULL;
+	if (!watch->revision)
+		g_free (revision);
+
+	/* The content is taken on the next save, when the view had time
+	 * to notify about the changes done before the revision was read. */
+	watch->changed = FALSE;
+	watch->unsaved = TRUE;
+
+	uid_index_schedule_save (watch->uid_index);
+}
+
+static gboolean
+uid_index_save_cb (gpointer user_data)
+{
+	ItipUidIndex *uid_index = user_data;
+	GHashTableIter iter;
+	gpointer value;
+
+	uid_index->save_id = 0;
+
+	g_hash_table_iter_init (&iter, uid_index->watches);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		SourceWatch *watch = value;
+
+		if (!watch->complete)
+			continue;
+
+		if (watch->changed) {
+			/* The content is newer than the revision */
+			if (watch->client && !watch->revision_pending) {
+				watch->revision_pending = TRUE;
+
+				e_client_get_backend_property (
+					E_CLIENT (watch->client), CLIENT_BACKEND_PROPERTY_REVISION, watch->cancellable,
+					source_watch_save_revision_ready_cb, g_object_ref (watch->cancellable));
+			}
+		} else if (watch->unsaved) {
+			source_watch_store_content (watch);
+			watch->unsaved = FALSE;
+		}
+	}
+
+	/* Once for all the calendars; includes also the removed ones */
+	if (uid_index->saved_changed) {
+		uid_index->saved_changed = FALSE;
+		uid_index_write_file (uid_index);
+	}
+
+	return FALSE;
+}
+
+static void
+uid_index_schedule_save (ItipUidIndex *uid_index)
+{
+	if (!uid_index->save_id)
+		uid_index->save_id = e_named_timeout_add_seconds (
+			UID_INDEX_SAVE_TIMEOUT_SECONDS, uid_index_save_cb, uid_index);
+}
+
+static const gchar *
+uid_index_get_extension_name (ECalClientSourceType type)
+{
+	switch (type) {
+		case E_CAL_CLIENT_SOURCE_TYPE_EVENTS:
+			return E_SOURCE_EXTENSION_CALENDAR;
+		case E_CAL_CLIENT_SOURCE_TYPE_TASKS:
+			return E_SOURCE_EXTENSION_TASK_LIST;
+		case E_CAL_CLIENT_SOURCE_TYPE_MEMOS:
+			return E_SOURCE_EXTENSION_MEMO_LIST;
+		default:
+			break;
+	}
+
+	g_return_val_if_reached (NULL);
+}
+
+/* Returns a shared index for the calendars of the @type; the index
+ * exists for the rest of the session.  It starts to load on the first
+ * call, thus the first invitation can still fall back to the search. */
+ItipUidIndex *
+itip_uid_index_get (EClientCache *client_cache,
+                    ECalClientSourceType type)
+{
+	ItipUidIndex *uid_index;
+	const gchar *extension_name;
+	GList *sources, *link;
+
+	g_return_val_if_fail (E_IS_CLIENT_CACHE (client_cache), NULL);
+
+	extension_name = uid_index_get_extension_name (type);
+	if (!extension_name || type >= G_N_ELEMENTS (uid_indexes))
+		return NULL;
+
+	if (uid_indexes[type])
+		return uid_indexes[type];
+
+	uid_index = g_new0 (ItipUidIndex, 1);
+	uid_index->client_cache = g_object_ref (client_cache);
+	uid_index->registry = e_client_cache_ref_registry (client_cache);
+	uid_index->extension_name = extension_name;
+	uid_index->watches = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, source_watch_free);
+	uid_index->uids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_hash_table_destroy);
+	uid_index->saved = g_key_file_new ();
+	uid_index->filename = g_strdup_printf ("%s" G_DIR_SEPARATOR_S "itip-uid-index-%d.ini", e_get_user_cache_dir (), type);
+
+	/* It's fine when the file does not exist */
+	g_key_file_load_from_file (uid_index->saved, uid_index->filename, G_KEY_FILE_NONE, NULL);
+
+	g_signal_connect_swapped (
+		uid_index->registry, "source-added",
+		G_CALLBACK (uid_index_watch_source), uid_index);
+	g_signal_connect_swapped (
+		uid_index->registry, "source-enabled",
+		G_CALLBACK (uid_index_watch_source), uid_index);
+	g_signal_connect_swapped (
+		uid_index->registry, "source-removed",
+		G_CALLBACK (uid_index_unwatch_source), uid_index);
+	g_signal_connect_swapped (
+		uid_index->registry, "source-disabled",
+		G_CALLBACK (uid_index_unwatch_source), uid_index);
+
+	sources = e_source_registry_list_enabled (uid_index->registry, extension_name);
+
+	for (link = sources; link; link = g_list_next (link))
+		uid_index_watch_source (uid_index, link->data);
+
+	g_list_free_full (sources, g_object_unref);
+
+	uid_indexes[type] = uid_index;
+
+	return uid_index;
+}
+
+/* Returns whether the calendar of the @source can contain a component
+ * with the @uid; that is, either it's known to contain it, or the index
+ * does not know the content of the calendar. */
+gboolean
+itip_uid_index_maybe_contains (ItipUidIndex *uid_index,
+                               ESource *source,
+                               const gchar *uid)
+{
+	SourceWatch *watch;
+	GHashTable *sources;
+	const gchar *source_uid;
+
+	g_return_val_if_fail (E_IS_SOURCE (source), TRUE);
+
+	if (!uid_index || !uid)
+		return TRUE;
+
+	source_uid = e_source_get_uid (source);
+
+	watch = g_hash_table_lookup (uid_index->watches, source_uid);
+	if (!watch || !(watch->complete || watch->from_cache))
+		return TRUE;
+
+	sources = g_hash_table_lookup (uid_index->uids, uid);
+
+	return sources && g_hash_table_contains (sources, source_uid);
+}
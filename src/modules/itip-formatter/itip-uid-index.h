@@ -0,0 +1,36 @@
+/*
+ * itip-uid-index.h
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ITIP_UID_INDEX_H
+#define ITIP_UID_INDEX_H
+
+#include <libecal/libecal.h>
+#include <e-util/e-util.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ItipUidIndex ItipUidIndex;
+
+ItipUidIndex *	itip_uid_index_get		(EClientCache *client_cache,
+						 ECalClientSourceType type);
+gboolean	itip_uid_index_maybe_contains	(ItipUidIndex *uid_index,
+						 ESource *source,
+						 const gchar *uid);
+
+G_END_DECLS
+
+#endif /* ITIP_UID_INDEX_H */
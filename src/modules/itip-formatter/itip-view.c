@@ -35,6 +35,7 @@
 #include <em-format/e-mail-formatter-utils.h>
 
 #include "itip-view.h"
+#include "itip-uid-index.h"
 #include "e-mail-part-itip.h"
 
 #include "itip-view-elements-defines.h"
@@ -4168,7 +4169,8 @@ static void
 find_server (ItipView *view,
              ECalComponent *comp)
 {
-	FormatItipFindData *fd = NULL;
+	FormatItipFindData *fd;
+	ItipUidIndex *uid_index = NULL;
 	const gchar *uid;
 	gchar *rid = NULL;
 	CamelStore *parent_store;
@@ -4255,41 +4257,56 @@ find_server (ItipView *view,
 			_("Searching for an existing version of this appointment"));
 	}
 
+	fd = g_new0 (FormatItipFindData, 1);
+	fd->view = g_object_ref (view);
+	fd->itip_cancellable = g_object_ref (view->priv->cancellable);
+	fd->cancellable = g_cancellable_new ();
+	fd->cancelled_id = g_cancellable_connect (
+		fd->itip_cancellable,
+		G_CALLBACK (itip_cancellable_cancelled), fd->cancellable, NULL);
+	fd->conflicts = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) e_cal_client_free_icalcomp_slist);
+	fd->uid = g_strdup (uid);
+	fd->rid = rid;
+	/* avoid free this at the end */
+	rid = NULL;
+
+	if (view->priv->start_time && view->priv->end_time) {
+		gchar *start, *end;
+
+		start = isodate_from_time_t (view->priv->start_time);
+		end = isodate_from_time_t (view->priv->end_time);
+
+		fd->sexp = g_strdup_printf (
+			"(and (occur-in-time-range? "
+			"(make-time \"%s\") "
+			"(make-time \"%s\")) "
+			"(not (uid? \"%s\")))",
+			start, end,
+			icalcomponent_get_uid (view->priv->ical_comp));
+
+		g_free (start);
+		g_free (end);
+	}
+
+	/* Hold the search until all calendars are started, thus
+	 * the result is shown even when no calendar is searched. */
+	fd->count = 1;
+
+	if (!current_source && view->priv->client_cache)
+		uid_index = itip_uid_index_get (view->priv->client_cache, view->priv->type);
+
 	for (; link != NULL; link = g_list_next (link)) {
 		ESource *source = E_SOURCE (link->data);
 
-		if (!fd) {
-			gchar *start = NULL, *end = NULL;
-
-			fd = g_new0 (FormatItipFindData, 1);
-			fd->view = g_object_ref (view);
-			fd->itip_cancellable = g_object_ref (view->priv->cancellable);
-			fd->cancellable = g_cancellable_new ();
-			fd->cancelled_id = g_cancellable_connect (
-				fd->itip_cancellable,
-				G_CALLBACK (itip_cancellable_cancelled), fd->cancellable, NULL);
-			fd->conflicts = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) e_cal_client_free_icalcomp_slist);
-			fd->uid = g_strdup (uid);
-			fd->rid = rid;
-			/* avoid free this at the end */
-			rid = NULL;
-
-			if (view->priv->start_time && view->priv->end_time) {
-				start = isodate_from_time_t (view->priv->start_time);
-				end = isodate_from_time_t (view->priv->end_time);
-
-				fd->sexp = g_strdup_printf (
-					"(and (occur-in-time-range? "
-					"(make-time \"%s\") "
-					"(make-time \"%s\")) "
-					"(not (uid? \"%s\")))",
-					start, end,
-					icalcomponent_get_uid (view->priv->ical_comp));
-			}
-
-			g_free (start);
-			g_free (end);
+		/* Calendars, which are known not to contain the component,
+		 * need to be opened only when searching them for conflicts. */
+		if (uid_index &&
+		    !g_list_find (conflict_list, source) &&
+		    !itip_uid_index_maybe_contains (uid_index, source, uid)) {
+			d (printf ("Skipping calendar '%s', it does not contain '%s'\n", e_source_get_uid (source), uid));
+			continue;
 		}
+
 		fd->count++;
 		d (printf ("Increasing itip formatter search count to %d\n", fd->count));
 
@@ -4298,6 +4315,8 @@ find_server (ItipView *view,
 			find_cal_opened_cb, fd);
 	}
 
+	decrease_find_data (fd);
+
 	g_list_free_full (conflict_list, (GDestroyNotify) g_object_unref);
 	g_list_free_full (list, (GDestroyNotify) g_object_unref);
 
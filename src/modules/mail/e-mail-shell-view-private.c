@@ -769,6 +769,8 @@ e_mail_shell_view_private_dispose (EMailShellView *mail_shell_view)
 		priv->search_account_cancel = NULL;
 	}
 
+	g_clear_pointer (&priv->search_account_key, g_free);
+
 	g_slist_free_full (priv->selected_uids, (GDestroyNotify) camel_pstring_free);
 	priv->selected_uids = NULL;
 }
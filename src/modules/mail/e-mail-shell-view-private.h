@@ -134,6 +134,7 @@ struct _EMailShellViewPrivate {
 	CamelVeeFolder *search_account_all;
 	CamelVeeFolder *search_account_current;
 	GCancellable *search_account_cancel;
+	gchar *search_account_key;	/* of the search being run */
 
 	GtkToolItem *send_receive_tool_item;
 	GtkToolItem *send_receive_tool_separator;
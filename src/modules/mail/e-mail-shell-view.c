@@ -47,15 +47,101 @@ static const gchar *SEARCH_RESULTS_STATE =
 "  </grouping>"
 "</ETableState>";
 
+/* Maximum number of source folders searched at the same time
+ * when populating the "All Accounts" or "Current Account" folder. */
+#define SEARCH_RESULTS_MAX_WORKERS 4
+
+#define SEARCH_RESULTS_SOURCES_KEY "e-mail-shell-view-search-sources"
+#define SEARCH_RESULTS_TEXT_KEY "e-mail-shell-view-search-text"
+
+/* Source folders of the last complete search,
+ * kept on the search folder for query refinements. */
+typedef struct {
+	gchar *stores_key;
+	gint stamp;		/* of search_results_sources_stamp */
+	GPtrArray *folders;	/* CamelFolder */
+} SearchResultsSources;
+
+/* Increased whenever a folder is created, deleted, renamed, subscribed
+ * or unsubscribed, which makes all the remembered sources outdated. */
+static volatile gint search_results_sources_stamp = 0;
+
+typedef struct {
+	CamelStore *store;
+	gchar *full_name;
+	CamelFolder *folder;	/* set when already opened */
+} SearchResultsItem;
+
+typedef struct {
+	CamelVeeFolder *vfolder;
+	GCancellable *cancellable;
+
+	GMutex lock;
+	GPtrArray *folders;	/* CamelFolder */
+	guint n_done;
+	guint n_total;
+	gboolean message_pushed;
+} SearchResultsJob;
+
 static void
-add_folders_from_store (GList **folders,
+search_results_sources_free (SearchResultsSources *sources)
+{
+	g_free (sources->stores_key);
+	g_ptr_array_unref (sources->folders);
+	g_slice_free (SearchResultsSources, sources);
+}
+
+static SearchResultsItem *
+search_results_item_new (CamelStore *store,
+                         const gchar *full_name,
+                         CamelFolder *folder)
+{
+	SearchResultsItem *item;
+
+	item = g_slice_new0 (SearchResultsItem);
+	item->store = store ? g_object_ref (store) : NULL;
+	item->full_name = g_strdup (full_name);
+	item->folder = folder ? g_object_ref (folder) : NULL;
+
+	return item;
+}
+
+static void
+search_results_item_free (SearchResultsItem *item)
+{
+	g_clear_object (&item->store);
+	g_clear_object (&item->folder);
+	g_free (item->full_name);
+	g_slice_free (SearchResultsItem, item);
+}
+
+static gchar *
+search_results_dup_stores_key (GList *stores_list)
+{
+	GString *key;
+	GList *link;
+
+	key = g_string_new ("");
+
+	for (link = stores_list; link != NULL; link = link->next) {
+		CamelService *service = CAMEL_SERVICE (link->data);
+
+		g_string_append (key, camel_service_get_uid (service));
+		g_string_append_c (key, '\n');
+	}
+
+	return g_string_free (key, FALSE);
+}
+
+static void
+add_folders_from_store (GQueue *items,
                         CamelStore *store,
                         GCancellable *cancellable,
                         GError **error)
 {
 	CamelFolderInfo *root, *fi;
 
-	g_return_if_fail (folders != NULL);
+	g_return_if_fail (items != NULL);
 	g_return_if_fail (store != NULL);
 
 	if (CAMEL_IS_VEE_STORE (store))
@@ -68,19 +154,11 @@ add_folders_from_store (GList **folders,
 	while (fi && !g_cancellable_is_cancelled (cancellable)) {
 		CamelFolderInfo *next;
 
-		if ((fi->flags & CAMEL_FOLDER_NOSELECT) == 0) {
-			CamelFolder *fldr;
-
-			fldr = camel_store_get_folder_sync (
-				store, fi->full_name, 0, cancellable, error);
-			if (fldr) {
-				if (CAMEL_IS_VEE_FOLDER (fldr)) {
-					g_object_unref (fldr);
-				} else {
-					*folders = g_list_prepend (*folders, fldr);
-				}
-			}
-		}
+		/* Folders are opened later, by the search workers. */
+		if ((fi->flags & CAMEL_FOLDER_NOSELECT) == 0)
+			g_queue_push_tail (
+				items, search_results_item_new (
+				store, fi->full_name, NULL));
 
 		/* pick the next */
 		next = fi->child;
@@ -104,11 +182,143 @@ add_folders_from_store (GList **folders,
 	camel_folder_info_free (root);
 }
 
+/* Only the job's status goes to the shared operation, replaced as
+ * a whole under the lock; the workers' own messages would otherwise
+ * interleave on its message stack. */
+static void
+search_results_job_set_status (SearchResultsJob *job,
+                               CamelFolder *folder)
+{
+	g_mutex_lock (&job->lock);
+
+	if (job->message_pushed)
+		camel_operation_pop_message (job->cancellable);
+
+	camel_operation_push_message (
+		job->cancellable,
+		/* Translators: The first '%s' is a folder name, the '%u'-s
+		 * are the count of the searched and all the folders. */
+		_("Searching folder “%s” (%u of %u)"),
+		camel_folder_get_display_name (folder),
+		MIN (job->n_done + 1, job->n_total), job->n_total);
+
+	job->message_pushed = TRUE;
+
+	g_mutex_unlock (&job->lock);
+}
+
+static void
+search_results_cancel_cb (GCancellable *cancellable,
+                          GCancellable *operation)
+{
+	g_cancellable_cancel (operation);
+}
+
+static void
+search_results_add_folder_thread (gpointer data,
+                                  gpointer user_data)
+{
+	SearchResultsItem *item = data;
+	SearchResultsJob *job = user_data;
+	CamelFolder *folder = NULL;
+	GCancellable *operation;
+	gulong handler_id;
+
+	if (g_cancellable_is_cancelled (job->cancellable))
+		goto exit;
+
+	/* Each worker has its own operation, cancelled with the job's. */
+	operation = camel_operation_new ();
+	handler_id = g_cancellable_connect (
+		job->cancellable, G_CALLBACK (search_results_cancel_cb),
+		operation, NULL);
+
+	if (item->folder != NULL)
+		folder = g_object_ref (item->folder);
+	else
+		folder = camel_store_get_folder_sync (
+			item->store, item->full_name, 0,
+			operation, NULL);
+
+	if (folder != NULL && CAMEL_IS_VEE_FOLDER (folder))
+		g_clear_object (&folder);
+
+	if (folder != NULL) {
+		search_results_job_set_status (job, folder);
+
+		/* Adding a single source makes the search folder evaluate
+		 * its expression over that folder only and emit the matches
+		 * right away, thus they show up in the message list while
+		 * the remaining folders are still being searched. */
+		camel_vee_folder_add_folder (
+			job->vfolder, folder, operation);
+	}
+
+	g_cancellable_disconnect (job->cancellable, handler_id);
+	g_object_unref (operation);
+
+exit:
+	g_mutex_lock (&job->lock);
+
+	if (folder != NULL)
+		g_ptr_array_add (job->folders, folder);
+
+	job->n_done++;
+	camel_operation_progress (
+		job->cancellable, job->n_done * 100 / job->n_total);
+
+	g_mutex_unlock (&job->lock);
+
+	search_results_item_free (item);
+}
+
+/* Returns the @folders which have a message in the @vfolder. */
+static GPtrArray *
+search_results_dup_folders_with_hits (CamelVeeFolder *vfolder,
+                                      GPtrArray *folders)
+{
+	GPtrArray *uids, *with_hits;
+	GHashTable *hashes;
+	guint ii;
+
+	/* The first 8 characters of a vfolder UID identify the folder. */
+	hashes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	uids = camel_folder_get_uids (CAMEL_FOLDER (vfolder));
+	for (ii = 0; uids && ii < uids->len; ii++) {
+		const gchar *uid = g_ptr_array_index (uids, ii);
+
+		if (uid && strlen (uid) > 8)
+			g_hash_table_add (hashes, g_strndup (uid, 8));
+	}
+	if (uids)
+		camel_folder_free_uids (CAMEL_FOLDER (vfolder), uids);
+
+	with_hits = g_ptr_array_new_with_free_func (g_object_unref);
+
+	for (ii = 0; ii < folders->len && g_hash_table_size (hashes) > 0; ii++) {
+		CamelFolder *folder = g_ptr_array_index (folders, ii);
+		gchar hash[9];
+
+		camel_vee_folder_hash_folder (folder, hash);
+		hash[8] = '\0';
+
+		if (g_hash_table_contains (hashes, hash))
+			g_ptr_array_add (with_hits, g_object_ref (folder));
+	}
+
+	g_hash_table_destroy (hashes);
+
+	return with_hits;
+}
+
 typedef struct {
 	MailMsg base;
 
+	GWeakRef mail_shell_view;
 	CamelFolder *folder;
-	GCancellable *cancellable;
+	gchar *query;
+	gchar *base_query;	/* which the query narrows, or NULL */
 	GList *stores_list;
 } SearchResultsMsg;
 
@@ -123,37 +333,161 @@ search_results_exec (SearchResultsMsg *msg,
                      GCancellable *cancellable,
                      GError **error)
 {
-	GList *folders = NULL, *link;
+	CamelVeeFolder *vfolder = CAMEL_VEE_FOLDER (msg->folder);
+	SearchResultsSources *sources;
+	SearchResultsItem *item;
+	SearchResultsJob job = { NULL, };
+	GThreadPool *pool;
+	GQueue items = G_QUEUE_INIT;
+	GPtrArray *narrow_folders = NULL;
+	gchar *stores_key;
+	gboolean same_query;
+	gint stamp;
+	GList *link;
+
+	stores_key = search_results_dup_stores_key (msg->stores_list);
+
+	/* Read before listing the folders, thus a change made meanwhile
+	 * makes the new list outdated as well. */
+	stamp = g_atomic_int_get (&search_results_sources_stamp);
+
+	sources = g_object_get_data (
+		G_OBJECT (vfolder), SEARCH_RESULTS_SOURCES_KEY);
+	if (sources != NULL && (sources->stamp != stamp ||
+	    g_strcmp0 (sources->stores_key, stores_key) != 0))
+		sources = NULL;
+
+	same_query = g_strcmp0 (
+		msg->query, camel_vee_folder_get_expression (vfolder)) == 0;
+
+	/* The search folder is complete and up to date already. */
+	if (sources != NULL && same_query) {
+		g_free (stores_key);
+		return;
+	}
 
-	for (link = msg->stores_list; link != NULL; link = link->next) {
-		CamelStore *store = CAMEL_STORE (link->data);
+	/* A query narrowing the complete results cannot match a message
+	 * outside of them, thus only the folders with results are searched. */
+	if (sources != NULL && msg->base_query != NULL &&
+	    g_strcmp0 (msg->base_query, camel_vee_folder_get_expression (vfolder)) == 0)
+		narrow_folders = search_results_dup_folders_with_hits (vfolder, sources->folders);
 
-		if (g_cancellable_is_cancelled (cancellable))
-			break;
+	/* Start with an empty search folder and add the sources one
+	 * by one, rather than letting the search folder rebuild itself
+	 * over all of them before anything can be shown. */
+	camel_vee_folder_set_folders (vfolder, NULL, cancellable);
 
-		add_folders_from_store (&folders, store, cancellable, error);
-	}
+	if (!same_query)
+		camel_vee_folder_set_expression (vfolder, msg->query);
 
-	if (!g_cancellable_is_cancelled (cancellable)) {
-		CamelVeeFolder *vfolder = CAMEL_VEE_FOLDER (msg->folder);
+	if (narrow_folders != NULL) {
+		guint ii;
+
+		for (ii = 0; ii < narrow_folders->len; ii++) {
+			CamelFolder *folder;
+
+			folder = g_ptr_array_index (narrow_folders, ii);
+			g_queue_push_tail (
+				&items, search_results_item_new (
+				NULL, NULL, folder));
+		}
+	} else if (sources != NULL) {
+		guint ii;
+
+		/* The folders did not change; search the folders opened
+		 * by the previous run instead of walking the stores and
+		 * opening every folder again. */
+		for (ii = 0; ii < sources->folders->len; ii++) {
+			CamelFolder *folder;
+
+			folder = g_ptr_array_index (sources->folders, ii);
+			g_queue_push_tail (
+				&items, search_results_item_new (
+				NULL, NULL, folder));
+		}
+	} else {
+		for (link = msg->stores_list; link != NULL; link = link->next) {
+			CamelStore *store = CAMEL_STORE (link->data);
 
-		folders = g_list_reverse (folders);
+			if (g_cancellable_is_cancelled (cancellable))
+				break;
 
-		camel_vee_folder_set_folders (vfolder, folders, cancellable);
+			add_folders_from_store (
+				&items, store, cancellable, error);
+		}
+	}
+
+	job.vfolder = vfolder;
+	job.cancellable = cancellable;
+	job.folders = g_ptr_array_new_with_free_func (g_object_unref);
+	job.n_total = MAX (items.length, 1);
+	g_mutex_init (&job.lock);
+
+	pool = g_thread_pool_new (
+		search_results_add_folder_thread, &job,
+		SEARCH_RESULTS_MAX_WORKERS, FALSE, NULL);
+
+	while ((item = g_queue_pop_head (&items)) != NULL)
+		g_thread_pool_push (pool, item, NULL);
+
+	/* Wait for all the folders to be searched. */
+	g_thread_pool_free (pool, FALSE, TRUE);
+
+	if (job.message_pushed)
+		camel_operation_pop_message (cancellable);
+
+	if (g_cancellable_is_cancelled (cancellable)) {
+		/* Do not reuse an incomplete list of sources. */
+		g_object_set_data (
+			G_OBJECT (vfolder), SEARCH_RESULTS_SOURCES_KEY, NULL);
+
+	/* A narrowing run keeps all the sources for a later wider query. */
+	} else if (narrow_folders == NULL) {
+		sources = g_slice_new0 (SearchResultsSources);
+		sources->stores_key = stores_key;
+		sources->stamp = stamp;
+		sources->folders = g_ptr_array_ref (job.folders);
+		stores_key = NULL;
+
+		g_object_set_data_full (
+			G_OBJECT (vfolder), SEARCH_RESULTS_SOURCES_KEY,
+			sources, (GDestroyNotify) search_results_sources_free);
 	}
 
-	g_list_free_full (folders, g_object_unref);
+	g_mutex_clear (&job.lock);
+	g_ptr_array_unref (job.folders);
+	if (narrow_folders != NULL)
+		g_ptr_array_unref (narrow_folders);
+	g_free (stores_key);
 }
 
 static void
 search_results_done (SearchResultsMsg *msg)
 {
+	EMailShellView *mail_shell_view;
+
+	mail_shell_view = g_weak_ref_get (&msg->mail_shell_view);
+
+	/* Nothing is left to be cancelled, unless a newer job replaced it. */
+	if (mail_shell_view != NULL) {
+		EMailShellViewPrivate *priv = mail_shell_view->priv;
+
+		if (priv->search_account_cancel == msg->base.cancellable) {
+			g_clear_object (&priv->search_account_cancel);
+			g_clear_pointer (&priv->search_account_key, g_free);
+		}
+
+		g_object_unref (mail_shell_view);
+	}
 }
 
 static void
 search_results_free (SearchResultsMsg *msg)
 {
+	g_weak_ref_clear (&msg->mail_shell_view);
 	g_object_unref (msg->folder);
+	g_free (msg->query);
+	g_free (msg->base_query);
 	g_list_free_full (msg->stores_list, g_object_unref);
 }
 
@@ -165,25 +499,125 @@ static MailMsgInfo search_results_setup_info = {
 	(MailMsgFreeFunc) search_results_free
 };
 
-static gint
-mail_shell_view_setup_search_results_folder (CamelFolder *folder,
+static void
+mail_shell_view_setup_search_results_folder (EMailShellView *mail_shell_view,
+                                             CamelFolder *folder,
+                                             const gchar *query,
+                                             const gchar *base_query,
                                              GList *stores,
                                              GCancellable *cancellable)
 {
 	SearchResultsMsg *msg;
-	gint id;
 
 	g_object_ref (folder);
 
-	msg = mail_msg_new (&search_results_setup_info);
+	msg = mail_msg_new_with_cancellable (
+		&search_results_setup_info, cancellable);
+	g_weak_ref_init (&msg->mail_shell_view, mail_shell_view);
 	msg->folder = folder;
-	msg->cancellable = cancellable;
+	msg->query = g_strdup (query);
+	msg->base_query = g_strdup (base_query);
 	msg->stores_list = stores;
 
-	id = msg->base.seq;
 	mail_msg_slow_ordered_push (msg);
+}
+
+/* Whether the @query can only match messages matched by the current
+ * expression of the @search_folder, either because it adds a filter
+ * on top of it, or because only the literal search @text got longer. */
+static gboolean
+mail_shell_view_query_narrows (CamelVeeFolder *search_folder,
+                               const gchar *query,
+                               const gchar *text)
+{
+	const gchar *old_query, *old_text;
+	GString *quoted, *old_quoted, *replaced;
+	gboolean narrows;
+	gsize len;
+
+	old_query = camel_vee_folder_get_expression (search_folder);
+	if (old_query == NULL || *old_query == '\0' || query == NULL)
+		return FALSE;
+
+	len = strlen (old_query);
+	if (g_str_has_prefix (query, "(and ") &&
+	    strncmp (query + 5, old_query, len) == 0 &&
+	    query[5 + len] == ' ')
+		return TRUE;
+
+	old_text = g_object_get_data (G_OBJECT (search_folder), SEARCH_RESULTS_TEXT_KEY);
+	if (old_text == NULL || *old_text == '\0' || text == NULL ||
+	    g_strcmp0 (old_text, text) == 0 || strstr (text, old_text) == NULL)
+		return FALSE;
+
+	/* All the quick search rules match substrings, thus a text
+	 * containing the old text matches less, when the rest of the
+	 * query is the same. */
+	quoted = g_string_new ("");
+	camel_sexp_encode_string (quoted, text);
+	old_quoted = g_string_new ("");
+	camel_sexp_encode_string (old_quoted, old_text);
+
+	replaced = e_str_replace_string (query, quoted->str, old_quoted->str);
+	narrows = replaced != NULL && g_strcmp0 (replaced->str, old_query) == 0;
+
+	if (replaced != NULL)
+		g_string_free (replaced, TRUE);
+	g_string_free (quoted, TRUE);
+	g_string_free (old_quoted, TRUE);
+
+	return narrows;
+}
+
+/* Queues a job filling the @search_folder with the @query results.  The
+ * previous job is cancelled, unless it is the same search.  The @text is
+ * the literal search text, or NULL.  This takes ownership of the @stores. */
+static void
+mail_shell_view_queue_search_results (EMailShellView *mail_shell_view,
+                                      CamelVeeFolder *search_folder,
+                                      const gchar *query,
+                                      const gchar *text,
+                                      GList *stores)
+{
+	EMailShellViewPrivate *priv = mail_shell_view->priv;
+	gchar *stores_key, *key;
+	gchar *base_query = NULL;
+
+	stores_key = search_results_dup_stores_key (stores);
+	key = g_strdup_printf ("%p\n%s\n%s", search_folder, query, stores_key);
+	g_free (stores_key);
+
+	/* The same search is still running, let it finish. */
+	if (priv->search_account_cancel != NULL &&
+	    g_strcmp0 (priv->search_account_key, key) == 0) {
+		g_list_free_full (stores, g_object_unref);
+		g_free (key);
+		return;
+	}
+
+	if (priv->search_account_cancel != NULL) {
+		g_cancellable_cancel (priv->search_account_cancel);
+		g_clear_object (&priv->search_account_cancel);
+	}
+
+	if (mail_shell_view_query_narrows (search_folder, query, text))
+		base_query = g_strdup (camel_vee_folder_get_expression (search_folder));
+
+	g_object_set_data_full (
+		G_OBJECT (search_folder), SEARCH_RESULTS_TEXT_KEY,
+		g_strdup (text), g_free);
+
+	g_free (priv->search_account_key);
+	priv->search_account_key = key;
+	priv->search_account_cancel = camel_operation_new ();
+
+	/* This takes ownership of the stores list. */
+	mail_shell_view_setup_search_results_folder (
+		mail_shell_view, CAMEL_FOLDER (search_folder),
+		query, base_query, stores,
+		priv->search_account_cancel);
 
-	return id;
+	g_free (base_query);
 }
 
 static void
@@ -298,13 +732,43 @@ mail_shell_view_finalize (GObject *object)
 	G_OBJECT_CLASS (e_mail_shell_view_parent_class)->finalize (object);
 }
 
+static void
+mail_shell_view_search_sources_changed_cb (EMailShellView *mail_shell_view)
+{
+	g_atomic_int_inc (&search_results_sources_stamp);
+}
+
 static void
 mail_shell_view_constructed (GObject *object)
 {
+	EShellBackend *shell_backend;
+	EMailSession *session;
+	MailFolderCache *folder_cache;
+	const gchar *signals[] = {
+		"folder-available",
+		"folder-unavailable",
+		"folder-deleted",
+		"folder-renamed"
+	};
+	gint ii;
+
 	/* Chain up to parent's constructed() method. */
 	G_OBJECT_CLASS (e_mail_shell_view_parent_class)->constructed (object);
 
 	e_mail_shell_view_private_constructed (E_MAIL_SHELL_VIEW (object));
+
+	shell_backend = e_shell_view_get_shell_backend (E_SHELL_VIEW (object));
+	session = e_mail_backend_get_session (E_MAIL_BACKEND (shell_backend));
+	folder_cache = e_mail_session_get_folder_cache (session);
+
+	/* Keep the search sources of "All Accounts" and "Current Account"
+	 * searches in sync with the folders; "folder-available" and
+	 * "folder-unavailable" cover also subscription changes. */
+	for (ii = 0; ii < G_N_ELEMENTS (signals); ii++)
+		g_signal_connect_object (
+			folder_cache, signals[ii],
+			G_CALLBACK (mail_shell_view_search_sources_changed_cb),
+			object, G_CONNECT_SWAPPED);
 }
 
 static void
@@ -435,6 +899,7 @@ mail_shell_view_execute_search (EShellView *shell_view)
 	GList *list, *iter;
 	GSList *search_strings = NULL;
 	const gchar *text;
+	gboolean text_is_literal;
 	gboolean valid;
 	gchar *query;
 	gchar *temp;
@@ -470,6 +935,11 @@ mail_shell_view_execute_search (EShellView *shell_view)
 	action = ACTION (MAIL_SEARCH_SUBJECT_OR_ADDRESSES_CONTAIN);
 	value = gtk_radio_action_get_current_value (GTK_RADIO_ACTION (action));
 
+	/* The text is matched as it is, not parsed into an expression. */
+	text_is_literal =
+		value != MAIL_SEARCH_ADVANCED &&
+		value != MAIL_SEARCH_FREE_FORM_EXPR;
+
 	text = e_shell_searchbar_get_search_text (searchbar);
 	if (value == MAIL_SEARCH_ADVANCED || text == NULL || *text == '\0') {
 		if (value != MAIL_SEARCH_ADVANCED)
@@ -752,18 +1222,12 @@ all_accounts:
 	/* Disable the scope combo while search is in progress. */
 	gtk_widget_set_sensitive (GTK_WIDGET (combo_box), FALSE);
 
-	/* If we already have a search folder, reuse it. */
-	if (search_folder != NULL) {
-		if (priv->search_account_cancel != NULL) {
-			g_cancellable_cancel (priv->search_account_cancel);
-			g_object_unref (priv->search_account_cancel);
-			priv->search_account_cancel = NULL;
-		}
-
-		camel_vee_folder_set_expression (search_folder, query);
-
+	/* If we already have a search folder, reuse it.  The search
+	 * job applies the new query over the already known source folders,
+	 * or only over the current results when the query narrows them.
+	 * Until it starts, the message list narrows the previous results. */
+	if (search_folder != NULL)
 		goto all_accounts_setup;
-	}
 
 	/* Create a new search folder. */
 
@@ -788,12 +1252,10 @@ all_accounts_setup:
 		gtk_tree_view_get_model (GTK_TREE_VIEW (folder_tree))));
 	g_list_foreach (list, (GFunc) g_object_ref, NULL);
 
-	priv->search_account_cancel = camel_operation_new ();
-
 	/* This takes ownership of the stores list. */
-	mail_shell_view_setup_search_results_folder (
-		CAMEL_FOLDER (search_folder), list,
-		priv->search_account_cancel);
+	mail_shell_view_queue_search_results (
+		E_MAIL_SHELL_VIEW (shell_view), search_folder, query,
+		text_is_literal ? text : NULL, list);
 
 	mail_shell_view_show_search_results_folder (
 		E_MAIL_SHELL_VIEW (shell_view),
@@ -860,18 +1322,10 @@ current_account:
 	/* Disable the scope combo while search is in progress. */
 	gtk_widget_set_sensitive (GTK_WIDGET (combo_box), FALSE);
 
-	/* If we already have a search folder, reuse it. */
-	if (search_folder != NULL) {
-		if (priv->search_account_cancel != NULL) {
-			g_cancellable_cancel (priv->search_account_cancel);
-			g_object_unref (priv->search_account_cancel);
-			priv->search_account_cancel = NULL;
-		}
-
-		camel_vee_folder_set_expression (search_folder, query);
-
+	/* If we already have a search folder, reuse it.
+	 * See the "All Accounts" case above. */
+	if (search_folder != NULL)
 		goto current_accout_setup;
-	}
 
 	/* Create a new search folder. */
 
@@ -906,12 +1360,10 @@ current_accout_setup:
 	if (store != NULL)
 		list = g_list_append (NULL, store);
 
-	priv->search_account_cancel = camel_operation_new ();
-
 	/* This takes ownership of the stores list. */
-	mail_shell_view_setup_search_results_folder (
-		CAMEL_FOLDER (search_folder), list,
-		priv->search_account_cancel);
+	mail_shell_view_queue_search_results (
+		E_MAIL_SHELL_VIEW (shell_view), search_folder, query,
+		text_is_literal ? text : NULL, list);
 
 	mail_shell_view_show_search_results_folder (
 		E_MAIL_SHELL_VIEW (shell_view),
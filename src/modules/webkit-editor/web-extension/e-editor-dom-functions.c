@@ -829,11 +829,186 @@ refresh_spell_check (EEditorPage *editor_page,
 	e_editor_page_unblock_selection_changed (editor_page);
 }
 
+/* How many blocks are spell checked in one idle callback */
+#define SPELL_CHECK_BLOCKS_PER_IDLE 10
+
+static void
+spell_check_pending_clear (EEditorPage *editor_page)
+{
+	GQueue *pending;
+	guint id;
+
+	id = e_editor_page_get_spell_check_pending_source_id (editor_page);
+	if (id > 0) {
+		g_source_remove (id);
+		e_editor_page_set_spell_check_pending_source_id (editor_page, 0);
+	}
+
+	pending = e_editor_page_get_spell_check_pending (editor_page);
+	while (!g_queue_is_empty (pending))
+		g_object_unref (g_queue_pop_head (pending));
+}
+
+/* Queues the paragraphs under the @parent; quotations and lists are
+ * split into their items, thus a long quoted thread is checked by
+ * parts too. */
+static void
+spell_check_pending_collect (GQueue *pending,
+                             WebKitDOMNode *parent)
+{
+	WebKitDOMNode *node;
+
+	for (node = webkit_dom_node_get_first_child (parent);
+	     node;
+	     node = webkit_dom_node_get_next_sibling (node)) {
+		if (!WEBKIT_DOM_IS_ELEMENT (node))
+			continue;
+
+		if (WEBKIT_DOM_IS_HTML_QUOTE_ELEMENT (node) ||
+		    WEBKIT_DOM_IS_HTML_U_LIST_ELEMENT (node) ||
+		    WEBKIT_DOM_IS_HTML_O_LIST_ELEMENT (node))
+			spell_check_pending_collect (pending, node);
+		else
+			g_queue_push_tail (pending, g_object_ref (node));
+	}
+}
+
+/* Removes blocks between the @first and the @last block (inclusive)
+ * from the pending blocks, because they had been checked already. */
+static void
+spell_check_pending_remove_range (EEditorPage *editor_page,
+                                  WebKitDOMNode *first,
+                                  WebKitDOMNode *last)
+{
+	GQueue *pending;
+	GList *link;
+
+	pending = e_editor_page_get_spell_check_pending (editor_page);
+	link = g_queue_peek_head_link (pending);
+
+	while (link) {
+		WebKitDOMNode *node = link->data;
+		GList *next = g_list_next (link);
+		gushort pos_first, pos_last;
+
+		pos_first = webkit_dom_node_compare_document_position (first, node);
+		pos_last = webkit_dom_node_compare_document_position (last, node);
+
+		if ((pos_first == 0 ||
+		     ((pos_first & WEBKIT_DOM_NODE_DOCUMENT_POSITION_FOLLOWING) != 0 &&
+		      (pos_first & WEBKIT_DOM_NODE_DOCUMENT_POSITION_CONTAINS) == 0)) &&
+		    (pos_last == 0 ||
+		     (pos_last & WEBKIT_DOM_NODE_DOCUMENT_POSITION_CONTAINED_BY) != 0 ||
+		     ((pos_last & WEBKIT_DOM_NODE_DOCUMENT_POSITION_PRECEDING) != 0 &&
+		      (pos_last & WEBKIT_DOM_NODE_DOCUMENT_POSITION_CONTAINS) == 0))) {
+			g_queue_delete_link (pending, link);
+			g_object_unref (node);
+		}
+
+		link = next;
+	}
+}
+
+static void
+spell_check_block (WebKitDOMDocument *document,
+                   WebKitDOMDOMSelection *dom_selection,
+                   WebKitDOMNode *block)
+{
+	WebKitDOMRange *end_range, *actual;
+	WebKitDOMText *text;
+
+	/* Append some text on the end of the block */
+	text = webkit_dom_document_create_text_node (document, "-x-evo-end");
+	webkit_dom_node_append_child (block, WEBKIT_DOM_NODE (text), NULL);
+
+	/* Create range that's pointing on the end of this text */
+	end_range = webkit_dom_document_create_range (document);
+	webkit_dom_range_select_node_contents (
+		end_range, WEBKIT_DOM_NODE (text), NULL);
+	webkit_dom_range_collapse (end_range, FALSE, NULL);
+
+	/* Move on the beginning of the block */
+	actual = webkit_dom_document_create_range (document);
+	webkit_dom_range_select_node_contents (actual, block, NULL);
+	webkit_dom_range_collapse (actual, TRUE, NULL);
+	webkit_dom_dom_selection_remove_all_ranges (dom_selection);
+	webkit_dom_dom_selection_add_range (dom_selection, actual);
+	g_clear_object (&actual);
+
+	actual = webkit_dom_dom_selection_get_range_at (dom_selection, 0, NULL);
+	perform_spell_check (dom_selection, actual, end_range);
+
+	g_clear_object (&end_range);
+	g_clear_object (&actual);
+
+	/* Remove the text that we inserted on the end of the block */
+	remove_node (WEBKIT_DOM_NODE (text));
+}
+
+static gboolean
+spell_check_pending_cb (gpointer user_data)
+{
+	EEditorPage *editor_page = user_data;
+	WebKitDOMDocument *document;
+	WebKitDOMDOMSelection *dom_selection;
+	WebKitDOMDOMWindow *dom_window;
+	WebKitDOMHTMLElement *body;
+	GQueue *pending;
+	gint ii;
+
+	g_return_val_if_fail (E_IS_EDITOR_PAGE (editor_page), FALSE);
+
+	pending = e_editor_page_get_spell_check_pending (editor_page);
+	document = e_editor_page_get_document (editor_page);
+	body = webkit_dom_document_get_body (document);
+
+	if (!body || !e_editor_page_get_inline_spelling_enabled (editor_page)) {
+		e_editor_page_set_spell_check_pending_source_id (editor_page, 0);
+		spell_check_pending_clear (editor_page);
+		return FALSE;
+	}
+
+	e_editor_dom_selection_save (editor_page);
+
+	/* Block callbacks of selection-changed signal as we don't want to
+	 * recount all the block format things in EEditorSelection and here as well
+	 * when we are moving with caret */
+	e_editor_page_block_selection_changed (editor_page);
+
+	dom_window = webkit_dom_document_get_default_view (document);
+	dom_selection = webkit_dom_dom_window_get_selection (dom_window);
+
+	for (ii = 0; ii < SPELL_CHECK_BLOCKS_PER_IDLE && !g_queue_is_empty (pending); ii++) {
+		WebKitDOMNode *block = g_queue_pop_head (pending);
+
+		/* The block could be removed or replaced meanwhile */
+		if (webkit_dom_node_contains (WEBKIT_DOM_NODE (body), block))
+			spell_check_block (document, dom_selection, block);
+
+		g_object_unref (block);
+	}
+
+	g_clear_object (&dom_selection);
+	g_clear_object (&dom_window);
+
+	e_editor_dom_selection_restore (editor_page);
+	/* Unblock the callbacks */
+	e_editor_page_unblock_selection_changed (editor_page);
+
+	if (g_queue_is_empty (pending)) {
+		e_editor_page_set_spell_check_pending_source_id (editor_page, 0);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 void
 e_editor_dom_turn_spell_check_off (EEditorPage *editor_page)
 {
 	g_return_if_fail (E_IS_EDITOR_PAGE (editor_page));
 
+	spell_check_pending_clear (editor_page);
 	refresh_spell_check (editor_page, FALSE);
 }
 
@@ -843,7 +1018,7 @@ e_editor_dom_force_spell_check_in_viewport (EEditorPage *editor_page)
 	WebKitDOMDocument *document;
 	WebKitDOMDOMSelection *dom_selection = NULL;
 	WebKitDOMDOMWindow *dom_window = NULL;
-	WebKitDOMElement *last_element;
+	WebKitDOMElement *last_element, *first_block, *last_block;
 	WebKitDOMHTMLElement *body;
 	WebKitDOMRange *end_range = NULL, *actual = NULL;
 	WebKitDOMText *text;
@@ -872,6 +1047,9 @@ e_editor_dom_force_spell_check_in_viewport (EEditorPage *editor_page)
 	if (!actual)
 		goto out;
 
+	first_block = get_parent_block_element (
+		webkit_dom_range_get_start_container (actual, NULL));
+
 	/* Append some text on the end of the body */
 	text = webkit_dom_document_create_text_node (document, "-x-evo-end");
 
@@ -886,11 +1064,14 @@ e_editor_dom_force_spell_check_in_viewport (EEditorPage *editor_page)
 		WebKitDOMElement *parent;
 
 		parent = get_parent_block_element (WEBKIT_DOM_NODE (last_element));
+		last_block = parent ? parent : last_element;
 		webkit_dom_node_append_child (
-			WEBKIT_DOM_NODE (parent ? parent : last_element), WEBKIT_DOM_NODE (text), NULL);
-	} else
+			WEBKIT_DOM_NODE (last_block), WEBKIT_DOM_NODE (text), NULL);
+	} else {
+		last_block = NULL;
 		webkit_dom_node_append_child (
 			WEBKIT_DOM_NODE (body), WEBKIT_DOM_NODE (text), NULL);
+	}
 
 	/* Create range that's pointing on the end of viewport */
 	end_range = webkit_dom_document_create_range (document);
@@ -907,6 +1088,13 @@ e_editor_dom_force_spell_check_in_viewport (EEditorPage *editor_page)
 	g_clear_object (&end_range);
 	g_clear_object (&actual);
 
+	/* The visible blocks do not need to be checked on idle anymore */
+	if (first_block) {
+		spell_check_pending_remove_range (
+			editor_page, WEBKIT_DOM_NODE (first_block),
+			last_block ? WEBKIT_DOM_NODE (last_block) : WEBKIT_DOM_NODE (text));
+	}
+
 	/* Remove the text that we inserted on the end of the body */
 	remove_node (WEBKIT_DOM_NODE (text));
 
@@ -916,13 +1104,45 @@ e_editor_dom_force_spell_check_in_viewport (EEditorPage *editor_page)
 	e_editor_page_unblock_selection_changed (editor_page);
 }
 
+/* Checks the visible part of the document immediately and the rest
+ * of it by parts, on idle, thus the editor stays responsive even with
+ * long documents. */
 void
 e_editor_dom_force_spell_check (EEditorPage *editor_page)
 {
+	WebKitDOMDocument *document;
+	WebKitDOMHTMLElement *body;
+	GQueue *pending;
+	guint id;
+
 	g_return_if_fail (E_IS_EDITOR_PAGE (editor_page));
 
-	if (e_editor_page_get_inline_spelling_enabled (editor_page))
-		refresh_spell_check (editor_page, TRUE);
+	if (!e_editor_page_get_inline_spelling_enabled (editor_page))
+		return;
+
+	document = e_editor_page_get_document (editor_page);
+	body = webkit_dom_document_get_body (document);
+
+	if (!body || !webkit_dom_node_get_first_child (WEBKIT_DOM_NODE (body)))
+		return;
+
+	webkit_dom_element_set_attribute (
+		WEBKIT_DOM_ELEMENT (body), "spellcheck", "true", NULL);
+
+	spell_check_pending_clear (editor_page);
+
+	pending = e_editor_page_get_spell_check_pending (editor_page);
+	spell_check_pending_collect (pending, WEBKIT_DOM_NODE (body));
+
+	e_editor_dom_force_spell_check_in_viewport (editor_page);
+
+	if (g_queue_is_empty (pending))
+		return;
+
+	id = g_idle_add_full (
+		G_PRIORITY_LOW, spell_check_pending_cb, editor_page, NULL);
+
+	e_editor_page_set_spell_check_pending_source_id (editor_page, id);
 }
 
 gboolean
@@ -5537,6 +5757,422 @@ parse_html_into_blocks (EEditorPage *editor_page,
 	g_regex_unref (regex_nbsp);
 }
 
+/* Wraps the paragraphs of the document, except of those under the @skip */
+static void
+wrap_paragraphs_in_document_skipping (EEditorPage *editor_page,
+                                      WebKitDOMNode *skip)
+{
+	WebKitDOMDocument *document;
+	WebKitDOMNodeList *list = NULL;
+	gint ii;
+
+	document = e_editor_page_get_document (editor_page);
+	list = webkit_dom_document_query_selector_all (
+		document, "[data-evo-paragraph]:not(#-x-evo-input-start)", NULL);
+
+	for (ii = webkit_dom_node_list_get_length (list); ii--;) {
+		gint word_wrap_length, quote, citation_level;
+		WebKitDOMNode *node = webkit_dom_node_list_item (list, ii);
+
+		if (skip && webkit_dom_node_contains (skip, node))
+			continue;
+
+		citation_level = e_editor_dom_get_citation_level (node, FALSE);
+		quote = citation_level ? citation_level * 2 : 0;
+		word_wrap_length = e_editor_page_get_word_wrap_length (editor_page);
+
+		if (node_is_list (node)) {
+			WebKitDOMNode *item = webkit_dom_node_get_first_child (node);
+
+			while (item && WEBKIT_DOM_IS_HTML_LI_ELEMENT (item)) {
+				e_editor_dom_wrap_paragraph_length (
+					editor_page, WEBKIT_DOM_ELEMENT (item), word_wrap_length - quote);
+				item = webkit_dom_node_get_next_sibling (item);
+			}
+		} else {
+			e_editor_dom_wrap_paragraph_length (
+				editor_page, WEBKIT_DOM_ELEMENT (node), word_wrap_length - quote);
+		}
+	}
+	g_clear_object (&list);
+}
+
+/* Plain text longer than this (in bytes) has the blocks of its main
+ * citation wrapped and quoted in plain text mode by
+ * wrap_and_quote_blocks_in_one_pass () instead of the DOM based passes. */
+#define QUOTE_IN_ONE_PASS_MIN_LENGTH (128 * 1024)
+
+static gboolean
+can_quote_in_one_pass (EEditorPage *editor_page,
+                       const gchar *text)
+{
+	GSettings *settings;
+	gboolean use_paragraphs;
+
+	if (e_editor_page_get_html_mode (editor_page))
+		return FALSE;
+
+	if (!text || strlen (text) < QUOTE_IN_ONE_PASS_MIN_LENGTH)
+		return FALSE;
+
+	/* The PRE blocks are not wrapped. */
+	settings = e_util_ref_settings ("org.gnome.evolution.mail");
+	use_paragraphs = g_settings_get_boolean (
+		settings, "composer-wrap-quoted-text-in-replies");
+	g_object_unref (settings);
+
+	return use_paragraphs;
+}
+
+/* Whether there is a space, a tabulator or a non-breaking space at @ptr */
+static gboolean
+is_blank_at (const gchar *ptr)
+{
+	return *ptr == ' ' || *ptr == '\t' ||
+		g_str_has_prefix (ptr, UNICODE_NBSP);
+}
+
+/* Whether the @block holds just the text, as parse_html_into_blocks ()
+ * creates it: the text with links and tabulators, or a sole BR for
+ * an empty line. */
+static gboolean
+block_is_plain_text (WebKitDOMNode *block)
+{
+	WebKitDOMNode *child;
+
+	child = webkit_dom_node_get_first_child (block);
+	if (!child)
+		return FALSE;
+
+	if (WEBKIT_DOM_IS_HTML_BR_ELEMENT (child))
+		return !webkit_dom_node_get_next_sibling (child);
+
+	for (; child; child = webkit_dom_node_get_next_sibling (child)) {
+		if (WEBKIT_DOM_IS_TEXT (child))
+			continue;
+
+		if (WEBKIT_DOM_IS_HTML_ANCHOR_ELEMENT (child) &&
+		    !webkit_dom_element_get_child_element_count (WEBKIT_DOM_ELEMENT (child)))
+			continue;
+
+		if (WEBKIT_DOM_IS_HTML_SPAN_ELEMENT (child) &&
+		    element_has_class (WEBKIT_DOM_ELEMENT (child), "Apple-tab-span"))
+			continue;
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+typedef struct _PlainTextLink {
+	gsize start;
+	gsize end;
+} PlainTextLink;
+
+/* Returns the link regex to use for the block's @text, the same one
+ * for all of its rows, or NULL when the @text cannot contain any link. */
+static GRegex *
+get_plain_text_link_regex (const gchar *text,
+                           GRegex **regex_link,
+                           GRegex **regex_email)
+{
+	gboolean is_email_address;
+	GRegex **regex;
+
+	if (!surround_links_with_anchor (text))
+		return NULL;
+
+	is_email_address =
+		strstr (text, "@") &&
+		!strstr (text, "://");
+
+	regex = is_email_address ? regex_email : regex_link;
+	if (!*regex)
+		*regex = g_regex_new (is_email_address ? E_MAIL_PATTERN : URL_PATTERN, 0, 0, NULL);
+
+	return *regex;
+}
+
+/* Returns the byte ranges of the links in the block's @text, which
+ * append_plain_text_block_wrapped () never breaks. */
+static GArray *
+find_plain_text_links (const gchar *text,
+                       gsize text_len,
+                       GRegex *regex)
+{
+	GMatchInfo *match_info = NULL;
+	GArray *links;
+
+	links = g_array_new (FALSE, FALSE, sizeof (PlainTextLink));
+
+	if (!regex)
+		return links;
+
+	g_regex_match_full (regex, text, text_len, 0, G_REGEX_MATCH_NOTEMPTY, &match_info, NULL);
+	while (match_info && g_match_info_matches (match_info)) {
+		PlainTextLink link;
+		gint start = 0, end = 0;
+
+		if (g_match_info_fetch_pos (match_info, 0, &start, &end) && end > start) {
+			link.start = start;
+			link.end = end;
+			g_array_append_val (links, link);
+		}
+
+		if (!g_match_info_next (match_info, NULL))
+			break;
+	}
+	g_match_info_free (match_info);
+
+	return links;
+}
+
+/* Appends the @row of the block's text escaped, with the non-breaking
+ * spaces and tabulators written as parse_html_into_blocks () writes them
+ * and with the links matching the @regex surrounded with anchors. The row
+ * always contains the whole links, thus their addresses are complete. */
+static void
+append_plain_text_row (GString *html,
+                       const gchar *row,
+                       gsize row_len,
+                       GRegex *regex)
+{
+	GString *escaped;
+	const gchar *ptr, *end;
+
+	escaped = g_string_sized_new (row_len + 16);
+	end = row + row_len;
+
+	for (ptr = row; ptr < end; ptr = g_utf8_next_char (ptr)) {
+		if (*ptr == '\t')
+			g_string_append (escaped, "<span class=\"Apple-tab-span\" style=\"white-space:pre\">\t</span>");
+		else if (*ptr == '&')
+			g_string_append (escaped, "&amp;");
+		else if (*ptr == '<')
+			g_string_append (escaped, "&lt;");
+		else if (*ptr == '>')
+			g_string_append (escaped, "&gt;");
+		else if (g_str_has_prefix (ptr, UNICODE_NBSP))
+			g_string_append (escaped, "&nbsp;");
+		else
+			g_string_append_len (escaped, ptr, g_utf8_next_char (ptr) - ptr);
+	}
+
+	if (regex && surround_links_with_anchor (escaped->str)) {
+		gchar *linked;
+
+		linked = g_regex_replace_eval (
+			regex,
+			escaped->str,
+			-1,
+			0,
+			G_REGEX_MATCH_NOTEMPTY,
+			create_anchor_for_link,
+			NULL,
+			NULL);
+
+		g_string_append (html, linked);
+		g_free (linked);
+	} else {
+		g_string_append_len (html, escaped->str, escaped->len);
+	}
+
+	g_string_free (escaped, TRUE);
+}
+
+/* Appends the block's @text wrapped to @length_to_wrap characters and
+ * quoted with @quoted (if not NULL), the same way as wrap_lines () and
+ * e_editor_dom_quote_plain_text_element_after_wrapping () would do it.
+ * The only breakable spaces left by parse_html_into_blocks () are the
+ * single spaces, the others are the non-breaking spaces already. The links
+ * are found in the whole @text first and they are never broken, a link
+ * longer than @length_to_wrap is left on its own row, like wrap_lines ()
+ * leaves the anchors. */
+static void
+append_plain_text_block_wrapped (GString *html,
+                                 const gchar *text,
+                                 gsize text_len,
+                                 gint length_to_wrap,
+                                 const gchar *quoted,
+                                 GRegex **regex_link,
+                                 GRegex **regex_email)
+{
+	const gchar *row, *end;
+	GArray *links;
+	GRegex *regex;
+	guint link_index = 0;
+
+	if (quoted)
+		g_string_append (html, quoted);
+
+	if (!text_len) {
+		g_string_append (html, "<br>");
+		return;
+	}
+
+	regex = get_plain_text_link_regex (text, regex_link, regex_email);
+	links = find_plain_text_links (text, text_len, regex);
+
+	row = text;
+	end = text + text_len;
+
+	while (row < end) {
+		const gchar *ptr, *break_at = NULL;
+		gboolean skip_space = FALSE;
+		gint column = 0;
+
+		for (ptr = row; ptr < end; ptr = g_utf8_next_char (ptr)) {
+			const PlainTextLink *link = NULL;
+
+			while (link_index < links->len &&
+			       text + g_array_index (links, PlainTextLink, link_index).end <= ptr)
+				link_index++;
+
+			if (link_index < links->len &&
+			    text + g_array_index (links, PlainTextLink, link_index).start <= ptr)
+				link = &g_array_index (links, PlainTextLink, link_index);
+
+			if (*ptr == '\t')
+				column += TAB_LENGTH - column % TAB_LENGTH;
+			else
+				column++;
+
+			if (column > length_to_wrap) {
+				/* The space just after the limit can be used as well. */
+				if (*ptr == ' ' && !link) {
+					break_at = ptr;
+					skip_space = TRUE;
+				} else if (link && !break_at) {
+					/* Nothing to break at before the link, keep it whole. */
+					ptr = text + link->end;
+					break_at = ptr;
+					skip_space = ptr < end && *ptr == ' ';
+				}
+				break;
+			}
+
+			/* Do not break inside of the links. */
+			if (link)
+				continue;
+
+			if (*ptr == ' ') {
+				break_at = ptr;
+				skip_space = TRUE;
+			} else if (*ptr == '-' && ptr > row && ptr + 1 < end &&
+				   !is_blank_at (g_utf8_prev_char (ptr)) && !is_blank_at (ptr + 1)) {
+				/* Always break after the dash character. */
+				break_at = ptr + 1;
+				skip_space = FALSE;
+			}
+		}
+
+		if (ptr >= end) {
+			break_at = end;
+			skip_space = FALSE;
+		} else if (!break_at) {
+			/* No character to break at, split the word. */
+			break_at = ptr > row ? ptr : g_utf8_next_char (ptr);
+			skip_space = FALSE;
+		}
+
+		append_plain_text_row (html, row, break_at - row, regex);
+
+		row = skip_space ? break_at + 1 : break_at;
+
+		if (row < end) {
+			g_string_append (html, "<br class=\"-x-evo-wrap-br\">");
+			if (quoted)
+				g_string_append (html, quoted);
+			if (skip_space)
+				g_string_append (html, "<span data-hidden-space=\"\"></span>");
+		}
+	}
+
+	g_array_free (links, TRUE);
+}
+
+static gchar *
+get_quoted_span_for_level (gint quote_level)
+{
+	gchar *quotation, *quoted;
+
+	if (quote_level <= 0)
+		return NULL;
+
+	quotation = get_quotation_for_level (quote_level);
+	quoted = g_strconcat ("<span class=\"-x-evo-quoted\">", quotation, "</span>", NULL);
+	g_free (quotation);
+
+	return quoted;
+}
+
+/* Wraps and quotes the blocks under the @element, which had been created
+ * by parse_html_into_blocks (), the same way as wrap_paragraphs_in_document_skipping ()
+ * and quote_plain_text_elements_after_wrapping_in_element () do it. The text
+ * blocks are rewritten with a single set_inner_html () call each, instead of
+ * touching the DOM for every line, which makes the difference when replying
+ * to very large messages. The other blocks, like those with the selection
+ * markers, go through the DOM functions. */
+static void
+wrap_and_quote_blocks_in_one_pass (EEditorPage *editor_page,
+                                   WebKitDOMElement *element)
+{
+	GRegex *regex_link = NULL, *regex_email = NULL;
+	WebKitDOMNodeList *list = NULL;
+	GString *html;
+	gint word_wrap_length, ii;
+
+	g_return_if_fail (E_IS_EDITOR_PAGE (editor_page));
+
+	list = webkit_dom_element_query_selector_all (
+		element, "[data-evo-paragraph]:not(#-x-evo-input-start)", NULL);
+
+	word_wrap_length = e_editor_page_get_word_wrap_length (editor_page);
+	html = g_string_sized_new (1024);
+
+	for (ii = webkit_dom_node_list_get_length (list); ii--;) {
+		WebKitDOMNode *node = webkit_dom_node_list_item (list, ii);
+		gint citation_level, length_to_wrap;
+
+		citation_level = e_editor_dom_get_citation_level (node, TRUE);
+		length_to_wrap = word_wrap_length - 2 * citation_level;
+
+		if (block_is_plain_text (node)) {
+			gchar *text, *quoted;
+
+			text = webkit_dom_node_get_text_content (node);
+			quoted = get_quoted_span_for_level (citation_level);
+
+			g_string_truncate (html, 0);
+			append_plain_text_block_wrapped (
+				html, text ? text : "", text ? strlen (text) : 0,
+				length_to_wrap >= MINIMAL_PARAGRAPH_WIDTH ? length_to_wrap : G_MAXINT,
+				quoted, &regex_link, &regex_email);
+
+			webkit_dom_element_set_inner_html (WEBKIT_DOM_ELEMENT (node), html->str, NULL);
+
+			g_free (quoted);
+			g_free (text);
+		} else {
+			e_editor_dom_wrap_paragraph_length (
+				editor_page, WEBKIT_DOM_ELEMENT (node), length_to_wrap);
+
+			if (citation_level > 0)
+				e_editor_dom_quote_plain_text_element_after_wrapping (
+					editor_page, WEBKIT_DOM_ELEMENT (node), citation_level);
+		}
+	}
+
+	g_clear_object (&list);
+	g_string_free (html, TRUE);
+
+	if (regex_email != NULL)
+		g_regex_unref (regex_email);
+	if (regex_link != NULL)
+		g_regex_unref (regex_link);
+}
+
 void
 e_editor_dom_quote_and_insert_text_into_selection (EEditorPage *editor_page,
                                                    const gchar *text,
@@ -5732,7 +6368,8 @@ create_text_markers_for_selection_in_element (WebKitDOMElement *element)
 
 static void
 quote_plain_text_elements_after_wrapping_in_element (EEditorPage *editor_page,
-                                                     WebKitDOMElement *element)
+                                                     WebKitDOMElement *element,
+                                                     WebKitDOMNode *skip)
 {
 	WebKitDOMNodeList *list = NULL;
 	gint ii;
@@ -5748,6 +6385,9 @@ quote_plain_text_elements_after_wrapping_in_element (EEditorPage *editor_page,
 		WebKitDOMNode *child;
 
 		child = webkit_dom_node_list_item (list, ii);
+		if (skip && webkit_dom_node_contains (skip, child))
+			continue;
+
 		citation_level = e_editor_dom_get_citation_level (child, TRUE);
 		e_editor_dom_quote_plain_text_element_after_wrapping (editor_page, WEBKIT_DOM_ELEMENT (child), citation_level);
 	}
@@ -5763,7 +6403,7 @@ quote_plain_text_elements_after_wrapping_in_document (EEditorPage *editor_page)
 	document = e_editor_page_get_document (editor_page);
 	body = webkit_dom_document_get_body (document);
 
-	quote_plain_text_elements_after_wrapping_in_element (editor_page, WEBKIT_DOM_ELEMENT (body));
+	quote_plain_text_elements_after_wrapping_in_element (editor_page, WEBKIT_DOM_ELEMENT (body), NULL);
 }
 
 static void
@@ -6005,6 +6645,7 @@ e_editor_dom_convert_content (EEditorPage *editor_page,
 	WebKitDOMNode *node;
 	WebKitDOMDOMWindow *dom_window = NULL;
 	gboolean start_bottom, empty = FALSE, cite_body = FALSE;
+	gboolean quote_in_one_pass = FALSE;
 	gchar *inner_html;
 	gint ii, jj, length;
 	GSettings *settings;
@@ -6142,10 +6783,12 @@ e_editor_dom_convert_content (EEditorPage *editor_page,
 	remove_thunderbird_signature (document);
 	create_text_markers_for_citations_in_element (WEBKIT_DOM_ELEMENT (body));
 
-	if (preferred_text && *preferred_text)
+	if (preferred_text && *preferred_text) {
 		webkit_dom_html_element_set_inner_text (
 			WEBKIT_DOM_HTML_ELEMENT (content_wrapper), preferred_text, NULL);
-	else {
+
+		quote_in_one_pass = cite_body && can_quote_in_one_pass (editor_page, preferred_text);
+	} else {
 		gchar *inner_text;
 		WebKitDOMNode *last_child;
 
@@ -6157,6 +6800,8 @@ e_editor_dom_convert_content (EEditorPage *editor_page,
 		if (WEBKIT_DOM_IS_HTML_BR_ELEMENT (last_child))
 			remove_node (last_child);
 
+		quote_in_one_pass = cite_body && can_quote_in_one_pass (editor_page, inner_text);
+
 		g_free (inner_text);
 	}
 
@@ -6244,9 +6889,19 @@ e_editor_dom_convert_content (EEditorPage *editor_page,
 	e_editor_dom_merge_siblings_if_necessary (editor_page, NULL);
 
 	if (!e_editor_page_get_html_mode (editor_page)) {
-		e_editor_dom_wrap_paragraphs_in_document (editor_page);
+		WebKitDOMNode *skip = NULL;
 
-		quote_plain_text_elements_after_wrapping_in_document (editor_page);
+		/* The blocks of the main citation are wrapped and quoted at
+		 * once, thus the document passes skip them. */
+		if (quote_in_one_pass && webkit_dom_node_get_parent_node (WEBKIT_DOM_NODE (content_wrapper))) {
+			wrap_and_quote_blocks_in_one_pass (editor_page, content_wrapper);
+			skip = WEBKIT_DOM_NODE (content_wrapper);
+		}
+
+		wrap_paragraphs_in_document_skipping (editor_page, skip);
+
+		quote_plain_text_elements_after_wrapping_in_element (
+			editor_page, WEBKIT_DOM_ELEMENT (body), skip);
 	}
 
 	clear_attributes (editor_page);
@@ -8399,7 +9054,7 @@ e_editor_dom_process_content_to_plain_text_for_exporting (EEditorPage *editor_pa
 	webkit_dom_node_normalize (source);
 
 	if (quote) {
-		quote_plain_text_elements_after_wrapping_in_element (editor_page, WEBKIT_DOM_ELEMENT (source));
+		quote_plain_text_elements_after_wrapping_in_element (editor_page, WEBKIT_DOM_ELEMENT (source), NULL);
 	} else if (e_editor_page_get_html_mode (editor_page)) {
 		WebKitDOMElement *citation;
 
@@ -8407,7 +9062,7 @@ e_editor_dom_process_content_to_plain_text_for_exporting (EEditorPage *editor_pa
 			WEBKIT_DOM_ELEMENT (source), "blockquote[type=cite]", NULL);
 		if (citation) {
 			preserve_pre_line_breaks_in_element (document, WEBKIT_DOM_ELEMENT (source));
-			quote_plain_text_elements_after_wrapping_in_element (editor_page, WEBKIT_DOM_ELEMENT (source));
+			quote_plain_text_elements_after_wrapping_in_element (editor_page, WEBKIT_DOM_ELEMENT (source), NULL);
 		}
 	}
 
@@ -14554,38 +15209,9 @@ e_editor_dom_selection_wrap (EEditorPage *editor_page)
 void
 e_editor_dom_wrap_paragraphs_in_document (EEditorPage *editor_page)
 {
-	WebKitDOMDocument *document;
-	WebKitDOMNodeList *list = NULL;
-	gint ii;
-
 	g_return_if_fail (E_IS_EDITOR_PAGE (editor_page));
 
-	document = e_editor_page_get_document (editor_page);
-	list = webkit_dom_document_query_selector_all (
-		document, "[data-evo-paragraph]:not(#-x-evo-input-start)", NULL);
-
-	for (ii = webkit_dom_node_list_get_length (list); ii--;) {
-		gint word_wrap_length, quote, citation_level;
-		WebKitDOMNode *node = webkit_dom_node_list_item (list, ii);
-
-		citation_level = e_editor_dom_get_citation_level (node, FALSE);
-		quote = citation_level ? citation_level * 2 : 0;
-		word_wrap_length = e_editor_page_get_word_wrap_length (editor_page);
-
-		if (node_is_list (node)) {
-			WebKitDOMNode *item = webkit_dom_node_get_first_child (node);
-
-			while (item && WEBKIT_DOM_IS_HTML_LI_ELEMENT (item)) {
-				e_editor_dom_wrap_paragraph_length (
-					editor_page, WEBKIT_DOM_ELEMENT (item), word_wrap_length - quote);
-				item = webkit_dom_node_get_next_sibling (item);
-			}
-		} else {
-			e_editor_dom_wrap_paragraph_length (
-				editor_page, WEBKIT_DOM_ELEMENT (node), word_wrap_length - quote);
-		}
-	}
-	g_clear_object (&list);
+	wrap_paragraphs_in_document_skipping (editor_page, NULL);
 }
 
 WebKitDOMElement *
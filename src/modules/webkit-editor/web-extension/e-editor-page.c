@@ -36,6 +36,8 @@ struct _EEditorPagePrivate {
 	ESpellChecker *spell_checker;
 
 	guint spell_check_on_scroll_event_source_id;
+	guint spell_check_pending_source_id;
+	GQueue spell_check_pending; /* WebKitDOMNode *, blocks to spell check */
 
 	EContentEditorAlignment alignment;
 	EContentEditorBlockFormat block_format;
@@ -180,6 +182,14 @@ e_editor_page_dispose (GObject *object)
 		editor_page->priv->spell_check_on_scroll_event_source_id = 0;
 	}
 
+	if (editor_page->priv->spell_check_pending_source_id > 0) {
+		g_source_remove (editor_page->priv->spell_check_pending_source_id);
+		editor_page->priv->spell_check_pending_source_id = 0;
+	}
+
+	while (!g_queue_is_empty (&editor_page->priv->spell_check_pending))
+		g_object_unref (g_queue_pop_head (&editor_page->priv->spell_check_pending));
+
 	if (editor_page->priv->background_color != NULL) {
 		g_free (editor_page->priv->background_color);
 		editor_page->priv->background_color = NULL;
@@ -259,6 +269,8 @@ e_editor_page_init (EEditorPage *editor_page)
 	editor_page->priv->renew_history_after_coordinates = TRUE;
 	editor_page->priv->allow_top_signature = FALSE;
 	editor_page->priv->spell_check_on_scroll_event_source_id = 0;
+	editor_page->priv->spell_check_pending_source_id = 0;
+	g_queue_init (&editor_page->priv->spell_check_pending);
 	editor_page->priv->mail_settings = e_util_ref_settings ("org.gnome.evolution.mail");
 	editor_page->priv->word_wrap_length = g_settings_get_int (editor_page->priv->mail_settings, "composer-word-wrap-length");
 	editor_page->priv->inline_images = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
@@ -848,6 +860,33 @@ e_editor_page_set_spell_check_on_scroll_event_source_id (EEditorPage *editor_pag
 	editor_page->priv->spell_check_on_scroll_event_source_id = value;
 }
 
+guint
+e_editor_page_get_spell_check_pending_source_id (EEditorPage *editor_page)
+{
+	g_return_val_if_fail (E_IS_EDITOR_PAGE (editor_page), 0);
+
+	return editor_page->priv->spell_check_pending_source_id;
+}
+
+void
+e_editor_page_set_spell_check_pending_source_id (EEditorPage *editor_page,
+                                                 guint value)
+{
+	g_return_if_fail (E_IS_EDITOR_PAGE (editor_page));
+
+	editor_page->priv->spell_check_pending_source_id = value;
+}
+
+/* Returns the queue of referenced WebKitDOMNode-s, blocks of the document
+ * which wait to be spell checked; it's owned by the @editor_page. */
+GQueue *
+e_editor_page_get_spell_check_pending (EEditorPage *editor_page)
+{
+	g_return_val_if_fail (E_IS_EDITOR_PAGE (editor_page), NULL);
+
+	return &editor_page->priv->spell_check_pending;
+}
+
 WebKitDOMNode *
 e_editor_page_get_node_under_mouse_click (EEditorPage *editor_page)
 {
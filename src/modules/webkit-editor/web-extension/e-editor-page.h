@@ -197,6 +197,13 @@ guint		e_editor_page_get_spell_check_on_scroll_event_source_id
 void		e_editor_page_set_spell_check_on_scroll_event_source_id
 						(EEditorPage *editor_page,
 						 guint value);
+guint		e_editor_page_get_spell_check_pending_source_id
+						(EEditorPage *editor_page);
+void		e_editor_page_set_spell_check_pending_source_id
+						(EEditorPage *editor_page,
+						 guint value);
+GQueue *	e_editor_page_get_spell_check_pending
+						(EEditorPage *editor_page);
 WebKitDOMNode *	e_editor_page_get_node_under_mouse_click
 						(EEditorPage *editor_page);
 
@@ -18,6 +18,8 @@
 
 #include "evolution-config.h"
 
+#include <string.h>
+
 #include <webkitdom/webkitdom.h>
 
 #include "web-extensions/e-dom-utils.h"
@@ -37,6 +39,7 @@ struct _EEditorUndoRedoManagerPrivate {
 
 	GList *history;
 	guint history_size;
+	gsize history_memory; /* estimated size of the events in the history */
 };
 
 enum {
@@ -82,7 +85,21 @@ const gchar* event_type_string[] = {
 	"HISTORY_UNQUOTE"
 };
 
-#define HISTORY_SIZE_LIMIT 30
+/* The history is limited by the memory its events take, rather than
+ * by their count, thus many small changes can be undone, while only
+ * a few large ones are kept. */
+#define HISTORY_SIZE_LIMIT 1000
+#define HISTORY_MEMORY_LIMIT (8 * 1024 * 1024)
+
+/* The nodes of a DOM change event, see pack_history_event(). */
+typedef struct {
+	gchar *to; /* HTML of the 'to' node */
+	gboolean to_is_newer_from; /* 'to' is the 'from' of the newer event */
+	gboolean has_from;
+	gsize from_prefix; /* Bytes of 'to' the 'from' starts with */
+	gsize from_suffix; /* Bytes of 'to' the 'from' ends with */
+	gchar *from_middle; /* The rest of the 'from' */
+} EEditorHistoryDOMDiff;
 
 G_DEFINE_TYPE (EEditorUndoRedoManager, e_editor_undo_redo_manager, G_TYPE_OBJECT)
 
@@ -173,6 +190,10 @@ print_history_event (EEditorHistoryEvent *event)
 		case HISTORY_TABLE_DIALOG:
 		case HISTORY_PAGE_DIALOG:
 		case HISTORY_UNQUOTE:
+			if (event->dom_diff) {
+				printf ("    content: packed\n");
+				break;
+			}
 			print_node_inner_html (event->data.dom.from);
 			print_node_inner_html (event->data.dom.to);
 			break;
@@ -1252,7 +1273,7 @@ undo_redo_hrule_dialog (EEditorPage *editor_page,
 		} else {
 			webkit_dom_node_insert_before (
 				webkit_dom_node_get_parent_node (WEBKIT_DOM_NODE (parent)),
-				event->data.dom.to,
+				webkit_dom_node_clone_node_with_error (event->data.dom.to, TRUE, NULL),
 				webkit_dom_node_get_next_sibling (WEBKIT_DOM_NODE (parent)),
 				NULL);
 		}
@@ -2211,6 +2232,17 @@ e_editor_undo_redo_manager_set_operation_in_progress (EEditorUndoRedoManager *ma
 	manager->priv->operation_in_progress = value;
 }
 
+static void
+history_dom_diff_free (EEditorHistoryDOMDiff *diff)
+{
+	if (!diff)
+		return;
+
+	g_free (diff->to);
+	g_free (diff->from_middle);
+	g_free (diff);
+}
+
 static void
 free_history_event (EEditorHistoryEvent *event)
 {
@@ -2251,6 +2283,7 @@ free_history_event (EEditorHistoryEvent *event)
 				g_clear_object (&event->data.dom.from);
 			if (event->data.dom.to != NULL)
 				g_clear_object (&event->data.dom.to);
+			history_dom_diff_free (event->dom_diff);
 			break;
 		default:
 			break;
@@ -2259,11 +2292,402 @@ free_history_event (EEditorHistoryEvent *event)
 	g_free (event);
 }
 
+static gsize
+history_node_memory_size (WebKitDOMNode *node)
+{
+	gchar *html;
+	gsize size;
+
+	if (!node)
+		return 0;
+
+	/* Measured as the serialized node, the form the DOM
+	 * changes are kept in, see pack_history_event(). */
+	if (WEBKIT_DOM_IS_ELEMENT (node))
+		html = webkit_dom_element_get_outer_html (WEBKIT_DOM_ELEMENT (node));
+	else
+		html = dom_get_node_inner_html (node);
+
+	size = html ? strlen (html) : 0;
+	g_free (html);
+
+	return size;
+}
+
+static gboolean
+history_event_has_dom_change (EEditorHistoryEvent *event)
+{
+	if (!event)
+		return FALSE;
+
+	switch (event->type) {
+		case HISTORY_HRULE_DIALOG:
+		case HISTORY_IMAGE_DIALOG:
+		case HISTORY_CELL_DIALOG:
+		case HISTORY_TABLE_DIALOG:
+		case HISTORY_TABLE_INPUT:
+		case HISTORY_PAGE_DIALOG:
+		case HISTORY_UNQUOTE:
+		case HISTORY_LINK_DIALOG:
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+/* Only elements can be parsed back from their HTML, except of those
+ * the parser puts to the document itself. */
+static gboolean
+history_node_can_be_packed (WebKitDOMNode *node)
+{
+	gchar *tag_name;
+	gboolean can_be_packed;
+
+	if (!node)
+		return TRUE;
+
+	if (!WEBKIT_DOM_IS_ELEMENT (node))
+		return FALSE;
+
+	tag_name = webkit_dom_element_get_tag_name (WEBKIT_DOM_ELEMENT (node));
+	can_be_packed =
+		g_ascii_strcasecmp (tag_name, "html") != 0 &&
+		g_ascii_strcasecmp (tag_name, "head") != 0 &&
+		g_ascii_strcasecmp (tag_name, "body") != 0;
+	g_free (tag_name);
+
+	return can_be_packed;
+}
+
+/* The table parts are dropped by the parser outside of a table. */
+static const gchar *
+history_html_parse_context (const gchar *html)
+{
+	static const struct {
+		const gchar *tag_name;
+		const gchar *context;
+	} contexts[] = {
+		{ "td", "tr" },
+		{ "th", "tr" },
+		{ "tr", "tbody" },
+		{ "tbody", "table" },
+		{ "thead", "table" },
+		{ "tfoot", "table" },
+		{ "caption", "table" },
+		{ "colgroup", "table" },
+		{ "col", "colgroup" }
+	};
+	gsize ii, len;
+
+	len = strcspn (html + 1, " \t\r\n/>");
+	for (ii = 0; ii < G_N_ELEMENTS (contexts); ii++) {
+		if (strlen (contexts[ii].tag_name) == len &&
+		    g_ascii_strncasecmp (html + 1, contexts[ii].tag_name, len) == 0)
+			return contexts[ii].context;
+	}
+
+	return "div";
+}
+
+static WebKitDOMNode *
+history_node_new_from_html (WebKitDOMDocument *document,
+                            const gchar *html)
+{
+	WebKitDOMElement *context;
+	WebKitDOMNode *node;
+
+	if (!html || *html != '<')
+		return NULL;
+
+	context = webkit_dom_document_create_element (
+		document, history_html_parse_context (html), NULL);
+	webkit_dom_element_set_inner_html (context, html, NULL);
+
+	node = webkit_dom_node_get_first_child (WEBKIT_DOM_NODE (context));
+	if (!node) {
+		g_warning ("%s: Failed to restore a history event from '%s'", G_STRFUNC, html);
+		return NULL;
+	}
+
+	g_object_ref (node);
+	webkit_dom_node_remove_child (WEBKIT_DOM_NODE (context), node, NULL);
+
+	return node;
+}
+
+/* Returns the HTML of the 'to' or the 'from' node of the DOM change
+ * event in the @item, whether it's packed or not. */
+static gchar *
+history_event_dup_dom_html (GList *item,
+                            gboolean to)
+{
+	EEditorHistoryEvent *event = item->data;
+	EEditorHistoryDOMDiff *diff = event->dom_diff;
+	GString *html;
+	gchar *to_html;
+
+	if (!diff) {
+		WebKitDOMNode *node;
+
+		node = to ? event->data.dom.to : event->data.dom.from;
+		if (!WEBKIT_DOM_IS_ELEMENT (node))
+			return NULL;
+
+		return webkit_dom_element_get_outer_html (WEBKIT_DOM_ELEMENT (node));
+	}
+
+	if (to) {
+		if (diff->to_is_newer_from)
+			return item->prev ? history_event_dup_dom_html (item->prev, FALSE) : NULL;
+
+		return g_strdup (diff->to);
+	}
+
+	if (!diff->has_from)
+		return NULL;
+
+	to_html = history_event_dup_dom_html (item, TRUE);
+	if (!to_html)
+		return g_strdup (diff->from_middle);
+
+	html = g_string_new_len (to_html, diff->from_prefix);
+	g_string_append (html, diff->from_middle);
+	g_string_append (html, to_html + strlen (to_html) - diff->from_suffix);
+	g_free (to_html);
+
+	return g_string_free (html, FALSE);
+}
+
+/* A DOM change event, which is not the current one anymore, doesn't
+ * need its nodes until it's undone or redone. Its 'to' node is kept
+ * as HTML and its 'from' node only as the part of its HTML, which
+ * differs from the 'to' node. When the event follows a change of the
+ * same element, the 'to' node of the older event is the 'from' node
+ * of this one, thus the older event doesn't keep it at all. */
+static void
+pack_history_event (EEditorUndoRedoManager *manager,
+                    GList *item)
+{
+	EEditorHistoryEvent *event = item->data, *older;
+	EEditorHistoryDOMDiff *diff;
+	gchar *from_html;
+
+	if (!history_event_has_dom_change (event) || event->dom_diff ||
+	    !history_node_can_be_packed (event->data.dom.from) ||
+	    !history_node_can_be_packed (event->data.dom.to))
+		return;
+
+	diff = g_new0 (EEditorHistoryDOMDiff, 1);
+	diff->to = history_event_dup_dom_html (item, TRUE);
+	from_html = history_event_dup_dom_html (item, FALSE);
+	diff->has_from = from_html != NULL;
+
+	if (from_html && diff->to) {
+		gsize from_len, to_len, max_len;
+
+		from_len = strlen (from_html);
+		to_len = strlen (diff->to);
+		max_len = MIN (from_len, to_len);
+
+		while (diff->from_prefix < max_len &&
+		       from_html[diff->from_prefix] == diff->to[diff->from_prefix])
+			diff->from_prefix++;
+
+		max_len -= diff->from_prefix;
+		while (diff->from_suffix < max_len &&
+		       from_html[from_len - diff->from_suffix - 1] == diff->to[to_len - diff->from_suffix - 1])
+			diff->from_suffix++;
+
+		diff->from_middle = g_strndup (
+			from_html + diff->from_prefix,
+			from_len - diff->from_prefix - diff->from_suffix);
+	} else {
+		diff->from_middle = g_strdup (from_html);
+	}
+
+	g_clear_object (&event->data.dom.from);
+	g_clear_object (&event->data.dom.to);
+	event->dom_diff = diff;
+
+	older = item->next ? item->next->data : NULL;
+	if (from_html && history_event_has_dom_change (older) && older->dom_diff) {
+		EEditorHistoryDOMDiff *older_diff = older->dom_diff;
+
+		if (g_strcmp0 (older_diff->to, from_html) == 0) {
+			gsize size = strlen (older_diff->to);
+
+			g_clear_pointer (&older_diff->to, g_free);
+			older_diff->to_is_newer_from = TRUE;
+			older->memory_size -= size;
+			manager->priv->history_memory -= size;
+		}
+	}
+
+	g_free (from_html);
+}
+
+/* The event older than the one in the @item stops referring to its
+ * 'from' node, because the event is going to be removed or changed. */
+static void
+history_event_detach_older (EEditorUndoRedoManager *manager,
+                            GList *item)
+{
+	EEditorHistoryEvent *older;
+	EEditorHistoryDOMDiff *older_diff;
+
+	older = item->next ? item->next->data : NULL;
+	if (!history_event_has_dom_change (older) || !older->dom_diff)
+		return;
+
+	older_diff = older->dom_diff;
+	if (!older_diff->to_is_newer_from)
+		return;
+
+	older_diff->to = history_event_dup_dom_html (item, FALSE);
+	older_diff->to_is_newer_from = FALSE;
+
+	if (older_diff->to) {
+		gsize size = strlen (older_diff->to);
+
+		older->memory_size += size;
+		manager->priv->history_memory += size;
+	}
+}
+
+/* Recreates the nodes of a packed event, thus it can be undone or redone.
+ * Returns whether the nodes were recreated and should be freed after that. */
+static gboolean
+history_event_restore_dom_change (EEditorUndoRedoManager *manager,
+                                  GList *item)
+{
+	EEditorHistoryEvent *event = item->data;
+	EEditorPage *editor_page;
+	WebKitDOMDocument *document;
+	gchar *html;
+
+	if (!history_event_has_dom_change (event) || !event->dom_diff)
+		return FALSE;
+
+	editor_page = editor_undo_redo_manager_ref_editor_page (manager);
+	g_return_val_if_fail (editor_page != NULL, FALSE);
+
+	document = e_editor_page_get_document (editor_page);
+
+	html = history_event_dup_dom_html (item, TRUE);
+	event->data.dom.to = history_node_new_from_html (document, html);
+	g_free (html);
+
+	html = history_event_dup_dom_html (item, FALSE);
+	event->data.dom.from = history_node_new_from_html (document, html);
+	g_free (html);
+
+	g_object_unref (editor_page);
+
+	return TRUE;
+}
+
+static void
+unpack_history_event (EEditorUndoRedoManager *manager,
+                      GList *item)
+{
+	EEditorHistoryEvent *event = item->data;
+
+	if (!history_event_restore_dom_change (manager, item))
+		return;
+
+	history_event_detach_older (manager, item);
+	history_dom_diff_free (event->dom_diff);
+	event->dom_diff = NULL;
+}
+
+static gsize
+estimate_history_event_memory_size (EEditorHistoryEvent *event)
+{
+	gsize size = sizeof (EEditorHistoryEvent);
+
+	switch (event->type) {
+		case HISTORY_INPUT:
+		case HISTORY_DELETE:
+		case HISTORY_CITATION_SPLIT:
+		case HISTORY_IMAGE:
+		case HISTORY_SMILEY:
+		case HISTORY_REMOVE_LINK:
+			size += history_node_memory_size (WEBKIT_DOM_NODE (event->data.fragment));
+			break;
+		case HISTORY_FONT_COLOR:
+		case HISTORY_PASTE:
+		case HISTORY_PASTE_AS_TEXT:
+		case HISTORY_PASTE_QUOTED:
+		case HISTORY_INSERT_HTML:
+		case HISTORY_REPLACE:
+		case HISTORY_REPLACE_ALL:
+			if (event->data.string.from)
+				size += strlen (event->data.string.from);
+			if (event->data.string.to)
+				size += strlen (event->data.string.to);
+			break;
+		case HISTORY_HRULE_DIALOG:
+		case HISTORY_IMAGE_DIALOG:
+		case HISTORY_CELL_DIALOG:
+		case HISTORY_TABLE_DIALOG:
+		case HISTORY_TABLE_INPUT:
+		case HISTORY_PAGE_DIALOG:
+		case HISTORY_UNQUOTE:
+		case HISTORY_LINK_DIALOG:
+			if (event->dom_diff) {
+				EEditorHistoryDOMDiff *diff = event->dom_diff;
+
+				size += sizeof (EEditorHistoryDOMDiff);
+				if (diff->to)
+					size += strlen (diff->to);
+				if (diff->from_middle)
+					size += strlen (diff->from_middle);
+			} else {
+				size += history_node_memory_size (event->data.dom.from);
+				size += history_node_memory_size (event->data.dom.to);
+			}
+			break;
+		default:
+			break;
+	}
+
+	return size;
+}
+
+/* The events are modified after being inserted, until another event
+ * is inserted, thus the current event is packed and its size measured
+ * only when it's not the current event anymore. */
+static void
+update_current_history_event_memory_size (EEditorUndoRedoManager *manager)
+{
+	EEditorHistoryEvent *event;
+
+	if (!manager->priv->history)
+		return;
+
+	event = manager->priv->history->data;
+	if (!event || event->type == HISTORY_START)
+		return;
+
+	pack_history_event (manager, manager->priv->history);
+
+	manager->priv->history_memory -= event->memory_size;
+	event->memory_size = estimate_history_event_memory_size (event);
+	manager->priv->history_memory += event->memory_size;
+}
+
 static void
 remove_history_event (EEditorUndoRedoManager *manager,
                       GList *item)
 {
-	free_history_event (item->data);
+	EEditorHistoryEvent *event = item->data;
+
+	if (event) {
+		manager->priv->history_memory -= event->memory_size;
+		history_event_detach_older (manager, item);
+	}
+
+	free_history_event (event);
 	manager->priv->history = g_list_delete_link (manager->priv->history, item);
 	manager->priv->history_size--;
 }
@@ -2301,12 +2725,20 @@ e_editor_undo_redo_manager_insert_history_event (EEditorUndoRedoManager *manager
 	}
 
 	remove_forward_redo_history_events_if_needed (manager);
+	update_current_history_event_memory_size (manager);
 
-	if (manager->priv->history_size >= HISTORY_SIZE_LIMIT) {
+	/* Remove the oldest events, but always keep the last one. */
+	while (manager->priv->history_size >= HISTORY_SIZE_LIMIT ||
+	       (manager->priv->history_size > 1 &&
+	        manager->priv->history_memory > HISTORY_MEMORY_LIMIT)) {
 		EEditorHistoryEvent *prev_event;
 		GList *item;
 
-		remove_history_event (manager, g_list_last (manager->priv->history)->prev);
+		item = g_list_last (manager->priv->history);
+		if (!item || !item->prev)
+			break;
+
+		remove_history_event (manager, item->prev);
 		while ((item = g_list_last (manager->priv->history)) && (item = item->prev) &&
 		       (prev_event = item->data) && prev_event->type == HISTORY_AND) {
 			remove_history_event (manager, g_list_last (manager->priv->history)->prev);
@@ -2328,8 +2760,13 @@ e_editor_undo_redo_manager_get_current_history_event (EEditorUndoRedoManager *ma
 {
 	g_return_val_if_fail (E_IS_EDITOR_UNDO_REDO_MANAGER (manager), NULL);
 
-	if (manager->priv->history)
+	if (manager->priv->history) {
+		/* The caller can change the event, thus it cannot stay packed. */
+		if (!manager->priv->operation_in_progress)
+			unpack_history_event (manager, manager->priv->history);
+
 		return manager->priv->history->data;
+	}
 
 	return NULL;
 }
@@ -2543,6 +2980,7 @@ e_editor_undo_redo_manager_undo (EEditorUndoRedoManager *manager)
 	EEditorHistoryEvent *event;
 	EEditorPage *editor_page;
 	GList *history;
+	gboolean restored;
 
 	g_return_if_fail (E_IS_EDITOR_UNDO_REDO_MANAGER (manager));
 
@@ -2562,6 +3000,8 @@ e_editor_undo_redo_manager_undo (EEditorUndoRedoManager *manager)
 	editor_page = editor_undo_redo_manager_ref_editor_page (manager);
 	g_return_if_fail (editor_page != NULL);
 
+	restored = history_event_restore_dom_change (manager, history);
+
 	switch (event->type) {
 		case HISTORY_BOLD:
 		case HISTORY_ITALIC:
@@ -2637,6 +3077,11 @@ e_editor_undo_redo_manager_undo (EEditorUndoRedoManager *manager)
 			return;
 	}
 
+	if (restored) {
+		g_clear_object (&event->data.dom.from);
+		g_clear_object (&event->data.dom.to);
+	}
+
 	if (history->next) {
 		event = history->next->data;
 		if (event->type == HISTORY_AND) {
@@ -2679,6 +3124,7 @@ e_editor_undo_redo_manager_redo (EEditorUndoRedoManager *manager)
 	EEditorPage *editor_page;
 	EEditorHistoryEvent *event;
 	GList *history;
+	gboolean restored;
 
 	if (!e_editor_undo_redo_manager_can_redo (manager))
 		return;
@@ -2696,6 +3142,8 @@ e_editor_undo_redo_manager_redo (EEditorUndoRedoManager *manager)
 
 	manager->priv->operation_in_progress = TRUE;
 
+	restored = history_event_restore_dom_change (manager, history->prev);
+
 	switch (event->type) {
 		case HISTORY_BOLD:
 		case HISTORY_MONOSPACE:
@@ -2787,6 +3235,11 @@ e_editor_undo_redo_manager_redo (EEditorUndoRedoManager *manager)
 			return;
 	}
 
+	if (restored) {
+		g_clear_object (&event->data.dom.from);
+		g_clear_object (&event->data.dom.to);
+	}
+
 	if (history->prev->prev) {
 		event = history->prev->prev->data;
 		if (event->type == HISTORY_AND) {
@@ -2826,6 +3279,7 @@ e_editor_undo_redo_manager_clean_history (EEditorUndoRedoManager *manager)
 	}
 
 	manager->priv->history_size = 0;
+	manager->priv->history_memory = 0;
 	editor_page = editor_undo_redo_manager_ref_editor_page (manager);
 	g_return_if_fail (editor_page != NULL);
 	e_editor_page_set_dont_save_history_in_body_input (editor_page, FALSE);
@@ -2974,4 +3428,5 @@ e_editor_undo_redo_manager_init (EEditorUndoRedoManager *manager)
 	manager->priv->operation_in_progress = FALSE;
 	manager->priv->history = NULL;
 	manager->priv->history_size = 0;
+	manager->priv->history_memory = 0;
 }
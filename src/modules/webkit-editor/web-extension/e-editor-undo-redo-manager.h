@@ -110,6 +110,8 @@ typedef struct {
 	enum EEditorHistoryEventType type;
 	EEditorSelection before;
 	EEditorSelection after;
+	gsize memory_size; /* Estimated by the manager, don't set it. */
+	gpointer dom_diff; /* Packed 'dom' data, managed by the manager. */
 	union {
 		WebKitDOMDocumentFragment *fragment;
 		EEditorStyleChange style;
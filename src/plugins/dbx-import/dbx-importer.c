@@ -52,6 +52,7 @@
 #include <mail/e-mail-backend.h>
 #include <mail/em-folder-selection-button.h>
 #include <mail/em-utils.h>
+#include <mail/importers/mail-importer.h>
 
 #define d(x)
 
@@ -583,8 +584,10 @@ dbx_import_file (DbxImporter *m)
 	GCancellable *cancellable;
 	gchar *filename;
 	CamelFolder *folder;
+	MailImporterCheckpoint *checkpoint = NULL;
 	gint tmpfile;
-	gint i;
+	gint i, first, stored = 0, n_batch = 0;
+	guint64 n_skip;
 	gint missing = 0;
 	m->status_what = NULL;
 	filename = g_filename_from_uri (
@@ -606,36 +609,67 @@ dbx_import_file (DbxImporter *m)
 	folder = e_mail_session_uri_to_folder_sync (
 		session, m->parent_uri, CAMEL_STORE_FOLDER_CREATE,
 		cancellable, &m->base.error);
-	if (!folder)
+	if (!folder) {
+		g_free (filename);
 		return;
+	}
 	d (printf ("importing to %s\n", camel_folder_get_full_name (folder)));
 
 	camel_folder_freeze (folder);
 
-	filename = g_filename_from_uri (
-		((EImportTargetURI *) m->target)->uri_src, NULL, NULL);
 	m->dbx_fd = g_open (filename, O_RDONLY, 0);
-	g_free (filename);
+
+	/* Continue after the last stored message of an interrupted import */
+	checkpoint = mail_importer_checkpoint_load (filename, m->parent_uri, folder);
 
 	if (m->dbx_fd == -1) {
 		g_set_error (
 			&m->base.error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
 			"Failed to open import file");
+		g_free (filename);
 		goto out;
 	}
 
-	if (!dbx_load_indices (m))
+	if (!dbx_load_indices (m)) {
+		g_free (filename);
 		goto out;
+	}
 
 	tmpfile = e_mkstemp ("dbx-import-XXXXXX");
 	if (tmpfile == -1) {
 		g_set_error (
 			&m->base.error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
 			"Failed to create temporary file for import");
+		g_free (filename);
 		goto out;
 	}
 
-	for (i = 0; i < m->index_count; i++) {
+	first = mail_importer_checkpoint_get_position (checkpoint);
+	if (first > 0) {
+		gchar *marker;
+
+		/* The checkpoint is valid for an unchanged file only,
+		 * but make sure the index table was read the same way. */
+		marker = first <= m->index_count ? g_strdup_printf ("%x", m->indices[first - 1]) : NULL;
+		if (g_strcmp0 (marker, mail_importer_checkpoint_get_marker (checkpoint)) != 0)
+			first = 0;
+		g_free (marker);
+	}
+
+	/* Messages stored after the last commit are skipped as well */
+	n_skip = first > 0 ? mail_importer_checkpoint_get_n_uncommitted (checkpoint) : 0;
+
+	if (first > 0) {
+		camel_operation_pop_message (NULL);
+		camel_operation_push_message (NULL, _("Continuing interrupted import of “%s”"), filename);
+	}
+
+	g_free (filename);
+
+	/* Everything up to here is stored, also when nothing is left */
+	stored = first;
+
+	for (i = first; i < m->index_count; i++) {
 		CamelMessageInfo *info;
 		CamelMimeMessage *msg;
 		CamelMimeParser *mp;
@@ -653,6 +687,7 @@ dbx_import_file (DbxImporter *m)
 			if (m->base.error != NULL)
 				goto out;
 			missing++;
+			stored = i + 1;
 			continue;
 		}
 		if (dbx_flags & 0x40)
@@ -676,6 +711,15 @@ dbx_import_file (DbxImporter *m)
 			break;
 		}
 
+		/* Stored already, after the last commit */
+		if (n_skip > 0) {
+			n_skip--;
+			g_object_unref (msg);
+			g_object_unref (mp);
+			stored = i + 1;
+			continue;
+		}
+
 		info = camel_message_info_new (NULL);
 		camel_message_info_set_flags (info, flags, ~0);
 		success = camel_folder_append_message_sync (
@@ -684,18 +728,45 @@ dbx_import_file (DbxImporter *m)
 		g_clear_object (&info);
 		g_object_unref (msg);
 
-		if (!success) {
-			g_object_unref (mp);
+		g_object_unref (mp);
+
+		if (!success)
 			break;
+
+		stored = i + 1;
+		n_batch++;
+
+		/* Save the summary once per batch, then remember the progress */
+		if (n_batch >= MAIL_IMPORTER_BATCH_SIZE) {
+			gchar *marker;
+
+			n_batch = 0;
+
+			if (camel_folder_synchronize_sync (folder, FALSE, cancellable, NULL)) {
+				marker = g_strdup_printf ("%x", m->indices[i]);
+				mail_importer_checkpoint_commit (checkpoint, folder, i + 1, marker);
+				g_free (marker);
+			}
 		}
 	}
  out:
+	/* FIXME Not passing GCancellable or GError here. */
+	if (camel_folder_synchronize_sync (folder, FALSE, NULL, NULL) && stored > 0) {
+		if (stored >= m->index_count) {
+			mail_importer_checkpoint_finish (checkpoint);
+		} else {
+			gchar *marker;
+
+			marker = g_strdup_printf ("%x", m->indices[stored - 1]);
+			mail_importer_checkpoint_commit (checkpoint, folder, stored, marker);
+			g_free (marker);
+		}
+	}
+	mail_importer_checkpoint_free (checkpoint);
 	if (m->dbx_fd != -1)
 		close (m->dbx_fd);
 	if (m->indices)
 		g_free (m->indices);
-	/* FIXME Not passing GCancellable or GError here. */
-	camel_folder_synchronize_sync (folder, FALSE, NULL, NULL);
 	camel_folder_thaw (folder);
 	g_object_unref (folder);
 	if (missing && m->base.error == NULL) {
@@ -64,13 +64,14 @@ static void pst_error_msg (const gchar *fmt, ...);
 static void pst_import_folders (PstImporter *m, pst_desc_tree *topitem);
 static void pst_process_item (PstImporter *m, pst_desc_tree *d_ptr, gchar **previouss_folder);
 static void pst_process_folder (PstImporter *m, pst_item *item);
-static void pst_process_email (PstImporter *m, pst_item *item);
+static void pst_process_email (PstImporter *m, pst_item *item, CamelFolder *folder);
 static void pst_process_contact (PstImporter *m, pst_item *item);
 static void pst_process_appointment (PstImporter *m, pst_item *item);
 static void pst_process_task (PstImporter *m, pst_item *item);
 static void pst_process_journal (PstImporter *m, pst_item *item);
 
 static void pst_import_file (PstImporter *m);
+static void pst_create_folder (PstImporter *m);
 gchar *foldername_to_utf8 (const gchar *pstname);
 gchar *string_to_utf8 (const gchar *string);
 void contact_set_date (EContact *contact, EContactField id, FILETIME *date);
@@ -91,6 +92,44 @@ gint e_plugin_lib_enable (EPlugin *ep, gint enable);
 
 static guchar pst_signature[] = { '!', 'B', 'D', 'N' };
 
+/* Items are read from the PST file by the import thread, converted
+ * by this many workers and stored in batches of the given size. */
+#define PST_IMPORT_MAX_WORKERS 4
+#define PST_IMPORT_BATCH_SIZE 50
+
+/* How many read items can wait for the conversion, to limit memory use */
+#define PST_IMPORT_MAX_PENDING 64
+
+typedef enum {
+	PST_WORK_EMAIL,
+	PST_WORK_CONTACT,
+	PST_WORK_APPOINTMENT,
+	PST_WORK_TASK,
+	PST_WORK_JOURNAL
+} PstWorkKind;
+
+typedef struct _PstWork {
+	PstWorkKind kind;
+	pst_item *item;
+	CamelFolder *folder;	/* for PST_WORK_EMAIL */
+} PstWork;
+
+typedef enum {
+	PST_BATCH_MESSAGES,
+	PST_BATCH_CONTACTS,
+	PST_BATCH_COMPONENTS
+} PstBatchKind;
+
+typedef struct _PstBatch {
+	PstBatchKind kind;
+	GObject *destination;	/* CamelFolder, EBookClient or ECalClient */
+	GSList *objects;	/* CamelMimeMessage, EContact or icalcomponent */
+	GSList *infos;		/* CamelMessageInfo, for messages only */
+	guint n_objects;
+	guint n_queued;		/* messages read, but not converted yet */
+	gboolean closed;	/* the import thread left the folder */
+} PstBatch;
+
 struct _PstImporter {
 	MailMsg base;
 
@@ -120,6 +159,20 @@ struct _PstImporter {
 	/* progress indicator */
 	gint position;
 	gint total;
+
+	/* conversion and storing pipeline */
+	GThreadPool *workers;
+	GMutex pending_lock;
+	GCond pending_cond;
+	guint n_pending;
+
+	GMutex batches_lock;
+	GHashTable *batches;	/* GObject *destination ~> PstBatch * */
+
+	volatile gint n_imported;
+	gint64 started;
+	gint64 last_rate_report;
+	gboolean rate_message_pushed;
 };
 
 gboolean
@@ -732,6 +785,381 @@ count_items (PstImporter *m,
 	}
 }
 
+static void
+pst_batch_free (PstBatch *batch)
+{
+	if (!batch)
+		return;
+
+	switch (batch->kind) {
+	case PST_BATCH_MESSAGES:
+	case PST_BATCH_CONTACTS:
+		g_slist_free_full (batch->objects, g_object_unref);
+		break;
+	case PST_BATCH_COMPONENTS:
+		g_slist_free_full (batch->objects, (GDestroyNotify) icalcomponent_free);
+		break;
+	}
+
+	g_slist_free_full (batch->infos, g_object_unref);
+	g_object_unref (batch->destination);
+	g_slice_free (PstBatch, batch);
+}
+
+static void
+pst_batch_write (PstImporter *m,
+                 PstBatch *batch)
+{
+	GSList *link, *ilink;
+	GError *error = NULL;
+
+	/* Items are prepended when added; store them in the order they
+	 * were converted, which differs from the PST order with more workers */
+	batch->objects = g_slist_reverse (batch->objects);
+	batch->infos = g_slist_reverse (batch->infos);
+
+	switch (batch->kind) {
+	case PST_BATCH_MESSAGES:
+		/* Notify about the changes once, when the whole batch is stored */
+		camel_folder_freeze (CAMEL_FOLDER (batch->destination));
+
+		for (link = batch->objects, ilink = batch->infos; link && ilink; link = g_slist_next (link), ilink = g_slist_next (ilink)) {
+			if (!camel_folder_append_message_sync (CAMEL_FOLDER (batch->destination), link->data, ilink->data, NULL, m->cancellable, &error)) {
+				g_debug ("%s: Failed to append message: %s", G_STRFUNC, error ? error->message : "Unknown error");
+				g_clear_error (&error);
+			}
+		}
+
+		camel_folder_synchronize_sync (CAMEL_FOLDER (batch->destination), FALSE, NULL, NULL);
+		camel_folder_thaw (CAMEL_FOLDER (batch->destination));
+		break;
+	case PST_BATCH_CONTACTS:
+		if (!e_book_client_add_contacts_sync (E_BOOK_CLIENT (batch->destination), batch->objects, NULL, m->cancellable, &error) &&
+		    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			g_clear_error (&error);
+
+			/* Find which contacts were rejected */
+			for (link = batch->objects; link; link = g_slist_next (link)) {
+				if (!e_book_client_add_contact_sync (E_BOOK_CLIENT (batch->destination), link->data, NULL, m->cancellable, &error)) {
+					g_warning ("%s: Failed to add contact: %s", G_STRFUNC, error ? error->message : "Unknown error");
+					g_clear_error (&error);
+				}
+			}
+		}
+		break;
+	case PST_BATCH_COMPONENTS:
+		if (!e_cal_client_create_objects_sync (E_CAL_CLIENT (batch->destination), batch->objects, NULL, m->cancellable, &error) &&
+		    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			g_clear_error (&error);
+
+			/* Find which components were rejected */
+			for (link = batch->objects; link; link = g_slist_next (link)) {
+				if (!e_cal_client_create_object_sync (E_CAL_CLIENT (batch->destination), link->data, NULL, m->cancellable, &error)) {
+					g_warning ("Creation of %s failed: %s",
+						icalcomponent_kind_to_string (icalcomponent_isa (link->data)),
+						error ? error->message : "Unknown error");
+					g_clear_error (&error);
+				}
+			}
+		}
+		break;
+	}
+
+	g_clear_error (&error);
+
+	g_atomic_int_add (&m->n_imported, batch->n_objects);
+}
+
+static void
+pst_batch_write_and_free (PstImporter *m,
+                          PstBatch *batch)
+{
+	if (batch->n_objects > 0 && !g_cancellable_is_cancelled (m->cancellable))
+		pst_batch_write (m, batch);
+
+	pst_batch_free (batch);
+}
+
+/* Call with the batches_lock held */
+static PstBatch *
+pst_import_batch_ensure (PstImporter *m,
+                         PstBatchKind kind,
+                         GObject *destination)
+{
+	PstBatch *batch;
+
+	batch = g_hash_table_lookup (m->batches, destination);
+	if (!batch) {
+		batch = g_slice_new0 (PstBatch);
+		batch->kind = kind;
+		batch->destination = g_object_ref (destination);
+
+		g_hash_table_insert (m->batches, destination, batch);
+	}
+
+	return batch;
+}
+
+/* Takes ownership of the object and the info. A full batch is stored
+ * by the thread which filled it, the batch of a folder when its last
+ * message is converted after the import thread left the folder, and
+ * the rest on pst_import_pipeline_finish(). */
+static void
+pst_import_batch_add (PstImporter *m,
+                      PstBatchKind kind,
+                      GObject *destination,
+                      gpointer object,
+                      CamelMessageInfo *info)
+{
+	PstBatch *batch, *full = NULL;
+
+	g_mutex_lock (&m->batches_lock);
+
+	batch = pst_import_batch_ensure (m, kind, destination);
+
+	batch->objects = g_slist_prepend (batch->objects, object);
+	if (kind == PST_BATCH_MESSAGES)
+		batch->infos = g_slist_prepend (batch->infos, info);
+	batch->n_objects++;
+
+	if (batch->n_objects >= PST_IMPORT_BATCH_SIZE) {
+		/* Keep the counters in the table, take only the objects */
+		full = g_slice_new0 (PstBatch);
+		full->kind = kind;
+		full->destination = g_object_ref (destination);
+		full->objects = batch->objects;
+		full->infos = batch->infos;
+		full->n_objects = batch->n_objects;
+
+		batch->objects = NULL;
+		batch->infos = NULL;
+		batch->n_objects = 0;
+	}
+
+	g_mutex_unlock (&m->batches_lock);
+
+	if (full)
+		pst_batch_write_and_free (m, full);
+}
+
+/* A message for the @folder was converted, or failed to be converted */
+static void
+pst_import_batch_message_done (PstImporter *m,
+                               CamelFolder *folder)
+{
+	PstBatch *batch;
+
+	g_mutex_lock (&m->batches_lock);
+
+	batch = g_hash_table_lookup (m->batches, folder);
+	if (batch) {
+		batch->n_queued--;
+
+		if (batch->closed && !batch->n_queued)
+			g_hash_table_steal (m->batches, folder);
+		else
+			batch = NULL;
+	}
+
+	g_mutex_unlock (&m->batches_lock);
+
+	if (batch)
+		pst_batch_write_and_free (m, batch);
+}
+
+/* Called by the import thread when it leaves the current folder, thus
+ * its last messages do not wait in memory until the end of the import. */
+static void
+pst_import_close_folder (PstImporter *m)
+{
+	PstBatch *batch = NULL;
+
+	if (!m->folder)
+		return;
+
+	g_mutex_lock (&m->batches_lock);
+
+	if (m->batches)
+		batch = g_hash_table_lookup (m->batches, m->folder);
+	if (batch) {
+		batch->closed = TRUE;
+
+		if (!batch->n_queued)
+			g_hash_table_steal (m->batches, m->folder);
+		else
+			batch = NULL;
+	}
+
+	g_mutex_unlock (&m->batches_lock);
+
+	if (batch)
+		pst_batch_write_and_free (m, batch);
+
+	g_clear_object (&m->folder);
+}
+
+/* Reads the attachments data in the import thread; the workers
+ * cannot access the PST file. */
+static void
+pst_preload_attachments (PstImporter *m,
+                         pst_item *item)
+{
+	pst_item_attach *attach;
+
+	for (attach = item->attach; attach; attach = attach->next) {
+		if (attach->data.data == NULL && attach->i_id) {
+			/* Freed together with the item */
+			attach->data = pst_attach_to_mem (&m->pst, attach);
+		}
+	}
+}
+
+static void
+pst_import_work_cb (gpointer data,
+                    gpointer user_data)
+{
+	PstWork *work = data;
+	PstImporter *m = user_data;
+
+	if (!g_cancellable_is_cancelled (m->cancellable)) {
+		switch (work->kind) {
+		case PST_WORK_EMAIL:
+			pst_process_email (m, work->item, work->folder);
+			break;
+		case PST_WORK_CONTACT:
+			pst_process_contact (m, work->item);
+			break;
+		case PST_WORK_APPOINTMENT:
+			pst_process_appointment (m, work->item);
+			break;
+		case PST_WORK_TASK:
+			pst_process_task (m, work->item);
+			break;
+		case PST_WORK_JOURNAL:
+			pst_process_journal (m, work->item);
+			break;
+		}
+	}
+
+	if (work->kind == PST_WORK_EMAIL)
+		pst_import_batch_message_done (m, work->folder);
+
+	pst_freeItem (work->item);
+	g_clear_object (&work->folder);
+	g_slice_free (PstWork, work);
+
+	g_mutex_lock (&m->pending_lock);
+	m->n_pending--;
+	g_cond_signal (&m->pending_cond);
+	g_mutex_unlock (&m->pending_lock);
+}
+
+/* Passes the item to the workers; returns the item back when it
+ * cannot be queued, otherwise NULL, as the workers own it then. */
+static pst_item *
+pst_import_queue_item (PstImporter *m,
+                       pst_item *item,
+                       PstWorkKind kind)
+{
+	PstWork *work;
+
+	if (kind == PST_WORK_EMAIL && m->folder == NULL) {
+		pst_create_folder (m);
+		if (!m->folder)
+			return item;
+	}
+
+	pst_preload_attachments (m, item);
+
+	work = g_slice_new0 (PstWork);
+	work->kind = kind;
+	work->item = item;
+	if (kind == PST_WORK_EMAIL) {
+		PstBatch *batch;
+
+		work->folder = g_object_ref (m->folder);
+
+		g_mutex_lock (&m->batches_lock);
+		batch = pst_import_batch_ensure (m, PST_BATCH_MESSAGES, G_OBJECT (m->folder));
+		batch->n_queued++;
+		batch->closed = FALSE;
+		g_mutex_unlock (&m->batches_lock);
+	}
+
+	/* Do not read ahead too much */
+	g_mutex_lock (&m->pending_lock);
+	while (m->n_pending >= PST_IMPORT_MAX_PENDING)
+		g_cond_wait (&m->pending_cond, &m->pending_lock);
+	m->n_pending++;
+	g_mutex_unlock (&m->pending_lock);
+
+	g_thread_pool_push (m->workers, work, NULL);
+
+	return NULL;
+}
+
+static void
+pst_import_report_rate (PstImporter *m,
+                        gboolean force)
+{
+	gint64 now = g_get_monotonic_time ();
+	gint n_imported;
+
+	if (!force && now - m->last_rate_report < G_USEC_PER_SEC)
+		return;
+
+	m->last_rate_report = now;
+
+	if (m->rate_message_pushed)
+		camel_operation_pop_message (m->cancellable);
+
+	n_imported = g_atomic_int_get (&m->n_imported);
+
+	camel_operation_push_message (m->cancellable,
+		ngettext ("Imported %d item (%.1f items per second)",
+			  "Imported %d items (%.1f items per second)", n_imported),
+		n_imported, now > m->started ? n_imported * (gdouble) G_USEC_PER_SEC / (now - m->started) : 0.0);
+
+	m->rate_message_pushed = TRUE;
+}
+
+static void
+pst_import_pipeline_start (PstImporter *m)
+{
+	m->batches = g_hash_table_new (g_direct_hash, g_direct_equal);
+	m->n_pending = 0;
+	m->n_imported = 0;
+	m->started = g_get_monotonic_time ();
+	m->last_rate_report = m->started;
+	m->rate_message_pushed = FALSE;
+
+	m->workers = g_thread_pool_new (pst_import_work_cb, m, PST_IMPORT_MAX_WORKERS, FALSE, NULL);
+}
+
+static void
+pst_import_pipeline_finish (PstImporter *m)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	/* Wait for the workers to finish */
+	g_thread_pool_free (m->workers, FALSE, TRUE);
+	m->workers = NULL;
+
+	/* Store what is left */
+	g_hash_table_iter_init (&iter, m->batches);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		pst_batch_write_and_free (m, value);
+
+	g_hash_table_destroy (m->batches);
+	m->batches = NULL;
+
+	if (m->rate_message_pushed) {
+		camel_operation_pop_message (m->cancellable);
+		m->rate_message_pushed = FALSE;
+	}
+}
+
 static void
 pst_import_file (PstImporter *m)
 {
@@ -806,6 +1234,8 @@ pst_import_folders (PstImporter *m,
 
 	node_to_folderuri = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
 
+	pst_import_pipeline_start (m);
+
 	if (topitem) {
 		d_ptr = topitem->child;
 		g_hash_table_insert (node_to_folderuri, topitem, g_strdup (m->folder_uri));
@@ -821,10 +1251,7 @@ pst_import_folders (PstImporter *m,
 		pst_process_item (m, d_ptr, &previous_folder);
 
 		if (d_ptr->child != NULL) {
-			if (m->folder) {
-				g_object_unref (m->folder);
-				m->folder = NULL;
-			}
+			pst_import_close_folder (m);
 
 			g_return_if_fail (m->folder_uri != NULL);
 			g_hash_table_insert (node_to_folderuri, d_ptr, g_strdup (m->folder_uri));
@@ -841,10 +1268,7 @@ pst_import_folders (PstImporter *m,
 			d_ptr = d_ptr->next;
 		} else {
 			while (d_ptr && d_ptr != topitem && d_ptr->next == NULL) {
-				if (m->folder) {
-					g_object_unref (m->folder);
-					m->folder = NULL;
-				}
+				pst_import_close_folder (m);
 
 				g_free (m->folder_uri);
 				m->folder_uri = NULL;
@@ -866,8 +1290,12 @@ pst_import_folders (PstImporter *m,
 		}
 
 		g_free (previous_folder);
+
+		pst_import_report_rate (m, FALSE);
 	}
 
+	pst_import_pipeline_finish (m);
+
 	g_hash_table_destroy (node_to_folderuri);
 }
 
@@ -900,32 +1328,34 @@ pst_process_item (PstImporter *m,
 		switch (item->type) {
 		case PST_TYPE_CONTACT:
 			if (item->contact && m->addressbook && GPOINTER_TO_INT (g_datalist_get_data (&m->target->data, "pst-do-addr")))
-				pst_process_contact (m, item);
+				item = pst_import_queue_item (m, item, PST_WORK_CONTACT);
 			break;
 		case PST_TYPE_APPOINTMENT:
 			if (item->appointment && m->calendar && GPOINTER_TO_INT (g_datalist_get_data (&m->target->data, "pst-do-appt")))
-				pst_process_appointment (m, item);
+				item = pst_import_queue_item (m, item, PST_WORK_APPOINTMENT);
 			break;
 		case PST_TYPE_TASK:
 			if (item->appointment && m->tasks && GPOINTER_TO_INT (g_datalist_get_data (&m->target->data, "pst-do-task")))
-				pst_process_task (m, item);
+				item = pst_import_queue_item (m, item, PST_WORK_TASK);
 			break;
 		case PST_TYPE_JOURNAL:
 			if (item->appointment && m->journal && GPOINTER_TO_INT (g_datalist_get_data (&m->target->data, "pst-do-journal")))
-				pst_process_journal (m, item);
+				item = pst_import_queue_item (m, item, PST_WORK_JOURNAL);
 			break;
 		case PST_TYPE_NOTE:
 		case PST_TYPE_SCHEDULE:
 		case PST_TYPE_REPORT:
 			if (item->email && GPOINTER_TO_INT (g_datalist_get_data (&m->target->data, "pst-do-mail")))
-				pst_process_email (m, item);
+				item = pst_import_queue_item (m, item, PST_WORK_EMAIL);
 			break;
 		}
 
 		m->current_item++;
 	}
 
-	pst_freeItem (item);
+	/* Queued items are freed by the workers */
+	if (item)
+		pst_freeItem (item);
 }
 
 /**
@@ -998,10 +1428,7 @@ pst_process_folder (PstImporter *m,
 	g_free (m->folder_uri);
 	m->folder_uri = uri;
 
-	if (m->folder) {
-		g_object_unref (m->folder);
-		m->folder = NULL;
-	}
+	pst_import_close_folder (m);
 
 	m->folder_count = item->folder->item_count;
 	m->current_item = 0;
@@ -1036,10 +1463,7 @@ pst_create_folder (PstImporter *m)
 
 	g_return_if_fail (g_str_has_prefix (dest, parent));
 
-	if (m->folder) {
-		g_object_unref (m->folder);
-		m->folder = NULL;
-	}
+	pst_import_close_folder (m);
 
 	dest_len = strlen (dest);
 	dest_end = dest + dest_len;
@@ -1104,15 +1528,12 @@ attachment_to_part (PstImporter *m,
 		mimetype = "application/octet-stream";
 	}
 
-	if (attach->data.data != NULL) {
+	/* The data had been read by pst_preload_attachments(), the PST
+	 * file cannot be accessed here, because this runs in a worker. */
+	if (attach->data.data != NULL)
 		camel_mime_part_set_content (part, attach->data.data, attach->data.size, mimetype);
-	} else {
-		pst_binary attach_rc;
-		attach_rc = pst_attach_to_mem (&m->pst, attach);
-
-		camel_mime_part_set_content (part, (gchar *) attach_rc.data, attach_rc.size, mimetype);
-		free (attach_rc.data);
-	}
+	else
+		camel_mime_part_set_content (part, "", 0, mimetype);
 
 	return part;
 }
@@ -1177,7 +1598,8 @@ strip_smtp (const gchar *str)
 
 static void
 pst_process_email (PstImporter *m,
-                   pst_item *item)
+                   pst_item *item,
+                   CamelFolder *folder)
 {
 	CamelMimeMessage *msg;
 	CamelInternetAddress *addr;
@@ -1187,13 +1609,6 @@ pst_process_email (PstImporter *m,
 	pst_item_attach *attach;
 	gboolean has_attachments;
 	gchar *comp_str = NULL;
-	gboolean success;
-
-	if (m->folder == NULL) {
-		pst_create_folder (m);
-		if (!m->folder)
-			return;
-	}
 
 	/* stops on the first valid attachment */
 	for (attach = item->attach; attach; attach = attach->next) {
@@ -1244,8 +1659,6 @@ pst_process_email (PstImporter *m,
 		}
 	}
 
-	camel_folder_freeze (m->folder);
-
 	msg = camel_mime_message_new ();
 
 	if (item->subject.str != NULL) {
@@ -1394,23 +1807,11 @@ pst_process_email (PstImporter *m,
 	if (item->flags & 0x08)
 		camel_message_info_set_flags (info, CAMEL_MESSAGE_DRAFT, ~0);
 
-	/* FIXME Not passing a GCancellable or GError here. */
-	success = camel_folder_append_message_sync (
-		m->folder, msg, info, NULL, NULL, NULL);
-	g_clear_object (&info);
-	g_object_unref (msg);
-
-	/* FIXME Not passing a GCancellable or GError here. */
-	camel_folder_synchronize_sync (m->folder, FALSE, NULL, NULL);
-	camel_folder_thaw (m->folder);
+	/* Takes ownership of the msg and the info */
+	pst_import_batch_add (m, PST_BATCH_MESSAGES, G_OBJECT (folder), msg, info);
 
+	g_object_unref (mp);
 	g_free (comp_str);
-
-	if (!success) {
-		g_debug ("%s: Exception!", G_STRFUNC);
-		return;
-	}
-
 }
 
 static void
@@ -1508,7 +1909,6 @@ pst_process_contact (PstImporter *m,
 	pst_item_contact *c;
 	EContact *ec;
 	GString *notes;
-	GError *error = NULL;
 
 	c = item->contact;
 	notes = g_string_sized_new (2048);
@@ -1648,17 +2048,8 @@ pst_process_contact (PstImporter *m,
 	contact_set_string (ec, E_CONTACT_NOTE, notes->str);
 	g_string_free (notes, TRUE);
 
-	e_book_client_add_contact_sync (
-		m->addressbook, ec, NULL, NULL, &error);
-
-	g_object_unref (ec);
-
-	if (error != NULL) {
-		g_warning (
-			"%s: Failed to add contact: %s",
-			G_STRFUNC, error->message);
-		g_error_free (error);
-	}
+	/* Takes ownership of the ec */
+	pst_import_batch_add (m, PST_BATCH_CONTACTS, G_OBJECT (m->addressbook), ec, NULL);
 }
 
 /**
@@ -1998,7 +2389,6 @@ pst_process_component (PstImporter *m,
                        ECalClient *cal)
 {
 	ECalComponent *ec;
-	GError *error = NULL;
 
 	g_return_if_fail (item->appointment != NULL);
 
@@ -2008,16 +2398,9 @@ pst_process_component (PstImporter *m,
 	fill_calcomponent (m, item, ec, comp_type);
 	set_cal_attachments (cal, ec, m, item->attach);
 
-	e_cal_client_create_object_sync (
-		cal, e_cal_component_get_icalcomponent (ec),
-		NULL, NULL, &error);
-
-	if (error != NULL) {
-		g_warning (
-			"Creation of %s failed: %s",
-			comp_type, error->message);
-		g_error_free (error);
-	}
+	/* Takes ownership of the icalcomponent */
+	pst_import_batch_add (m, PST_BATCH_COMPONENTS, G_OBJECT (cal),
+		icalcomponent_new_clone (e_cal_component_get_icalcomponent (ec)), NULL);
 
 	g_object_unref (ec);
 }
@@ -2078,6 +2461,9 @@ pst_import_free (PstImporter *m)
 
 	g_free (m->status_what);
 	g_mutex_clear (&m->status_lock);
+	g_mutex_clear (&m->pending_lock);
+	g_cond_clear (&m->pending_cond);
+	g_mutex_clear (&m->batches_lock);
 
 	g_source_remove (m->status_timeout_id);
 	m->status_timeout_id = 0;
@@ -2155,6 +2541,9 @@ pst_import (EImport *ei,
 	m->status_timeout_id =
 		e_named_timeout_add (100, pst_status_timeout, m);
 	g_mutex_init (&m->status_lock);
+	g_mutex_init (&m->pending_lock);
+	g_cond_init (&m->pending_cond);
+	g_mutex_init (&m->batches_lock);
 	m->cancellable = camel_operation_new ();
 
 	g_signal_connect (
@@ -32,6 +32,7 @@
 #include <shell/e-shell-view.h>
 
 #include "url-editor-dialog.h"
+#include "publish-changes.h"
 #include "publish-format-fb.h"
 #include "publish-format-ical.h"
 
@@ -43,6 +44,15 @@ static GtkListStore *store = NULL;
 static GHashTable *uri_timeouts = NULL;
 static GSList *publish_uris = NULL;
 static GSList *queued_publishes = NULL;
+
+/* Publishing runs in a thread pool, thus the locations are published
+ * concurrently; each location at most once at a time. */
+#define PUBLISH_MAX_THREADS 4
+
+static GThreadPool *publish_pool = NULL;
+static GHashTable *publishing_uris = NULL;
+static GHashTable *removed_uris = NULL; /* freed by their publish job */
+static GMutex publish_lock; /* guards the above and queued_publishes */
 static gint online = 0;
 
 static GSList *error_queue = NULL;
@@ -53,6 +63,7 @@ static void  error_queue_add (gchar *descriptions, GError *error);
 gint          e_plugin_lib_enable (EPlugin *ep, gint enable);
 GtkWidget   *publish_calendar_locations (EPlugin *epl, EConfigHookItemFactoryData *data);
 static void  update_timestamp (EPublishUri *uri);
+static void  add_timeout (EPublishUri *uri);
 static void publish (EPublishUri *uri, gboolean can_report_success);
 
 static GtkStatusIcon *status_icon = NULL;
@@ -167,26 +178,126 @@ update_publish_notification (GtkMessageType msg_type,
 	}
 }
 
+typedef struct _PublishJob {
+	EPublishUri *uri;
+	gboolean can_report_success;
+} PublishJob;
+
 static void
-publish_no_succ_info (EPublishUri *uri)
+publish_job_run (gpointer data,
+                 gpointer user_data)
 {
-	publish (uri, FALSE);
+	PublishJob *job = data;
+	gboolean removed;
+
+	g_mutex_lock (&publish_lock);
+	removed = removed_uris && g_hash_table_contains (removed_uris, job->uri);
+	g_mutex_unlock (&publish_lock);
+
+	/* The location could be removed while the job was queued */
+	if (!removed)
+		publish (job->uri, job->can_report_success);
+
+	g_mutex_lock (&publish_lock);
+	g_hash_table_remove (publishing_uris, job->uri);
+	removed = removed_uris && g_hash_table_remove (removed_uris, job->uri);
+	g_mutex_unlock (&publish_lock);
+
+	if (removed) {
+		publish_changes_forget (job->uri);
+		g_free (job->uri);
+	}
+
+	g_slice_free (PublishJob, job);
 }
 
 static void
-publish_uri_async (EPublishUri *uri)
+publish_uri_queue (EPublishUri *uri,
+                   gboolean can_report_success)
 {
-	GThread *thread = NULL;
+	PublishJob *job;
 	GError *error = NULL;
 
-	thread = g_thread_try_new (
-		NULL, (GThreadFunc) publish_no_succ_info, uri, &error);
-	if (error != NULL) {
-		g_warning (G_STRLOC ": %s", error->message);
-		g_error_free (error);
-	} else {
-		g_thread_unref (thread);
+	g_mutex_lock (&publish_lock);
+
+	if (!publish_pool) {
+		publish_pool = g_thread_pool_new (
+			publish_job_run, NULL,
+			PUBLISH_MAX_THREADS, FALSE, &error);
+
+		if (!publish_pool) {
+			g_mutex_unlock (&publish_lock);
+			/* To Translators: This is shown to a user when creation of a new thread,
+			 * where the publishing should be done, fails. Basically, this shouldn't
+			 * ever happen, and if so, then something is really wrong. */
+			error_queue_add (g_strdup (_("Could not create publish thread.")), error);
+			return;
+		}
+
+		publishing_uris = g_hash_table_new (g_direct_hash, g_direct_equal);
 	}
+
+	/* Being published right now, no need to do it twice. */
+	if (g_hash_table_contains (publishing_uris, uri)) {
+		g_mutex_unlock (&publish_lock);
+		return;
+	}
+
+	g_hash_table_add (publishing_uris, uri);
+
+	job = g_slice_new0 (PublishJob);
+	job->uri = uri;
+	job->can_report_success = can_report_success;
+
+	g_thread_pool_push (publish_pool, job, NULL);
+
+	g_mutex_unlock (&publish_lock);
+}
+
+/* Returns TRUE when a publish job still uses the @uri; the job
+ * frees it then, otherwise the caller should free it. */
+static gboolean
+publish_uri_forget (EPublishUri *uri)
+{
+	gboolean in_use;
+
+	g_mutex_lock (&publish_lock);
+
+	queued_publishes = g_slist_remove (queued_publishes, uri);
+
+	in_use = publishing_uris && g_hash_table_contains (publishing_uris, uri);
+
+	if (in_use) {
+		if (!removed_uris)
+			removed_uris = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+		g_hash_table_add (removed_uris, uri);
+	}
+
+	g_mutex_unlock (&publish_lock);
+
+	return in_use;
+}
+
+static void
+publish_uri_async (EPublishUri *uri)
+{
+	publish_uri_queue (uri, FALSE);
+}
+
+static gboolean
+publish_timeout_cb (gpointer user_data)
+{
+	EPublishUri *uri = user_data;
+
+	/* This source is done; schedule the next one and publish
+	 * in a thread, instead of blocking the main loop. */
+	g_hash_table_remove (uri_timeouts, uri);
+	add_timeout (uri);
+
+	publish_uri_async (uri);
+
+	return FALSE;
 }
 
 static void
@@ -196,6 +307,8 @@ publish_online (EPublishUri *uri,
                 gboolean can_report_success)
 {
 	GOutputStream *stream;
+	GOutputStream *buffered;
+	PublishState *state;
 	GError *error = NULL;
 
 	stream = G_OUTPUT_STREAM (g_file_replace (
@@ -219,15 +332,30 @@ publish_online (EPublishUri *uri,
 		return;
 	}
 
+	/* Take it before writing, thus changes done meanwhile
+	 * are published the next time. */
+	state = publish_changes_snapshot (uri);
+
+	/* The formats write component by component. */
+	buffered = g_buffered_output_stream_new_sized (stream, 64 * 1024);
+
 	switch (uri->publish_format) {
 		case URI_PUBLISH_AS_ICAL:
-			publish_calendar_as_ical (stream, uri, &error);
+			publish_calendar_as_ical (buffered, uri, &error);
 			break;
 		case URI_PUBLISH_AS_FB:
-			publish_calendar_as_fb (stream, uri, &error);
+			publish_calendar_as_fb (buffered, uri, &error);
 			break;
 	}
 
+	if (error == NULL)
+		g_output_stream_flush (buffered, NULL, &error);
+
+	if (error == NULL)
+		publish_changes_set_published (uri, state);
+	else
+		publish_changes_state_free (state);
+
 	if (error != NULL)
 		error_queue_add (
 			g_strdup_printf (
@@ -243,7 +371,8 @@ publish_online (EPublishUri *uri,
 
 	update_timestamp (uri);
 
-	g_output_stream_close (stream, NULL, NULL);
+	g_output_stream_close (buffered, NULL, NULL);
+	g_object_unref (buffered);
 	g_object_unref (stream);
 }
 
@@ -457,12 +586,21 @@ publish (EPublishUri *uri,
 		GError *error = NULL;
 		GFile *file;
 
+		g_mutex_lock (&publish_lock);
 		if (g_slist_find (queued_publishes, uri))
 			queued_publishes = g_slist_remove (queued_publishes, uri);
+		g_mutex_unlock (&publish_lock);
 
 		if (!uri->enabled)
 			return;
 
+		/* Nothing changed since the last publish; the user
+		 * initiated publish is done regardless. */
+		if (!can_report_success && publish_changes_is_unchanged (uri)) {
+			update_timestamp (uri);
+			return;
+		}
+
 		file = g_file_new_for_uri (uri->location);
 
 		g_return_if_fail (file != NULL);
@@ -485,8 +623,10 @@ publish (EPublishUri *uri,
 
 		g_object_unref (file);
 	} else {
+		g_mutex_lock (&publish_lock);
 		if (g_slist_find (queued_publishes, uri) == NULL)
 			queued_publishes = g_slist_prepend (queued_publishes, uri);
+		g_mutex_unlock (&publish_lock);
 	}
 }
 
@@ -508,12 +648,12 @@ add_timeout (EPublishUri *uri)
 	switch (uri->publish_frequency) {
 	case URI_PUBLISH_DAILY:
 		id = e_named_timeout_add_seconds (
-			24 * 60 * 60, (GSourceFunc) publish, uri);
+			24 * 60 * 60, publish_timeout_cb, uri);
 		g_hash_table_insert (uri_timeouts, uri, GUINT_TO_POINTER (id));
 		break;
 	case URI_PUBLISH_WEEKLY:
 		id = e_named_timeout_add_seconds (
-			7 * 24 * 60 * 60, (GSourceFunc) publish, uri);
+			7 * 24 * 60 * 60, publish_timeout_cb, uri);
 		g_hash_table_insert (uri_timeouts, uri, GUINT_TO_POINTER (id));
 		break;
 	}
@@ -584,24 +724,24 @@ add_offset_timeout (EPublishUri *uri)
 	switch (uri->publish_frequency) {
 	case URI_PUBLISH_DAILY:
 		if (elapsed > 24 * 60 * 60) {
-			publish (uri, FALSE);
+			publish_uri_async (uri);
 			add_timeout (uri);
 		} else {
 			id = e_named_timeout_add_seconds (
 				24 * 60 * 60 - elapsed,
-				(GSourceFunc) publish, uri);
+				publish_timeout_cb, uri);
 			g_hash_table_insert (uri_timeouts, uri, GUINT_TO_POINTER (id));
 			break;
 		}
 		break;
 	case URI_PUBLISH_WEEKLY:
 		if (elapsed > 7 * 24 * 60 * 60) {
-			publish (uri, FALSE);
+			publish_uri_async (uri);
 			add_timeout (uri);
 		} else {
 			id = e_named_timeout_add_seconds (
 				7 * 24 * 60 * 60 - elapsed,
-				(GSourceFunc) publish, uri);
+				publish_timeout_cb, uri);
 			g_hash_table_insert (uri_timeouts, uri, GUINT_TO_POINTER (id));
 			break;
 		}
@@ -660,6 +800,7 @@ url_list_enable_toggled (GtkCellRendererToggle *renderer,
 		gtk_tree_model_get (model, &iter, URL_LIST_URL_COLUMN, &url, -1);
 
 		url->enabled = !url->enabled;
+		publish_changes_forget (url);
 
 		gtk_list_store_set (GTK_LIST_STORE (model), &iter, URL_LIST_ENABLED_COLUMN, url->enabled, -1);
 
@@ -743,6 +884,8 @@ url_edit_clicked (GtkButton *button,
 				URL_LIST_LOCATION_COLUMN, uri->location,
 				URL_LIST_URL_COLUMN, uri, -1);
 
+			publish_changes_forget (uri);
+
 			id = GPOINTER_TO_UINT (g_hash_table_lookup (uri_timeouts, uri));
 			if (id)
 				g_source_remove (id);
@@ -807,10 +950,15 @@ url_remove_clicked (GtkButton *button,
 
 		publish_uris = g_slist_remove (publish_uris, url);
 		id = GPOINTER_TO_UINT (g_hash_table_lookup (uri_timeouts, url));
-		if (id)
+		if (id) {
 			g_source_remove (id);
+			g_hash_table_remove (uri_timeouts, url);
+		}
 
-		g_free (url);
+		if (!publish_uri_forget (url)) {
+			publish_changes_forget (url);
+			g_free (url);
+		}
 		url_list_changed (ui);
 	}
 }
@@ -819,9 +967,19 @@ static void
 online_state_changed (EShell *shell)
 {
 	online = e_shell_get_online (shell);
-	if (online)
-		while (queued_publishes)
-			publish (queued_publishes->data, FALSE);
+	if (online) {
+		GSList *queued, *link;
+
+		g_mutex_lock (&publish_lock);
+		queued = queued_publishes;
+		queued_publishes = NULL;
+		g_mutex_unlock (&publish_lock);
+
+		for (link = queued; link; link = g_slist_next (link))
+			publish_uri_queue (link->data, FALSE);
+
+		g_slist_free (queued);
+	}
 }
 
 GtkWidget *
@@ -912,17 +1070,15 @@ publish_calendar_locations (EPlugin *epl,
 	return toplevel;
 }
 
-static gpointer
-publish_urls (gpointer data)
+static void
+publish_urls (void)
 {
 	GSList *l;
 
 	for (l = publish_uris; l; l = g_slist_next (l)) {
 		EPublishUri *uri = l->data;
-		publish (uri, TRUE);
+		publish_uri_queue (uri, TRUE);
 	}
-
-	return GINT_TO_POINTER (0);
 }
 
 static gpointer
@@ -1086,18 +1242,7 @@ static void
 action_calendar_publish_cb (GtkAction *action,
                             EShellView *shell_view)
 {
-	GThread *thread = NULL;
-	GError *error = NULL;
-
-	thread = g_thread_try_new (NULL, (GThreadFunc) publish_urls, NULL, &error);
-	if (!thread) {
-		/* To Translators: This is shown to a user when creation of a new thread,
-		 * where the publishing should be done, fails. Basically, this shouldn't
-		 * ever happen, and if so, then something is really wrong. */
-		error_queue_add (g_strdup (_("Could not create publish thread.")), error);
-	} else {
-		g_thread_unref (thread);
-	}
+	publish_urls ();
 }
 
 static GtkActionEntry entries[] = {
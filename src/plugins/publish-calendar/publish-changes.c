@@ -0,0 +1,277 @@
+/*
+ * publish-changes.c
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Tracks changes of the published calendars, thus the periodic
+ * publishing can skip locations whose calendars did not change
+ * since the last successful publish. Each watched calendar has
+ * a running ECalClientView, which bumps a generation counter on
+ * any change; a location remembers the generations it published. */
+
+#include "evolution-config.h"
+
+#include <time.h>
+
+#include "publish-changes.h"
+
+typedef struct _SourceWatch {
+	ECalClientView *view;
+	guint64 generation;
+	gboolean broken;	/* changes are not known anymore */
+} SourceWatch;
+
+struct _PublishState {
+	GHashTable *generations;	/* source UID ~> guint64 * */
+	time_t day;			/* free/busy start day */
+};
+
+static GMutex changes_lock;
+static GHashTable *source_watches = NULL;	/* source UID ~> SourceWatch * */
+static GHashTable *published_states = NULL;	/* EPublishUri * ~> PublishState * */
+
+static void
+source_watch_free (gpointer ptr)
+{
+	SourceWatch *watch = ptr;
+
+	if (watch) {
+		if (watch->view) {
+			g_signal_handlers_disconnect_by_data (watch->view, watch);
+			e_cal_client_view_stop (watch->view, NULL);
+			g_object_unref (watch->view);
+		}
+
+		g_slice_free (SourceWatch, watch);
+	}
+}
+
+static void
+source_watch_changed_cb (ECalClientView *view,
+                         gpointer objects,
+                         SourceWatch *watch)
+{
+	g_mutex_lock (&changes_lock);
+	watch->generation++;
+	g_mutex_unlock (&changes_lock);
+}
+
+static void
+source_watch_complete_cb (ECalClientView *view,
+                          const GError *error,
+                          SourceWatch *watch)
+{
+	if (!error)
+		return;
+
+	/* Cannot tell about changes anymore, always publish. */
+	g_mutex_lock (&changes_lock);
+	watch->broken = TRUE;
+	g_mutex_unlock (&changes_lock);
+}
+
+static time_t
+publish_changes_get_day (EPublishUri *uri)
+{
+	icaltimezone *utc;
+
+	if (uri->publish_format != URI_PUBLISH_AS_FB)
+		return 0;
+
+	/* The free/busy information covers a range starting today,
+	 * thus it changes with the day, even without any change. */
+	utc = icaltimezone_get_utc_timezone ();
+
+	return time_day_begin_with_zone (time (NULL), utc);
+}
+
+/* Starts watching changes of the @client, unless it's already watched.
+ * Call this before reading the data, thus no change is missed. */
+void
+publish_changes_watch (ECalClient *client)
+{
+	ESource *source;
+	SourceWatch *watch;
+	ECalClientView *view = NULL;
+	GSList *fields;
+	const gchar *uid;
+	GError *error = NULL;
+
+	g_return_if_fail (E_IS_CAL_CLIENT (client));
+
+	source = e_client_get_source (E_CLIENT (client));
+	uid = e_source_get_uid (source);
+
+	g_mutex_lock (&changes_lock);
+
+	if (!source_watches)
+		source_watches = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, source_watch_free);
+
+	watch = g_hash_table_lookup (source_watches, uid);
+
+	g_mutex_unlock (&changes_lock);
+
+	if (watch)
+		return;
+
+	if (!e_cal_client_get_view_sync (client, "#t", &view, NULL, &error)) {
+		g_warning ("%s: Failed to watch changes of '%s': %s", G_STRFUNC, uid, error ? error->message : "Unknown error");
+		g_clear_error (&error);
+		return;
+	}
+
+	watch = g_slice_new0 (SourceWatch);
+	watch->view = view;
+	watch->generation = 1;
+
+	g_signal_connect (view, "objects-added", G_CALLBACK (source_watch_changed_cb), watch);
+	g_signal_connect (view, "objects-modified", G_CALLBACK (source_watch_changed_cb), watch);
+	g_signal_connect (view, "objects-removed", G_CALLBACK (source_watch_changed_cb), watch);
+	g_signal_connect (view, "complete", G_CALLBACK (source_watch_complete_cb), watch);
+
+	/* Only the fact of a change is interesting, not the objects. */
+	fields = g_slist_prepend (NULL, (gpointer) "UID");
+	e_cal_client_view_set_fields_of_interest (view, fields, NULL);
+	g_slist_free (fields);
+
+	e_cal_client_view_set_flags (view, E_CAL_CLIENT_VIEW_FLAGS_NONE, NULL);
+	e_cal_client_view_start (view, &error);
+
+	if (error) {
+		g_warning ("%s: Failed to start view of '%s': %s", G_STRFUNC, uid, error->message);
+		g_clear_error (&error);
+		source_watch_free (watch);
+		return;
+	}
+
+	g_mutex_lock (&changes_lock);
+
+	/* Another thread could be faster. */
+	if (g_hash_table_contains (source_watches, uid))
+		source_watch_free (watch);
+	else
+		g_hash_table_insert (source_watches, g_strdup (uid), watch);
+
+	g_mutex_unlock (&changes_lock);
+}
+
+/* Returns current state of the calendars of the @uri; take it before
+ * publishing and pass it to publish_changes_set_published() after. */
+PublishState *
+publish_changes_snapshot (EPublishUri *uri)
+{
+	PublishState *state;
+	GSList *link;
+
+	g_return_val_if_fail (uri != NULL, NULL);
+
+	state = g_slice_new0 (PublishState);
+	state->generations = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	state->day = publish_changes_get_day (uri);
+
+	g_mutex_lock (&changes_lock);
+
+	for (link = uri->events; link; link = g_slist_next (link)) {
+		const gchar *uid = link->data;
+		SourceWatch *watch;
+		guint64 *generation;
+
+		watch = source_watches ? g_hash_table_lookup (source_watches, uid) : NULL;
+
+		generation = g_new (guint64, 1);
+		*generation = (watch && !watch->broken) ? watch->generation : 0;
+
+		g_hash_table_insert (state->generations, g_strdup (uid), generation);
+	}
+
+	g_mutex_unlock (&changes_lock);
+
+	return state;
+}
+
+void
+publish_changes_state_free (PublishState *state)
+{
+	if (state) {
+		g_hash_table_destroy (state->generations);
+		g_slice_free (PublishState, state);
+	}
+}
+
+/* Whether none of the calendars of the @uri changed since
+ * the last successful publish of it. */
+gboolean
+publish_changes_is_unchanged (EPublishUri *uri)
+{
+	PublishState *state;
+	GSList *link;
+	gboolean unchanged;
+
+	g_return_val_if_fail (uri != NULL, FALSE);
+
+	g_mutex_lock (&changes_lock);
+
+	state = published_states ? g_hash_table_lookup (published_states, uri) : NULL;
+	unchanged = state && uri->events &&
+		g_hash_table_size (state->generations) == g_slist_length (uri->events) &&
+		state->day == publish_changes_get_day (uri);
+
+	for (link = uri->events; unchanged && link; link = g_slist_next (link)) {
+		const gchar *uid = link->data;
+		SourceWatch *watch;
+		guint64 *generation;
+
+		watch = source_watches ? g_hash_table_lookup (source_watches, uid) : NULL;
+		generation = g_hash_table_lookup (state->generations, uid);
+
+		unchanged = watch && generation && !watch->broken &&
+			*generation != 0 && watch->generation == *generation;
+	}
+
+	g_mutex_unlock (&changes_lock);
+
+	return unchanged;
+}
+
+/* Takes ownership of the @state. */
+void
+publish_changes_set_published (EPublishUri *uri,
+                               PublishState *state)
+{
+	g_return_if_fail (uri != NULL);
+	g_return_if_fail (state != NULL);
+
+	g_mutex_lock (&changes_lock);
+
+	if (!published_states)
+		published_states = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) publish_changes_state_free);
+
+	g_hash_table_insert (published_states, uri, state);
+
+	g_mutex_unlock (&changes_lock);
+}
+
+/* Call when the @uri is changed or removed; the next publish of it
+ * will not be skipped. */
+void
+publish_changes_forget (EPublishUri *uri)
+{
+	g_mutex_lock (&changes_lock);
+
+	if (published_states)
+		g_hash_table_remove (published_states, uri);
+
+	g_mutex_unlock (&changes_lock);
+}
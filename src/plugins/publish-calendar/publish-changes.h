@@ -0,0 +1,35 @@
+/*
+ * publish-changes.h
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <libecal/libecal.h>
+
+#include "publish-location.h"
+
+#ifndef PUBLISH_CHANGES_H
+#define PUBLISH_CHANGES_H
+
+typedef struct _PublishState PublishState;
+
+void		publish_changes_watch		(ECalClient *client);
+PublishState *	publish_changes_snapshot	(EPublishUri *uri);
+void		publish_changes_state_free	(PublishState *state);
+gboolean	publish_changes_is_unchanged	(EPublishUri *uri);
+void		publish_changes_set_published	(EPublishUri *uri,
+						 PublishState *state);
+void		publish_changes_forget		(EPublishUri *uri);
+
+#endif
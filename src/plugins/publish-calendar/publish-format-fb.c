@@ -27,6 +27,7 @@
 
 #include <shell/e-shell.h>
 
+#include "publish-changes.h"
 #include "publish-format-fb.h"
 
 static gboolean
@@ -85,6 +86,9 @@ write_calendar (const gchar *uid,
 	if (client == NULL)
 		return FALSE;
 
+	/* Watch changes before reading the free/busy, thus none is missed. */
+	publish_changes_watch (E_CAL_CLIENT (client));
+
 	if (e_client_get_backend_property_sync (client, CAL_BACKEND_PROPERTY_CAL_EMAIL_ADDRESS, &email, NULL, NULL)) {
 		if (email && *email)
 			users = g_slist_append (users, email);
@@ -96,22 +100,43 @@ write_calendar (const gchar *uid,
 		E_CAL_CLIENT (client), start, end, users, &objects, NULL, error);
 
 	if (success) {
-		gchar *ical_string;
+		gchar *ical_string, *tail;
 		GSList *iter;
 
-		for (iter = objects; iter; iter = iter->next) {
-			ECalComponent *comp = iter->data;
-			icalcomponent *icalcomp = icalcomponent_new_clone (e_cal_component_get_icalcomponent (comp));
-			icalcomponent_add_component (top_level, icalcomp);
-		}
-
+		/* Write the component by component; the VCALENDAR
+		 * wrapper is split around its END line. */
 		ical_string = icalcomponent_as_ical_string_r (top_level);
 
+		tail = g_strrstr (ical_string, "END:VCALENDAR");
+		g_warn_if_fail (tail != NULL);
+		if (!tail)
+			tail = ical_string + strlen (ical_string);
+
 		success = g_output_stream_write_all (
 			stream, ical_string,
-			strlen (ical_string),
+			tail - ical_string,
 			NULL, NULL, error);
 
+		for (iter = objects; success && iter; iter = iter->next) {
+			ECalComponent *comp = iter->data;
+			gchar *comp_string;
+
+			comp_string = icalcomponent_as_ical_string_r (e_cal_component_get_icalcomponent (comp));
+
+			success = g_output_stream_write_all (
+				stream, comp_string,
+				strlen (comp_string),
+				NULL, NULL, error);
+
+			g_free (comp_string);
+		}
+
+		if (success)
+			success = g_output_stream_write_all (
+				stream, tail,
+				strlen (tail),
+				NULL, NULL, error);
+
 		e_cal_client_free_ecalcomp_slist (objects);
 		g_free (ical_string);
 	}
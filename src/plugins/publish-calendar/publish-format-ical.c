@@ -26,6 +26,7 @@
 
 #include <shell/e-shell.h>
 
+#include "publish-changes.h"
 #include "publish-format-ical.h"
 
 typedef struct {
@@ -63,12 +64,19 @@ insert_tz_comps (icalparameter *param,
 	g_hash_table_insert (tdata->zones, (gpointer) tzid, (gpointer) tzcomp);
 }
 
-static void
-append_tz_to_comp (gpointer key,
-                   gpointer value,
-                   icalcomponent *toplevel)
+static gboolean
+write_component (GOutputStream *stream,
+                 icalcomponent *icalcomp,
+                 GError **error)
 {
-	icalcomponent_add_component (toplevel, (icalcomponent *) value);
+	gchar *ical_string;
+	gboolean success;
+
+	ical_string = icalcomponent_as_ical_string_r (icalcomp);
+	success = g_output_stream_write_all (stream, ical_string, strlen (ical_string), NULL, NULL, error);
+	g_free (ical_string);
+
+	return success;
 }
 
 static gboolean
@@ -105,38 +113,59 @@ write_calendar (const gchar *uid,
 	if (client == NULL)
 		return FALSE;
 
-	top_level = e_cal_util_new_top_level ();
+	/* Watch changes before reading the objects, thus none is missed. */
+	publish_changes_watch (E_CAL_CLIENT (client));
 
 	e_cal_client_get_object_list_sync (
 		E_CAL_CLIENT (client), "#t", &objects, NULL, error);
 
 	if (objects != NULL) {
 		GSList *iter;
-		gchar *ical_string;
+		GHashTableIter zones_iter;
+		gpointer value;
+		gchar *ical_string, *tail;
 		CompTzData tdata;
 
-		tdata.zones = g_hash_table_new (g_str_hash, g_str_equal);
+		/* Write the component by component, instead of building
+		 * the whole calendar as a single string in the memory.
+		 * The VCALENDAR wrapper is split around its END line. */
+		top_level = e_cal_util_new_top_level ();
+		ical_string = icalcomponent_as_ical_string_r (top_level);
+		icalcomponent_free (top_level);
+
+		tail = g_strrstr (ical_string, "END:VCALENDAR");
+		g_warn_if_fail (tail != NULL);
+		if (!tail)
+			tail = ical_string + strlen (ical_string);
+
+		res = g_output_stream_write_all (stream, ical_string, tail - ical_string, NULL, NULL, error);
+
+		tdata.zones = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) icalcomponent_free);
 		tdata.client = E_CAL_CLIENT (client);
 
-		for (iter = objects; iter; iter = iter->next) {
-			icalcomponent *icalcomp = icalcomponent_new_clone (iter->data);
+		for (iter = objects; res && iter; iter = iter->next) {
+			icalcomponent *icalcomp = iter->data;
+
 			icalcomponent_foreach_tzid (icalcomp, insert_tz_comps, &tdata);
-			icalcomponent_add_component (top_level, icalcomp);
+			res = write_component (stream, icalcomp, error);
 		}
 
-		g_hash_table_foreach (tdata.zones, (GHFunc) append_tz_to_comp, top_level);
+		g_hash_table_iter_init (&zones_iter, tdata.zones);
+		while (res && g_hash_table_iter_next (&zones_iter, NULL, &value)) {
+			res = write_component (stream, value, error);
+		}
+
+		if (res)
+			res = g_output_stream_write_all (stream, tail, strlen (tail), NULL, NULL, error);
 
 		g_hash_table_destroy (tdata.zones);
 		tdata.zones = NULL;
 
-		ical_string = icalcomponent_as_ical_string_r (top_level);
-		res = g_output_stream_write_all (stream, ical_string, strlen (ical_string), NULL, NULL, error);
 		g_free (ical_string);
 		e_cal_client_free_icalcomp_slist (objects);
 	}
 
 	g_object_unref (client);
-	icalcomponent_free (top_level);
 
 	return res;
 }
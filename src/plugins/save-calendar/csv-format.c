@@ -42,20 +42,6 @@ struct _CsvPluginData
 	GtkWidget *delimiter_entry, *newline_entry, *quote_entry, *header_check;
 };
 
-static void
-display_error_message (GtkWidget *parent,
-                       GError *error)
-{
-	GtkWidget *dialog;
-
-	dialog = gtk_message_dialog_new (
-		GTK_WINDOW (parent), 0,
-		GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE,
-		"%s", error->message);
-	gtk_dialog_run (GTK_DIALOG (dialog));
-	gtk_widget_destroy (dialog);
-}
-
 enum { /* CSV helper enum */
 	ECALCOMPONENTTEXT,
 	ECALCOMPONENTATTENDEE,
@@ -298,6 +284,215 @@ userstring_to_systemstring (const gchar *userstring)
 	return retval;
 }
 
+static void
+csv_config_free (gpointer ptr)
+{
+	CsvConfig *config = ptr;
+
+	if (config) {
+		g_free (config->delimiter);
+		g_free (config->quote);
+		g_free (config->newline);
+		g_free (config);
+	}
+}
+
+static gboolean
+csv_begin (GOutputStream *stream,
+           ECalClient *client,
+           gpointer user_data,
+           GCancellable *cancellable,
+           GError **error)
+{
+	CsvConfig *config = user_data;
+	GString *line;
+	gboolean success;
+	gint i = 0;
+
+	static const gchar *labels[] = {
+		 N_("UID"),
+		 N_("Summary"),
+		 N_("Description List"),
+		 N_("Categories List"),
+		 N_("Comment List"),
+		 N_("Completed"),
+		 N_("Created"),
+		 N_("Contact List"),
+		 N_("Start"),
+		 N_("End"),
+		 N_("Due"),
+		 N_("percent Done"),
+		 N_("Priority"),
+		 N_("URL"),
+		 N_("Attendees List"),
+		 N_("Location"),
+		 N_("Modified"),
+	};
+
+	if (!config->header)
+		return TRUE;
+
+	line = g_string_new ("");
+	for (i = 0; i < G_N_ELEMENTS (labels); i++) {
+		if (i > 0)
+			g_string_append (line, config->delimiter);
+		g_string_append (line, _(labels[i]));
+	}
+
+	g_string_append (line, config->newline);
+
+	success = g_output_stream_write_all (
+		stream, line->str, line->len,
+		NULL, cancellable, error);
+	g_string_free (line, TRUE);
+
+	return success;
+}
+
+static gboolean
+csv_write_component (GOutputStream *stream,
+                     ECalClient *client,
+                     icalcomponent *icalcomp,
+                     gpointer user_data,
+                     GCancellable *cancellable,
+                     GError **error)
+{
+	CsvConfig *config = user_data;
+	ECalComponent *comp;
+	gchar *delimiter_temp = NULL;
+	const gchar *temp_constchar;
+	GSList *temp_list;
+	ECalComponentDateTime temp_dt;
+	struct icaltimetype *temp_time;
+	gint *temp_int;
+	ECalComponentText temp_comptext;
+	GString *line;
+	gboolean success;
+
+	comp = e_cal_component_new_from_icalcomponent (icalcomponent_new_clone (icalcomp));
+	if (!comp)
+		return TRUE;
+
+	line = g_string_new ("");
+
+	/* Getting the stuff */
+	e_cal_component_get_uid (comp, &temp_constchar);
+	line = add_string_to_csv (line, temp_constchar, config);
+
+	e_cal_component_get_summary (comp, &temp_comptext);
+	line = add_string_to_csv (
+		line, temp_comptext.value, config);
+
+	e_cal_component_get_description_list (comp, &temp_list);
+	line = add_list_to_csv (
+		line, temp_list, config, ECALCOMPONENTTEXT);
+	if (temp_list)
+		e_cal_component_free_text_list (temp_list);
+
+	e_cal_component_get_categories_list (comp, &temp_list);
+	line = add_list_to_csv (
+		line, temp_list, config, CONSTCHAR);
+	if (temp_list)
+		e_cal_component_free_categories_list (temp_list);
+
+	e_cal_component_get_comment_list (comp, &temp_list);
+	line = add_list_to_csv (
+		line, temp_list, config, ECALCOMPONENTTEXT);
+	if (temp_list)
+		e_cal_component_free_text_list (temp_list);
+
+	e_cal_component_get_completed (comp, &temp_time);
+	line = add_time_to_csv (line, temp_time, config);
+	if (temp_time)
+		e_cal_component_free_icaltimetype (temp_time);
+
+	e_cal_component_get_created (comp, &temp_time);
+	line = add_time_to_csv (line, temp_time, config);
+	if (temp_time)
+		e_cal_component_free_icaltimetype (temp_time);
+
+	e_cal_component_get_contact_list (comp, &temp_list);
+	line = add_list_to_csv (
+		line, temp_list, config, ECALCOMPONENTTEXT);
+	if (temp_list)
+		e_cal_component_free_text_list (temp_list);
+
+	e_cal_component_get_dtstart (comp, &temp_dt);
+	line = add_time_to_csv (
+		line, temp_dt.value ?
+		temp_dt.value : NULL, config);
+	e_cal_component_free_datetime (&temp_dt);
+
+	e_cal_component_get_dtend (comp, &temp_dt);
+	line = add_time_to_csv (
+		line, temp_dt.value ?
+		temp_dt.value : NULL, config);
+	e_cal_component_free_datetime (&temp_dt);
+
+	e_cal_component_get_due (comp, &temp_dt);
+	line = add_time_to_csv (
+		line, temp_dt.value ?
+		temp_dt.value : NULL, config);
+	e_cal_component_free_datetime (&temp_dt);
+
+	e_cal_component_get_percent (comp, &temp_int);
+	line = add_nummeric_to_csv (line, temp_int, config);
+
+	e_cal_component_get_priority (comp, &temp_int);
+	line = add_nummeric_to_csv (line, temp_int, config);
+
+	e_cal_component_get_url (comp, &temp_constchar);
+	line = add_string_to_csv (line, temp_constchar, config);
+
+	if (e_cal_component_has_attendees (comp)) {
+		e_cal_component_get_attendee_list (comp, &temp_list);
+		line = add_list_to_csv (
+			line, temp_list, config,
+			ECALCOMPONENTATTENDEE);
+		if (temp_list)
+			e_cal_component_free_attendee_list (temp_list);
+	} else {
+		line = add_list_to_csv (
+			line, NULL, config,
+			ECALCOMPONENTATTENDEE);
+	}
+
+	e_cal_component_get_location (comp, &temp_constchar);
+	line = add_string_to_csv (line, temp_constchar, config);
+
+	e_cal_component_get_last_modified (comp, &temp_time);
+
+	/* Append a newline (record delimiter) */
+	delimiter_temp = config->delimiter;
+	config->delimiter = config->newline;
+
+	line = add_time_to_csv (line, temp_time, config);
+
+	/* And restore for the next record */
+	config->delimiter = delimiter_temp;
+
+	/* Important note!
+	 * The documentation is not requiring this!
+	 *
+	 * if (temp_time)
+	 *     e_cal_component_free_icaltimetype (temp_time);
+	 *
+	 * Please uncomment and fix documentation if untrue
+	 * http://www.gnome.org/projects/evolution/
+	 *	developer-doc/libecal/ECalComponent.html
+	 *	#e-cal-component-get-last-modified
+	 */
+	success = g_output_stream_write_all (
+		stream, line->str, line->len,
+		NULL, cancellable, error);
+
+	/* It's written, so we can free it */
+	g_string_free (line, TRUE);
+	g_object_unref (comp);
+
+	return success;
+}
+
 static void
 do_save_calendar_csv (FormatHandler *handler,
                       ESourceSelector *selector,
@@ -314,12 +509,6 @@ do_save_calendar_csv (FormatHandler *handler,
 	 * http://www.creativyst.com/cgi-bin/Prod/15/eg/csv2xml.pl
 	 */
 
-	ESource *primary_source;
-	EClient *source_client;
-	GError *error = NULL;
-	GSList *objects = NULL;
-	GOutputStream *stream;
-	GString *line = NULL;
 	CsvConfig *config = NULL;
 	CsvPluginData *d = handler->data;
 	const gchar *tmp = NULL;
@@ -327,25 +516,6 @@ do_save_calendar_csv (FormatHandler *handler,
 	if (!dest_uri)
 		return;
 
-	/* open source client */
-	primary_source = e_source_selector_ref_primary_selection (selector);
-	source_client = e_client_cache_get_client_sync (client_cache,
-		primary_source, e_source_selector_get_extension_name (selector), 30, NULL, &error);
-	g_object_unref (primary_source);
-
-	/* Sanity check. */
-	g_return_if_fail (
-		((source_client != NULL) && (error == NULL)) ||
-		((source_client == NULL) && (error != NULL)));
-
-	if (source_client == NULL) {
-		display_error_message (
-			gtk_widget_get_toplevel (GTK_WIDGET (selector)),
-			error);
-		g_error_free (error);
-		return;
-	}
-
 	config = g_new (CsvConfig, 1);
 
 	tmp = gtk_entry_get_text (GTK_ENTRY (d->delimiter_entry));
@@ -357,200 +527,11 @@ do_save_calendar_csv (FormatHandler *handler,
 	config->header = gtk_toggle_button_get_active (
 		GTK_TOGGLE_BUTTON (d->header_check));
 
-	stream = open_for_writing (
-		GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (selector))),
-		dest_uri, &error);
-
-	if (stream && e_cal_client_get_object_list_as_comps_sync (E_CAL_CLIENT (source_client), "#t", &objects, NULL, NULL)) {
-		GSList *iter;
-
-		if (config->header) {
-
-			gint i = 0;
-
-			static const gchar *labels[] = {
-				 N_("UID"),
-				 N_("Summary"),
-				 N_("Description List"),
-				 N_("Categories List"),
-				 N_("Comment List"),
-				 N_("Completed"),
-				 N_("Created"),
-				 N_("Contact List"),
-				 N_("Start"),
-				 N_("End"),
-				 N_("Due"),
-				 N_("percent Done"),
-				 N_("Priority"),
-				 N_("URL"),
-				 N_("Attendees List"),
-				 N_("Location"),
-				 N_("Modified"),
-			};
-
-			line = g_string_new ("");
-			for (i = 0; i < G_N_ELEMENTS (labels); i++) {
-				if (i > 0)
-					g_string_append (line, config->delimiter);
-				g_string_append (line, _(labels[i]));
-			}
-
-			g_string_append (line, config->newline);
-
-			g_output_stream_write_all (
-				stream, line->str, line->len,
-				NULL, NULL, NULL);
-			g_string_free (line, TRUE);
-		}
-
-		for (iter = objects; iter; iter = iter->next) {
-			ECalComponent *comp = iter->data;
-			gchar *delimiter_temp = NULL;
-			const gchar *temp_constchar;
-			GSList *temp_list;
-			ECalComponentDateTime temp_dt;
-			struct icaltimetype *temp_time;
-			gint *temp_int;
-			ECalComponentText temp_comptext;
-
-			line = g_string_new ("");
-
-			/* Getting the stuff */
-			e_cal_component_get_uid (comp, &temp_constchar);
-			line = add_string_to_csv (line, temp_constchar, config);
-
-			e_cal_component_get_summary (comp, &temp_comptext);
-			line = add_string_to_csv (
-				line, temp_comptext.value, config);
-
-			e_cal_component_get_description_list (comp, &temp_list);
-			line = add_list_to_csv (
-				line, temp_list, config, ECALCOMPONENTTEXT);
-			if (temp_list)
-				e_cal_component_free_text_list (temp_list);
-
-			e_cal_component_get_categories_list (comp, &temp_list);
-			line = add_list_to_csv (
-				line, temp_list, config, CONSTCHAR);
-			if (temp_list)
-				e_cal_component_free_categories_list (temp_list);
-
-			e_cal_component_get_comment_list (comp, &temp_list);
-			line = add_list_to_csv (
-				line, temp_list, config, ECALCOMPONENTTEXT);
-			if (temp_list)
-				e_cal_component_free_text_list (temp_list);
-
-			e_cal_component_get_completed (comp, &temp_time);
-			line = add_time_to_csv (line, temp_time, config);
-			if (temp_time)
-				e_cal_component_free_icaltimetype (temp_time);
-
-			e_cal_component_get_created (comp, &temp_time);
-			line = add_time_to_csv (line, temp_time, config);
-			if (temp_time)
-				e_cal_component_free_icaltimetype (temp_time);
-
-			e_cal_component_get_contact_list (comp, &temp_list);
-			line = add_list_to_csv (
-				line, temp_list, config, ECALCOMPONENTTEXT);
-			if (temp_list)
-				e_cal_component_free_text_list (temp_list);
-
-			e_cal_component_get_dtstart (comp, &temp_dt);
-			line = add_time_to_csv (
-				line, temp_dt.value ?
-				temp_dt.value : NULL, config);
-			e_cal_component_free_datetime (&temp_dt);
-
-			e_cal_component_get_dtend (comp, &temp_dt);
-			line = add_time_to_csv (
-				line, temp_dt.value ?
-				temp_dt.value : NULL, config);
-			e_cal_component_free_datetime (&temp_dt);
-
-			e_cal_component_get_due (comp, &temp_dt);
-			line = add_time_to_csv (
-				line, temp_dt.value ?
-				temp_dt.value : NULL, config);
-			e_cal_component_free_datetime (&temp_dt);
-
-			e_cal_component_get_percent (comp, &temp_int);
-			line = add_nummeric_to_csv (line, temp_int, config);
-
-			e_cal_component_get_priority (comp, &temp_int);
-			line = add_nummeric_to_csv (line, temp_int, config);
-
-			e_cal_component_get_url (comp, &temp_constchar);
-			line = add_string_to_csv (line, temp_constchar, config);
-
-			if (e_cal_component_has_attendees (comp)) {
-				e_cal_component_get_attendee_list (comp, &temp_list);
-				line = add_list_to_csv (
-					line, temp_list, config,
-					ECALCOMPONENTATTENDEE);
-				if (temp_list)
-					e_cal_component_free_attendee_list (temp_list);
-			} else {
-				line = add_list_to_csv (
-					line, NULL, config,
-					ECALCOMPONENTATTENDEE);
-			}
-
-			e_cal_component_get_location (comp, &temp_constchar);
-			line = add_string_to_csv (line, temp_constchar, config);
-
-			e_cal_component_get_last_modified (comp, &temp_time);
-
-			/* Append a newline (record delimiter) */
-			delimiter_temp = config->delimiter;
-			config->delimiter = config->newline;
-
-			line = add_time_to_csv (line, temp_time, config);
-
-			/* And restore for the next record */
-			config->delimiter = delimiter_temp;
-
-			/* Important note!
-			 * The documentation is not requiring this!
-			 *
-			 * if (temp_time)
-			 *     e_cal_component_free_icaltimetype (temp_time);
-			 *
-			 * Please uncomment and fix documentation if untrue
-			 * http://www.gnome.org/projects/evolution/
-			 *	developer-doc/libecal/ECalComponent.html
-			 *	#e-cal-component-get-last-modified
-			 */
-			g_output_stream_write_all (
-				stream, line->str, line->len,
-				NULL, NULL, &error);
-
-			/* It's written, so we can free it */
-			g_string_free (line, TRUE);
-		}
-
-		g_output_stream_close (stream, NULL, NULL);
-
-		e_cal_client_free_ecalcomp_slist (objects);
-	}
-
-	if (stream)
-		g_object_unref (stream);
-
-	g_object_unref (source_client);
-
-	g_free (config->delimiter);
-	g_free (config->quote);
-	g_free (config->newline);
-	g_free (config);
-
-	if (error != NULL) {
-		display_error_message (
-			gtk_widget_get_toplevel (GTK_WIDGET (selector)),
-			error);
-		g_error_free (error);
-	}
+	/* The config is freed when the calendar is written */
+	save_calendar_to_uri (
+		selector, client_cache, dest_uri,
+		csv_begin, csv_write_component, NULL,
+		config, csv_config_free);
 }
 
 static GtkWidget *
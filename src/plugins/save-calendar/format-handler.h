@@ -46,3 +46,27 @@ FormatHandler *ical_format_handler_new (void);
 FormatHandler *rdf_format_handler_new (void);
 
 GOutputStream *open_for_writing (GtkWindow *parent, const gchar *uri, GError **error);
+
+/* Called with the opened output stream before and after all components are written */
+typedef gboolean (* SaveCalendarStreamFunc)	(GOutputStream *stream,
+						 ECalClient *client,
+						 gpointer user_data,
+						 GCancellable *cancellable,
+						 GError **error);
+
+/* Called for each component of the calendar; the icalcomp is owned by the caller */
+typedef gboolean (* SaveCalendarComponentFunc)	(GOutputStream *stream,
+						 ECalClient *client,
+						 icalcomponent *icalcomp,
+						 gpointer user_data,
+						 GCancellable *cancellable,
+						 GError **error);
+
+void		save_calendar_to_uri		(ESourceSelector *selector,
+						 EClientCache *client_cache,
+						 const gchar *dest_uri,
+						 SaveCalendarStreamFunc begin_func,
+						 SaveCalendarComponentFunc component_func,
+						 SaveCalendarStreamFunc end_func,
+						 gpointer user_data,
+						 GDestroyNotify free_user_data);
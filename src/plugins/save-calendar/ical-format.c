@@ -27,25 +27,22 @@
 
 #include "format-handler.h"
 
-static void
-display_error_message (GtkWidget *parent,
-                       const gchar *message)
-{
-	GtkWidget *dialog;
-
-	dialog = gtk_message_dialog_new (
-		GTK_WINDOW (parent), 0,
-		GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE,
-		"%s", message);
-	gtk_dialog_run (GTK_DIALOG (dialog));
-	gtk_widget_destroy (dialog);
-}
-
 typedef struct {
-	GHashTable *zones;
+	GHashTable *zones;	/* gchar *tzid ~> icalcomponent * */
 	ECalClient *client;
 } CompTzData;
 
+static void
+comp_tz_data_free (gpointer ptr)
+{
+	CompTzData *tdata = ptr;
+
+	if (tdata) {
+		g_hash_table_destroy (tdata->zones);
+		g_free (tdata);
+	}
+}
+
 static void
 insert_tz_comps (icalparameter *param,
                  gpointer cb_data)
@@ -72,104 +69,116 @@ insert_tz_comps (icalparameter *param,
 		return;
 	}
 
+	/* The component is freed once written, thus copy the tzid. */
 	tzcomp = icalcomponent_new_clone (icaltimezone_get_component (zone));
-	g_hash_table_insert (tdata->zones, (gpointer) tzid, (gpointer) tzcomp);
+	g_hash_table_insert (tdata->zones, g_strdup (tzid), tzcomp);
 }
 
-static void
-append_tz_to_comp (gpointer key,
-                   gpointer value,
-                   icalcomponent *toplevel)
+static gboolean
+write_ical_string (GOutputStream *stream,
+                   const gchar *ical_str,
+                   gsize len,
+                   GCancellable *cancellable,
+                   GError **error)
 {
-	icalcomponent_add_component (toplevel, (icalcomponent *) value);
+	return g_output_stream_write_all (stream, ical_str, len, NULL, cancellable, error);
 }
 
-static void
-do_save_calendar_ical (FormatHandler *handler,
-                       ESourceSelector *selector,
-		       EClientCache *client_cache,
-                       gchar *dest_uri)
+static gboolean
+ical_begin (GOutputStream *stream,
+            ECalClient *client,
+            gpointer user_data,
+            GCancellable *cancellable,
+            GError **error)
 {
-	ESource *primary_source;
-	EClient *source_client;
-	GError *error = NULL;
-	GSList *objects = NULL;
-	icalcomponent *top_level = NULL;
+	CompTzData *tdata = user_data;
+	icalcomponent *top_level;
+	gchar *ical_str, *end;
+	gboolean success;
 
-	if (!dest_uri)
-		return;
+	tdata->client = client;
 
-	/* open source client */
-	primary_source = e_source_selector_ref_primary_selection (selector);
-	source_client = e_client_cache_get_client_sync (client_cache,
-		primary_source, e_source_selector_get_extension_name (selector), 30, NULL, &error);
-	g_object_unref (primary_source);
+	/* Write the VCALENDAR properties, the components
+	 * follow and the END line is written at the end. */
+	top_level = e_cal_util_new_top_level ();
+	ical_str = icalcomponent_as_ical_string_r (top_level);
+	icalcomponent_free (top_level);
 
-	/* Sanity check. */
-	g_return_if_fail (
-		((source_client != NULL) && (error == NULL)) ||
-		((source_client == NULL) && (error != NULL)));
+	end = g_strrstr (ical_str, "END:VCALENDAR");
+	if (end)
+		*end = '\0';
 
-	if (error != NULL) {
-		display_error_message (
-			gtk_widget_get_toplevel (GTK_WIDGET (selector)),
-			error->message);
-		g_error_free (error);
-		return;
-	}
+	success = write_ical_string (stream, ical_str, strlen (ical_str), cancellable, error);
 
-	/* create destination file */
-	top_level = e_cal_util_new_top_level ();
+	g_free (ical_str);
 
-	e_cal_client_get_object_list_sync (
-		E_CAL_CLIENT (source_client), "#t", &objects, NULL, &error);
+	return success;
+}
 
-	if (objects != NULL) {
-		CompTzData tdata;
-		GOutputStream *stream;
-		GSList *iter;
+static gboolean
+ical_write_component (GOutputStream *stream,
+                      ECalClient *client,
+                      icalcomponent *icalcomp,
+                      gpointer user_data,
+                      GCancellable *cancellable,
+                      GError **error)
+{
+	CompTzData *tdata = user_data;
+	gchar *ical_str;
+	gboolean success;
 
-		tdata.zones = g_hash_table_new (g_str_hash, g_str_equal);
-		tdata.client = E_CAL_CLIENT (source_client);
+	icalcomponent_foreach_tzid (icalcomp, insert_tz_comps, tdata);
 
-		for (iter = objects; iter; iter = iter->next) {
-			icalcomponent *icalcomp = icalcomponent_new_clone (iter->data);
+	ical_str = icalcomponent_as_ical_string_r (icalcomp);
+	success = write_ical_string (stream, ical_str, strlen (ical_str), cancellable, error);
+	g_free (ical_str);
 
-			icalcomponent_foreach_tzid (icalcomp, insert_tz_comps, &tdata);
-			icalcomponent_add_component (top_level, icalcomp);
-		}
+	return success;
+}
 
-		g_hash_table_foreach (tdata.zones, (GHFunc) append_tz_to_comp, top_level);
+static gboolean
+ical_end (GOutputStream *stream,
+          ECalClient *client,
+          gpointer user_data,
+          GCancellable *cancellable,
+          GError **error)
+{
+	CompTzData *tdata = user_data;
+	GHashTableIter iter;
+	gpointer value;
+	gboolean success = TRUE;
 
-		g_hash_table_destroy (tdata.zones);
-		tdata.zones = NULL;
+	/* The used timezones are known only after all the components */
+	g_hash_table_iter_init (&iter, tdata->zones);
+	while (success && g_hash_table_iter_next (&iter, NULL, &value)) {
+		gchar *ical_str = icalcomponent_as_ical_string_r (value);
 
-		/* save the file */
-		stream = open_for_writing (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (selector))), dest_uri, &error);
+		success = write_ical_string (stream, ical_str, strlen (ical_str), cancellable, error);
 
-		if (stream) {
-			gchar *ical_str = icalcomponent_as_ical_string_r (top_level);
+		g_free (ical_str);
+	}
 
-			g_output_stream_write_all (stream, ical_str, strlen (ical_str), NULL, NULL, &error);
-			g_output_stream_close (stream, NULL, NULL);
+	return success && write_ical_string (stream, "END:VCALENDAR\r\n", 15, cancellable, error);
+}
 
-			g_object_unref (stream);
-			g_free (ical_str);
-		}
+static void
+do_save_calendar_ical (FormatHandler *handler,
+                       ESourceSelector *selector,
+		       EClientCache *client_cache,
+                       gchar *dest_uri)
+{
+	CompTzData *tdata;
 
-		e_cal_client_free_icalcomp_slist (objects);
-	}
+	if (!dest_uri)
+		return;
 
-	if (error != NULL) {
-		display_error_message (
-			gtk_widget_get_toplevel (GTK_WIDGET (selector)),
-			error->message);
-		g_error_free (error);
-	}
+	tdata = g_new0 (CompTzData, 1);
+	tdata->zones = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) icalcomponent_free);
 
-	/* terminate */
-	g_object_unref (source_client);
-	icalcomponent_free (top_level);
+	save_calendar_to_uri (
+		selector, client_cache, dest_uri,
+		ical_begin, ical_write_component, ical_end,
+		tdata, comp_tz_data_free);
 }
 
 FormatHandler *
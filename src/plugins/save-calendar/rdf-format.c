@@ -67,19 +67,6 @@ enum { /* XML helper enum */
 	CONSTCHAR
 };
 
-static void
-display_error_message (GtkWidget *parent,
-                       const gchar *error_message)
-{
-	GtkWidget *dialog;
-
-	dialog = gtk_message_dialog_new (
-		GTK_WINDOW (parent), 0, GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE,
-		"%s", error_message);
-	gtk_dialog_run (GTK_DIALOG (dialog));
-	gtk_widget_destroy (dialog);
-}
-
 /* Some helpers for the xml stuff */
 static void
 add_list_to_rdf (xmlNodePtr node,
@@ -168,210 +155,277 @@ add_string_to_rdf (xmlNodePtr node,
 	}
 }
 
+typedef struct _RdfData {
+	xmlDocPtr doc;
+	xmlNodePtr fnode;	/* the Vcalendar node */
+	xmlBufferPtr buffer;
+	gchar *tail;		/* what follows the components */
+	gchar *indent;		/* indentation of the components */
+} RdfData;
+
 static void
-do_save_calendar_rdf (FormatHandler *handler,
-                      ESourceSelector *selector,
-		      EClientCache *client_cache,
-                      gchar *dest_uri)
+rdf_data_free (gpointer ptr)
 {
-
-	/*
-	 * According to some documentation about CSV, newlines 'are' allowed
-	 * in CSV-files. But you 'do' have to put the value between quotes.
-	 * The helper 'string_needsquotes' will check for that
-	 *
-	 * http://www.creativyst.com/Doc/Articles/CSV/CSV01.htm
-	 * http://www.creativyst.com/cgi-bin/Prod/15/eg/csv2xml.pl
-	 */
-
-	ESource *primary_source;
-	EClient *source_client;
-	GError *error = NULL;
-	GSList *objects = NULL;
-	gchar *temp = NULL;
-	GOutputStream *stream;
-
-	if (!dest_uri)
-		return;
-
-	/* open source client */
-	primary_source = e_source_selector_ref_primary_selection (selector);
-	source_client = e_client_cache_get_client_sync (client_cache,
-		primary_source, e_source_selector_get_extension_name (selector), 30, NULL, &error);
-	g_object_unref (primary_source);
-
-	/* Sanity check. */
-	g_return_if_fail (
-		((source_client != NULL) && (error == NULL)) ||
-		((source_client == NULL) && (error != NULL)));
-
-	if (source_client == NULL) {
-		display_error_message (
-			gtk_widget_get_toplevel (GTK_WIDGET (selector)),
-			error->message);
-		g_error_free (error);
-		return;
+	RdfData *rdf = ptr;
+
+	if (rdf) {
+		if (rdf->buffer)
+			xmlBufferFree (rdf->buffer);
+		if (rdf->doc)
+			xmlFreeDoc (rdf->doc);
+		g_free (rdf->tail);
+		g_free (rdf->indent);
+		g_free (rdf);
 	}
+}
 
-	stream = open_for_writing (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (selector))), dest_uri, &error);
-
-	if (stream && e_cal_client_get_object_list_as_comps_sync (E_CAL_CLIENT (source_client), "#t", &objects, NULL, NULL)) {
-		GSList *iter;
+/* Writes the current content of the rdf->buffer and empties it. */
+static gboolean
+rdf_flush_buffer (RdfData *rdf,
+                  GOutputStream *stream,
+                  GCancellable *cancellable,
+                  GError **error)
+{
+	gboolean success;
 
-		xmlBufferPtr buffer = xmlBufferCreate ();
-		xmlDocPtr doc = xmlNewDoc ((xmlChar *) "1.0");
-		xmlNodePtr fnode;
+	success = g_output_stream_write_all (stream, xmlBufferContent (rdf->buffer), xmlBufferLength (rdf->buffer), NULL, cancellable, error);
 
-		doc->children = xmlNewDocNode (doc, NULL, (const guchar *)"rdf:RDF", NULL);
-		xmlSetProp (doc->children, (const guchar *)"xmlns:rdf", (const guchar *)"http://www.w3.org/1999/02/22-rdf-syntax-ns#");
-		xmlSetProp (doc->children, (const guchar *)"xmlns", (const guchar *)"http://www.w3.org/2002/12/cal/ical#");
+	xmlBufferEmpty (rdf->buffer);
 
-		fnode = xmlNewChild (doc->children, NULL, (const guchar *)"Vcalendar", NULL);
+	return success;
+}
 
-		/* Should Evolution publicise these? */
-		xmlSetProp (fnode, (const guchar *)"xmlns:x-wr", (const guchar *)"http://www.w3.org/2002/12/cal/prod/Apple_Comp_628d9d8459c556fa#");
-		xmlSetProp (fnode, (const guchar *)"xmlns:x-lic", (const guchar *)"http://www.w3.org/2002/12/cal/prod/Apple_Comp_628d9d8459c556fa#");
+static gboolean
+rdf_begin (GOutputStream *stream,
+           ECalClient *client,
+           gpointer user_data,
+           GCancellable *cancellable,
+           GError **error)
+{
+	RdfData *rdf = user_data;
+	ESource *source;
+	xmlDocPtr doc;
+	xmlNodePtr fnode;
+	const gchar *content;
+	const gchar *tail;
+	gchar *temp = NULL;
+	gint indent_len;
+	gboolean success;
 
-		/* Not sure if it's correct like this */
-		xmlNewChild (fnode, NULL, (const guchar *)"prodid", (const guchar *)"-//" PACKAGE " " VERSION VERSION_SUBSTRING " " VERSION_COMMENT "//iCal 1.0//EN");
+	source = e_client_get_source (E_CLIENT (client));
 
-		/* Assuming GREGORIAN is the only supported calendar scale */
-		xmlNewChild (fnode, NULL, (const guchar *)"calscale", (const guchar *)"GREGORIAN");
+	rdf->buffer = xmlBufferCreate ();
+	rdf->doc = doc = xmlNewDoc ((xmlChar *) "1.0");
 
-		temp = calendar_config_get_timezone ();
-		xmlNewChild (fnode, NULL, (const guchar *)"x-wr:timezone", (guchar *) temp);
-		g_free (temp);
+	doc->children = xmlNewDocNode (doc, NULL, (const guchar *)"rdf:RDF", NULL);
+	xmlSetProp (doc->children, (const guchar *)"xmlns:rdf", (const guchar *)"http://www.w3.org/1999/02/22-rdf-syntax-ns#");
+	xmlSetProp (doc->children, (const guchar *)"xmlns", (const guchar *)"http://www.w3.org/2002/12/cal/ical#");
 
-		xmlNewChild (fnode, NULL, (const guchar *)"method", (const guchar *)"PUBLISH");
+	rdf->fnode = fnode = xmlNewChild (doc->children, NULL, (const guchar *)"Vcalendar", NULL);
 
-		xmlNewChild (fnode, NULL, (const guchar *)"x-wr:relcalid", (guchar *) e_source_get_uid (primary_source));
+	/* Should Evolution publicise these? */
+	xmlSetProp (fnode, (const guchar *)"xmlns:x-wr", (const guchar *)"http://www.w3.org/2002/12/cal/prod/Apple_Comp_628d9d8459c556fa#");
+	xmlSetProp (fnode, (const guchar *)"xmlns:x-lic", (const guchar *)"http://www.w3.org/2002/12/cal/prod/Apple_Comp_628d9d8459c556fa#");
 
-		xmlNewChild (fnode, NULL, (const guchar *)"x-wr:calname", (guchar *) e_source_get_display_name (primary_source));
+	/* Not sure if it's correct like this */
+	xmlNewChild (fnode, NULL, (const guchar *)"prodid", (const guchar *)"-//" PACKAGE " " VERSION VERSION_SUBSTRING " " VERSION_COMMENT "//iCal 1.0//EN");
 
-		/* Version of this RDF-format */
-		xmlNewChild (fnode, NULL, (const guchar *)"version", (const guchar *)"2.0");
+	/* Assuming GREGORIAN is the only supported calendar scale */
+	xmlNewChild (fnode, NULL, (const guchar *)"calscale", (const guchar *)"GREGORIAN");
 
-		for (iter = objects; iter; iter = iter->next) {
-			ECalComponent *comp = iter->data;
-			const gchar *temp_constchar;
-			gchar *tmp_str = NULL;
-			GSList *temp_list;
-			ECalComponentDateTime temp_dt;
-			struct icaltimetype *temp_time;
-			gint *temp_int;
-			ECalComponentText temp_comptext;
-			xmlNodePtr c_node = xmlNewChild (fnode, NULL, (const guchar *)"component", NULL);
-			xmlNodePtr node = xmlNewChild (c_node, NULL, (const guchar *)"Vevent", NULL);
+	temp = calendar_config_get_timezone ();
+	xmlNewChild (fnode, NULL, (const guchar *)"x-wr:timezone", (guchar *) temp);
+	g_free (temp);
 
-			/* Getting the stuff */
-			e_cal_component_get_uid (comp, &temp_constchar);
-			tmp_str = g_strdup_printf ("#%s", temp_constchar);
-			xmlSetProp (node, (const guchar *)"about", (guchar *) tmp_str);
-			g_free (tmp_str);
-			add_string_to_rdf (node, "uid",temp_constchar);
+	xmlNewChild (fnode, NULL, (const guchar *)"method", (const guchar *)"PUBLISH");
 
-			e_cal_component_get_summary (comp, &temp_comptext);
-			add_string_to_rdf (node, "summary", temp_comptext.value);
+	xmlNewChild (fnode, NULL, (const guchar *)"x-wr:relcalid", (guchar *) e_source_get_uid (source));
 
-			e_cal_component_get_description_list (comp, &temp_list);
-			add_list_to_rdf (node, "description", temp_list, ECALCOMPONENTTEXT);
-			if (temp_list)
-				e_cal_component_free_text_list (temp_list);
+	xmlNewChild (fnode, NULL, (const guchar *)"x-wr:calname", (guchar *) e_source_get_display_name (source));
 
-			e_cal_component_get_categories_list (comp, &temp_list);
-			add_list_to_rdf (node, "categories", temp_list, CONSTCHAR);
-			if (temp_list)
-				e_cal_component_free_categories_list (temp_list);
+	/* Version of this RDF-format */
+	xmlNewChild (fnode, NULL, (const guchar *)"version", (const guchar *)"2.0");
 
-			e_cal_component_get_comment_list (comp, &temp_list);
-			add_list_to_rdf (node, "comment", temp_list, ECALCOMPONENTTEXT);
+	/* I used a buffer rather than xmlDocDump: I want gio support */
+	xmlNodeDump (rdf->buffer, doc, doc->children, 2, 1);
 
-			if (temp_list)
-				e_cal_component_free_text_list (temp_list);
+	/* Split the document at the end of the Vcalendar node; the part
+	 * before is written now, the components are written one by one
+	 * and the rest is written at the end. */
+	content = (const gchar *) xmlBufferContent (rdf->buffer);
+	tail = g_strrstr (content, "</Vcalendar>");
+	g_return_val_if_fail (tail != NULL, FALSE);
 
-			e_cal_component_get_completed (comp, &temp_time);
-			add_time_to_rdf (node, "completed", temp_time);
-			if (temp_time)
-				e_cal_component_free_icaltimetype (temp_time);
+	/* Move to the beginning of the line with the end tag */
+	indent_len = 0;
+	while (tail > content && tail[-1] == ' ') {
+		tail--;
+		indent_len++;
+	}
 
-			e_cal_component_get_created (comp, &temp_time);
-			add_time_to_rdf (node, "created", temp_time);
-			if (temp_time)
-				e_cal_component_free_icaltimetype (temp_time);
+	rdf->tail = g_strdup (tail);
+	rdf->indent = g_strnfill (indent_len + 2, ' ');
 
-			e_cal_component_get_contact_list (comp, &temp_list);
-			add_list_to_rdf (node, "contact", temp_list, ECALCOMPONENTTEXT);
-			if (temp_list)
-				e_cal_component_free_text_list (temp_list);
+	success = g_output_stream_write_all (stream, content, tail - content, NULL, cancellable, error);
 
-			e_cal_component_get_dtstart (comp, &temp_dt);
-			add_time_to_rdf (node, "dtstart", temp_dt.value ? temp_dt.value : NULL);
-			e_cal_component_free_datetime (&temp_dt);
+	xmlBufferEmpty (rdf->buffer);
 
-			e_cal_component_get_dtend (comp, &temp_dt);
-			add_time_to_rdf (node, "dtend", temp_dt.value ? temp_dt.value : NULL);
-			e_cal_component_free_datetime (&temp_dt);
+	return success;
+}
 
-			e_cal_component_get_due (comp, &temp_dt);
-			add_time_to_rdf (node, "due", temp_dt.value ? temp_dt.value : NULL);
-			e_cal_component_free_datetime (&temp_dt);
+static gboolean
+rdf_write_component (GOutputStream *stream,
+                     ECalClient *client,
+                     icalcomponent *icalcomp,
+                     gpointer user_data,
+                     GCancellable *cancellable,
+                     GError **error)
+{
+	RdfData *rdf = user_data;
+	ECalComponent *comp;
+	const gchar *temp_constchar;
+	gchar *tmp_str = NULL;
+	GSList *temp_list;
+	ECalComponentDateTime temp_dt;
+	struct icaltimetype *temp_time;
+	gint *temp_int;
+	ECalComponentText temp_comptext;
+	xmlNodePtr c_node;
+	xmlNodePtr node;
+	gboolean success;
+
+	comp = e_cal_component_new_from_icalcomponent (icalcomponent_new_clone (icalcomp));
+	if (!comp)
+		return TRUE;
+
+	c_node = xmlNewChild (rdf->fnode, NULL, (const guchar *)"component", NULL);
+	node = xmlNewChild (c_node, NULL, (const guchar *)"Vevent", NULL);
+
+	/* Getting the stuff */
+	e_cal_component_get_uid (comp, &temp_constchar);
+	tmp_str = g_strdup_printf ("#%s", temp_constchar);
+	xmlSetProp (node, (const guchar *)"about", (guchar *) tmp_str);
+	g_free (tmp_str);
+	add_string_to_rdf (node, "uid",temp_constchar);
+
+	e_cal_component_get_summary (comp, &temp_comptext);
+	add_string_to_rdf (node, "summary", temp_comptext.value);
+
+	e_cal_component_get_description_list (comp, &temp_list);
+	add_list_to_rdf (node, "description", temp_list, ECALCOMPONENTTEXT);
+	if (temp_list)
+		e_cal_component_free_text_list (temp_list);
+
+	e_cal_component_get_categories_list (comp, &temp_list);
+	add_list_to_rdf (node, "categories", temp_list, CONSTCHAR);
+	if (temp_list)
+		e_cal_component_free_categories_list (temp_list);
+
+	e_cal_component_get_comment_list (comp, &temp_list);
+	add_list_to_rdf (node, "comment", temp_list, ECALCOMPONENTTEXT);
+
+	if (temp_list)
+		e_cal_component_free_text_list (temp_list);
+
+	e_cal_component_get_completed (comp, &temp_time);
+	add_time_to_rdf (node, "completed", temp_time);
+	if (temp_time)
+		e_cal_component_free_icaltimetype (temp_time);
+
+	e_cal_component_get_created (comp, &temp_time);
+	add_time_to_rdf (node, "created", temp_time);
+	if (temp_time)
+		e_cal_component_free_icaltimetype (temp_time);
+
+	e_cal_component_get_contact_list (comp, &temp_list);
+	add_list_to_rdf (node, "contact", temp_list, ECALCOMPONENTTEXT);
+	if (temp_list)
+		e_cal_component_free_text_list (temp_list);
+
+	e_cal_component_get_dtstart (comp, &temp_dt);
+	add_time_to_rdf (node, "dtstart", temp_dt.value ? temp_dt.value : NULL);
+	e_cal_component_free_datetime (&temp_dt);
+
+	e_cal_component_get_dtend (comp, &temp_dt);
+	add_time_to_rdf (node, "dtend", temp_dt.value ? temp_dt.value : NULL);
+	e_cal_component_free_datetime (&temp_dt);
+
+	e_cal_component_get_due (comp, &temp_dt);
+	add_time_to_rdf (node, "due", temp_dt.value ? temp_dt.value : NULL);
+	e_cal_component_free_datetime (&temp_dt);
+
+	e_cal_component_get_percent (comp, &temp_int);
+	add_nummeric_to_rdf (node, "percentComplete", temp_int);
+
+	e_cal_component_get_priority (comp, &temp_int);
+	add_nummeric_to_rdf (node, "priority", temp_int);
+
+	e_cal_component_get_url (comp, &temp_constchar);
+	add_string_to_rdf (node, "URL", temp_constchar);
+
+	if (e_cal_component_has_attendees (comp)) {
+		e_cal_component_get_attendee_list (comp, &temp_list);
+		add_list_to_rdf (node, "attendee", temp_list, ECALCOMPONENTATTENDEE);
+		if (temp_list)
+			e_cal_component_free_attendee_list (temp_list);
+	}
 
-			e_cal_component_get_percent (comp, &temp_int);
-			add_nummeric_to_rdf (node, "percentComplete", temp_int);
-
-			e_cal_component_get_priority (comp, &temp_int);
-			add_nummeric_to_rdf (node, "priority", temp_int);
+	e_cal_component_get_location (comp, &temp_constchar);
+	add_string_to_rdf (node, "location", temp_constchar);
 
-			e_cal_component_get_url (comp, &temp_constchar);
-			add_string_to_rdf (node, "URL", temp_constchar);
+	e_cal_component_get_last_modified (comp, &temp_time);
+	add_time_to_rdf (node, "lastModified",temp_time);
 
-			if (e_cal_component_has_attendees (comp)) {
-				e_cal_component_get_attendee_list (comp, &temp_list);
-				add_list_to_rdf (node, "attendee", temp_list, ECALCOMPONENTATTENDEE);
-				if (temp_list)
-					e_cal_component_free_attendee_list (temp_list);
-			}
+	/* Important note!
+	 * The documentation is not requiring this!
+	 *
+	 * if (temp_time) e_cal_component_free_icaltimetype (temp_time);
+	 *
+	 * Please uncomment and fix documentation if untrue
+	 * http://www.gnome.org/projects/evolution/developer-doc/libecal/ECalComponent.html
+	 *	#e-cal-component-get-last-modified
+	 */
 
-			e_cal_component_get_location (comp, &temp_constchar);
-			add_string_to_rdf (node, "location", temp_constchar);
-
-			e_cal_component_get_last_modified (comp, &temp_time);
-			add_time_to_rdf (node, "lastModified",temp_time);
-
-			/* Important note!
-			 * The documentation is not requiring this!
-			 *
-			 * if (temp_time) e_cal_component_free_icaltimetype (temp_time);
-			 *
-			 * Please uncomment and fix documentation if untrue
-			 * http://www.gnome.org/projects/evolution/developer-doc/libecal/ECalComponent.html
-			 *	#e-cal-component-get-last-modified
-			 */
-		}
+	/* The node is written and freed immediately, thus
+	 * the document never holds more than one component. */
+	xmlBufferCCat (rdf->buffer, rdf->indent);
+	xmlNodeDump (rdf->buffer, rdf->doc, c_node, strlen (rdf->indent) / 2, 1);
+	xmlBufferCCat (rdf->buffer, "\n");
 
-		/* I used a buffer rather than xmlDocDump: I want gio support */
-		xmlNodeDump (buffer, doc, doc->children, 2, 1);
+	xmlUnlinkNode (c_node);
+	xmlFreeNode (c_node);
+	g_object_unref (comp);
 
-		g_output_stream_write_all (stream, xmlBufferContent (buffer), xmlBufferLength (buffer), NULL, NULL, &error);
-		g_output_stream_close (stream, NULL, NULL);
+	success = rdf_flush_buffer (rdf, stream, cancellable, error);
 
-		e_cal_client_free_ecalcomp_slist (objects);
+	return success;
+}
 
-		xmlBufferFree (buffer);
-		xmlFreeDoc (doc);
-	}
+static gboolean
+rdf_end (GOutputStream *stream,
+         ECalClient *client,
+         gpointer user_data,
+         GCancellable *cancellable,
+         GError **error)
+{
+	RdfData *rdf = user_data;
 
-	if (stream)
-		g_object_unref (stream);
+	return g_output_stream_write_all (stream, rdf->tail, strlen (rdf->tail), NULL, cancellable, error);
+}
 
-	g_object_unref (source_client);
+static void
+do_save_calendar_rdf (FormatHandler *handler,
+                      ESourceSelector *selector,
+		      EClientCache *client_cache,
+                      gchar *dest_uri)
+{
+	if (!dest_uri)
+		return;
 
-	if (error != NULL) {
-		display_error_message (
-			gtk_widget_get_toplevel (GTK_WIDGET (selector)),
-			error->message);
-		g_error_free (error);
-	}
+	save_calendar_to_uri (
+		selector, client_cache, dest_uri,
+		rdf_begin, rdf_write_component, rdf_end,
+		g_new0 (RdfData, 1), rdf_data_free);
 }
 
 FormatHandler *
@@ -26,6 +26,7 @@
 
 #include <string.h>
 #include <glib/gi18n.h>
+#include <camel/camel.h>
 
 #include <shell/e-shell-sidebar.h>
 #include <shell/e-shell-view.h>
@@ -292,6 +293,411 @@ open_for_writing (GtkWindow *parent,
 	return NULL;
 }
 
+typedef struct _SaveCalendarData {
+	EClientCache *client_cache;
+	ESource *source;
+	gchar *extension_name;
+	GOutputStream *stream;
+	SaveCalendarStreamFunc begin_func;
+	SaveCalendarComponentFunc component_func;
+	SaveCalendarStreamFunc end_func;
+	gpointer user_data;
+	GDestroyNotify free_user_data;
+} SaveCalendarData;
+
+static void
+save_calendar_data_free (gpointer ptr)
+{
+	SaveCalendarData *scd = ptr;
+
+	if (scd) {
+		if (scd->free_user_data)
+			scd->free_user_data (scd->user_data);
+
+		g_clear_object (&scd->client_cache);
+		g_clear_object (&scd->source);
+		g_clear_object (&scd->stream);
+		g_free (scd->extension_name);
+		g_free (scd);
+	}
+}
+
+/* How many components the view can deliver ahead of the writer */
+#define SAVE_CALENDAR_MAX_QUEUED 256
+
+typedef struct _WriteComponentsData {
+	GOutputStream *stream;
+	ECalClient *client;
+	SaveCalendarComponentFunc component_func;
+	gpointer user_data;
+	GCancellable *cancellable;
+	GMainContext *main_context;
+
+	GMutex lock;
+	GCond cond;
+	GQueue queue;		/* icalcomponent *, waiting for the writer */
+	gboolean done;		/* the view delivered everything */
+	GError *error;
+
+	/* used by the writer thread only */
+	guint n_written;
+	gint64 last_report;
+	gboolean message_pushed;
+} WriteComponentsData;
+
+static void
+save_calendar_set_error (WriteComponentsData *wcd,
+			 GError *error)
+{
+	g_mutex_lock (&wcd->lock);
+
+	if (!wcd->error)
+		wcd->error = error;
+	else
+		g_error_free (error);
+
+	g_cond_broadcast (&wcd->cond);
+	g_mutex_unlock (&wcd->lock);
+
+	g_main_context_wakeup (wcd->main_context);
+}
+
+static void
+save_calendar_report_written (WriteComponentsData *wcd)
+{
+	gint64 now = g_get_monotonic_time ();
+
+	if (now - wcd->last_report < G_USEC_PER_SEC)
+		return;
+
+	wcd->last_report = now;
+
+	if (wcd->message_pushed)
+		camel_operation_pop_message (wcd->cancellable);
+
+	camel_operation_push_message (wcd->cancellable,
+		ngettext ("Saved %u component", "Saved %u components", wcd->n_written),
+		wcd->n_written);
+
+	wcd->message_pushed = TRUE;
+}
+
+static gpointer
+save_calendar_writer_thread (gpointer user_data)
+{
+	WriteComponentsData *wcd = user_data;
+
+	g_mutex_lock (&wcd->lock);
+
+	while (!wcd->error) {
+		icalcomponent *icalcomp;
+		GError *local_error = NULL;
+		gboolean success;
+
+		icalcomp = g_queue_pop_head (&wcd->queue);
+		if (!icalcomp) {
+			if (wcd->done)
+				break;
+
+			g_cond_wait (&wcd->cond, &wcd->lock);
+			continue;
+		}
+
+		/* There is a room for the view now */
+		g_cond_broadcast (&wcd->cond);
+		g_mutex_unlock (&wcd->lock);
+
+		success = !g_cancellable_set_error_if_cancelled (wcd->cancellable, &local_error) &&
+			wcd->component_func (wcd->stream, wcd->client, icalcomp, wcd->user_data, wcd->cancellable, &local_error);
+
+		icalcomponent_free (icalcomp);
+
+		if (success) {
+			wcd->n_written++;
+			save_calendar_report_written (wcd);
+		} else {
+			save_calendar_set_error (wcd, local_error ? local_error :
+				g_error_new_literal (G_IO_ERROR, G_IO_ERROR_FAILED, _("Failed to save a component")));
+		}
+
+		g_mutex_lock (&wcd->lock);
+	}
+
+	g_mutex_unlock (&wcd->lock);
+
+	if (wcd->message_pushed)
+		camel_operation_pop_message (wcd->cancellable);
+
+	return NULL;
+}
+
+static void
+save_calendar_objects_added_cb (ECalClientView *view,
+				const GSList *objects,
+				gpointer user_data)
+{
+	WriteComponentsData *wcd = user_data;
+	const GSList *link;
+
+	g_mutex_lock (&wcd->lock);
+
+	/* Changes made after the initial content was delivered are ignored */
+	for (link = objects; link && !wcd->done && !wcd->error; link = g_slist_next (link)) {
+		/* Do not read ahead of the writer too much */
+		while (g_queue_get_length (&wcd->queue) >= SAVE_CALENDAR_MAX_QUEUED && !wcd->error)
+			g_cond_wait (&wcd->cond, &wcd->lock);
+
+		if (!wcd->error) {
+			g_queue_push_tail (&wcd->queue, icalcomponent_new_clone (link->data));
+			g_cond_broadcast (&wcd->cond);
+		}
+	}
+
+	g_mutex_unlock (&wcd->lock);
+}
+
+static void
+save_calendar_complete_cb (ECalClientView *view,
+			   const GError *error,
+			   gpointer user_data)
+{
+	WriteComponentsData *wcd = user_data;
+
+	if (error)
+		save_calendar_set_error (wcd, g_error_copy (error));
+
+	g_mutex_lock (&wcd->lock);
+	wcd->done = TRUE;
+	g_cond_broadcast (&wcd->cond);
+	g_mutex_unlock (&wcd->lock);
+}
+
+static gboolean
+save_calendar_cancelled_cb (GCancellable *cancellable,
+			    gpointer user_data)
+{
+	WriteComponentsData *wcd = user_data;
+	GError *local_error = NULL;
+
+	if (g_cancellable_set_error_if_cancelled (cancellable, &local_error))
+		save_calendar_set_error (wcd, local_error);
+
+	return FALSE;
+}
+
+static gboolean
+save_calendar_view_running (WriteComponentsData *wcd)
+{
+	gboolean running;
+
+	g_mutex_lock (&wcd->lock);
+	running = !wcd->done && !wcd->error;
+	g_mutex_unlock (&wcd->lock);
+
+	return running;
+}
+
+/* Writes the components as the view delivers them, thus the calendar is
+ * read only once and only few components are in memory at a time. The
+ * writing is done in another thread, which the view waits for, when it
+ * gets SAVE_CALENDAR_MAX_QUEUED components ahead of it. */
+static gboolean
+save_calendar_write_components_sync (ECalClient *client,
+				     GOutputStream *stream,
+				     SaveCalendarComponentFunc component_func,
+				     gpointer user_data,
+				     GCancellable *cancellable,
+				     GError **error)
+{
+	ECalClientView *view = NULL;
+	WriteComponentsData wcd;
+	GSource *cancel_source;
+	GThread *writer;
+	GError *local_error = NULL;
+
+	memset (&wcd, 0, sizeof (WriteComponentsData));
+	wcd.stream = stream;
+	wcd.client = client;
+	wcd.component_func = component_func;
+	wcd.user_data = user_data;
+	wcd.cancellable = cancellable;
+	g_mutex_init (&wcd.lock);
+	g_cond_init (&wcd.cond);
+	g_queue_init (&wcd.queue);
+
+	/* The view notifies in the main context it was created in. */
+	wcd.main_context = g_main_context_new ();
+	g_main_context_push_thread_default (wcd.main_context);
+
+	if (!e_cal_client_get_view_sync (client, "#t", &view, cancellable, error)) {
+		g_main_context_pop_thread_default (wcd.main_context);
+		g_main_context_unref (wcd.main_context);
+		g_mutex_clear (&wcd.lock);
+		g_cond_clear (&wcd.cond);
+		return FALSE;
+	}
+
+	writer = g_thread_new ("save-calendar-writer", save_calendar_writer_thread, &wcd);
+
+	g_signal_connect (view, "objects-added", G_CALLBACK (save_calendar_objects_added_cb), &wcd);
+	g_signal_connect (view, "complete", G_CALLBACK (save_calendar_complete_cb), &wcd);
+
+	cancel_source = g_cancellable_source_new (cancellable);
+	g_source_set_callback (cancel_source, (GSourceFunc) save_calendar_cancelled_cb, &wcd, NULL);
+	g_source_attach (cancel_source, wcd.main_context);
+
+	e_cal_client_view_start (view, &local_error);
+	if (local_error)
+		save_calendar_set_error (&wcd, local_error);
+
+	while (save_calendar_view_running (&wcd))
+		g_main_context_iteration (wcd.main_context, TRUE);
+
+	g_source_destroy (cancel_source);
+	g_source_unref (cancel_source);
+
+	g_signal_handlers_disconnect_by_data (view, &wcd);
+	e_cal_client_view_stop (view, NULL);
+	g_object_unref (view);
+
+	/* Let the writer store what is queued, unless it failed */
+	g_mutex_lock (&wcd.lock);
+	wcd.done = TRUE;
+	g_cond_broadcast (&wcd.cond);
+	g_mutex_unlock (&wcd.lock);
+
+	g_thread_join (writer);
+
+	g_main_context_pop_thread_default (wcd.main_context);
+	g_main_context_unref (wcd.main_context);
+
+	g_queue_free_full (&wcd.queue, (GDestroyNotify) icalcomponent_free);
+	g_mutex_clear (&wcd.lock);
+	g_cond_clear (&wcd.cond);
+
+	if (!wcd.error)
+		g_cancellable_set_error_if_cancelled (cancellable, &wcd.error);
+
+	if (wcd.error) {
+		g_propagate_error (error, wcd.error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+save_calendar_thread (EAlertSinkThreadJobData *job_data,
+		      gpointer user_data,
+		      GCancellable *cancellable,
+		      GError **error)
+{
+	SaveCalendarData *scd = user_data;
+	EClient *client;
+	gboolean success;
+
+	client = e_client_cache_get_client_sync (scd->client_cache,
+		scd->source, scd->extension_name, 30, cancellable, error);
+
+	if (!client) {
+		g_output_stream_close (scd->stream, NULL, NULL);
+		return;
+	}
+
+	success = (!scd->begin_func || scd->begin_func (scd->stream, E_CAL_CLIENT (client), scd->user_data, cancellable, error)) &&
+		save_calendar_write_components_sync (E_CAL_CLIENT (client), scd->stream, scd->component_func, scd->user_data, cancellable, error) &&
+		(!scd->end_func || scd->end_func (scd->stream, E_CAL_CLIENT (client), scd->user_data, cancellable, error));
+
+	if (success)
+		g_output_stream_close (scd->stream, cancellable, error);
+	else
+		g_output_stream_close (scd->stream, NULL, NULL);
+
+	g_object_unref (client);
+}
+
+/* Asks for the file overwrite in the main thread, then writes the calendar
+ * of the primary selection in the @selector into the @dest_uri in a dedicated
+ * thread. The components are written one after another, as a calendar view
+ * delivers them, with the number of the written components shown in the shell
+ * view. The @free_user_data is called in the main thread once the job is done. */
+void
+save_calendar_to_uri (ESourceSelector *selector,
+		      EClientCache *client_cache,
+		      const gchar *dest_uri,
+		      SaveCalendarStreamFunc begin_func,
+		      SaveCalendarComponentFunc component_func,
+		      SaveCalendarStreamFunc end_func,
+		      gpointer user_data,
+		      GDestroyNotify free_user_data)
+{
+	SaveCalendarData *scd;
+	EShellWindow *shell_window;
+	EShellView *shell_view;
+	EActivity *activity;
+	GtkWidget *toplevel;
+	GOutputStream *stream;
+	ESource *source;
+	gchar *description;
+	GError *error = NULL;
+
+	g_return_if_fail (E_IS_SOURCE_SELECTOR (selector));
+	g_return_if_fail (E_IS_CLIENT_CACHE (client_cache));
+	g_return_if_fail (dest_uri != NULL);
+	g_return_if_fail (component_func != NULL);
+
+	toplevel = gtk_widget_get_toplevel (GTK_WIDGET (selector));
+
+	if (!E_IS_SHELL_WINDOW (toplevel)) {
+		g_warn_if_reached ();
+
+		if (free_user_data)
+			free_user_data (user_data);
+		return;
+	}
+
+	stream = open_for_writing (GTK_WINDOW (toplevel), dest_uri, &error);
+
+	if (!stream) {
+		if (error) {
+			e_alert_run_dialog_for_args (
+				GTK_WINDOW (toplevel), "system:simple-error",
+				error->message, NULL);
+			g_clear_error (&error);
+		}
+
+		if (free_user_data)
+			free_user_data (user_data);
+		return;
+	}
+
+	shell_window = E_SHELL_WINDOW (toplevel);
+	shell_view = e_shell_window_get_shell_view (shell_window,
+		e_shell_window_get_active_view (shell_window));
+
+	source = e_source_selector_ref_primary_selection (selector);
+
+	scd = g_new0 (SaveCalendarData, 1);
+	scd->client_cache = g_object_ref (client_cache);
+	scd->source = source;
+	scd->extension_name = g_strdup (e_source_selector_get_extension_name (selector));
+	scd->stream = stream;
+	scd->begin_func = begin_func;
+	scd->component_func = component_func;
+	scd->end_func = end_func;
+	scd->user_data = user_data;
+	scd->free_user_data = free_user_data;
+
+	description = g_strdup_printf (_("Saving “%s”"), e_source_get_display_name (source));
+
+	activity = e_shell_view_submit_thread_job (shell_view, description,
+		"system:simple-error", NULL, save_calendar_thread,
+		scd, save_calendar_data_free);
+
+	g_clear_object (&activity);
+	g_free (description);
+}
+
 static void
 save_general (EShellView *shell_view)
 {
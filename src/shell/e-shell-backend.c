@@ -645,9 +645,22 @@ e_shell_backend_start (EShellBackend *shell_backend)
 
 	class = E_SHELL_BACKEND_GET_CLASS (shell_backend);
 
-	if (class->start != NULL)
+	if (class->start != NULL) {
+		EStartupTraceSpan *trace_span = NULL;
+
+		if (e_startup_trace_is_enabled ()) {
+			gchar *span_name;
+
+			span_name = g_strdup_printf ("%s backend start", class->name);
+			trace_span = e_startup_trace_begin ("shell", span_name);
+			g_free (span_name);
+		}
+
 		class->start (shell_backend);
 
+		e_startup_trace_end (trace_span);
+	}
+
 	shell_backend->priv->started = TRUE;
 }
 
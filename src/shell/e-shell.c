@@ -68,6 +68,7 @@ struct _EShellPrivate {
 	gchar *module_directory;
 
 	guint inhibit_cookie;
+	guint startup_trace_registration_id;
 	guint set_online_timeout_id;
 	guint prepare_quit_timeout_id;
 
@@ -269,6 +270,58 @@ shell_action_quit_cb (GSimpleAction *action,
 	e_shell_quit (shell, E_SHELL_QUIT_REMOTE_REQUEST);
 }
 
+/* Lets the process which asked for the startup trace summary
+ * get it back, rather than having it printed by this process. */
+#define SHELL_STARTUP_TRACE_INTERFACE "org.gnome.Evolution.StartupTrace"
+
+static const gchar shell_startup_trace_introspection_xml[] =
+	"<node>"
+	"  <interface name='" SHELL_STARTUP_TRACE_INTERFACE "'>"
+	"    <method name='DumpSummary'>"
+	"      <arg type='s' name='summary' direction='out'/>"
+	"    </method>"
+	"  </interface>"
+	"</node>";
+
+static void
+shell_startup_trace_method_call_cb (GDBusConnection *connection,
+                                    const gchar *sender,
+                                    const gchar *object_path,
+                                    const gchar *interface_name,
+                                    const gchar *method_name,
+                                    GVariant *parameters,
+                                    GDBusMethodInvocation *invocation,
+                                    gpointer user_data)
+{
+	gchar *summary;
+	GError *local_error = NULL;
+
+	if (g_strcmp0 (method_name, "DumpSummary") != 0) {
+		g_dbus_method_invocation_return_error (
+			invocation, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD,
+			"Unknown method '%s'", method_name);
+		return;
+	}
+
+	if (!e_startup_trace_flush (&local_error)) {
+		g_warning ("%s: %s", G_STRFUNC, local_error ? local_error->message : "Unknown error");
+		g_clear_error (&local_error);
+	}
+
+	summary = e_startup_trace_dup_summary ();
+
+	g_dbus_method_invocation_return_value (
+		invocation, g_variant_new ("(s)", summary ? summary : ""));
+
+	g_free (summary);
+}
+
+static const GDBusInterfaceVTable shell_startup_trace_vtable = {
+	shell_startup_trace_method_call_cb,
+	NULL,
+	NULL
+};
+
 static void
 shell_add_actions (GApplication *application)
 {
@@ -1619,6 +1672,52 @@ shell_shutdown (GApplication *application)
 	G_APPLICATION_CLASS (e_shell_parent_class)->shutdown (application);
 }
 
+static gboolean
+shell_dbus_register (GApplication *application,
+                     GDBusConnection *connection,
+                     const gchar *object_path,
+                     GError **error)
+{
+	EShell *shell;
+	GDBusNodeInfo *node_info;
+
+	shell = E_SHELL (application);
+
+	/* Chain up to parent's method. */
+	if (!G_APPLICATION_CLASS (e_shell_parent_class)->dbus_register (application, connection, object_path, error))
+		return FALSE;
+
+	node_info = g_dbus_node_info_new_for_xml (shell_startup_trace_introspection_xml, error);
+	if (!node_info)
+		return FALSE;
+
+	shell->priv->startup_trace_registration_id = g_dbus_connection_register_object (
+		connection, object_path, node_info->interfaces[0],
+		&shell_startup_trace_vtable, shell, NULL, error);
+
+	g_dbus_node_info_unref (node_info);
+
+	return shell->priv->startup_trace_registration_id != 0;
+}
+
+static void
+shell_dbus_unregister (GApplication *application,
+                       GDBusConnection *connection,
+                       const gchar *object_path)
+{
+	EShell *shell;
+
+	shell = E_SHELL (application);
+
+	if (shell->priv->startup_trace_registration_id) {
+		g_dbus_connection_unregister_object (connection, shell->priv->startup_trace_registration_id);
+		shell->priv->startup_trace_registration_id = 0;
+	}
+
+	/* Chain up to parent's method. */
+	G_APPLICATION_CLASS (e_shell_parent_class)->dbus_unregister (application, connection, object_path);
+}
+
 static void
 shell_activate (GApplication *application)
 {
@@ -1677,6 +1776,7 @@ shell_initable_init (GInitable *initable,
 	EShell *shell = E_SHELL (initable);
 	ESourceRegistry *registry;
 	ESource *proxy_source;
+	EStartupTraceSpan *trace_span;
 	gulong handler_id;
 
 	shell_add_actions (application);
@@ -1684,7 +1784,10 @@ shell_initable_init (GInitable *initable,
 	if (!g_application_register (application, cancellable, error))
 		return FALSE;
 
+	trace_span = e_startup_trace_begin ("shell", "e_source_registry_new_sync");
 	registry = e_source_registry_new_sync (cancellable, error);
+	e_startup_trace_end (trace_span);
+
 	if (registry == NULL)
 		return FALSE;
 
@@ -1752,6 +1855,8 @@ e_shell_class_init (EShellClass *class)
 	application_class->startup = shell_startup;
 	application_class->shutdown = shell_shutdown;
 	application_class->activate = shell_activate;
+	application_class->dbus_register = shell_dbus_register;
+	application_class->dbus_unregister = shell_dbus_unregister;
 
 	gtk_application_class = GTK_APPLICATION_CLASS (class);
 	gtk_application_class->window_added = shell_window_added;
@@ -2850,3 +2955,58 @@ e_shell_requires_shutdown (EShell *shell)
 
 	return shell->priv->requires_shutdown;
 }
+
+/**
+ * e_shell_dup_remote_startup_trace_summary:
+ * @shell: an #EShell
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Asks the primary instance, when the @shell is a remote instance, for
+ * the counters of its startup trace, and saves the trace file of the
+ * primary instance, if it records one.  See e_startup_trace_dup_summary().
+ *
+ * Free the returned string with g_free(), when no longer needed.
+ *
+ * Returns: (transfer full) (nullable): the startup trace summary of
+ *    the primary instance, or %NULL on error
+ *
+ * Since: 3.28
+ **/
+gchar *
+e_shell_dup_remote_startup_trace_summary (EShell *shell,
+                                          GCancellable *cancellable,
+                                          GError **error)
+{
+	GApplication *application;
+	GDBusConnection *connection;
+	GVariant *result;
+	gchar *summary = NULL;
+
+	g_return_val_if_fail (E_IS_SHELL (shell), NULL);
+
+	application = G_APPLICATION (shell);
+
+	connection = g_application_get_dbus_connection (application);
+	if (!connection || !g_application_get_is_remote (application)) {
+		g_set_error_literal (
+			error, G_IO_ERROR, G_IO_ERROR_NOT_CONNECTED,
+			_("No running Evolution instance"));
+		return NULL;
+	}
+
+	result = g_dbus_connection_call_sync (
+		connection,
+		g_application_get_application_id (application),
+		g_application_get_dbus_object_path (application),
+		SHELL_STARTUP_TRACE_INTERFACE, "DumpSummary",
+		NULL, G_VARIANT_TYPE ("(s)"),
+		G_DBUS_CALL_FLAGS_NONE, -1, cancellable, error);
+
+	if (result) {
+		g_variant_get (result, "(s)", &summary);
+		g_variant_unref (result);
+	}
+
+	return summary;
+}
@@ -147,6 +147,10 @@ gboolean	e_shell_quit			(EShell *shell,
 						 EShellQuitReason reason);
 void		e_shell_cancel_quit		(EShell *shell);
 gboolean	e_shell_requires_shutdown	(EShell *shell);
+gchar *		e_shell_dup_remote_startup_trace_summary
+						(EShell *shell,
+						 GCancellable *cancellable,
+						 GError **error);
 
 G_END_DECLS
 
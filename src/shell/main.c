@@ -97,8 +97,10 @@ static gboolean disable_eplugin = FALSE;
 static gboolean disable_preview = FALSE;
 static gboolean import_uris = FALSE;
 static gboolean quit = FALSE;
+static gboolean dump_startup_trace = FALSE;
 
 static gchar *geometry = NULL;
+static gchar *startup_trace_filename = NULL;
 static gchar *requested_view = NULL;
 static gchar **remaining_args;
 
@@ -251,6 +253,8 @@ idle_cb (const gchar * const *uris)
 
 	shell = e_shell_get_default ();
 
+	e_startup_trace_mark ("shell", "main loop running");
+
 	/* These calls do the right thing when another Evolution
 	 * process is running. */
 	if (uris != NULL && *uris != NULL) {
@@ -258,6 +262,7 @@ idle_cb (const gchar * const *uris)
 			gtk_main_quit ();
 	} else {
 		e_shell_create_shell_window (shell, requested_view);
+		e_startup_trace_mark ("shell", "shell window created");
 	}
 
 	/* If another Evolution process is running, we're done. */
@@ -336,6 +341,10 @@ static GOptionEntry entries[] = {
 	  N_("Import URIs or filenames given as rest of arguments."), NULL },
 	{ "quit", 'q', 0, G_OPTION_ARG_NONE, &quit,
 	  N_("Request a running Evolution process to quit"), NULL },
+	{ "startup-trace", '\0', 0, G_OPTION_ARG_FILENAME, &startup_trace_filename,
+	  N_("Record a timeline of the startup and save it as a Chrome trace into FILE"), "FILE" },
+	{ "dump-startup-trace", '\0', 0, G_OPTION_ARG_NONE, &dump_startup_trace,
+	  N_("Print the startup trace counters of a running Evolution process"), NULL },
 	{ "version", 'v', G_OPTION_FLAG_HIDDEN | G_OPTION_FLAG_NO_ARG,
 	  G_OPTION_ARG_CALLBACK, option_version_cb, NULL, NULL },
 	{ G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_STRING_ARRAY,
@@ -435,6 +444,7 @@ main (gint argc,
 #ifdef DEVELOPMENT
 	gboolean skip_warning_dialog;
 #endif
+	EStartupTraceSpan *trace_span;
 	gboolean success;
 	GError *error = NULL;
 
@@ -545,6 +555,14 @@ main (gint argc,
 	if (force_shutdown)
 		shell_force_shutdown ();
 
+	/* The trace is opt-in, either from the command line or through
+	 * the environment, to be able to trace also D-Bus activation. */
+	if (!startup_trace_filename && g_getenv ("EVOLUTION_STARTUP_TRACE"))
+		startup_trace_filename = g_strdup (g_getenv ("EVOLUTION_STARTUP_TRACE"));
+
+	if (startup_trace_filename && *startup_trace_filename && !dump_startup_trace)
+		e_startup_trace_enable (startup_trace_filename);
+
 	if (disable_preview) {
 		settings = e_util_ref_settings ("org.gnome.evolution.mail");
 		g_settings_set_boolean (settings, "safe-list", TRUE);
@@ -612,6 +630,22 @@ main (gint argc,
 		goto exit;
 	}
 
+	if (dump_startup_trace) {
+		gchar *summary;
+
+		/* The summary is returned by the running instance and
+		 * printed here, where it was asked for. */
+		summary = e_shell_dup_remote_startup_trace_summary (shell, NULL, &error);
+		if (summary) {
+			g_print ("%s", summary);
+			g_free (summary);
+		} else {
+			g_printerr ("%s: Failed to get the startup trace: %s\n", argv[0], error ? error->message : "Unknown error");
+			g_clear_error (&error);
+		}
+		goto exit;
+	}
+
 	if (g_application_get_is_remote (G_APPLICATION (shell))) {
 		if (remaining_args && *remaining_args)
 			e_shell_handle_uris (shell, (const gchar * const *) remaining_args, import_uris);
@@ -641,10 +675,17 @@ main (gint argc,
 	 *           files and directories under XDG_DATA_HOME.  Without
 	 *           this the mail conversion will not trigger for users
 	 *           upgrading from Evolution 2.30 or older. */
+	trace_span = e_startup_trace_begin ("shell", "e_migrate_base_dirs");
 	e_migrate_base_dirs (shell);
+	e_startup_trace_end (trace_span);
+
+	trace_span = e_startup_trace_begin ("shell", "e_convert_local_mail");
 	e_convert_local_mail (shell);
+	e_startup_trace_end (trace_span);
 
+	trace_span = e_startup_trace_begin ("shell", "e_shell_load_modules");
 	e_shell_load_modules (shell);
+	e_startup_trace_end (trace_span);
 
 	if (!disable_eplugin) {
 		/* Register built-in plugin hook types. */
@@ -653,14 +694,20 @@ main (gint argc,
 
 		/* All EPlugin and EPluginHook subclasses should be
 		 * registered in GType now, so load plugins now. */
+		trace_span = e_startup_trace_begin ("shell", "e_plugin_load_plugins");
 		e_plugin_load_plugins ();
+		e_startup_trace_end (trace_span);
 	}
 
 	/* Attempt migration -after- loading all modules and plugins,
 	 * as both shell backends and certain plugins hook into this. */
+	trace_span = e_startup_trace_begin ("shell", "e_shell_migrate_attempt");
 	e_shell_migrate_attempt (shell);
+	e_startup_trace_end (trace_span);
 
+	trace_span = e_startup_trace_begin ("shell", "ready-to-start");
 	e_shell_event (shell, "ready-to-start", NULL);
+	e_startup_trace_end (trace_span);
 
 	g_idle_add ((GSourceFunc) idle_cb, remaining_args);
 
@@ -687,6 +734,13 @@ exit:
 
 	gtk_accel_map_save (e_get_accels_filename ());
 
+	if (!e_startup_trace_flush (&error)) {
+		g_warning ("Failed to write startup trace: %s", error ? error->message : "Unknown error");
+		g_clear_error (&error);
+	}
+
+	g_free (startup_trace_filename);
+
 	e_util_cleanup_settings ();
 	e_spell_checker_free_global_memory ();
 